@@ -31,6 +31,7 @@ typedef struct
 Task_stat prev_stat[MAX_TASK_COUNT];
 
 void ShowTaskStatistics(void);
+void ShowTaskHistograms(void);
 
 static __inline__ UINT32 clz(UINT32 input)
 {
@@ -67,8 +68,12 @@ void StatisticsTaskFn(void * ptr)
 		printf("\n\nSTAT: Total CPU %2u.%02u\%\, Max Scheduler Time %u us", 
 			int_part, dec_part, os_stat.max_scheduler_elapsed_us);
 		
+		printf("\nSTAT: Max MMU Switch Time %u us, Page Table Switches %u / %u", 
+			os_stat.max_mmu_switch_elapsed_us, os_stat.ptable_switch_counter, os_stat.schedule_counter);
+		
 		// Show task specific statistics
 		ShowTaskStatistics();
+		ShowTaskHistograms();
 	}
 }
 
@@ -135,6 +140,88 @@ void ShowTaskStatistics()
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Returns the upper bound (in us) of the histogram bin where the given fraction 
+// of the samples is reached. Bin n has the values up to 2^n - 1 us
+///////////////////////////////////////////////////////////////////////////////
+static UINT32 GetPercentile(const UINT32 * histogram, UINT32 count, UINT32 percent)
+{
+	UINT32 bin, sum = 0;
+	UINT32 target = (UINT32)(((UINT64) count * percent + 99) / 100);
+	
+	for(bin = 0; bin < OS_HISTOGRAM_BINS - 1; bin++)
+	{
+		sum += histogram[bin];
+		if(sum >= target) break;
+	}
+	
+	return (1 << bin) - 1;
+}
+
+static void PrintHistogram(const char * title, const UINT32 * histogram)
+{
+	int bin, last = -1;
+	
+	for(bin = 0; bin < OS_HISTOGRAM_BINS; bin++)
+	{
+		if(histogram[bin]) last = bin;
+	}
+	
+	// Counts of the bins from < 1us up to the last one used
+	printf("\n     %s", title);
+	for(bin = 0; bin <= last; bin++)
+	{
+		printf(" %u", histogram[bin]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Shows the distribution of the response times and the start jitter of the
+// periodic tasks. The percentiles are the bin limits, so they are upper bounds
+///////////////////////////////////////////////////////////////////////////////
+void ShowTaskHistograms()
+{
+	int i, bin;
+	UINT32 mask, count, started;
+	OS_TaskHistograms hist;
+	
+	printf("\nId     Jobs  Resp p50 / p99 / max (us)   Jitter p50 / p99 / max (us)");
+	
+	for(i = MAX_INDEX - 1; i >= 0; i--)
+	{
+		mask = g_task_alloc_mask[i];
+		while(mask)
+		{
+			UINT32 item = (i << 5) + (31 - clz(mask));
+			mask &= ~(1 << (item & 0x1f));
+			
+			if(OS_GetTaskHistograms((OS_Task_t)item, &hist) != SUCCESS)
+				continue;
+			
+			for(count = 0, started = 0, bin = 0; bin < OS_HISTOGRAM_BINS; bin++)
+			{
+				count += hist.response_time[bin];
+				started += hist.start_jitter[bin];
+			}
+			
+			// Not a periodic task or no job completed so far
+			if(!count)
+				continue;
+			
+			printf("\n[%2u] %8u  %8u %8u %8u   %8u %8u %8u", item, count,
+				GetPercentile(hist.response_time, count, 50), 
+				GetPercentile(hist.response_time, count, 99), 
+				hist.max_response_time_us,
+				GetPercentile(hist.start_jitter, started, 50), 
+				GetPercentile(hist.start_jitter, started, 99), 
+				hist.max_start_jitter_us);
+			
+			PrintHistogram("resp:  ", hist.response_time);
+			PrintHistogram("jitter:", hist.start_jitter);
+		}
+	}
+}
+
 int main(int argc, char *argv[])
 {
     OS_CreatePeriodicTask(STAT_TASK_PERIOD, STAT_TASK_PERIOD, 
@@ -0,0 +1,12 @@
+SOURCE_DIRS	:=	
+
+## The receiver and the sender of the benchmark are two images built from here.
+## APP=msgq_bench builds the receiver and APP=msgq_bench_tx the sender. They share
+## the linker script and the sender is loaded above the receiver
+ifeq ($(APP), msgq_bench_tx)
+	APP_ORIGIN	:=	0x21500000
+else
+	APP_ORIGIN	:=	0x21300000
+endif
+
+SOURCES		+=	 $(APP).c $(foreach srcdir, $(SOURCE_DIRS), $(wildcard $(srcdir)/*.c))
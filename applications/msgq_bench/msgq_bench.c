@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	msgq_bench.c
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Message queue throughput between two processes
+//		This process creates the queue and receives. msgq_bench_tx sends as fast
+//		as it can from an aperiodic task of a lower priority. So every message
+//		switches to the receiver process and back, which is the worst case.
+//		The messages received in each second are printed along with the
+//		messages that came out of order or with a wrong payload.
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#include "os_api.h"
+#include "printf.h"
+#include "msgq_bench.h"
+
+#define REPORT_PERIOD		1000000		// 1 sec
+
+static OS_MsgQueue_t g_queue;
+
+static OS_Task_t g_rx_task;
+static OS_Task_t g_report_task;
+static UINT32 g_rx_stack[0x400];
+static UINT32 g_report_stack[0x400];
+
+static volatile UINT32 g_received;
+static volatile UINT32 g_errors;
+static UINT32 g_last_received;
+
+void ReceiveTaskFn(void * ptr)
+{
+	UINT32 expected = 0;
+	BenchMsg * msg;
+	OS_Return ret;
+	int i;
+	
+	while(1)
+	{
+		ret = OS_MsgQueueReceive(g_queue, (void **) &msg);
+		if(ret != SUCCESS)
+		{
+			printf("\nMSGQ: Receive failed %d", ret);
+			break;
+		}
+		
+		// The message is read in place
+		if(msg->seq != expected) g_errors++;
+		for(i = 0; i < MSGQ_BENCH_WORDS; i++)
+		{
+			if(msg->payload[i] != (msg->seq ^ i)) 
+			{
+				g_errors++;
+				break;
+			}
+		}
+		
+		expected = msg->seq + 1;
+		
+		OS_MsgQueueRelease(g_queue, msg);
+		g_received++;
+	}
+}
+
+void ReportTaskFn(void * ptr)
+{
+	UINT32 received = g_received;
+	
+	printf("\nMSGQ: %u msgs/s, %u errors", received - g_last_received, g_errors);
+	g_last_received = received;
+}
+
+int main(int argc, char *argv[])
+{
+	OS_Return ret;
+	
+	do
+	{
+		ret = OS_MsgQueueCreate(MSGQ_BENCH_NAME, sizeof(BenchMsg), MSGQ_BENCH_SLOTS, &g_queue);
+		if(ret != SUCCESS) break;
+		
+		ret = OS_CreateAperiodicTask(TASK_PRIORITY_HIGH, g_rx_stack, sizeof(g_rx_stack), 
+									"MSGQ RX", &g_rx_task, ReceiveTaskFn, NULL);
+		if(ret != SUCCESS) break;
+		
+		ret = OS_CreatePeriodicTask(REPORT_PERIOD, REPORT_PERIOD, 5000, 0, 
+									g_report_stack, sizeof(g_report_stack), 
+									"MSGQ REPORT", &g_report_task, ReportTaskFn, NULL);
+		if(ret != SUCCESS) break;
+		
+	} while(0);
+	
+	return ret;
+}
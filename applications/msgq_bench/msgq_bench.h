@@ -0,0 +1,26 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	msgq_bench.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Message layout shared by msgq_bench and msgq_bench_tx
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _MSGQ_BENCH_H
+#define _MSGQ_BENCH_H
+
+#include "os_api.h"
+
+#define MSGQ_BENCH_NAME			"BENCH"
+#define MSGQ_BENCH_SLOTS		64
+#define MSGQ_BENCH_WORDS		15
+
+typedef struct
+{
+	UINT32 seq;
+	UINT32 payload[MSGQ_BENCH_WORDS];		// payload[i] = seq ^ i
+	
+} BenchMsg;
+
+#endif // _MSGQ_BENCH_H
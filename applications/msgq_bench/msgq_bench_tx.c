@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	msgq_bench_tx.c
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Sender for the message queue throughput test. See msgq_bench.c
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#include "os_api.h"
+#include "printf.h"
+#include "msgq_bench.h"
+
+static OS_Task_t g_tx_task;
+static UINT32 g_tx_stack[0x400];
+
+void SendTaskFn(void * ptr)
+{
+	OS_MsgQueue_t queue;
+	UINT32 seq = 0;
+	BenchMsg * msg;
+	OS_Return ret;
+	int i;
+	
+	// The receiver may not have created the queue yet
+	while(OS_MsgQueueOpen(MSGQ_BENCH_NAME, &queue) != SUCCESS)
+	{
+		OS_TaskYield();
+	}
+	
+	while(1)
+	{
+		// The receiver has not released any slot yet
+		ret = OS_MsgQueueAlloc(queue, (void **) &msg);
+		if(ret == RESOURCE_EXHAUSTED)
+		{
+			OS_TaskYield();
+			continue;
+		}
+		else if(ret != SUCCESS)
+		{
+			printf("\nMSGQ: Alloc failed %d", ret);
+			break;
+		}
+		
+		// The message is written in place
+		msg->seq = seq;
+		for(i = 0; i < MSGQ_BENCH_WORDS; i++)
+		{
+			msg->payload[i] = seq ^ i;
+		}
+		
+		ret = OS_MsgQueueSend(queue, msg);
+		if(ret != SUCCESS)
+		{
+			printf("\nMSGQ: Send failed %d", ret);
+			break;
+		}
+		
+		seq++;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	return OS_CreateAperiodicTask(TASK_PRIORITY_LOW, g_tx_stack, sizeof(g_tx_stack), 
+									"MSGQ TX", &g_tx_task, SendTaskFn, NULL);
+}
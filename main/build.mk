@@ -2,4 +2,7 @@
 ##
 ## SOURCES		+=	$(foreach srcdir, $(SOURCE_DIRS), $(wildcard $(srcdir)/*.c))
 
-SOURCES	+=	main/main.c
\ No newline at end of file
+SOURCES	+=	main/main.c
+
+## The static schedule table generated by tools/schedgen (OS_STATIC_SCHEDULE)
+SOURCES	+=	$(wildcard main/schedule_table.c)
\ No newline at end of file
@@ -17,6 +17,7 @@
 //#define TEST_SRT
 //#define TEST_APERIODIC
 //#define TEST_RTC
+//#define TEST_MSGQ
 #define TEST_G2D
 
 OS_Process_t test_proc;
@@ -156,6 +157,11 @@ int main(int argc, char *argv[])
 	OS_CreateProcessFromFile(&test_rtc, "test_rtc", ADMIN_PROCESS, "applications/bin/test_rtc.elf", NULL);
 #endif
 
+#if defined(TEST_MSGQ)
+	OS_CreateProcessFromFile(&test_proc1, "msgq_bench", 0, "applications/bin/msgq_bench.elf", NULL);
+	OS_CreateProcessFromFile(&test_proc2, "msgq_bench_tx", 0, "applications/bin/msgq_bench_tx.elf", NULL);
+#endif
+
 #if defined(TEST_G2D)
 	OS_CreateProcessFromFile(&test_g2d, "test_g2d", ADMIN_PROCESS, "applications/bin/G2D.elf", NULL);
 #endif
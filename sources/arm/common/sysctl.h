@@ -47,6 +47,13 @@ void _sysctl_clean_invalidate_dcache_range(void *start, void *end);
 //----------------------------------------------------------------------------------------
 void _sysctl_wait_for_interrupt(void);
 
+#if OS_WITH_VFP==1
+	void _sysctl_vfp_init(void);
+	void _sysctl_vfp_enable(BOOL enable);
+	void _sysctl_vfp_save(void * context);
+	void _sysctl_vfp_restore(const void * context);
+#endif
+
 #if ENABLE_L2_CACHE==1
 	void _sysctl_enable_l2cache(void);
 	void _sysctl_disable_l2cache(void);
@@ -35,7 +35,7 @@ extern OS_Task * g_current_task;
 
 extern _OS_Queue g_ready_q;
 extern _OS_Queue g_wait_q;
-extern _OS_Queue g_ap_ready_q;
+extern _OS_BitmapQueue g_ap_ready_q;
 extern _OS_Queue g_completed_task_q;
 
 extern void _OS_SchedulerSuspendTask(OS_Task *);
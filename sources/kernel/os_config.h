@@ -50,11 +50,64 @@
 #define MIN_TASK_PERIOD                   1000       // in Microseconds.
 #define MIN_TASK_BUDGET                   100        // 100 uSec
 
+// Cycle counter timebase (Cortex-A8 / S5PV210 only). The execution time of the tasks
+// (accumulated_budget and the budget charged at every context switch) is measured with
+// the PMU cycle counter instead of the budget timer. The fraction of a microsecond left
+// at each context switch is carried over to the next one instead of being dropped.
+#define OS_PMU_TIMEBASE                   0
+
+// Per task VFP / NEON registers (Cortex-A8 / S5PV210 only). The VFP is switched lazily.
+// It is enabled only for the task whose registers it holds. Any other task traps on its
+// first VFP instruction and the registers are switched then. So the context switches do
+// not save or restore the VFP of the tasks that do not use it. The ISRs and the kernel
+// outside the task context should not use floating point. Needed for FLOAT_ABI=hard.
+#define OS_WITH_VFP                       0
+
+// Tickless scheduling. When enabled, there is no interrupt at every MIN_TASK_PERIOD.
+// The periodic timer only keeps the absolute time and the budget timer is programmed
+// as a one-shot timer for the next event (job release, deadline or budget expiry).
+// Periods & phase need not be multiple of MIN_TASK_PERIOD in this mode.
+#define OS_TICKLESS_SCHEDULING            0
+
+// Budget reclamation (CASH). The budget left by the periodic jobs that complete early
+// is kept as spare budget until their deadline. The periodic and CBS tasks with a later
+// deadline use the spare budget before their own budget, so that they can overrun without
+// a TBE. OS_MAX_SPARE_BUDGETS limits the number of pending spare budgets.
+#define OS_BUDGET_RECLAMATION             0
+#define OS_MAX_SPARE_BUDGETS              16
+
+// Mixed criticality scheduling (EDF-VD). The periodic tasks have a low or high criticality
+// and the high criticality tasks have a larger budget for the high criticality mode.
+// In the low criticality mode, the high criticality tasks are scheduled with shorter 
+// (virtual) deadlines. When one of them exceeds its low criticality budget, the system
+// switches to the high criticality mode and the low criticality jobs are dropped until
+// the CPU becomes idle.
+#define OS_MIXED_CRITICALITY              0
+
+// Static (time-triggered) scheduling. The EDF schedule of the periodic tasks for one
+// hyperperiod is computed offline by tools/schedgen from the task manifest. The generated
+// table (main/schedule_table.c) is linked with the kernel and the tasks of the table
+// are dispatched from it in constant time, without any queue operations. The periodic
+// tasks should be created before the scheduling starts and they should match the table.
+// The aperiodic tasks use the time left by the table. Needs OS_TICKLESS_SCHEDULING.
+#define OS_STATIC_SCHEDULE                0
+
+// Implementation of the priority queues used by the scheduler (g_ready_q, g_wait_q etc.)
+// The sorted list has O(n) insertion, which is cheapest for a handful of tasks.
+// The pairing heap has O(1) insertion and O(log n) amortized removal. It keeps the
+// scheduler time bounded when there are many periodic tasks.
+#define OS_PQUEUE_SORTED_LIST             0
+#define OS_PQUEUE_PAIRING_HEAP            1
+#define OS_PQUEUE_BACKEND                 OS_PQUEUE_SORTED_LIST
+
 #define MAX_PROCESS_COUNT                 16         // This number is used to preallocate PCB
 #define MAX_TASK_COUNT                    64         // This number is used to preallocate TCB
 #define MAX_OPEN_FILES                    16         // This number is used to preallocate FILE strctures
 #define MAX_SEMAPHORE_COUNT               64         // This number is used to preallocate Semaphore structures
 #define MAX_MUTEX_COUNT                   64         // This number is used to preallocate Mutex structures
+#define MAX_EVENT_COUNT                   32         // This number is used to preallocate Event structures
+#define MAX_MSGQ_COUNT                    8          // This number is used to preallocate Message Queue structures
+#define OS_MSGQ_NAME_SIZE                 16
 
 // Kernel drivers
 #define MAX_KERNEL_DRIVERS                16         // Preallocate few driver structures
@@ -63,6 +116,11 @@
 // MMU related
 #define ENABLE_MMU						  1			 // Support for Virtual memory and memory protection
 
+// Tag the TLB entries of each process with an ASID (ARMv6 and above). The kernel mappings
+// are global. So the TLB need not be flushed when switching between processes and
+// the page table is switched only when the process changes.
+#define ENABLE_MMU_ASID					  1
+
 // Note: We will have to change the memmap.ld to ensure that individual sections are aligned
 // by the following page size.
 #define KERNEL_PAGE_SIZE                  64         // Possible Values 4, 64 and 1024 (in Kilobytes)
@@ -86,6 +144,8 @@
 #define ENABLE_LCD                        1
 #define ENABLE_G2D_BLOCK                  1
 
+#ifndef __ASSEMBLER__
+
 // Define the Debug masks
 typedef enum
 {
@@ -107,6 +167,8 @@ typedef enum
     
 } Klog_MaskType;
 
+#endif // __ASSEMBLER__
+
 #define ENABLE_ASSERTS               1        // Enable ASSERT macros or not
 #define OS_ENABLE_CPU_STATS          1        // Enable OS & CPU Stats
 #define OS_WITH_VALIDATE_TASK        1
@@ -115,4 +177,12 @@ typedef enum
 #define OS_KLOG_MASK                 (KLOG_GENERAL_INFO | KLOG_OS_STARTUP | KLOG_MISC)
 #define DEBUG_UART_CHANNEL           0
 
+// Binary trace of the scheduler events (os_trace.h). The events are written into a ring
+// buffer, g_trace_buffer, and not formatted on the target. So it is cheap enough to leave
+// on, unlike the kernel logging. tools/tracedump converts a dump of the buffer into the
+// Chrome trace / Perfetto JSON format. The timestamps are in CPU cycles with
+// OS_PMU_TIMEBASE, which is the cheapest, and in microseconds otherwise.
+#define OS_TRACE_ENABLED             0
+#define OS_TRACE_BUFFER_SIZE         4096     // Number of events. Should be a power of 2
+
 #endif // _OS_CONFIG_H
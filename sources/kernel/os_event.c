@@ -0,0 +1,345 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_event.c
+//	Author: Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: OS Event flag implementation
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "os_event.h"
+#include "os_timer.h"
+#include "os_sched.h"
+#include "util.h"
+
+// Placeholders for all the event objects
+OS_EventCB g_event_pool[MAX_EVENT_COUNT];
+UINT32 g_event_usage_mask[(MAX_EVENT_COUNT + 31) >> 5];
+
+// The event that each task waits on with the flags and the mode of its wait
+static OS_EventCB * g_event_waiting_on[MAX_TASK_COUNT];
+static UINT32 g_event_wait_mask[MAX_TASK_COUNT];
+static UINT8 g_event_wait_mode[MAX_TASK_COUNT];
+
+#define EVENT_WAIT_MODE_MASK	(OS_EVENT_WAIT_ALL | OS_EVENT_AUTO_CLEAR)
+
+static OS_Return assert_event_open(OS_Event_t event);
+static void BlockOnEvent(OS_EventCB * evobj, UINT32 mask, UINT32 mode);
+static void WakeEventWaiter(OS_EventCB * evobj, OS_Task * task, OS_Return result, UINT32 flags);
+
+// Checks if the flags satisfy a wait for the mask
+static __inline__ BOOL IsWaitSatisfied(UINT32 flags, UINT32 mask, UINT32 mode)
+{
+	return (mode & OS_EVENT_WAIT_ALL) ? ((flags & mask) == mask) : ((flags & mask) != 0);
+}
+
+OS_Return _OS_EventAlloc(OS_Event_t * event, UINT32 flags)
+{
+	OS_Return status;
+
+	if(!event) {
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+
+	if(!g_current_process) {
+		status = PROCESS_INVALID;
+		goto exit;
+	}
+
+	// Get a free Event resource from the pool
+	*event = (OS_Event_t) GetFreeResIndex(g_event_usage_mask, MAX_EVENT_COUNT);
+
+	if(*event < 0) {
+		status = RESOURCE_EXHAUSTED;
+		goto exit;
+	}
+
+	OS_EventCB * evobj = (OS_EventCB *)&g_event_pool[*event];
+
+	// Block the event resource
+	SetResourceStatus(g_event_usage_mask, *event, FALSE);
+
+	evobj->flags = flags;
+	evobj->owner = (OS_Process *) g_current_process;
+
+	_OS_QueueInit(&evobj->periodic_wait_queue);
+	_OS_QueueInit(&evobj->aperiodic_wait_queue);
+
+	status = SUCCESS;
+
+exit:
+	return status;
+}
+
+OS_Return _OS_EventWait(OS_Event_t event, UINT32 mask, UINT32 mode, UINT32 * flags)
+{
+	OS_Return status;
+
+#if OS_ENABLE_CPU_STATS==1
+	// We need to track how long did we take to schedule the next task
+    g_sched_starting_counter_value = _OS_Timer_GetCount(PERIODIC_TIMER);
+#endif
+
+	if(!mask || (mode & ~EVENT_WAIT_MODE_MASK)) {
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+
+	if((status = assert_event_open(event)) != SUCCESS) {
+		goto exit;
+	}
+
+	// Get the Event object
+	OS_EventCB * evobj = (OS_EventCB *)&g_event_pool[event];
+
+	// Make sure that the current process owns the Event.
+	if(evobj->owner != (OS_Process *) g_current_process) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+
+	// The flags are already there. Return without going through the scheduler
+	if(IsWaitSatisfied(evobj->flags, mask, mode)) {
+
+		if(flags) {
+			*flags = evobj->flags & mask;
+		}
+
+		if(mode & OS_EVENT_AUTO_CLEAR) {
+			evobj->flags &= ~mask;
+		}
+
+		goto exit;
+	}
+
+	// Update the accumulated and remaining budgets
+	_OS_UpdateCurrentTaskBudget();
+
+	KlogStr(KLOG_SEMAPHORE_DEBUG, "Event Wait :- ", g_current_task->name);
+	BlockOnEvent(evobj, mask, mode);
+
+	// The task that posts the flags updates the result
+	_OS_Schedule();
+
+exit:
+	return status;
+}
+
+OS_Return _OS_EventPost(OS_Event_t event, UINT32 flags)
+{
+	OS_Return status;
+	OS_Task * task;
+	OS_Task * next;
+	UINT32 clear_flags = 0;
+	BOOL woken = FALSE;
+	_OS_Queue * q;
+	UINT32 i;
+
+#if OS_ENABLE_CPU_STATS==1
+	// We need to track how long did we take to schedule the next task
+    g_sched_starting_counter_value = _OS_Timer_GetCount(PERIODIC_TIMER);
+#endif
+
+	if((status = assert_event_open(event)) != SUCCESS) {
+		goto exit;
+	}
+
+	// Get the Event object
+	OS_EventCB * evobj = (OS_EventCB *)&g_event_pool[event];
+
+	// Make sure that the current process owns the Event.
+	if(evobj->owner != (OS_Process *) g_current_process) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+
+	flags |= evobj->flags;
+
+	// The periodic / CBS tasks first, then the aperiodic tasks. Each queue is in order
+	for(i = 0; i < 2; i++) {
+
+		q = i ? &evobj->aperiodic_wait_queue : &evobj->periodic_wait_queue;
+		task = (OS_Task *) q->head;
+
+		while(task) {
+
+			next = (OS_Task *) task->qp.np_next;
+
+			if(IsWaitSatisfied(flags, g_event_wait_mask[task->id], g_event_wait_mode[task->id])) {
+
+				if(!woken) {
+					// Update the accumulated and remaining budgets before the first task is woken up
+					_OS_UpdateCurrentTaskBudget();
+					woken = TRUE;
+				}
+
+				if(g_event_wait_mode[task->id] & OS_EVENT_AUTO_CLEAR) {
+					clear_flags |= g_event_wait_mask[task->id];
+				}
+
+				WakeEventWaiter(evobj, task, SUCCESS, flags);
+			}
+
+			task = next;
+		}
+	}
+
+	evobj->flags = flags & ~clear_flags;
+
+	if(woken) {
+
+		KlogStr(KLOG_SEMAPHORE_DEBUG, "Event Post :- ", g_current_task->name);
+
+		// The return path for this function is through _OS_Schedule, so it is important to
+		// update the result in the syscall_result
+		if(g_current_task->syscall_result) {
+			g_current_task->syscall_result[0] = SUCCESS;
+		}
+
+		_OS_Schedule();
+	}
+
+exit:
+	return status;
+}
+
+OS_Return _OS_EventClear(OS_Event_t event, UINT32 flags)
+{
+	OS_Return status;
+
+	if((status = assert_event_open(event)) != SUCCESS) {
+		goto exit;
+	}
+
+	// Get the Event object
+	OS_EventCB * evobj = (OS_EventCB *)&g_event_pool[event];
+
+	// Make sure that the current process owns the Event.
+	if(evobj->owner != (OS_Process *) g_current_process) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+
+	evobj->flags &= ~flags;
+
+exit:
+	return status;
+}
+
+OS_Return _OS_EventFree(OS_Event_t event)
+{
+	OS_Return status;
+	OS_Task * task;
+
+#if OS_ENABLE_CPU_STATS==1
+	// We need to track how long did we take to schedule the next task
+    g_sched_starting_counter_value = _OS_Timer_GetCount(PERIODIC_TIMER);
+#endif
+
+	if((status = assert_event_open(event)) != SUCCESS) {
+		goto exit;
+	}
+
+	// Get the Event object
+	OS_EventCB * evobj = (OS_EventCB *)&g_event_pool[event];
+
+	// Make sure that the current process owns the Event.
+	if(evobj->owner != (OS_Process *) g_current_process) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+
+	// Update the accumulated and remaining budgets
+	_OS_UpdateCurrentTaskBudget();
+
+	// We need to unblock all the waiting tasks
+	while((task = (OS_Task *) evobj->periodic_wait_queue.head) != NULL) {
+		WakeEventWaiter(evobj, task, RESOURCE_DELETED, 0);
+	}
+
+	while((task = (OS_Task *) evobj->aperiodic_wait_queue.head) != NULL) {
+		WakeEventWaiter(evobj, task, RESOURCE_DELETED, 0);
+	}
+
+	evobj->flags = 0;
+	evobj->owner = NULL;
+
+	SetResourceStatus(g_event_usage_mask, event, TRUE);
+
+	if(g_current_task->syscall_result) {
+		g_current_task->syscall_result[0] = SUCCESS;
+	}
+
+	_OS_Schedule();
+
+exit:
+	return status;
+}
+
+void _OS_EventWaiterUpdate(OS_Task * task)
+{
+	OS_EventCB * evobj = g_event_waiting_on[task->id];
+
+	if(evobj) {
+		_OS_NPQueueDelete(&evobj->periodic_wait_queue, (_OS_TaskQNode *) task);
+		_OS_NPQueueInsertSorted(&evobj->periodic_wait_queue, (_OS_TaskQNode *) task);
+	}
+}
+
+// Blocks the current task on the event
+static void BlockOnEvent(OS_EventCB * evobj, UINT32 mask, UINT32 mode)
+{
+	// Block the current task
+	_OS_SchedulerBlockCurrentTask();
+
+	g_event_waiting_on[g_current_task->id] = evobj;
+	g_event_wait_mask[g_current_task->id] = mask;
+	g_event_wait_mode[g_current_task->id] = (UINT8) mode;
+
+	// The key of a periodic / CBS task is its deadline and that of an aperiodic task is
+	// its priority. The tasks with the same key stay in the order in which they came
+	if(IS_PERIODIC_TASK(g_current_task->attributes) || IS_CBS_TASK(g_current_task->attributes)) {
+		_OS_NPQueueInsertSorted(&evobj->periodic_wait_queue, (_OS_TaskQNode *) g_current_task);
+	}
+	else {
+		_OS_NPQueueInsertSorted(&evobj->aperiodic_wait_queue, (_OS_TaskQNode *) g_current_task);
+	}
+}
+
+// Takes the task out of the wait queue and makes it ready. The flags are returned to
+// the task along with the result
+static void WakeEventWaiter(OS_EventCB * evobj, OS_Task * task, OS_Return result, UINT32 flags)
+{
+	if(IS_PERIODIC_TASK(task->attributes) || IS_CBS_TASK(task->attributes)) {
+		_OS_NPQueueDelete(&evobj->periodic_wait_queue, (_OS_TaskQNode *) task);
+	}
+	else {
+		_OS_NPQueueDelete(&evobj->aperiodic_wait_queue, (_OS_TaskQNode *) task);
+	}
+
+	g_event_waiting_on[task->id] = NULL;
+
+	// A periodic task whose deadline has passed goes on as a late job from its next release
+	_OS_SchedulerUnblockTask(task);
+
+	// The return path for waiting tasks is through _OS_Schedule, so it is important to
+	// update the result in the syscall_result. The waiter is in the process that posts
+	if(task->syscall_result) {
+		task->syscall_result[0] = result;
+		task->syscall_result[1] = flags & g_event_wait_mask[task->id];
+	}
+}
+
+static OS_Return assert_event_open(OS_Event_t event)
+{
+	if(event < 0 || event >= MAX_EVENT_COUNT) {
+		return BAD_ARGUMENT;
+	}
+
+	if(!IsResourceBusy(g_event_usage_mask, event)) {
+		return RESOURCE_NOT_OPEN;
+	}
+
+	return SUCCESS;
+}
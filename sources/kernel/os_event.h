@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_event.h
+//	Author: Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Header file for the OS Event flag APIs
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _OS_EVENT_H
+#define _OS_EVENT_H
+
+#include "os_core.h"
+#include "os_types.h"
+#include "os_queue.h"
+#include "os_process.h"
+
+typedef struct
+{
+	UINT32 flags;						// Flags that are set now
+	OS_Process * owner;					// Owner process
+	_OS_Queue periodic_wait_queue;		// Periodic / CBS tasks in the order of their deadlines
+	_OS_Queue aperiodic_wait_queue;		// Aperiodic tasks in the order of their priorities
+
+} OS_EventCB;
+
+extern OS_EventCB g_event_pool[MAX_EVENT_COUNT];
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// An event is a group of 32 flags. A task waits till any or all of the flags in
+// its mask are set. A post sets flags and wakes up every task whose wait is
+// satisfied by them in one pass, the periodic / CBS tasks in the order of their
+// deadlines followed by the aperiodic tasks in the order of their priorities. So
+// one post signals any number of tasks, where a semaphore needs a post for each.
+//
+// All the waiters of a post see the flags as they were after the post. The flags
+// of the waiters with OS_EVENT_AUTO_CLEAR are cleared after the pass, so they do
+// not take the flags away from the other waiters of the same post.
+//
+// The wait queues are plain lists rather than priority queues so that the post
+// can go through all the waiters in order. A post or a free is O(N) in the number
+// of waiters, but it is done in one system call.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+OS_Return _OS_EventAlloc(OS_Event_t * event, UINT32 flags);
+OS_Return _OS_EventWait(OS_Event_t event, UINT32 mask, UINT32 mode, UINT32 * flags);
+OS_Return _OS_EventPost(OS_Event_t event, UINT32 flags);
+OS_Return _OS_EventClear(OS_Event_t event, UINT32 flags);
+OS_Return _OS_EventFree(OS_Event_t event);
+
+// Moves a periodic task waiting on an event to its new place in the wait queue.
+// The scheduler calls it when the deadline of a blocked task changes. Nothing is done
+// if the task is not waiting on an event
+// ASSUMPTION: The interrupts are disabled
+void _OS_EventWaiterUpdate(OS_Task * task);
+
+#endif //_OS_EVENT_H
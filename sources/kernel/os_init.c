@@ -14,6 +14,9 @@
 #include "os_memory.h"
 #include "target.h"
 #include "cache.h"
+#include "os_vfp.h"
+#include "os_trace.h"
+#include "os_msgq.h"
 #include "uart.h"
 #include "soc.h"
 
@@ -23,7 +26,7 @@ extern void _OS_PlatformInit();
 extern OS_Return ramdisk_init(void * addr);
 extern _OS_Queue g_ready_q;
 extern _OS_Queue g_wait_q;
-extern _OS_Queue g_ap_ready_q;
+extern _OS_BitmapQueue g_ap_ready_q;
 extern _OS_Queue g_completed_task_q;
 
 // Following variable are derived from the linker script file.
@@ -62,6 +65,11 @@ void _OS_Init()
 	// Initialize free resource pools
 	_OS_InitFreeResources();
 	
+#if OS_TRACE_ENABLED==1
+	// The tasks are traced from their creation
+	_OS_TraceInit();
+#endif
+	
 #if ENABLE_RAMDISK==1	
 	if(ramdisk_init((void *)&__ramdisk_start__) != SUCCESS) {
 		panic("ramdisk_init failed\n");
@@ -86,9 +94,10 @@ void _OS_Init()
 	// Initialize the global queue for timer waiting
 	_OS_QueueInit(&g_ready_q); 
 	_OS_QueueInit(&g_wait_q);
-	_OS_QueueInit(&g_ap_ready_q);
+	_OS_BitmapQueueInit(&g_ap_ready_q);
 	_OS_QueueInit(&g_completed_task_q);
 	_OS_QueueInit(&g_periodic_blocked_q);
+	_OS_QueueInit(&g_ceiling_blocked_q);
 	
 	// Initialize debug UART
 	Uart_Init(UART0);	
@@ -100,6 +109,11 @@ void _OS_Init()
 	// Target Initialization
 	_OS_TargetInit();	
 
+#if OS_WITH_VFP==1
+	// The VFP is enabled per task on its first use
+	_OS_VFPInit();
+#endif
+
 	// Start the scheduling timer
 	_OS_InitTimer();
 
@@ -136,16 +150,19 @@ void _OS_InitInterrupts()
 ///////////////////////////////////////////////////////////////////////////////
 // Initialization of free resource pools
 ///////////////////////////////////////////////////////////////////////////////
+
+// Bits of the last word of a usage mask that are past the count of the resources.
+// None when the count is a multiple of 32
+#define UNUSED_RES_BITS(count)	((UINT32) ~((1ull << ((((count) - 1) & 0x1f) + 1)) - 1))
+
 static void _OS_InitFreeResources(void)
 {
 	// The resource usage masks are already cleared when BSS section is initialized
 	// Only mark the unused bits as busy
-	g_task_usage_mask[((MAX_TASK_COUNT + 31) >> 5) - 1] 
-		|= ~((1ull << (32 - (MAX_TASK_COUNT & 0x1f))) - 1);	
-	g_process_usage_mask[((MAX_PROCESS_COUNT + 31) >> 5) - 1] 
-		|= ~((1ull << (32 - (MAX_PROCESS_COUNT & 0x1f))) - 1);	
-	g_rdfile_usage_mask[((MAX_OPEN_FILES + 31) >> 5) - 1] 
-		|= ~((1ull << (32 - (MAX_OPEN_FILES & 0x1f))) - 1);			
+	g_task_usage_mask[((MAX_TASK_COUNT + 31) >> 5) - 1] |= UNUSED_RES_BITS(MAX_TASK_COUNT);
+	g_process_usage_mask[((MAX_PROCESS_COUNT + 31) >> 5) - 1] |= UNUSED_RES_BITS(MAX_PROCESS_COUNT);
+	g_rdfile_usage_mask[((MAX_OPEN_FILES + 31) >> 5) - 1] |= UNUSED_RES_BITS(MAX_OPEN_FILES);
+	g_msgq_usage_mask[((MAX_MSGQ_COUNT + 31) >> 5) - 1] |= UNUSED_RES_BITS(MAX_MSGQ_COUNT);
 }
 
 #if ENABLE_MMU
@@ -156,45 +173,45 @@ void _OS_create_kernel_memory_map(_MMU_L1_PageTable * ptable)
 	// Create Map for Executable Kernel Sections
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) &__EX_system_area_start__, (PADDR) &__EX_system_area_start__, 
-			length, KERNEL_EX_USER_NA, TRUE, TRUE);
+			length, KERNEL_EX_USER_NA, TRUE, TRUE, TRUE);
 
 	// Create Map for Read Only Kernel Sections
 	length = (UINT32) ((UINT32)&__RO_system_area_end__ - (UINT32)&__RO_system_area_start__);
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) &__RO_system_area_start__, (PADDR) &__RO_system_area_start__, 
-			length, KERNEL_RO_USER_NA, TRUE, TRUE);
+			length, KERNEL_RO_USER_NA, TRUE, TRUE, TRUE);
 				
 	// Create Map for Read/Write Kernel Sections
 	length = (UINT32) ((UINT32)&__RW_system_area_end__ - (UINT32)&__RW_system_area_start__);
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) &__RW_system_area_start__, (PADDR) &__RW_system_area_start__, 
-			length, KERNEL_RW_USER_NA, TRUE, TRUE);
+			length, KERNEL_RW_USER_NA, TRUE, TRUE, TRUE);
 
 	// Create Map for user section. There are some user functions in the kernel binary. 
 	// They should not share page with the kernel
 	length = (UINT32) ((UINT32)&__EX_user_area_end__ - (UINT32)&__EX_user_area_start__);
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) &__EX_user_area_start__, (PADDR) &__EX_user_area_start__, 
-			length, KERNEL_RO_USER_EX, TRUE, TRUE);
+			length, KERNEL_RO_USER_EX, TRUE, TRUE, TRUE);
 	
 	//------------------------- Ramdisk ---------------------------------
 	// Create Map for Ramdisk space. Kernel will have read/write permissions
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) &__ramdisk_start__, (PADDR) &__ramdisk_start__, 
-			(UINT32) &__ramdisk_length__, KERNEL_RO_USER_NA, TRUE, TRUE);
+			(UINT32) &__ramdisk_length__, KERNEL_RO_USER_NA, TRUE, TRUE, TRUE);
 
 	// Create Map for Page Table space. Kernel will have read/write permissions
 	// This space should not be cacheable / buffer-able
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable,
 			(VADDR) &__page_table_area_start__, (PADDR) &__page_table_area_start__, 
-			(UINT32) &__page_table_area_length__, KERNEL_RW_USER_NA, FALSE, FALSE);	
+			(UINT32) &__page_table_area_length__, KERNEL_RW_USER_NA, FALSE, FALSE, TRUE);	
 			
 	//------------------------- Timer ---------------------------------
 	// Create IO mappings for the kernel task before we access timer registers
 	// Disable caching and write buffer for this region
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) ELFIN_TIMER_BASE, (PADDR) ELFIN_TIMER_BASE, 
-			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE);
+			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE, TRUE);
 
 
 	//------------------------- UART ---------------------------------
@@ -202,47 +219,48 @@ void _OS_create_kernel_memory_map(_MMU_L1_PageTable * ptable)
 	// Disable caching and write buffer for this region
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) ELFIN_UART_BASE, (PADDR) ELFIN_UART_BASE, 
-			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE);
+			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE, TRUE);
 
 	//------------------------- UART ---------------------------------
 	// Create IO mappings for the kernel task before we access RTC registers
 	// Disable caching and write buffer for this region
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) RTC_BASE, (PADDR) RTC_BASE, 
-			(UINT32) 0x10000, KERNEL_RW_USER_NA, FALSE, FALSE);
+			(UINT32) 0x10000, KERNEL_RW_USER_NA, FALSE, FALSE, TRUE);
 
 	//------------------------- VIC ---------------------------------
 	// Create IO mappings for the kernel task before we access VIC registers
 	// Disable caching and write buffer for this region
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) ELFIN_VIC0_BASE_ADDR, (PADDR) ELFIN_VIC0_BASE_ADDR, 
-			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE);
+			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE, TRUE);
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) ELFIN_VIC1_BASE_ADDR, (PADDR) ELFIN_VIC1_BASE_ADDR, 
-			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE);
+			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE, TRUE);
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) ELFIN_VIC2_BASE_ADDR, (PADDR) ELFIN_VIC2_BASE_ADDR, 
-			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE);
+			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE, TRUE);
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) ELFIN_VIC3_BASE_ADDR, (PADDR) ELFIN_VIC3_BASE_ADDR, 
-			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE);
+			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE, TRUE);
 
 	//------------------------- GPIO ---------------------------------
 	// Create IO mappings for the kernel task before we access GPIO registers
 	// Disable caching and write buffer for this region
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) ELFIN_GPIO_BASE, (PADDR) ELFIN_GPIO_BASE, 
-			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE);
+			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE, TRUE);
 			
 	//------------------------- LCD ---------------------------------
 #if ENABLE_LCD && TARGET_HAS_LCD
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) DISP_CONTROLLER_BASE_ADDR, (PADDR) DISP_CONTROLLER_BASE_ADDR, 
-			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE);
+			(UINT32) ONE_MB, KERNEL_RW_USER_NA, FALSE, FALSE, TRUE);
 
+	// The frame buffer can be mapped into a process with user access. So it is not global
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) FB_ADDR, (PADDR) FB_ADDR, 
-			(UINT32) FB_SIZE, KERNEL_RW_USER_NA, FALSE, FALSE);
+			(UINT32) FB_SIZE, KERNEL_RW_USER_NA, FALSE, FALSE, FALSE);
 #endif
 		
 	//------------------------- HEAP ---------------------------------
@@ -0,0 +1,438 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_msgq.c
+//	Author: Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Zero copy message queues between the processes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "os_msgq.h"
+#include "os_sem.h"
+#include "os_timer.h"
+#include "os_sched.h"
+#include "os_memory.h"
+#include "cache.h"
+#include "util.h"
+
+// Placeholders for all the message queue objects
+OS_MsgQueueCB g_msgq_pool[MAX_MSGQ_COUNT];
+UINT32 g_msgq_usage_mask[(MAX_MSGQ_COUNT + 31) >> 5];
+
+// States of a slot
+enum
+{
+	MSGQ_SLOT_FREE = 0,
+	MSGQ_SLOT_WRITING,			// Allocated by the sender
+	MSGQ_SLOT_SENT,				// In the sent ring
+	MSGQ_SLOT_READING			// Received
+};
+
+// The slots have an index of 16 bits
+#define MSGQ_MAX_SLOTS			0xFFFF
+#define MSGQ_MAX_MSG_SIZE		0x100000
+
+static OS_Return assert_msgq_open(OS_MsgQueue_t queue);
+static INT32 FindQueue(const INT8 * name);
+static INT32 GetSlotIndex(const OS_MsgQueueCB * msgq, const void * msg);
+static void MapQueue(const OS_MsgQueueCB * msgq, OS_Process * process);
+
+static __inline__ UINT32 ProcessMask(const OS_Process * process)
+{
+	return process ? (1 << (process - g_process_pool)) : 0;
+}
+
+static __inline__ UINT8 * SlotAddress(const OS_MsgQueueCB * msgq, UINT32 index)
+{
+	return msgq->buffer + index * msgq->msg_size;
+}
+
+OS_Return _OS_MsgQueueCreate(const INT8 * name, UINT32 msg_size, UINT32 msg_count, OS_MsgQueue_t * queue)
+{
+	OS_Return status;
+	UINT32 slot_size;
+	UINT32 i;
+
+	if(!name || !queue || !msg_size || (msg_size > MSGQ_MAX_MSG_SIZE) || 
+		!msg_count || (msg_count > MSGQ_MAX_SLOTS)) {
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+
+	if(!g_current_process) {
+		status = PROCESS_INVALID;
+		goto exit;
+	}
+
+	// The names are unique
+	if(FindQueue(name) >= 0) {
+		status = RESOURCE_BUSY;
+		goto exit;
+	}
+
+	// The slots start at a cache line and their size is a power of 2. So the slot
+	// of a message is found without a division
+	slot_size = CACHE_LINE_SIZE;
+	while(slot_size < msg_size) {
+		slot_size <<= 1;
+	}
+
+	if((UINT64) slot_size * msg_count > (UINT32) -1) {
+		status = OUT_OF_SPACE;
+		goto exit;
+	}
+
+	// Get a free message queue resource from the pool
+	*queue = (OS_MsgQueue_t) GetFreeResIndex(g_msgq_usage_mask, MAX_MSGQ_COUNT);
+
+	if(*queue < 0) {
+		status = RESOURCE_EXHAUSTED;
+		goto exit;
+	}
+
+	OS_MsgQueueCB *msgq = (OS_MsgQueueCB *)&g_msgq_pool[*queue];
+
+	// The slots are in the user heap. The book keeping is in the kernel heap so that
+	// the processes cannot change it
+	msgq->buffer = (UINT8 *) _OS_AllocUserPages(slot_size * msg_count);
+	msgq->free_ring = (UINT16 *) kmalloc(msg_count * sizeof(UINT16));
+	msgq->sent_ring = (UINT16 *) kmalloc(msg_count * sizeof(UINT16));
+	msgq->slot_state = (UINT8 *) kmalloc(msg_count * sizeof(UINT8));
+	msgq->slot_holder = (OS_Process **) kmalloc(msg_count * sizeof(OS_Process *));
+
+	if(!msgq->buffer || !msgq->free_ring || !msgq->sent_ring || !msgq->slot_state || !msgq->slot_holder) {
+		status = OUT_OF_SPACE;
+		goto exit;
+	}
+
+	if((status = _OS_SemKernelAlloc(&msgq->receivers)) != SUCCESS) {
+		goto exit;
+	}
+
+	// Block the message queue resource
+	SetResourceStatus(g_msgq_usage_mask, *queue, FALSE);
+
+	strncpy(msgq->name, name, OS_MSGQ_NAME_SIZE - 1);
+	msgq->name[OS_MSGQ_NAME_SIZE - 1] = '\0';
+	msgq->msg_size = slot_size;
+	msgq->msg_count = msg_count;
+	msgq->users = ProcessMask(g_current_process);
+
+	for(i = 0; i < msg_count; i++) {
+		msgq->free_ring[i] = (UINT16) i;
+		msgq->slot_state[i] = MSGQ_SLOT_FREE;
+		msgq->slot_holder[i] = NULL;
+	}
+
+	msgq->free_head = 0;
+	msgq->free_count = msg_count;
+	msgq->sent_head = 0;
+	msgq->sent_count = 0;
+
+	MapQueue(msgq, g_current_process);
+
+	status = SUCCESS;
+
+exit:
+	return status;
+}
+
+OS_Return _OS_MsgQueueOpen(const INT8 * name, OS_MsgQueue_t * queue)
+{
+	OS_Return status;
+	INT32 index;
+
+	if(!name || !queue) {
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+
+	if(!g_current_process) {
+		status = PROCESS_INVALID;
+		goto exit;
+	}
+
+	index = FindQueue(name);
+	if(index < 0) {
+		status = RESOURCE_NOT_FOUND;
+		goto exit;
+	}
+
+	OS_MsgQueueCB * msgq = &g_msgq_pool[index];
+
+	if(!(msgq->users & ProcessMask(g_current_process))) {
+		msgq->users |= ProcessMask(g_current_process);
+		MapQueue(msgq, g_current_process);
+	}
+
+	*queue = index;
+	status = SUCCESS;
+
+exit:
+	return status;
+}
+
+OS_Return _OS_MsgQueueAlloc(OS_MsgQueue_t queue, void ** msg)
+{
+	OS_Return status;
+
+	if((status = assert_msgq_open(queue)) != SUCCESS) {
+		goto exit;
+	}
+
+	if(!msg) {
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+
+	OS_MsgQueueCB * msgq = &g_msgq_pool[queue];
+
+	// The slots are not handed out to the processes that did not open the queue
+	if(!(msgq->users & ProcessMask(g_current_process))) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+
+	// The senders do not wait for a free slot
+	if(!msgq->free_count) {
+		status = RESOURCE_EXHAUSTED;
+		goto exit;
+	}
+
+	UINT32 index = msgq->free_ring[msgq->free_head];
+
+	if(++msgq->free_head == msgq->msg_count) {
+		msgq->free_head = 0;
+	}
+	msgq->free_count--;
+
+	msgq->slot_state[index] = MSGQ_SLOT_WRITING;
+	msgq->slot_holder[index] = (OS_Process *) g_current_process;
+
+	*msg = SlotAddress(msgq, index);
+
+exit:
+	return status;
+}
+
+OS_Return _OS_MsgQueueSend(OS_MsgQueue_t queue, const void * msg)
+{
+	OS_Return status;
+	INT32 index;
+
+#if OS_ENABLE_CPU_STATS==1
+	// We need to track how long did we take to schedule the next task
+    g_sched_starting_counter_value = _OS_Timer_GetCount(PERIODIC_TIMER);
+#endif
+
+	if((status = assert_msgq_open(queue)) != SUCCESS) {
+		goto exit;
+	}
+
+	OS_MsgQueueCB * msgq = &g_msgq_pool[queue];
+
+	index = GetSlotIndex(msgq, msg);
+	if(index < 0) {
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+
+	// Only the process that allocated the slot can send it
+	if((msgq->slot_state[index] != MSGQ_SLOT_WRITING) ||
+		(msgq->slot_holder[index] != (OS_Process *) g_current_process)) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+
+	// There is always room in the sent ring as it has one place for every slot
+	UINT32 tail = msgq->sent_head + msgq->sent_count;
+	if(tail >= msgq->msg_count) {
+		tail -= msgq->msg_count;
+	}
+
+	msgq->sent_ring[tail] = (UINT16) index;
+	msgq->sent_count++;
+
+	msgq->slot_state[index] = MSGQ_SLOT_SENT;
+	msgq->slot_holder[index] = NULL;
+
+	// The woken task takes the message when it runs. It may have an earlier deadline
+	if(!_OS_SemKernelWake(msgq->receivers)) {
+		goto exit;
+	}
+
+	// Update the accumulated and remaining budgets
+	_OS_UpdateCurrentTaskBudget();
+
+	// The return path for this function is through _OS_Schedule, so it is important to
+	// update the result in the syscall_result
+	if(g_current_task->syscall_result) {
+		g_current_task->syscall_result[0] = SUCCESS;
+	}
+
+	_OS_Schedule();
+
+exit:
+	return status;
+}
+
+OS_Return _OS_MsgQueueReceive(OS_MsgQueue_t queue, void ** msg)
+{
+	OS_Return status;
+
+#if OS_ENABLE_CPU_STATS==1
+	// We need to track how long did we take to schedule the next task
+    g_sched_starting_counter_value = _OS_Timer_GetCount(PERIODIC_TIMER);
+#endif
+
+	if((status = assert_msgq_open(queue)) != SUCCESS) {
+		goto exit;
+	}
+
+	if(!msg) {
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+
+	OS_MsgQueueCB * msgq = &g_msgq_pool[queue];
+
+	if(!(msgq->users & ProcessMask(g_current_process))) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+
+	if(!msgq->sent_count) {
+
+		// NO_DATA stays as the result till the task runs again. Then the caller
+		// tries again. The sender cannot write the result of this task as the
+		// result is not mapped in the process of the sender
+		status = NO_DATA;
+		if(g_current_task->syscall_result) {
+			g_current_task->syscall_result[0] = NO_DATA;
+		}
+
+		_OS_SemKernelWait(msgq->receivers);
+		_OS_Schedule();
+
+		goto exit;
+	}
+
+	UINT32 index = msgq->sent_ring[msgq->sent_head];
+
+	if(++msgq->sent_head == msgq->msg_count) {
+		msgq->sent_head = 0;
+	}
+	msgq->sent_count--;
+
+	msgq->slot_state[index] = MSGQ_SLOT_READING;
+	msgq->slot_holder[index] = (OS_Process *) g_current_process;
+
+	*msg = SlotAddress(msgq, index);
+
+exit:
+	return status;
+}
+
+OS_Return _OS_MsgQueueRelease(OS_MsgQueue_t queue, const void * msg)
+{
+	OS_Return status;
+	INT32 index;
+
+	if((status = assert_msgq_open(queue)) != SUCCESS) {
+		goto exit;
+	}
+
+	OS_MsgQueueCB * msgq = &g_msgq_pool[queue];
+
+	index = GetSlotIndex(msgq, msg);
+	if(index < 0) {
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+
+	// A received slot or an allocated one that was not sent can be released by
+	// the process that holds it
+	if(((msgq->slot_state[index] != MSGQ_SLOT_READING) && (msgq->slot_state[index] != MSGQ_SLOT_WRITING)) ||
+		(msgq->slot_holder[index] != (OS_Process *) g_current_process)) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+
+	UINT32 tail = msgq->free_head + msgq->free_count;
+	if(tail >= msgq->msg_count) {
+		tail -= msgq->msg_count;
+	}
+
+	msgq->free_ring[tail] = (UINT16) index;
+	msgq->free_count++;
+
+	msgq->slot_state[index] = MSGQ_SLOT_FREE;
+	msgq->slot_holder[index] = NULL;
+
+exit:
+	return status;
+}
+
+// Returns the queue with the name or -1 if there is none
+static INT32 FindQueue(const INT8 * name)
+{
+	INT8 qname[OS_MSGQ_NAME_SIZE];
+	INT32 i;
+
+	strncpy(qname, name, OS_MSGQ_NAME_SIZE - 1);
+	qname[OS_MSGQ_NAME_SIZE - 1] = '\0';
+
+	for(i = 0; i < MAX_MSGQ_COUNT; i++) {
+
+		if(IsResourceBusy(g_msgq_usage_mask, i) && !strcmp(g_msgq_pool[i].name, qname)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+// Returns the slot of the message or -1 if it is not the start of a slot of the queue
+static INT32 GetSlotIndex(const OS_MsgQueueCB * msgq, const void * msg)
+{
+	UINTPTR offset = (UINTPTR) msg - (UINTPTR) msgq->buffer;
+
+	if((UINTPTR) msg < (UINTPTR) msgq->buffer || (offset & (msgq->msg_size - 1))) {
+		return -1;
+	}
+
+	offset >>= (31 - __builtin_clz(msgq->msg_size));
+
+	return (offset < msgq->msg_count) ? (INT32) offset : -1;
+}
+
+// Gives the process user access to the slots. The address is the same in all processes
+static void MapQueue(const OS_MsgQueueCB * msgq, OS_Process * process)
+{
+#if ENABLE_MMU
+
+	// The heap is in the kernel map of every process without user access. So the map
+	// uses the same page size as the kernel map
+	KERNEL_VA_TO_PA_MAP_FUNCTION(process->ptable,
+							(VADDR) msgq->buffer,
+							(PADDR) msgq->buffer,
+							msgq->msg_size * msgq->msg_count,
+							KERNEL_RW_USER_RW, TRUE, TRUE, FALSE);
+
+	// The kernel map of the pages may already be in the TLB
+	FLUSH_PROCESS_TLB(process);
+#endif
+}
+
+static OS_Return assert_msgq_open(OS_MsgQueue_t queue)
+{
+	if(queue < 0 || queue >= MAX_MSGQ_COUNT) {
+		return BAD_ARGUMENT;
+	}
+
+	if(!IsResourceBusy(g_msgq_usage_mask, queue)) {
+		return RESOURCE_NOT_OPEN;
+	}
+
+	return SUCCESS;
+}
@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_msgq.h
+//	Author: Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Header file for the message queues between the processes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _OS_MSGQ_H
+#define _OS_MSGQ_H
+
+#include "os_core.h"
+#include "os_types.h"
+#include "os_process.h"
+
+#if MAX_PROCESS_COUNT > 32
+	#error "The message queues keep their processes in a 32 bit mask"
+#endif
+
+typedef struct
+{
+	INT8 name[OS_MSGQ_NAME_SIZE];
+	UINT8 * buffer;				// Slots of the messages. Mapped into the processes that use the queue
+	UINT32 msg_size;			// Size of a slot in bytes. A multiple of the cache line
+	UINT32 msg_count;			// Number of slots
+	UINT32 users;				// Processes that created / opened the queue. One bit per PCB in g_process_pool
+	OS_Sem_t receivers;			// Wait queue of the tasks receiving from an empty queue
+
+	// Indices of the free slots and of the slots that were sent and not yet received.
+	// Each ring has room for all the slots
+	UINT16 * free_ring;
+	UINT32 free_head;
+	UINT32 free_count;
+	UINT16 * sent_ring;
+	UINT32 sent_head;
+	UINT32 sent_count;
+
+	// State of each slot and the process that holds it while it is being written or read
+	UINT8 * slot_state;
+	OS_Process ** slot_holder;
+
+} OS_MsgQueueCB;
+
+extern OS_MsgQueueCB g_msgq_pool[MAX_MSGQ_COUNT];
+extern UINT32 g_msgq_usage_mask[];
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// The messages are not copied. The slots are in pages of the user heap that are
+// mapped into every process that uses the queue, at the same address. So the sender
+// writes the message in place and the receiver reads it from there. Only the index
+// of the slot passes through the kernel. The kernel notes down which process holds
+// each slot. A process can send or release only the slots that it holds. The MMU
+// does not stop a process from touching the other slots of the queue though.
+//
+// The tasks that receive from an empty queue wait in the order of their deadlines,
+// then the aperiodic tasks by priority, as with the semaphores. A send wakes up the
+// first of them. The woken task takes the first message that is there when it runs.
+// It waits again if another receiver took it in the meantime.
+//
+// The queues are never freed. Their pages cannot be given back to the user heap.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+OS_Return _OS_MsgQueueCreate(const INT8 * name, UINT32 msg_size, UINT32 msg_count, OS_MsgQueue_t * queue);
+OS_Return _OS_MsgQueueOpen(const INT8 * name, OS_MsgQueue_t * queue);
+OS_Return _OS_MsgQueueAlloc(OS_MsgQueue_t queue, void ** msg);
+OS_Return _OS_MsgQueueSend(OS_MsgQueue_t queue, const void * msg);
+OS_Return _OS_MsgQueueReceive(OS_MsgQueue_t queue, void ** msg);
+OS_Return _OS_MsgQueueRelease(OS_MsgQueue_t queue, const void * msg);
+
+#endif //_OS_MSGQ_H
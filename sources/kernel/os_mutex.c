@@ -0,0 +1,418 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_mutex.c
+//	Author: Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: OS Mutex implementation (Stack Resource Policy)
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "os_mutex.h"
+#include "os_timer.h"
+#include "os_sched.h"
+#include "util.h"
+
+// Placeholders for all the mutex objects
+OS_MutexCB g_mutex_pool[MAX_MUTEX_COUNT];
+UINT32 g_mutex_usage_mask[(MAX_MUTEX_COUNT + 31) >> 5];
+
+// The mutexes that are locked now and the highest ceiling among them
+static OS_MutexCB * g_locked_mutex_list;
+static UINT32 g_system_ceiling = OS_MUTEX_NO_CEILING;
+
+// Number of mutexes held by each task and the priority of the aperiodic tasks
+// before they locked their first mutex
+static UINT8 g_mutex_held_count[MAX_TASK_COUNT];
+static UINT16 g_mutex_base_priority[MAX_TASK_COUNT];
+
+// The mutex that each periodic / CBS task waits for
+static OS_MutexCB * g_mutex_waiting_on[MAX_TASK_COUNT];
+
+static OS_Return assert_mutex_open(OS_Mutex_t mutex);
+static void AcquireMutex(OS_MutexCB * mtxobj, OS_Task * task, BOOL ready);
+static void ReleaseMutex(OS_MutexCB * mtxobj);
+static OS_Task * GetNextHolder(OS_MutexCB * mtxobj);
+
+static __inline__ UINT32 GetPreemptionLevel(const OS_Task * task)
+{
+	if(IS_PERIODIC_TASK(task->attributes)) {
+		return task->p.deadline;
+	}
+	else if(IS_CBS_TASK(task->attributes)) {
+		return task->p.period;
+	}
+
+	return OS_MUTEX_NO_CEILING;
+}
+
+OS_Return _OS_MutexAlloc(OS_Mutex_t *mutex, UINT32 ceiling_deadline_us)
+{
+	OS_Return status;
+
+	if(!mutex) {
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+
+	if(!g_current_process) {
+		status = PROCESS_INVALID;
+		goto exit;
+	}
+
+	// Get a free Mutex resource from the pool
+	*mutex = (OS_Mutex_t) GetFreeResIndex(g_mutex_usage_mask, MAX_MUTEX_COUNT);
+
+	if(*mutex < 0) {
+		status = RESOURCE_EXHAUSTED;
+		goto exit;
+	}
+
+	OS_MutexCB *mtxobj = (OS_MutexCB *)&g_mutex_pool[*mutex];
+
+	// Block the mutex resource
+	SetResourceStatus(g_mutex_usage_mask, *mutex, FALSE);
+
+	mtxobj->holder = NULL;
+	mtxobj->ceiling = ceiling_deadline_us ? ceiling_deadline_us : OS_MUTEX_NO_CEILING;
+	mtxobj->owner = (OS_Process *) g_current_process;
+	mtxobj->next_locked = NULL;
+
+	_OS_QueueInit(&mtxobj->periodic_wait_queue);
+	_OS_QueueInit(&mtxobj->aperiodic_wait_queue);
+
+	status = SUCCESS;
+
+exit:
+	return status;
+}
+
+OS_Return _OS_MutexLock(OS_Mutex_t mutex)
+{
+	OS_Return status;
+
+#if OS_ENABLE_CPU_STATS==1
+	// We need to track how long did we take to schedule the next task
+    g_sched_starting_counter_value = _OS_Timer_GetCount(PERIODIC_TIMER);
+#endif
+
+	if((status = assert_mutex_open(mutex)) != SUCCESS) {
+		goto exit;
+	}
+
+	// Get the Mutex object
+	OS_MutexCB * mtxobj = (OS_MutexCB *)&g_mutex_pool[mutex];
+
+	// Make sure that the current process owns the Mutex.
+	if(mtxobj->owner != (OS_Process *) g_current_process) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+
+	// The mutexes are not recursive
+	if(mtxobj->holder == g_current_task) {
+		status = RESOURCE_BUSY;
+		goto exit;
+	}
+
+	// Update the accumulated and remaining budgets
+	_OS_UpdateCurrentTaskBudget();
+
+	KlogStr(KLOG_SEMAPHORE_DEBUG, "Mutex Lock :- ", g_current_task->name);
+
+	// Learn the ceiling from the tasks that lock the mutex
+	UINT32 level = GetPreemptionLevel(g_current_task);
+	if(level < mtxobj->ceiling) {
+
+		mtxobj->ceiling = level;
+		if(mtxobj->holder && level < g_system_ceiling) {
+			g_system_ceiling = level;
+		}
+	}
+
+	if(!mtxobj->holder) {
+
+		AcquireMutex(mtxobj, g_current_task, TRUE);
+
+		// The return path for this function is through _OS_Schedule, so it is important to
+		// update the result in the syscall_result
+		if(g_current_task->syscall_result) {
+			g_current_task->syscall_result[0] = SUCCESS;
+		}
+	}
+	else {
+
+		// The SRP should have held this task back. Wait for the holder to hand over the mutex
+		_OS_SchedulerBlockCurrentTask();
+
+		if(IS_PERIODIC_TASK(g_current_task->attributes) || IS_CBS_TASK(g_current_task->attributes)) {
+
+			// The key of the task is its deadline. The tasks with the same deadline stay
+			// in the order in which they came
+			g_mutex_waiting_on[g_current_task->id] = mtxobj;
+			_OS_NPQueueInsertSorted(&mtxobj->periodic_wait_queue, (_OS_TaskQNode *)g_current_task);
+		}
+		else {
+
+			// Note that we are going to use this as a priority queue
+			_OS_PQueueInsertWithKey(&mtxobj->aperiodic_wait_queue, (_OS_TaskQNode *)g_current_task,
+				g_current_task->ap.priority());
+		}
+	}
+
+	_OS_Schedule();
+
+exit:
+	return status;
+}
+
+OS_Return _OS_MutexUnlock(OS_Mutex_t mutex)
+{
+	OS_Return status;
+
+#if OS_ENABLE_CPU_STATS==1
+	// We need to track how long did we take to schedule the next task
+    g_sched_starting_counter_value = _OS_Timer_GetCount(PERIODIC_TIMER);
+#endif
+
+	if((status = assert_mutex_open(mutex)) != SUCCESS) {
+		goto exit;
+	}
+
+	// Get the Mutex object
+	OS_MutexCB * mtxobj = (OS_MutexCB *)&g_mutex_pool[mutex];
+
+	// Only the holder can unlock the mutex
+	if(mtxobj->owner != (OS_Process *) g_current_process || mtxobj->holder != g_current_task) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+
+	// Update the accumulated and remaining budgets
+	_OS_UpdateCurrentTaskBudget();
+
+	KlogStr(KLOG_SEMAPHORE_DEBUG, "Mutex Unlock :- ", g_current_task->name);
+	ReleaseMutex(mtxobj);
+
+	// Hand over the mutex to a task that waited for it
+	OS_Task * task = GetNextHolder(mtxobj);
+	if(task) {
+
+		AcquireMutex(mtxobj, task, FALSE);
+		_OS_SchedulerUnblockTask(task);
+
+		if(task->syscall_result) {
+			task->syscall_result[0] = SUCCESS;
+		}
+	}
+
+	// The system ceiling may be lower now. The tasks held back by it are checked again
+	// when they are scheduled
+	_OS_SchedulerReleaseCeilingBlocked();
+
+	if(g_current_task->syscall_result) {
+		g_current_task->syscall_result[0] = SUCCESS;
+	}
+
+	_OS_Schedule();
+
+exit:
+	return status;
+}
+
+OS_Return _OS_MutexFree(OS_Mutex_t mutex)
+{
+	OS_Return status;
+
+	if((status = assert_mutex_open(mutex)) != SUCCESS) {
+		goto exit;
+	}
+
+	// Get the Mutex object
+	OS_MutexCB * mtxobj = (OS_MutexCB *)&g_mutex_pool[mutex];
+
+	// Make sure that the current process owns the Mutex.
+	if(mtxobj->owner != (OS_Process *) g_current_process) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+
+	// The tasks wait only for a locked mutex. So there is no one to wake up
+	if(mtxobj->holder) {
+		status = RESOURCE_BUSY;
+		goto exit;
+	}
+
+	mtxobj->ceiling = OS_MUTEX_NO_CEILING;
+	mtxobj->owner = NULL;
+
+	SetResourceStatus(g_mutex_usage_mask, mutex, TRUE);
+
+exit:
+	return status;
+}
+
+void _OS_MutexWaiterUpdate(OS_Task * task)
+{
+	OS_MutexCB * mtxobj = g_mutex_waiting_on[task->id];
+
+	if(mtxobj) {
+		_OS_NPQueueDelete(&mtxobj->periodic_wait_queue, (_OS_TaskQNode *) task);
+		_OS_NPQueueInsertSorted(&mtxobj->periodic_wait_queue, (_OS_TaskQNode *) task);
+	}
+}
+
+void _OS_MutexReleaseHeld(OS_Task * task)
+{
+	OS_MutexCB * mtxobj = g_locked_mutex_list;
+	OS_Task * next;
+
+	if(!g_mutex_held_count[task->id]) {
+		return;
+	}
+
+	while(mtxobj) {
+
+		if(mtxobj->holder != task) {
+			mtxobj = mtxobj->next_locked;
+			continue;
+		}
+
+		KlogStr(KLOG_SEMAPHORE_DEBUG, "Mutex Release (Abort) :- ", task->name);
+		ReleaseMutex(mtxobj);
+
+		// Hand over the mutex to a task that waited for it, as in _OS_MutexUnlock
+		next = GetNextHolder(mtxobj);
+		if(next) {
+
+			AcquireMutex(mtxobj, next, FALSE);
+			_OS_SchedulerUnblockTask(next);
+
+			if(next->syscall_result) {
+				next->syscall_result[0] = SUCCESS;
+			}
+		}
+
+		// The list changed. Look for the next mutex of the task from the start
+		mtxobj = g_locked_mutex_list;
+	}
+
+	_OS_SchedulerReleaseCeilingBlocked();
+}
+
+BOOL _OS_MutexCeilingBlocks(const OS_Task * task)
+{
+	return (g_system_ceiling != OS_MUTEX_NO_CEILING) &&
+			(GetPreemptionLevel(task) >= g_system_ceiling) &&
+			!g_mutex_held_count[task->id];
+}
+
+// Makes the task the holder of the mutex. The task is ready if it is in the ready queue
+static void AcquireMutex(OS_MutexCB * mtxobj, OS_Task * task, BOOL ready)
+{
+	mtxobj->holder = task;
+	mtxobj->next_locked = g_locked_mutex_list;
+	g_locked_mutex_list = mtxobj;
+
+	if(mtxobj->ceiling < g_system_ceiling) {
+		g_system_ceiling = mtxobj->ceiling;
+	}
+
+	if(g_mutex_held_count[task->id]++ ||
+		IS_PERIODIC_TASK(task->attributes) || IS_CBS_TASK(task->attributes)) {
+		return;
+	}
+
+	// The aperiodic task runs ahead of the other aperiodic tasks till it unlocks
+	g_mutex_base_priority[task->id] = (UINT16) task->ap.priority();
+	if(ready) {
+		_OS_BitmapQueueDelete(&g_ap_ready_q, (_OS_TaskQNode *) task);
+		_OS_BitmapQueueInsert(&g_ap_ready_q, (_OS_TaskQNode *) task, 0);
+	}
+	else {
+		task->ap.priority() = 0;
+	}
+}
+
+// Unlocks the mutex held by its holder
+static void ReleaseMutex(OS_MutexCB * mtxobj)
+{
+	OS_MutexCB ** link = &g_locked_mutex_list;
+	OS_MutexCB * node;
+	OS_Task * task = mtxobj->holder;
+
+	// The mutexes need not be unlocked in the reverse order. So take the mutex out
+	// from anywhere in the list and find the highest ceiling of the rest
+	g_system_ceiling = OS_MUTEX_NO_CEILING;
+	while((node = *link) != NULL) {
+
+		if(node == mtxobj) {
+			*link = node->next_locked;
+			continue;
+		}
+
+		if(node->ceiling < g_system_ceiling) {
+			g_system_ceiling = node->ceiling;
+		}
+
+		link = &node->next_locked;
+	}
+
+	mtxobj->holder = NULL;
+	mtxobj->next_locked = NULL;
+
+	if(--g_mutex_held_count[task->id] ||
+		IS_PERIODIC_TASK(task->attributes) || IS_CBS_TASK(task->attributes)) {
+		return;
+	}
+
+	// The aperiodic task gets back its own priority
+	_OS_BitmapQueueDelete(&g_ap_ready_q, (_OS_TaskQNode *) task);
+	_OS_BitmapQueueInsert(&g_ap_ready_q, (_OS_TaskQNode *) task, g_mutex_base_priority[task->id]);
+}
+
+// Takes the next holder out from the wait queues. The periodic / CBS tasks are in the
+// order of their deadlines. The first of them with a pending job comes first, followed
+// by the aperiodic tasks and then by the periodic tasks whose jobs expired
+static OS_Task * GetNextHolder(OS_MutexCB * mtxobj)
+{
+	OS_Task * head = (OS_Task *) mtxobj->periodic_wait_queue.head;
+	OS_Task * task = head;
+	const UINT64 curtime = _OS_GetElapsedTime();
+
+	// The job of a blocked task expires only when it misses its deadline. So the head
+	// is taken unless some deadlines were missed
+	while(task && task->p.job_release_time > curtime) {
+		task = (OS_Task *) task->qp.np_next;
+	}
+
+	if(!task) {
+
+		// Check the aperiodic_wait_queue
+		_OS_PQueueGet(&mtxobj->aperiodic_wait_queue, (_OS_TaskQNode **) &task);
+		if(task) {
+			return task;
+		}
+
+		task = head;
+	}
+
+	if(task) {
+		_OS_NPQueueDelete(&mtxobj->periodic_wait_queue, (_OS_TaskQNode *) task);
+		g_mutex_waiting_on[task->id] = NULL;
+	}
+
+	return task;
+}
+
+static OS_Return assert_mutex_open(OS_Mutex_t mutex)
+{
+	if(mutex < 0 || mutex >= MAX_MUTEX_COUNT) {
+		return BAD_ARGUMENT;
+	}
+
+	if(!IsResourceBusy(g_mutex_usage_mask, mutex)) {
+		return RESOURCE_NOT_OPEN;
+	}
+
+	return SUCCESS;
+}
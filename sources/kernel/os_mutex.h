@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_mutex.h
+//	Author: Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Header file for the OS Mutex APIs
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _OS_MUTEX_H
+#define _OS_MUTEX_H
+
+#include "os_core.h"
+#include "os_types.h"
+#include "os_queue.h"
+#include "os_process.h"
+
+// Preemption level / ceiling of the tasks that are not scheduled by their deadlines
+#define OS_MUTEX_NO_CEILING		((UINT32) -1)
+
+typedef struct OS_MutexCB
+{
+	OS_Task * holder;					// Task that locked the mutex. NULL if it is free
+	UINT32 ceiling;						// Shortest relative deadline (us) of the tasks using the mutex
+	OS_Process * owner;					// Owner process
+	struct OS_MutexCB * next_locked;	// Next mutex in the list of the locked mutexes
+	_OS_Queue periodic_wait_queue;		// Periodic / CBS tasks in the order of their deadlines
+	_OS_Queue aperiodic_wait_queue;		// Aperiodic tasks in the order of their priorities
+
+} OS_MutexCB;
+
+extern OS_MutexCB g_mutex_pool[MAX_MUTEX_COUNT];
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// The mutexes follow the Stack Resource Policy (SRP) of Baker, which bounds the
+// priority inversion under EDF without changing the deadlines of the tasks.
+// The preemption level of a periodic task is its relative deadline and that of a
+// CBS task is its period. A smaller value is a higher level. The ceiling of a
+// mutex is the highest level of the tasks that lock it and the system ceiling is
+// the highest ceiling of the mutexes that are locked now.
+// A task whose level is not above the system ceiling is held back before it
+// starts to run, rather than when it tries to lock. So a job is blocked at most
+// once, for at most one critical section of a job with a longer deadline, and a
+// lock never blocks while all the tasks follow the rules below.
+//
+// The ceiling is given when the mutex is allocated. If it is 0, the ceiling is
+// learnt from the tasks as they lock. Then the first jobs are not protected until
+// every task has locked the mutex once.
+//
+// Rules for the tasks:
+//	- Unlock the mutexes before the job completes
+//	- Do not wait on a semaphore / IO while holding a mutex
+//
+// A job that is aborted (OVERRUN_ABORT or a low criticality job dropped in the
+// high criticality mode) or a task that ends for good gives up the mutexes it
+// holds at that point, as if it unlocked them. The data that they protect may be
+// left half updated. So a task with OVERRUN_ABORT should keep its critical
+// sections short enough to finish within its budget, or check the data again
+// when it locks.
+//
+// If a task locks a mutex that is held anyway (a wrong ceiling or a broken rule),
+// it waits for the mutex as with a semaphore. The mutex is handed over to the
+// waiter with the earliest deadline.
+// The aperiodic tasks do not have a preemption level. They run at the highest
+// aperiodic priority while they hold a mutex.
+// With the static schedule there is no ceiling. The mutexes then work as binary
+// semaphores.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+OS_Return _OS_MutexAlloc(OS_Mutex_t *mutex, UINT32 ceiling_deadline_us);
+OS_Return _OS_MutexLock(OS_Mutex_t mutex);
+OS_Return _OS_MutexUnlock(OS_Mutex_t mutex);
+OS_Return _OS_MutexFree(OS_Mutex_t mutex);
+
+// Moves a periodic task waiting for a mutex to its new place in the wait queue.
+// The scheduler calls it when the deadline of a blocked task changes. Nothing is done
+// if the task is not waiting for a mutex
+// ASSUMPTION: The interrupts are disabled
+void _OS_MutexWaiterUpdate(OS_Task * task);
+
+// Unlocks every mutex held by the task, handing each over to its next waiter, and
+// lowers the system ceiling. It is called when the job of the task is aborted or
+// the task ends, so that its mutexes are not left locked for ever
+// ASSUMPTION: The interrupts are disabled and the task is not waiting for a mutex
+void _OS_MutexReleaseHeld(OS_Task * task);
+
+// Checks if the task is held back by the system ceiling. The tasks that hold a
+// mutex are never held back
+// ASSUMPTION: The interrupts are disabled
+BOOL _OS_MutexCeilingBlocks(const OS_Task * task);
+
+#endif //_OS_MUTEX_H
@@ -37,6 +37,10 @@ UINT32 g_rdfile_usage_mask[(MAX_OPEN_FILES + 31) >> 5];
 
 #define MAX_LOADABLE_SECTIONS	16
 
+#if ENABLE_MMU && (ENABLE_MMU_ASID==1) && (MAX_PROCESS_COUNT > MAX_ASID)
+	#error "Each process needs a unique ASID. MAX_PROCESS_COUNT should not exceed MAX_ASID"
+#endif
+
 OS_Return OS_CreateProcess(
 	OS_Process_t *process,
 	const INT8 *process_name,
@@ -98,6 +102,14 @@ OS_Return OS_CreateProcess(
 	// Note that this does not compromise the security as the user mode cannot read/write
 	// anything in the kernel memory map
 	_OS_create_kernel_memory_map(pcb->ptable);
+
+#if ENABLE_MMU_ASID==1
+	// Each process gets a unique ASID. So there is no need to recycle them.
+	pcb->asid = pcb->id + 1;
+	
+	// The process resource may have been used before. Discard the old TLB entries of this ASID
+	FLUSH_PROCESS_TLB(pcb);
+#endif
 #endif	
 
 	// Block the process resource
@@ -203,26 +215,26 @@ OS_Return OS_CreateProcessFromFile(
 			_MMU_add_l2_small_page_va_to_pa_map(pcb->ptable,
 									sections[i].vaddr, sections[i].vaddr,
 									sections[i].size, ap, 
-									TRUE, TRUE);
+									TRUE, TRUE, FALSE);
 									
 			// Also map this place in the kernel process
 			_MMU_add_l2_small_page_va_to_pa_map(g_kernel_process->ptable,
 									sections[i].vaddr, sections[i].vaddr,
 									sections[i].size, KERNEL_RW_USER_NA,
-									TRUE, TRUE);
+									TRUE, TRUE, FALSE);
 #elif USER_PAGE_SIZE==64
 
 			// Create a map in the user process
 			_MMU_add_l2_large_page_va_to_pa_map(pcb->ptable,
 									sections[i].vaddr, sections[i].vaddr,
 									sections[i].size, ap, 
-									TRUE, TRUE);
+									TRUE, TRUE, FALSE);
 
 			// Also map this place in the kernel process
 			_MMU_add_l2_large_page_va_to_pa_map(g_kernel_process->ptable,
 									sections[i].vaddr, sections[i].vaddr,
 									sections[i].size, KERNEL_RW_USER_NA, 
-									TRUE, TRUE);
+									TRUE, TRUE, FALSE);
 #else
 	#error "Supported values for USER_PAGE_SIZE is either 4 or 64"
 #endif
@@ -235,3 +247,14 @@ OS_Return OS_CreateProcessFromFile(
 	
 	return status;	
 }
+
+///////////////////////////////////////////////////////////////////////////////
+// OS_SetProcessReservation:
+// Reserves budget_in_us of CPU time in every period_in_us for the current process
+// It should be called before the process creates its periodic / CBS tasks
+///////////////////////////////////////////////////////////////////////////////
+OS_Return OS_SetProcessReservation(UINT32 budget_in_us, UINT32 period_in_us)
+{
+	return _OS_SetProcessReservation(g_current_process ? g_current_process : g_kernel_process,
+		budget_in_us, period_in_us);
+}
@@ -35,7 +35,17 @@ typedef struct OS_Process
 
 #if ENABLE_MMU
 	_MMU_L1_PageTable * ptable;
+#if ENABLE_MMU_ASID==1
+	UINT32 asid;		// Address Space ID used to tag the non-global TLB entries
 #endif
+#endif
+
+	// CPU reservation of the process. The process server stands for the process in
+	// g_ready_q and the ready tasks of the process are kept in ready_q by their deadline.
+	// The server is NULL if the process does not have a reservation
+	union OS_Task * server;
+	_OS_Queue ready_q;
+	UINT64 allocated_cpu;		// Sum of budget / period of the tasks in the reservation
 
 	// Pointer to next process in the list
 	struct OS_Process *next;	
@@ -10,6 +10,20 @@
 #include "os_queue.h"
 #include "os_core.h"
 
+static __inline__ UINT32 CountLeadingZeros(UINT32 input)
+{
+#if defined(__arm__)
+	unsigned int result;
+	
+	__asm__ volatile("clz %0, %1" : "=r" (result) : "r" (input));
+	
+	return result;
+#else
+	// Host builds of the queues (unittests)
+	return input ? __builtin_clz(input) : 32;
+#endif
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //				Q Initialization
 ///////////////////////////////////////////////////////////////////////////////
@@ -20,8 +34,102 @@ void _OS_QueueInit(_OS_Queue * q)
 	ASSERT(q);
 	q->head = q->tail = NULL;
 	q->count = 0;
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+	q->seq = 0;
+#endif
+}
+
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+
+///////////////////////////////////////////////////////////////////////////////
+//				Pairing Heap helpers
+// The root of the heap is kept in q->head. Each node points to its first child
+// using p_child. The children of a node are linked using p_next / p_prev, where
+// p_prev of the first child points back to the parent.
+///////////////////////////////////////////////////////////////////////////////
+
+// Returns TRUE if 'a' should come out of the queue before 'b'. The sequence
+// number preserves the insertion order for equal keys, same as the sorted list
+static __inline__ BOOL HeapLess(const _OS_HybridQNode * a, const _OS_HybridQNode * b)
+{
+	return (a->key < b->key) || ((a->key == b->key) && ((INT32)(a->seq - b->seq) < 0));
+}
+
+// Links two heap roots and returns the new root. Both nodes should not have siblings
+static __inline__ _OS_HybridQNode * HeapLink(_OS_HybridQNode * a, _OS_HybridQNode * b)
+{
+	_OS_HybridQNode * tmp;
+	
+	if(HeapLess(b, a)) {
+		tmp = a; a = b; b = tmp;
+	}
+	
+	// Make 'b' the first child of 'a'
+	b->p_next = a->p_child;
+	if(a->p_child) a->p_child->p_prev = b;
+	b->p_prev = a;
+	a->p_child = b;
+	
+	return a;
+}
+
+// Standard two pass pairing of the sibling list starting at 'first'. 
+// Returns the new root or NULL if the list is empty.
+static _OS_HybridQNode * HeapMergePairs(_OS_HybridQNode * first)
+{
+	_OS_HybridQNode *a, *b, *next, *root;
+	_OS_HybridQNode *list = NULL;
+	
+	// First pass: link the siblings in pairs from left to right. The resulting roots are
+	// pushed onto 'list' using p_next so that the second pass goes from right to left
+	while(first) 
+	{
+		a = first;
+		b = a->p_next;
+		a->p_prev = NULL;
+		
+		if(!b) {
+			a->p_next = list;
+			list = a;
+			break;
+		}
+		
+		next = b->p_next;
+		a->p_next = b->p_next = b->p_prev = NULL;
+		
+		a = HeapLink(a, b);
+		a->p_next = list;
+		list = a;
+		first = next;
+	}
+	
+	if(!list) return NULL;
+	
+	// Second pass: link the roots from right to left into a single tree
+	root = list;
+	list = list->p_next;
+	root->p_next = NULL;
+	while(list) 
+	{
+		next = list->p_next;
+		list->p_next = NULL;
+		root = HeapLink(root, list);
+		list = next;
+	}
+	
+	return root;
 }
 
+// Removes the root of the heap
+static __inline__ void HeapRemoveRoot(_OS_Queue * q, _OS_HybridQNode * node)
+{
+	q->head = HeapMergePairs(node->p_child);
+	node->p_next = node->p_prev = node->p_child = NULL;
+	q->count--;
+}
+
+#endif // OS_PQUEUE_BACKEND
+
 ///////////////////////////////////////////////////////////////////////////////
 //				Q Insertion
 ///////////////////////////////////////////////////////////////////////////////
@@ -30,6 +138,19 @@ void _OS_QueueInit(_OS_Queue * q)
 // location at which it will be inserted. This is a sorted queue on key value.
 void _OS_PQueueInsertWithKey(_OS_Queue * q, _OS_HybridQNode * item, UINT64 key)
 {
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+
+	ASSERT(q && item);
+	
+	item->key = key;
+	item->seq = q->seq++;
+	item->p_next = item->p_prev = item->p_child = NULL;
+	
+	q->head = (q->head) ? HeapLink(q->head, item) : item;
+	q->count++;
+
+#else
+
 	_OS_HybridQNode *node, *prev;
 	ASSERT(q && item);
 	
@@ -61,6 +182,111 @@ void _OS_PQueueInsertWithKey(_OS_Queue * q, _OS_HybridQNode * item, UINT64 key)
 	}
 	
 	q->count++;
+#endif
+}
+
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_SORTED_LIST
+// Merges two lists linked through p_next and sorted by key. The elements of 'a' come
+// before the elements of 'b' with equal keys. The p_prev links are not updated
+static _OS_HybridQNode * MergeSortedLists(_OS_HybridQNode * a, _OS_HybridQNode * b)
+{
+	_OS_HybridQNode *head = NULL, *tail = NULL, *next;
+	
+	while(a && b) 
+	{
+		if(b->key < a->key) {
+			next = b;
+			b = b->p_next;
+		}
+		else {
+			next = a;
+			a = a->p_next;
+		}
+		
+		if(tail) tail->p_next = next;
+		else head = next;
+		tail = next;
+	}
+	
+	next = a ? a : b;
+	if(tail) tail->p_next = next;
+	else head = next;
+	
+	return head;
+}
+
+#endif
+
+// Function to insert a batch of elements into the priority queue. The elements are
+// linked through p_next and their keys are already set. With the sorted list, the batch
+// is sorted and merged with the queue in one pass, which is O(n + k log k) instead of 
+// O(n * k) for inserting them one by one. The elements with equal keys come out in
+// the order of insertion, the batch being inserted in the order of the list.
+void _OS_PQueueInsertBatch(_OS_Queue * q, _OS_HybridQNode * items)
+{
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+
+	_OS_HybridQNode * next;
+	
+	// The heap insertion is O(1) anyway
+	while(items) 
+	{
+		next = items->p_next;
+		_OS_PQueueInsertWithKey(q, items, items->key);
+		items = next;
+	}
+
+#else
+
+	// Natural merge sort of the batch. It is split into runs of ascending keys and
+	// bins[i] has the merge of 2^i runs. The later runs are merged after the earlier ones,
+	// so the equal keys keep their order. The batch is often sorted already, for example
+	// the jobs released together that completed in the EDF order, which is O(k) then.
+	_OS_HybridQNode * bins[32];
+	_OS_HybridQNode *node, *last, *prev = NULL;
+	UINT32 count = 0, runs = 0, i;
+	
+	ASSERT(q);
+	
+	if(!items) return;
+	
+	while(items)
+	{
+		node = last = items;
+		count++;
+		while(last->p_next && (last->p_next->key >= last->key)) {
+			last = last->p_next;
+			count++;
+		}
+		
+		items = last->p_next;
+		last->p_next = NULL;
+		
+		for(i = 0; runs & (1 << i); i++) {
+			node = MergeSortedLists(bins[i], node);
+		}
+		
+		bins[i] = node;
+		runs++;
+	}
+	
+	// Merge the remaining bins, later (smaller) bins first
+	node = NULL;
+	for(i = 0; runs >> i; i++) {
+		if(runs & (1 << i)) node = MergeSortedLists(bins[i], node);
+	}
+	
+	q->head = MergeSortedLists(q->head, node);
+	
+	// Fix the backward links and the tail
+	for(node = q->head; node; node = node->p_next) {
+		node->p_prev = prev;
+		prev = node;
+	}
+	
+	q->tail = prev;
+	q->count += count;
+#endif
 }
 
 // Function to insert an element into the non-priority queue
@@ -82,6 +308,38 @@ void _OS_NPQueueInsert(_OS_Queue * q, _OS_HybridQNode * item)
 	q->count++;
 }
 
+// Function to insert an element into the non-priority queue in the order of its key,
+// which the caller sets. The element goes after the ones with equal keys. The search
+// starts from the tail as the new elements usually have the largest keys
+void _OS_NPQueueInsertSorted(_OS_Queue * q, _OS_HybridQNode * item)
+{
+	_OS_HybridQNode * prev;
+	ASSERT(q && item);
+
+	prev = q->tail;
+	while(prev && (prev->key > item->key)) {
+		prev = prev->np_prev;
+	}
+
+	item->np_prev = prev;
+	if(prev) {
+		item->np_next = prev->np_next;
+		prev->np_next = item;
+	}
+	else {
+		item->np_next = q->head;
+		q->head = item;
+	}
+
+	if(item->np_next) {
+		item->np_next->np_prev = item;
+	}
+	else {
+		q->tail = item;
+	}
+	q->count++;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //				Q Deletions
 // Functions to delete an item from the queue. Returns true if the item is deleted.
@@ -94,6 +352,42 @@ BOOL _OS_PQueueDelete(_OS_Queue * q, _OS_HybridQNode * item)
     _OS_HybridQNode * next, * prev;
     ASSERT(q && item);
 
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+
+	if(item == q->head) {
+		HeapRemoveRoot(q, item);
+		return TRUE;
+	}
+	
+	// Unlink the item from its sibling list. If it is the first child, 
+	// p_prev points to the parent
+	next = item->p_next;
+	prev = item->p_prev;
+	ASSERT(prev);
+	
+	if(prev->p_child == item) {
+		prev->p_child = next;
+	}
+	else {
+		prev->p_next = next;
+	}
+	
+	if(next) {
+		next->p_prev = prev;
+	}
+	
+	// Merge the children of the item back into the heap
+	next = HeapMergePairs(item->p_child);
+	if(next) {
+		q->head = HeapLink(q->head, next);
+	}
+	
+	item->p_next = item->p_prev = item->p_child = NULL;
+	q->count--;
+	return TRUE;
+
+#else
+
 	next = item->p_next;
 	prev = item->p_prev;
 	item->p_next = NULL;
@@ -114,6 +408,7 @@ BOOL _OS_PQueueDelete(_OS_Queue * q, _OS_HybridQNode * item)
 	}
 	q->count--;
 	return TRUE;
+#endif
 }
 
 BOOL _OS_NPQueueDelete(_OS_Queue * q, _OS_HybridQNode * item)
@@ -157,6 +452,9 @@ void _OS_PQueueGet(_OS_Queue * q, _OS_HybridQNode ** item)
 	if(item) *item = node;
 	if(node) 
 	{
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+		HeapRemoveRoot(q, node);
+#else
 		q->head = node->p_next;
 		if(!q->head) {
 			q->tail = NULL;
@@ -166,6 +464,7 @@ void _OS_PQueueGet(_OS_Queue * q, _OS_HybridQNode ** item)
 		}
 		node->p_next = node->p_prev = NULL;
 		q->count--;
+#endif
 	}
 }
 
@@ -179,6 +478,9 @@ void _OS_PQueueGetWithKey(_OS_Queue * q, _OS_HybridQNode ** item, UINT64 * key)
 	if(node) 
 	{
 		*key = node->key;
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+		HeapRemoveRoot(q, node);
+#else
 		q->head = node->p_next;
 		if(!q->head) {
 			q->tail = NULL;
@@ -188,6 +490,7 @@ void _OS_PQueueGetWithKey(_OS_Queue * q, _OS_HybridQNode ** item, UINT64 * key)
 		}
 		node->p_next = node->p_prev = NULL;
 		q->count--;
+#endif
 	}
 }
 
@@ -237,3 +540,116 @@ BOOL _OS_QueuePeekWithKey(_OS_Queue * q, _OS_HybridQNode ** item, UINT64 * key)
 	}
 	return FALSE;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+//				Bitmap Queue
+// Level 'n' is the bit (31 - (n & 31)) of level_map[n >> 5]. Group 'g' is the bit
+// (31 - g) of group_map. So CountLeadingZeros gives the smallest non-empty level at both levels.
+///////////////////////////////////////////////////////////////////////////////
+
+void _OS_BitmapQueueInit(_OS_BitmapQueue * q)
+{
+	UINT32 i;
+	ASSERT(q);
+	
+	q->group_map = 0;
+	for(i = 0; i < OS_BITMAP_QUEUE_GROUPS; i++) {
+		q->level_map[i] = 0;
+	}
+	for(i = 0; i < OS_BITMAP_QUEUE_LEVELS; i++) {
+		q->head[i] = NULL;
+	}
+	q->count = 0;
+}
+
+// Inserts the item at the tail of the list for the key
+void _OS_BitmapQueueInsert(_OS_BitmapQueue * q, _OS_HybridQNode * item, UINT32 key)
+{
+	_OS_HybridQNode * head;
+	ASSERT(q && item && (key < OS_BITMAP_QUEUE_LEVELS));
+	
+	item->key = key;
+	item->p_next = NULL;
+	
+	head = q->head[key];
+	if(head) {
+		item->p_prev = head->p_prev;
+		head->p_prev->p_next = item;
+		head->p_prev = item;
+	}
+	else {
+		item->p_prev = item;
+		q->head[key] = item;
+		q->level_map[key >> 5] |= (0x80000000 >> (key & 0x1f));
+		q->group_map |= (0x80000000 >> (key >> 5));
+	}
+	
+	q->count++;
+}
+
+// Deletes the item from the list for its key. The item should be in the queue
+BOOL _OS_BitmapQueueDelete(_OS_BitmapQueue * q, _OS_HybridQNode * item)
+{
+	_OS_HybridQNode * head, * next;
+	UINT32 key;
+	ASSERT(q && item);
+	
+	key = (UINT32) item->key;
+	head = q->head[key];
+	next = item->p_next;
+	ASSERT(head);
+	
+	if(item == head) {
+		q->head[key] = next;
+		if(next) {
+			next->p_prev = item->p_prev;		// The tail
+		}
+		else {
+			// The list is empty now
+			q->level_map[key >> 5] &= ~(0x80000000 >> (key & 0x1f));
+			if(!q->level_map[key >> 5]) {
+				q->group_map &= ~(0x80000000 >> (key >> 5));
+			}
+		}
+	}
+	else {
+		item->p_prev->p_next = next;
+		if(next) {
+			next->p_prev = item->p_prev;
+		}
+		else {
+			head->p_prev = item->p_prev;		// The tail was deleted
+		}
+	}
+	
+	item->p_next = item->p_prev = NULL;
+	q->count--;
+	return TRUE;
+}
+
+void _OS_BitmapQueueGet(_OS_BitmapQueue * q, _OS_HybridQNode ** item)
+{
+	_OS_HybridQNode * node;
+	
+	_OS_BitmapQueuePeek(q, &node);
+	if(item) *item = node;
+	if(node) {
+		_OS_BitmapQueueDelete(q, node);
+	}
+}
+
+BOOL _OS_BitmapQueuePeek(_OS_BitmapQueue * q, _OS_HybridQNode ** item)
+{
+	UINT32 group;
+	ASSERT(q);
+	
+	if(!q->group_map) {
+		if(item) *item = NULL;
+		return FALSE;
+	}
+	
+	group = CountLeadingZeros(q->group_map);
+	if(item) *item = q->head[(group << 5) + CountLeadingZeros(q->level_map[group])];
+	
+	return TRUE;
+}
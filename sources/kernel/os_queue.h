@@ -15,32 +15,72 @@
 // This is a Hybrid queue where each element can participate in two queues at the same time.
 // One priority queue and one non-priority queue. This routine is heavily used while managing
 // task queues where there is a need to keep a single task in multiple queues
+//
+// The priority queue has two possible implementations selected by OS_PQUEUE_BACKEND
+// in os_config.h. The sorted list keeps p_next/p_prev as a doubly linked list
+// ordered by key. The pairing heap reuses p_next/p_prev as the sibling links and
+// adds a child link, which makes the insertion O(1) and the removal O(log n) amortized.
+// In both cases the elements with equal keys come out in the order of insertion.
 ///////////////////////////////////////////////////////////////////////////////
 
 ///////////////////////////////////////////////////////////////////////////////
 // Necessary Include Files
 ///////////////////////////////////////////////////////////////////////////////
 #include "os_types.h"	// Include common data types being used
+#include "os_config.h"
 
+// NOTE: The size of this structure is used in the assembly (QNODE_SIZE_IN_TCB) 
 typedef struct _OS_HybridQNode
 {	
 	struct _OS_HybridQNode * np_next;	// NonPriority Queue Next
 	struct _OS_HybridQNode * np_prev;	// NonPriority Queue Previous
-	struct _OS_HybridQNode * p_next;	// Priority Queue Next
-	struct _OS_HybridQNode * p_prev;	// Priority Queue Previous
+	struct _OS_HybridQNode * p_next;	// Priority Queue Next (Heap: next sibling)
+	struct _OS_HybridQNode * p_prev;	// Priority Queue Previous (Heap: previous sibling or parent)
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+	struct _OS_HybridQNode * p_child;	// Heap: first child
+	UINT32 seq;							// Heap: insertion order for elements with equal keys
+#endif
 	UINT64 key;							// Priority Key
 	
 } __attribute__ ((packed)) _OS_HybridQNode;
 
 // Following type can be with for both Priority and NonPriority queues
+// When used as a heap, the head is the root of the heap and the tail is not used
 typedef struct
 {
 	_OS_HybridQNode * head;
 	_OS_HybridQNode * tail;
 	UINT32 count;
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+	UINT32 seq;							// Sequence number for the next insertion
+#endif
 	
 } _OS_Queue;
 
+///////////////////////////////////////////////////////////////////////////////
+// Bitmap priority queue for small keys (0 to OS_BITMAP_QUEUE_LEVELS - 1)
+// There is a FIFO list for each key and a two level bitmap of the non-empty lists.
+// So the insertion, deletion and getting the first element are O(1) irrespective of
+// the number of elements. The elements with equal keys come out in the order of 
+// insertion, same as the priority queue above. Only the p_next/p_prev links are used.
+///////////////////////////////////////////////////////////////////////////////
+// The idle task uses the level after MIN_PRIORITY so that it runs after all other tasks
+#define OS_BITMAP_QUEUE_LEVELS			(MIN_PRIORITY + 2)
+#define OS_BITMAP_QUEUE_GROUPS			((OS_BITMAP_QUEUE_LEVELS + 31) >> 5)
+
+#if OS_BITMAP_QUEUE_GROUPS > 32
+#error "The bitmap queue supports only up to 1024 levels"
+#endif
+
+typedef struct
+{
+	UINT32 group_map;									// Bit for each group of 32 levels. MSB is group 0
+	UINT32 level_map[OS_BITMAP_QUEUE_GROUPS];			// Bit for each level. MSB is the first level in the group
+	_OS_HybridQNode * head[OS_BITMAP_QUEUE_LEVELS];	// The p_prev of the head points to the tail
+	UINT32 count;
+	
+} _OS_BitmapQueue;
+
 ///////////////////////////////////////////////////////////////////////////////
 // Queue manipulation function
 // Some of these functions intentionally don't return error values to keep them
@@ -55,6 +95,15 @@ void _OS_QueueInit(_OS_Queue * q);
 void _OS_PQueueInsertWithKey(_OS_Queue * q, _OS_HybridQNode * item, UINT64 key);
 void _OS_NPQueueInsert(_OS_Queue * q, _OS_HybridQNode * item);
 
+// Function to insert an element into the non-priority queue in the order of item->key.
+// The non-priority links of an element can be kept sorted while it is in a priority
+// queue with the same key
+void _OS_NPQueueInsertSorted(_OS_Queue * q, _OS_HybridQNode * item);
+
+// Function to insert a batch of elements, linked through p_next, with their keys already
+// set. This is cheaper than inserting them one by one when several elements come together
+void _OS_PQueueInsertBatch(_OS_Queue * q, _OS_HybridQNode * items);
+
 // Function to delete an item from the queue. 
 // Returns true if the item is deleted, false otherwise
 // This function does not actually validate if the element is in the queue, it is the 
@@ -71,4 +120,11 @@ void _OS_NPQueueGet(_OS_Queue * q, _OS_HybridQNode ** item);
 BOOL _OS_QueuePeek(_OS_Queue * q, _OS_HybridQNode ** item);
 BOOL _OS_QueuePeekWithKey(_OS_Queue * q, _OS_HybridQNode ** item, UINT64 * key);
 
+// Bitmap queue functions. Smaller key comes out first
+void _OS_BitmapQueueInit(_OS_BitmapQueue * q);
+void _OS_BitmapQueueInsert(_OS_BitmapQueue * q, _OS_HybridQNode * item, UINT32 key);
+BOOL _OS_BitmapQueueDelete(_OS_BitmapQueue * q, _OS_HybridQNode * item);
+void _OS_BitmapQueueGet(_OS_BitmapQueue * q, _OS_HybridQNode ** item);
+BOOL _OS_BitmapQueuePeek(_OS_BitmapQueue * q, _OS_HybridQNode ** item);
+
 #endif // _OS_QUEUE_H
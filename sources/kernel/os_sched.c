@@ -11,24 +11,52 @@
 #include "os_timer.h"
 #include "util.h"
 #include "sysctl.h"
+#include "target.h"
+#include "os_vfp.h"
+#include "os_trace.h"
+#include "os_stat.h"
+#include "os_mutex.h"
+#include "os_event.h"
 
+#if OS_STATIC_SCHEDULE==1
+#include "os_static_sched.h"
+
+#if (OS_TICKLESS_SCHEDULING==0) || (OS_BUDGET_RECLAMATION==1) || (OS_MIXED_CRITICALITY==1)
+	#error "The static schedule needs OS_TICKLESS_SCHEDULING. It does not support the budget reclamation or the mixed criticality"
+#endif
+#endif
+
+#if OS_TICKLESS_SCHEDULING==1
+// In tickless mode, the periodic timer only maintains the time base. So use the
+// longest interval possible. The job releases are driven by the budget timer.
+#define PERIODIC_TIMER_INTERVAL     MAX_TIMER0_INTERVAL_uS
+
+// Smallest timeout programmed into the budget timer. Events that are already due
+// are handled after this delay
+#define TICKLESS_MIN_TIMEOUT_US     5
+#else
 // The PERIODIC_TIMER_INTERVAL is same as MIN_TASK_PERIOD
 #define PERIODIC_TIMER_INTERVAL     MIN_TASK_PERIOD
+#endif
 
 _OS_Queue g_ready_q;
 _OS_Queue g_wait_q;
-_OS_Queue g_ap_ready_q;
+_OS_BitmapQueue g_ap_ready_q;
 _OS_Queue g_completed_task_q;
 
 // The following queue has all the tasks that are blocked on resources such ASSERT
 // Semaphores or IOs
 _OS_Queue g_periodic_blocked_q;
 
+// The ready tasks that are held back by the mutex ceiling (see os_mutex.h)
+_OS_Queue g_ceiling_blocked_q;
+
 // This global variable can be accessed from outside
 BOOL _OS_IsRunning = FALSE;
 
 // This variable holds the beginning time (in us) of the current period
 // It gets updated everytime the Periodic ISR is fired (NOT updated for budget timer)
+// It is always advanced by PERIODIC_TIMER_INTERVAL, so it does not drift even in tickless mode
 UINT64 g_current_period_us;
 
 // This variable holds the starting time of next period (in us)
@@ -47,12 +75,27 @@ UINT32 g_budget_timer_intr_counter;
 UINT32 g_max_scheduler_elapsed_count;
 UINT32 g_sched_starting_counter_value;
 UINT32 g_sched_ending_counter_value;
+UINT32 g_max_mmu_switch_elapsed_count;
+UINT32 g_schedule_counter;
+UINT32 g_ptable_switch_counter;
+#endif
+
+#if ENABLE_MMU && (ENABLE_MMU_ASID==1)
+// The process whose page table & ASID are currently set in the MMU
+static OS_Process * g_mmu_current_process;
 #endif
 static char os_name_string [] = { OS_NAME_STRING };
 
 OS_Task * g_idle_task;  // A TCB for the idle task
 static UINT32 g_idle_task_stack [OS_IDLE_TASK_STACK_SIZE];
 
+#if OS_MIXED_CRITICALITY==1
+// The system is in the high criticality mode from the time a high criticality job
+// exceeds its low criticality budget till the CPU becomes idle
+BOOL g_high_criticality_mode = FALSE;
+UINT32 g_criticality_switch_count;
+#endif
+
 extern OS_Process * g_kernel_process;	// Kernel process
 
 
@@ -60,10 +103,109 @@ extern OS_Process * g_kernel_process;	// Kernel process
 void main(int argc, char **argv);
 static void CheckTaskBudgetDline(OS_Task * task);
 static void UpdatePeriodicBlockedQueue(void);
+static void ReleaseJobs(void);
+static void ChargeTaskBudget(OS_Task * task, UINT32 budget_spent, UINT64 now);
+static void ChargeServerBudget(OS_Task * task, UINT32 budget_spent, UINT64 now);
+static void ChargeProcessServer(OS_Task * task, UINT32 budget_spent, UINT64 now);
+static UINT64 GetServerDeadline(OS_Task * task, UINT64 now);
+#if OS_STATIC_SCHEDULE==0
+static UINT32 GetUsableBudget(OS_Task * task, UINT64 now);
+#endif
+static void ExpireDeadline(OS_Task * task, UINT64 now);
+static void ReleaseJob(OS_Task * task, UINT64 now);
+static void StartNextJob(OS_Task * task, UINT64 now);
+static void HandleOverrun(OS_Task * task, BOOL blocked);
+static void AbortJob(OS_Task * task);
+static void NotifyOverrun(OS_Task * task);
 static void _OS_idle_task(void * ptr);
 
 #define MIN(a, b)   (((a) > (b)) ? (b) : (a))
 
+#if OS_TICKLESS_SCHEDULING==1
+static UINT32 GetPeriodOffset(void);
+static UINT64 GetNextEventTime(void);
+static void SetReleaseTimer(UINT64 now, UINT64 abs_timeout_us);
+#else
+#define GetPeriodOffset()   _OS_Timer_GetTimeElapsed_us(PERIODIC_TIMER)
+#endif
+
+#if OS_BUDGET_RECLAMATION==1
+// Budget left by a job which completed early. It can be used until the job deadline
+typedef struct
+{
+	UINT64 deadline;
+	UINT32 budget;
+	
+} _OS_SpareBudget;
+
+// Spare budgets sorted by their deadlines
+static _OS_SpareBudget g_spare_budget[OS_MAX_SPARE_BUDGETS];
+static UINT32 g_spare_budget_count;
+
+static void DonateSpareBudget(UINT64 deadline, UINT32 budget, UINT64 now);
+static UINT32 GetSpareBudget(UINT64 deadline, UINT64 now);
+static UINT32 UseSpareBudget(UINT64 deadline, UINT64 start, UINT32 budget_spent);
+#endif
+
+#if OS_STATIC_SCHEDULE==1
+// The TCBs of the tasks in the static schedule in the order of the table
+static OS_Task * g_static_task[OS_STATIC_MAX_TASKS];
+
+// The periodic tasks blocked on semaphores etc. indexed by the task id
+static UINT32 g_static_blocked_mask[(MAX_TASK_COUNT + 31) >> 5];
+
+// The current slot and the start of the current hyperperiod
+static const OS_StaticSlot * g_static_slot;
+static INT64 g_static_frame_start;
+
+static void BindStaticSchedule(void);
+static void AdvanceStaticSchedule(UINT64 now);
+static UINT64 GetNextSlotTime(void);
+static OS_Task * GetStaticSlotTask(void);
+#endif
+
+#if OS_MIXED_CRITICALITY==1
+static void DropJobs(OS_Task * task, UINT64 now, BOOL blocked);
+static void SwitchToHighCriticality(UINT64 now);
+
+// The relative deadline of the next job. The high criticality tasks use the virtual 
+// deadline in the low criticality mode
+static __inline__ UINT32 GetJobDeadline(OS_Task * task)
+{
+	return (!g_high_criticality_mode && IS_HI_CRITICALITY_TASK(task->attributes)) ? 
+		task->p.virtual_deadline : task->p.deadline;
+}
+
+// The budget of the next job in the current criticality mode
+static __inline__ UINT32 GetJobBudget(OS_Task * task)
+{
+	return g_high_criticality_mode ? task->p.budget_hi : task->p.budget;
+}
+#else
+#define GetJobDeadline(task)	((task)->p.deadline)
+#define GetJobBudget(task)		((task)->p.budget)
+#endif
+
+#if OS_STATIC_SCHEDULE==0
+static void BlockOnCeiling(OS_Task * task);
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the server of the process reservation which the task runs in. NULL if the
+// process does not have a reservation or if the task is the server itself
+///////////////////////////////////////////////////////////////////////////////
+static __inline__ OS_Task * GetProcessServer(OS_Task * task)
+{
+	OS_Task * server = task->owner_process->server;
+	return (server != task) ? server : NULL;
+}
+
+// Returns the ready queue for a periodic / CBS task
+static __inline__ _OS_Queue * GetReadyQueue(OS_Task * task)
+{
+	return GetProcessServer(task) ? &task->owner_process->ready_q : &g_ready_q;
+}
+
 static __inline__ UINT32 clz(UINT32 input)
 {
 	unsigned int result;
@@ -84,7 +226,13 @@ void _OS_Start()
     {
         // Reset the global timer variables
         g_current_period_us = 0;
+#if OS_TICKLESS_SCHEDULING==1
+        // The jobs are released before the first periodic interrupt. So the time base
+        // starts now, rather than at the first periodic interrupt
+        g_next_period_us = PERIODIC_TIMER_INTERVAL;
+#else
         g_next_period_us = 0;
+#endif
         g_current_period_offset_us = 0;
 
         // Reset the current task
@@ -99,6 +247,11 @@ void _OS_Start()
             g_current_process = g_current_process->next;
         }
 
+#if OS_STATIC_SCHEDULE==1
+        // The periodic jobs are released by the static schedule from now on
+        BindStaticSchedule();
+#endif
+
 #if ENABLE_MMU		
 		// We need to set permissions in the domain access register before we enable MMU
 		// DOMAIN_ACCESS_CLIENT specifies that the permission bits should be used from the Page Tables
@@ -110,7 +263,12 @@ void _OS_Start()
 		_sysctl_flush_tlb();
 		
 		// Before enabling MMU, set the page table address in SYSCTL register
+#if ENABLE_MMU_ASID==1
+		_sysctl_set_ptable_asid((PADDR)g_kernel_process->ptable, g_kernel_process->asid);
+		g_mmu_current_process = g_kernel_process;
+#else
 		_sysctl_set_ptable((PADDR)g_kernel_process->ptable);
+#endif
 
 		// Start the MMU and Virtual Memory
 		_sysctl_enable_mmu();	
@@ -120,6 +278,11 @@ void _OS_Start()
         // Start the Periodic timer
         _OS_Timer_PeriodicTimerStart(PERIODIC_TIMER_INTERVAL);
 
+#if OS_TICKLESS_SCHEDULING==1
+        // There is no periodic tick to release the first jobs. So arm the budget timer
+        SetReleaseTimer(0, GetNextEventTime());
+#endif
+
 #if OS_ENABLE_CPU_STATS==1
         Syslog32("Max periodic timer count = ", _OS_Timer_GetMaxCount(PERIODIC_TIMER));
 #endif
@@ -186,10 +349,10 @@ static void _OS_idle_task(void * ptr)
 ///////////////////////////////////////////////////////////////////////////////
 void _OS_PeriodicTimerISR(void *arg)
 {
-    UINT64 new_time = 0;
     OS_Task * task = (OS_Task *)arg;
 
     KlogStr(KLOG_PERIODIC_TIMER_ISR, "Periodic ISR - ", task->name);
+    OS_TRACE(TRACE_IRQ, task, PERIODIC_TIMER);
                 
     // Acknowledge the timer interrupt
     _OS_Timer_AckInterrupt(PERIODIC_TIMER);
@@ -197,7 +360,12 @@ void _OS_PeriodicTimerISR(void *arg)
     // Update timer variables
     g_current_period_us = g_next_period_us;
     g_next_period_us += PERIODIC_TIMER_INTERVAL;
+#if OS_TICKLESS_SCHEDULING==1
+    // The periodic interrupt may have been held off while the interrupts were disabled
+    g_current_period_offset_us = GetPeriodOffset();
+#else
     g_current_period_offset_us = 0;    
+#endif
     
 #if OS_ENABLE_CPU_STATS==1
     g_sched_starting_counter_value = _OS_Timer_GetMaxCount(PERIODIC_TIMER);
@@ -212,22 +380,7 @@ void _OS_PeriodicTimerISR(void *arg)
     UpdatePeriodicBlockedQueue();
     
     // Consider new jobs to be introduced from the wait queue
-    while(_OS_QueuePeekWithKey(&g_wait_q, NULL, &new_time))
-    {
-        if(new_time > g_current_period_us) break;
-		
-        // Dequeue the new task from the queue.
-        _OS_PQueueGet(&g_wait_q, (_OS_TaskQNode**) &task);
-        
-		ASSERT(g_current_period_us == task->p.job_release_time);
-        
-        // Reset the remaining budget to full
-        task->p.remaining_budget = task->p.budget;
-        
-        // Insert into ready queue with deadline as the key. This is where the EDF scheduler
-        // is coming into picture
-        _OS_SetAlarm(task, g_current_period_us + task->p.deadline, TRUE);
-    }
+    ReleaseJobs();
     
     // Call the OS Scheduler function to schedule the next task
     _OS_Schedule();
@@ -241,6 +394,7 @@ void _OS_BudgetTimerISR(void *arg)
     OS_Task * task = (OS_Task *)arg;
     
     KlogStr(KLOG_BUDGET_TIMER_ISR, "Budget/Dline ISR - ", task->name);
+    OS_TRACE(TRACE_IRQ, task, BUDGET_TIMER);
 
     // Acknowledge the timer interrupt
     _OS_Timer_AckInterrupt(BUDGET_TIMER);
@@ -251,7 +405,7 @@ void _OS_BudgetTimerISR(void *arg)
 #endif
     
     // Get the time elapsed since the beginning of the period
-    g_current_period_offset_us = _OS_Timer_GetTimeElapsed_us(PERIODIC_TIMER);
+    g_current_period_offset_us = GetPeriodOffset();
         
     // Some ready task must have exceeded its budget or deadline
     // Do the necessary handling
@@ -261,6 +415,11 @@ void _OS_BudgetTimerISR(void *arg)
     // for periodic tasks
     UpdatePeriodicBlockedQueue();
     
+#if OS_TICKLESS_SCHEDULING==1
+    // In tickless mode, this timer is also used for releasing new jobs
+    ReleaseJobs();
+#endif
+
     // Call the OS Scheduler function to schedule the next task
     _OS_Schedule();
 }
@@ -280,24 +439,213 @@ static void UpdatePeriodicBlockedQueue(void)
 		
         // Dequeue the new task from the queue.
         _OS_PQueueGet(&g_periodic_blocked_q, NULL);
+        
+#if OS_MIXED_CRITICALITY==1
+		// Only the virtual deadline has expired. The job can still complete in time
+		if(abs_deadline < task->p.job_release_time + task->p.deadline)
+		{
+			_OS_PQueueInsertWithKey(&g_periodic_blocked_q, (_OS_TaskQNode *) task, 
+									task->p.job_release_time + task->p.deadline);
+			_OS_SemWaiterUpdate(task);
+			_OS_EventWaiterUpdate(task);
+			_OS_MutexWaiterUpdate(task);
+			continue;
+		}
+#endif
                 
 		// Deadline has expired
-		// TODO: Take necessary action for deadline miss
 		task->p.dline_miss_count ++;
 
 		KlogStr(KLOG_DEADLINE_MISS, "Deadline Miss (Blocked) - ", task->name);
+		OS_TRACE(TRACE_DEADLINE_MISS, task, task->p.dline_miss_count);
+		HandleOverrun(task, TRUE);
 
         // Reset the remaining budget to full
-        task->p.remaining_budget = task->p.budget;
+        task->p.remaining_budget = GetJobBudget(task);
 
 		// We are done for the current period. Update the next job_release_time.
 		task->p.job_release_time += task->p.period;
 
 		// Re-insert the task with the new deadline
 		_OS_PQueueInsertWithKey(&g_periodic_blocked_q, (_OS_TaskQNode *) task, 
-								task->p.job_release_time + task->p.deadline);
+								task->p.job_release_time + GetJobDeadline(task));
+		
+		// A task waiting on a semaphore has no job waiting till its next release. A task
+		// waiting on an event or a mutex keeps its place by the new deadline
+		_OS_SemWaiterUpdate(task);
+		_OS_EventWaiterUpdate(task);
+		_OS_MutexWaiterUpdate(task);
+		NotifyOverrun(task);
+    }
+    
+    // The semaphore waits that time out. The deadlines are checked first, so that a
+    // wait that times out at the deadline is counted as a miss
+    _OS_SemExpireTimeouts(curtime);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ReleaseJobs
+// Moves the tasks whose release time has arrived from the wait queue to ready queue
+///////////////////////////////////////////////////////////////////////////////
+static void ReleaseJobs(void)
+{
+	UINT64 new_time = 0;
+	const UINT64 curtime = (g_current_period_us + g_current_period_offset_us);
+	OS_Task * task;
+	_OS_TaskQNode *batch = NULL, *batch_tail = NULL;
+
+    while(_OS_QueuePeekWithKey(&g_wait_q, NULL, &new_time))
+    {
+        if(new_time > curtime) break;
+		
+        // Dequeue the new task from the queue.
+        _OS_PQueueGet(&g_wait_q, (_OS_TaskQNode**) &task);
+        
+#if OS_TICKLESS_SCHEDULING==0
+		ASSERT(g_current_period_us == task->p.job_release_time);
+#endif
+        
+        // Many jobs are released together at the harmonic period boundaries. The jobs 
+        // going to g_ready_q are collected and merged into it at once below. The tasks
+        // in a process reservation go to their process ready queue as usual
+        if(GetProcessServer(task)
+#if OS_MIXED_CRITICALITY==1
+        	|| (g_high_criticality_mode && !IS_HI_CRITICALITY_TASK(task->attributes))
+#endif
+        	)
+        {
+        	ReleaseJob(task, curtime);
+        	continue;
+        }
+        
+        task->p.remaining_budget = GetJobBudget(task);
+        task->p.alarm_time() = task->p.job_release_time + GetJobDeadline(task);
+        OS_TRACE(TRACE_RELEASE, task, (UINT32) task->p.alarm_time());
+        ASSERT(task->p.alarm_time() > g_current_period_us);
+        
+        ((_OS_TaskQNode *) task)->key = task->p.alarm_time();
+        ((_OS_TaskQNode *) task)->p_next = NULL;
+        if(batch_tail) batch_tail->p_next = (_OS_TaskQNode *) task;
+        else batch = (_OS_TaskQNode *) task;
+        batch_tail = (_OS_TaskQNode *) task;
     }
+    
+    if(batch)
+    {
+    	_OS_PQueueInsertBatch(&g_ready_q, batch);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Releases the job of a periodic task whose release time has arrived
+///////////////////////////////////////////////////////////////////////////////
+static void ReleaseJob(OS_Task * task, UINT64 now)
+{
+#if OS_MIXED_CRITICALITY==1
+	if(g_high_criticality_mode && !IS_HI_CRITICALITY_TASK(task->attributes))
+	{
+		DropJobs(task, now, FALSE);
+		return;
+	}
+#endif
+
+    // Reset the remaining budget to full
+    task->p.remaining_budget = GetJobBudget(task);
+    OS_TRACE(TRACE_RELEASE, task, (UINT32)(task->p.job_release_time + GetJobDeadline(task)));
+    
+    // Insert into ready queue with deadline as the key. This is where the EDF scheduler
+    // is coming into picture
+    _OS_SetAlarm(task, task->p.job_release_time + GetJobDeadline(task), TRUE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Moves a periodic task to its next job once the current job is done. The task 
+// should be taken out of the ready queue before calling this function
+///////////////////////////////////////////////////////////////////////////////
+static void StartNextJob(OS_Task * task, UINT64 now)
+{
+    // We are done for the current period. Update the next job_release_time.
+    task->p.job_release_time += task->p.period;
+    
+	// If the next job is already due, it goes to the ready queue with the deadline
+	// as the alarm time. Or else, it waits till the next release time
+	if(task->p.job_release_time <= now)
+		ReleaseJob(task, now);
+	else
+		_OS_SetAlarm(task, task->p.job_release_time, FALSE);
+}
+
+#if OS_MIXED_CRITICALITY==1
+///////////////////////////////////////////////////////////////////////////////
+// Drops the released jobs of a low criticality task in the high criticality mode
+// The task waits for its first release after now. The dropped jobs are counted in
+// dropped_count and not in exec_count. A job in progress is aborted like with
+// OVERRUN_ABORT, so that it does not go on in the budget of a later job. A task
+// that was blocked has what it waited for. So it finishes the job instead
+///////////////////////////////////////////////////////////////////////////////
+static void DropJobs(OS_Task * task, UINT64 now, BOOL blocked)
+{
+	if(!blocked)
+	{
+		AbortJob(task);
+	}
+	
+	do
+	{
+		task->p.dropped_count++;
+		task->p.job_release_time += task->p.period;
+		
+	} while(task->p.job_release_time <= now);
+	
+	_OS_SetAlarm(task, task->p.job_release_time, FALSE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Switches to the high criticality mode. The high criticality jobs get the rest of
+// their high criticality budgets and their real deadlines. The low criticality jobs
+// are dropped.
+///////////////////////////////////////////////////////////////////////////////
+static void SwitchToHighCriticality(UINT64 now)
+{
+	_OS_Queue ready_q;
+	OS_Task * task;
+	UINT64 key;
+	
+	KlogStr(KLOG_WARNING, "Switching to high criticality mode", "");
+	
+	g_high_criticality_mode = TRUE;
+	g_criticality_switch_count++;
+	
+	// Every periodic job in g_ready_q changes its deadline. So rebuild the queue
+	_OS_QueueInit(&ready_q);
+	while(_OS_QueuePeekWithKey(&g_ready_q, NULL, &key))
+	{
+		_OS_PQueueGet(&g_ready_q, (_OS_TaskQNode**) &task);
+		_OS_PQueueInsertWithKey(&ready_q, (_OS_TaskQNode *) task, key);
+	}
+	
+	while(_OS_QueuePeekWithKey(&ready_q, NULL, &key))
+	{
+		_OS_PQueueGet(&ready_q, (_OS_TaskQNode**) &task);
+		
+		if(!IS_PERIODIC_TASK(task->attributes))
+		{
+			// CBS tasks & process servers keep their deadlines
+			_OS_PQueueInsertWithKey(&g_ready_q, (_OS_TaskQNode *) task, key);
+		}
+		else if(IS_HI_CRITICALITY_TASK(task->attributes))
+		{
+			task->p.remaining_budget += task->p.budget_hi - task->p.budget;
+			_OS_PQueueInsertWithKey(&g_ready_q, (_OS_TaskQNode *) task, 
+				task->p.job_release_time + task->p.deadline);
+		}
+		else
+		{
+			DropJobs(task, now, FALSE);
+		}
+	}
 }
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 // Check task budget & deadline
@@ -305,20 +653,35 @@ static void UpdatePeriodicBlockedQueue(void)
 static void CheckTaskBudgetDline(OS_Task * task)
 {	
 	UINT64 new_time = 0;
+	const UINT64 curtime = (g_current_period_us + g_current_period_offset_us);
 	UINT32 budget_spent = _OS_Timer_GetTimeElapsed_us(BUDGET_TIMER);
+	OS_Process * process;
     task->accumulated_budget += budget_spent;
     
+#if OS_STATIC_SCHEDULE==1
+    // The periodic jobs follow the static schedule. Their budgets are enforced by the slots
+    AdvanceStaticSchedule(curtime);
+    return;
+#endif
+    
     if(IS_PERIODIC_TASK(task->attributes))
     {
-		// The budget spent should always be < remaining_budget. However because of
-		// inaccuracies in the tick <-> us conversions, it is better to limit the budget_spent
-        if(budget_spent > task->p.remaining_budget)
-			budget_spent = task->p.remaining_budget;
-
-        // Adjust the remaining & accumulated budgets
-		task->p.remaining_budget -= budget_spent;
+        // Adjust the remaining budget
+        ChargeTaskBudget(task, budget_spent, curtime);
+        ChargeProcessServer(task, budget_spent, curtime);
+        
+#if OS_MIXED_CRITICALITY==1
+        // A high criticality job used up its low criticality budget. It gets the rest
+        // of its high criticality budget
+        if((task->p.remaining_budget == 0) && !g_high_criticality_mode && 
+            (task->p.budget_hi > task->p.budget))
+        {
+            SwitchToHighCriticality(curtime);
+        }
+#endif
         
         // If the remaining_budget == 0, there was a TBE exception.
+        // Any spare budget that the task could use is already used up by now.
         if(task->p.remaining_budget == 0)
         {
             KlogStr(KLOG_TBE_EXCEPTION, "TBE Exception = ", task->name);
@@ -326,48 +689,129 @@ static void CheckTaskBudgetDline(OS_Task * task)
             // Count the number of TBEs
             task->p.TBE_count++;
             task->p.exec_count++;
+            OS_TRACE(TRACE_TBE, task, task->p.TBE_count);
             
-            // TODO: Raise the flag saying that the thread has exceeded its budget
+            HandleOverrun(task, FALSE);
             
             // Take the current task out of ready queue
-            _OS_PQueueGet(&g_ready_q, NULL);
-            
-            // We are done for the current period. Update the next job_release_time.
-            task->p.job_release_time += task->p.period;
-            
-			// If we are going to put the task into ready queue, then the alarm time
-			// should be the deadline. Or else, it should be the next release time
-			if(task->p.job_release_time == g_current_period_us)
-				_OS_SetAlarm(task, task->p.job_release_time + task->p.deadline, TRUE);
-			else
-				_OS_SetAlarm(task, task->p.job_release_time, FALSE);
+            _OS_ReadyQueueDelete(task);
+            StartNextJob(task, curtime);
+            NotifyOverrun(task);
         }
     }
+    else if(IS_CBS_TASK(task->attributes))
+    {
+        ChargeServerBudget(task, budget_spent, curtime);
+        ChargeProcessServer(task, budget_spent, curtime);
+    }
     
     // Check if anyone in the ready queue exceeded the deadline
     while(_OS_QueuePeekWithKey(&g_ready_q, NULL, &new_time))
     {
-        if(new_time > (g_current_period_us + g_current_period_offset_us)) break;
+        if(new_time > curtime) break;
         
         // Now get the front task from the queue.
         _OS_PQueueGet(&g_ready_q, (_OS_TaskQNode**) &task);
+        ExpireDeadline(task, curtime);
+    }
+    
+    // The tasks of the processes with a reservation are not in g_ready_q
+    for(process = g_process_list_head; process; process = process->next)
+    {
+        if(!process->server) continue;
         
-        // Deadline has expired
-        // TODO: Take necessary action for deadline miss
+        while(_OS_QueuePeekWithKey(&process->ready_q, (_OS_TaskQNode**) &task, &new_time))
+        {
+            if(new_time > curtime) break;
+            
+            _OS_ReadyQueueDelete(task);
+            ExpireDeadline(task, curtime);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Handles a periodic / CBS task whose deadline has expired in the ready queue
+// The task should be taken out of the ready queue before calling this function
+///////////////////////////////////////////////////////////////////////////////
+static void ExpireDeadline(OS_Task * task, UINT64 now)
+{
+    if(IS_CBS_TASK(task->attributes))
+    {
+        // The server could not use its budget before its deadline. This happens only
+        // when the system is overloaded. Start over with full budget and a new deadline
         task->p.dline_miss_count ++;
-        task->p.exec_count++;
-        
-        KlogStr(KLOG_DEADLINE_MISS, "Deadline Miss - ", task->name);
-        
-        // We are done for the current period. Update the next job_release_time.
-        task->p.job_release_time += task->p.period;
-        
-		// If we are going to put the task into ready queue, then the alarm time
-		// should be the deadline. Or else, it should be the next release time
-		if(task->p.job_release_time == g_current_period_us)
-			_OS_SetAlarm(task, task->p.job_release_time + task->p.deadline, TRUE);
-		else
-			_OS_SetAlarm(task, task->p.job_release_time, FALSE);
+        OS_TRACE(TRACE_DEADLINE_MISS, task, task->p.dline_miss_count);
+        task->p.remaining_budget = task->p.budget;
+        _OS_ReadyQueueInsert(task, now + task->p.period);
+        return;
+    }
+    
+#if OS_MIXED_CRITICALITY==1
+    // Only the virtual deadline has expired. The low criticality jobs cannot be
+    // scheduled as planned. So continue in the high criticality mode
+    if(task->p.alarm_time() < task->p.job_release_time + task->p.deadline)
+    {
+        _OS_ReadyQueueInsert(task, task->p.job_release_time + task->p.deadline);
+        if(!g_high_criticality_mode) SwitchToHighCriticality(now);
+        return;
+    }
+#endif
+    
+    // Deadline has expired
+    task->p.dline_miss_count ++;
+    task->p.exec_count++;
+    
+    KlogStr(KLOG_DEADLINE_MISS, "Deadline Miss - ", task->name);
+    OS_TRACE(TRACE_DEADLINE_MISS, task, task->p.dline_miss_count);
+    HandleOverrun(task, FALSE);
+    
+    StartNextJob(task, now);
+    NotifyOverrun(task);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Applies the overrun policy of a periodic task whose job has exhausted its budget
+// or missed its deadline. It is called before the task moves to its next job.
+// A task blocked on a semaphore is in the semaphore wait queue. So it cannot be
+// restarted and finishes the late job when it is unblocked
+///////////////////////////////////////////////////////////////////////////////
+static void HandleOverrun(OS_Task * task, BOOL blocked)
+{
+    if((task->p.overrun_policy & OVERRUN_ABORT) && !blocked)
+    {
+        AbortJob(task);
+    }
+    
+    if(task->p.overrun_policy & OVERRUN_SKIP)
+    {
+        // The skipped releases are counted as finished jobs like the dropped ones
+        task->p.job_release_time += (UINT64) task->p.period * task->p.overrun_skip;
+        task->p.exec_count += task->p.overrun_skip;
+        task->p.skipped_count += task->p.overrun_skip;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Aborts the job of a periodic task that is not blocked. The mutexes that the job
+// holds are unlocked now, so that they do not hold back the other tasks. The context
+// is rebuilt in _OS_Schedule when the task runs next
+///////////////////////////////////////////////////////////////////////////////
+static void AbortJob(OS_Task * task)
+{
+    _OS_MutexReleaseHeld(task);
+    task->p.restart_job = TRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Wakes up the handler of the overruns of the task. The handler may be waiting in
+// the same queue as the task. So this is called once the task is back in its queue
+///////////////////////////////////////////////////////////////////////////////
+static void NotifyOverrun(OS_Task * task)
+{
+    if(task->p.overrun_policy & OVERRUN_NOTIFY)
+    {
+        _OS_SemSignal(task->p.overrun_sem);
     }
 }
 
@@ -383,9 +827,60 @@ void _OS_SetAlarm(OS_Task *task,
     // Ensure that the timeout is in the future
     ASSERT(abs_time_in_us > g_current_period_us)
         
-    // Insert the task into the g_ready_q / g_wait_q
+    // Insert the task into the ready queue / g_wait_q
     task->p.alarm_time() = abs_time_in_us;
-    _OS_PQueueInsertWithKey((ready ? &g_ready_q : &g_wait_q), (_OS_TaskQNode *) task, abs_time_in_us);
+    if(ready)
+        _OS_ReadyQueueInsert(task, abs_time_in_us);
+    else
+        _OS_PQueueInsertWithKey(&g_wait_q, (_OS_TaskQNode *) task, abs_time_in_us);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Ready queue functions for the periodic & CBS tasks
+// The tasks of a process with a CPU reservation are kept in the process ready queue.
+// The process server is in g_ready_q with the server deadline as long as the process
+// has a ready task. So EDF picks the process first and then the task within the process.
+// ASSUMPTION: The interrupts are disabled
+///////////////////////////////////////////////////////////////////////////////
+void _OS_ReadyQueueInsert(OS_Task * task, UINT64 deadline)
+{
+    OS_Task * server = GetProcessServer(task);
+    
+    if(server)
+    {
+        if(!task->owner_process->ready_q.count)
+        {
+            // The process becomes ready. Start the server as a CBS task would start a new job
+            const UINT64 now = _OS_IsRunning ? _OS_GetElapsedTime() : 0;
+            _OS_PQueueInsertWithKey(&g_ready_q, (_OS_TaskQNode *) server, GetServerDeadline(server, now));
+        }
+        
+        _OS_PQueueInsertWithKey(&task->owner_process->ready_q, (_OS_TaskQNode *) task, deadline);
+    }
+    else
+    {
+        _OS_PQueueInsertWithKey(&g_ready_q, (_OS_TaskQNode *) task, deadline);
+    }
+}
+
+void _OS_ReadyQueueDelete(OS_Task * task)
+{
+    OS_Task * server = GetProcessServer(task);
+    
+    if(server)
+    {
+        _OS_PQueueDelete(&task->owner_process->ready_q, (_OS_TaskQNode *) task);
+        
+        // The process server keeps its budget & deadline till the process is ready again
+        if(!task->owner_process->ready_q.count)
+        {
+            _OS_PQueueDelete(&g_ready_q, (_OS_TaskQNode *) server);
+        }
+    }
+    else
+    {
+        _OS_PQueueDelete(&g_ready_q, (_OS_TaskQNode *) task);
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -397,43 +892,156 @@ void _OS_Schedule()
 {
     OS_Task * task;
     
+#if OS_STATIC_SCHEDULE==1
+    // The budget timer cannot be set for less than TICKLESS_MIN_TIMEOUT_US. So start
+    // the next slot now rather than late if it is that close
+    AdvanceStaticSchedule(g_current_period_us + GetPeriodOffset() + TICKLESS_MIN_TIMEOUT_US);
+    
+    // Run the task of the current slot if its job is pending. Otherwise the rest
+    // of the slot is used by the aperiodic tasks
+    task = GetStaticSlotTask();
+    if(!task)
+    {
+        _OS_BitmapQueuePeek(&g_ap_ready_q, (_OS_TaskQNode**) &task);
+    }
+#else
     // Check if there is any ready task in the periodic ready queue
     // Or else check the Aperiodic ready queue
-    if(!_OS_QueuePeek(&g_ready_q, (_OS_TaskQNode**) &task))
+    while(_OS_QueuePeek(&g_ready_q, (_OS_TaskQNode**) &task))
+    {
+        if(IS_PROCESS_SERVER(task->attributes))
+        {
+            // Run the earliest deadline task of the process within the server budget
+            _OS_QueuePeek(&task->owner_process->ready_q, (_OS_TaskQNode**) &task);
+        }
+        
+        // The SRP does not let a job start while it may need a mutex that is locked
+        if(!_OS_MutexCeilingBlocks(task))
+        {
+            break;
+        }
+        
+        BlockOnCeiling(task);
+    }
+    
+    if(!task)
     {
-        _OS_QueuePeek(&g_ap_ready_q, (_OS_TaskQNode**) &task);
+#if OS_MIXED_CRITICALITY==1
+        // No periodic job is pending. So the low criticality tasks can run again
+        if(g_high_criticality_mode && !g_periodic_blocked_q.count)
+        {
+            g_high_criticality_mode = FALSE;
+        }
+#endif
+        _OS_BitmapQueuePeek(&g_ap_ready_q, (_OS_TaskQNode**) &task);
     }
+#endif
 
     KlogStr(KLOG_CONTEXT_SWITCH, "ContextSW To - ", task->name);
 
-    // For periodic task, set the next budget timeout we should use.
-    if(IS_PERIODIC_TASK(task->attributes))
+#if OS_TICKLESS_SCHEDULING==1
+    {
+        // The timeout to be used = MIN(next job release / blocked task deadline,
+        // task remaining budget, task next deadline)
+        UINT64 now, abs_timeout_us;
+
+        g_current_period_offset_us = GetPeriodOffset();
+        now = g_current_period_us + g_current_period_offset_us;
+        abs_timeout_us = GetNextEventTime();
+
+#if OS_STATIC_SCHEDULE==0
+        if(IS_PERIODIC_TASK(task->attributes))
+        {
+            abs_timeout_us = MIN(abs_timeout_us, task->p.alarm_time());
+            abs_timeout_us = MIN(abs_timeout_us, now + GetUsableBudget(task, now));
+        }
+        else if(IS_CBS_TASK(task->attributes))
+        {
+            abs_timeout_us = MIN(abs_timeout_us, now + GetUsableBudget(task, now));
+        }
+#endif
+
+        SetReleaseTimer(now, abs_timeout_us);
+    }
+#else
+    // For periodic task, set the next budget timeout we should use.
+    if(IS_PERIODIC_TASK(task->attributes))
     {
         // The timeout to be used = MIN(task remaining budget, task next deadline)
         UINT64 now = g_current_period_us + g_current_period_offset_us;
-        UINT64 abs_deadline_us = (task->p.job_release_time + task->p.deadline);
-        UINT64 abs_budget_us = (now + task->p.remaining_budget);
+        UINT64 abs_deadline_us = task->p.alarm_time();
+        UINT64 abs_budget_us = (now + GetUsableBudget(task, now));
         UINT64 abs_timeout_us = MIN(abs_deadline_us, abs_budget_us);
         
-		ASSERT(abs_timeout_us > now);
+        // The budget runs out in a system call, such as a mutex unlock, that comes just
+        // before the budget timer. The timer then fires at once and handles the TBE
+        if(abs_timeout_us <= now)
+        {
+            abs_timeout_us = now + 1;
+        }
             
 		// Set the budget timeout. Even though there may be a periodic interrupt before
 		// the next budget timeout, it is helpful to keep the timer running so that
 		// we can accurately measure the budget spent
 		_OS_Timer_SetTimeout_us(abs_timeout_us - now);
     }
+    else if(IS_CBS_TASK(task->attributes))
+    {
+        // The server deadline is only used for ordering the ready queue. The server 
+        // is preempted when its budget is exhausted
+        UINT64 now = g_current_period_us + g_current_period_offset_us;
+        _OS_Timer_SetTimeout_us(GetUsableBudget(task, now));
+    }
     else
     {
         // If this is a Aperiodic task, keep the timer running so that we can calculate the budget used
         _OS_Timer_SetMaxTimeout();
     }
+#endif
     
 #if ENABLE_MMU
+#if OS_ENABLE_CPU_STATS==1
+	UINT32 mmu_switch_start_count = _OS_Timer_GetCount(PERIODIC_TIMER);
+	g_schedule_counter++;
+#endif
+
+#if ENABLE_MMU_ASID==1
+	// The kernel maps are global and the process maps are tagged with their ASID.
+	// So the TLB entries stay valid and we only need to switch the page table
+	// when the process changes.
+	if(task->owner_process != g_mmu_current_process)
+	{
+		_sysctl_set_ptable_asid((PADDR)(task->owner_process->ptable), task->owner_process->asid);
+		g_mmu_current_process = task->owner_process;
+#if OS_ENABLE_CPU_STATS==1
+		g_ptable_switch_counter++;
+#endif
+	}
+#else
 	// Before we change the ptable, we need to flush TLB so that older process's maps are discarded
 	_sysctl_flush_tlb();
 
 	// Set the page table address in SYSCTL register to the new task's process
 	_sysctl_set_ptable((PADDR)(task->owner_process->ptable));
+#if OS_ENABLE_CPU_STATS==1
+	g_ptable_switch_counter++;
+#endif
+#endif
+
+#if OS_ENABLE_CPU_STATS==1
+	{
+		// Since timer is downcounting, the end value will be smaller than starting value
+		UINT32 mmu_switch_end_count = _OS_Timer_GetCount(PERIODIC_TIMER);
+		if(mmu_switch_end_count < mmu_switch_start_count)
+		{
+			UINT32 diff_count = (mmu_switch_start_count - mmu_switch_end_count);
+			if(g_max_mmu_switch_elapsed_count < diff_count) 
+			{
+				g_max_mmu_switch_elapsed_count = diff_count;
+			}
+		}
+	}
+#endif
 #endif
     
 #if OS_ENABLE_CPU_STATS==1
@@ -452,6 +1060,28 @@ void _OS_Schedule()
 	g_sched_starting_counter_value = 0;
 #endif
 
+    // The job of the task was aborted on an overrun. The task starts over on a new
+    // stack. The page table of its process is active by now
+    if(IS_PERIODIC_TASK(task->attributes) && task->p.restart_job)
+    {
+        _OS_RestartPeriodicTask(task);
+    }
+
+#if OS_ENABLE_CPU_STATS==1
+    // The first dispatch of a job gives its start jitter
+    if(IS_PERIODIC_TASK(task->attributes) && _OS_StatIsNewJob(task))
+    {
+        _OS_StatJobStart(task, g_current_period_us + GetPeriodOffset());
+    }
+#endif
+
+    OS_TRACE_DISPATCH(task);
+
+#if OS_WITH_VFP==1
+    // The VFP traps unless it has the registers of the new task
+    _OS_VFPSwitch(task);
+#endif
+
     // It is OK to context switch to another task with interrupts disabled
     _OS_ContextRestore(task);    // This has the affect of g_current_task = task;
 }
@@ -475,28 +1105,50 @@ void _OS_TaskYield()
 #endif
             OS_Task * task = (OS_Task *)g_current_task;
 
+            // Update g_current_period_offset_us as we need the current time below
+            g_current_period_offset_us = GetPeriodOffset();
+
             task->p.exec_count++;
+            OS_TRACE_SWITCH_OUT(TRACE_JOB_END, task, task->p.exec_count);
+#if OS_ENABLE_CPU_STATS==1
+            _OS_StatJobEnd(task, g_current_period_us + g_current_period_offset_us);
+#endif
             
-            // Adjust the remaining & accumulated budgets
-            ASSERT(budget_spent <= task->p.remaining_budget);
-            task->p.remaining_budget -= budget_spent;
+            // Adjust the remaining budget
+            ChargeTaskBudget(task, budget_spent, g_current_period_us + g_current_period_offset_us);
+            ChargeProcessServer(task, budget_spent, g_current_period_us + g_current_period_offset_us);
             
-            // Take the current task out of ready queue
-            _OS_PQueueGet(&g_ready_q, NULL);
+#if OS_BUDGET_RECLAMATION==1
+            // The job completed early. Others can use the rest of its budget until its deadline
+            // The budget within a process reservation is not shared with the others
+            if(!task->owner_process->server)
+            {
+                DonateSpareBudget(task->p.alarm_time(), task->p.remaining_budget, 
+                    g_current_period_us + g_current_period_offset_us);
+            }
+#endif
             
-            // We are done for the current period. Update the next job_release_time.
+#if OS_STATIC_SCHEDULE==1
+            // The rest of the slots of this job are left to the aperiodic tasks
             task->p.job_release_time += task->p.period;
-            
-			// If we are going to put the task into ready queue, then the alarm time
-			// should be the deadline. Or else, it should be the next release time
-			if(task->p.job_release_time == g_current_period_us)
-				_OS_SetAlarm(task, task->p.job_release_time + task->p.deadline, TRUE);
-			else
-				_OS_SetAlarm(task, task->p.job_release_time, FALSE);
+#else
+            // Take the current task out of ready queue
+            _OS_ReadyQueueDelete(task);
+            StartNextJob(task, g_current_period_us + g_current_period_offset_us);
+#endif
+        }
+        else
+        {
+            OS_TRACE_SWITCH_OUT(TRACE_YIELD, g_current_task, 0);
+            if(IS_CBS_TASK(g_current_task->attributes))
+            {
+                ChargeServerBudget(g_current_task, budget_spent, _OS_GetElapsedTime());
+                ChargeProcessServer(g_current_task, budget_spent, _OS_GetElapsedTime());
+            }
         }
 
         // Before calling _OS_Schedule, update g_current_period_offset_us
-        g_current_period_offset_us = _OS_Timer_GetTimeElapsed_us(PERIODIC_TIMER);
+        g_current_period_offset_us = GetPeriodOffset();
 
         // Call reschedule
         _OS_Schedule();
@@ -521,10 +1173,20 @@ OS_Return _OS_CompleteAperiodicTask()
 
 		// If this function ever returns, just block this task by adding it to
 		// block q
-		_OS_PQueueDelete(&g_ap_ready_q, (_OS_TaskQNode *)task);
+		if(IS_CBS_TASK(task->attributes))
+		{
+			// Give back the CPU reserved for the server
+			_OS_ReadyQueueDelete(task);
+			_OS_ReleaseTaskReservation(task);
+		}
+		else
+		{
+			_OS_BitmapQueueDelete(&g_ap_ready_q, (_OS_TaskQNode *)task);
+		}
 
 		// Insert into block q
 		_OS_NPQueueInsert(&g_completed_task_q, (_OS_TaskQNode *)task);
+		OS_TRACE_SWITCH_OUT(TRACE_TASK_END, task, 0);
 
 		// Note that the TCB resource for this task will not be freed.
 		// This task will remain in the blocked queue permanently
@@ -537,6 +1199,51 @@ OS_Return _OS_CompleteAperiodicTask()
 	return ret;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Function to be called when a periodic task finishes for good. The task is taken
+// out of scheduling and its TCB & the CPU reserved for it are freed.
+///////////////////////////////////////////////////////////////////////////////
+OS_Return _OS_CompletePeriodicTask()
+{
+	UINT32 intsts;
+	
+	if(!IS_PERIODIC_TASK(g_current_task->attributes))
+	{
+		return INVALID_TASK;
+	}
+
+	OS_ENTER_CRITICAL(intsts);
+
+#if OS_STATIC_SCHEDULE==1
+	{
+		// The slots of the task are not used anymore
+		UINT32 i;
+		for(i = 0; i < g_static_schedule.task_count; i++)
+		{
+			if(g_static_task[i] == g_current_task) g_static_task[i] = NULL;
+		}
+	}
+#else
+	// The current task is always in the ready queue
+	_OS_ReadyQueueDelete(g_current_task);
+#endif
+	// The mutexes that the task did not unlock are given to their waiters
+	_OS_MutexReleaseHeld(g_current_task);
+	
+	// Trace the end before the TCB is given back
+	OS_TRACE_SWITCH_OUT(TRACE_TASK_END, g_current_task, 0);
+	_OS_FreePeriodicTask(g_current_task);
+	
+	// Schedule the next task before enabling the interrupts. Otherwise the timer
+	// interrupts would do the budget accounting for the task we just freed.
+	// The interrupts are enabled again when the next task is restored.
+	_OS_Schedule();
+	
+	OS_EXIT_CRITICAL(intsts);
+	
+	return SUCCESS;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Remove current task from the scheduler ready queue and insert it into blocked queue
 // It is the responsibility of the caller to queue this task somewhere else
@@ -549,20 +1256,35 @@ void _OS_SchedulerBlockCurrentTask()
 	KlogStr(KLOG_IO_BLOCK_UNBLOCK, "Blocking - ", g_current_task->name);	
 
 	OS_ENTER_CRITICAL(intsts);
+	OS_TRACE_SWITCH_OUT(TRACE_BLOCK, g_current_task, 0);
 		
+#if OS_STATIC_SCHEDULE==1
+	if(IS_PERIODIC_TASK(g_current_task->attributes)) {
+	
+		// The task does not use its slots until it is unblocked
+		SetResourceStatus(g_static_blocked_mask, g_current_task->id, FALSE);
+	}
+	else
+#endif
 	if(IS_PERIODIC_TASK(g_current_task->attributes)) {
 	
 		// Delete the current task from ready tasks queue
-		_OS_PQueueDelete(&g_ready_q, (_OS_TaskQNode *)g_current_task); 
+		_OS_ReadyQueueDelete(g_current_task); 
 		
 		// Add this task to the global blocked periodic queue so that scheduler can
 		// continuously update its deadlines and readiness
 		_OS_PQueueInsertWithKey(&g_periodic_blocked_q, (_OS_TaskQNode *)g_current_task,
 			g_current_task->p.alarm_time());
 	}
+	else if(IS_CBS_TASK(g_current_task->attributes)) {
+	
+		// Delete the current task from ready tasks queue. The server keeps its budget 
+		// and deadline (alarm_time) until the task is unblocked
+		_OS_ReadyQueueDelete(g_current_task); 
+	}
 	else {
 		// Delete the current task from ready tasks queue
-		_OS_PQueueDelete(&g_ap_ready_q, (_OS_TaskQNode *)g_current_task); 
+		_OS_BitmapQueueDelete(&g_ap_ready_q, (_OS_TaskQNode *)g_current_task); 
 	}
 		
 	OS_EXIT_CRITICAL(intsts);
@@ -582,18 +1304,34 @@ void _OS_SchedulerUnblockTask(OS_Task * task)
 	KlogStr(KLOG_IO_BLOCK_UNBLOCK, "Unblocking - ", task->name);	
 	
 	OS_ENTER_CRITICAL(intsts);
+	OS_TRACE(TRACE_UNBLOCK, task, 0);
+	
+#if OS_STATIC_SCHEDULE==1
+	if(IS_PERIODIC_TASK(task->attributes)) {
 	
+		// The task runs again in the slots of its pending job
+		SetResourceStatus(g_static_blocked_mask, task->id, TRUE);
+	}
+	else
+#endif
 	if(IS_PERIODIC_TASK(task->attributes)) {
 	
 		// Delete this task from the g_periodic_blocked_q
 		_OS_PQueueDelete(&g_periodic_blocked_q, (_OS_TaskQNode *) task);
 		
 		// Insert this into the periodic ready / wait queue
-		if(task->p.job_release_time <= g_current_period_us) {
+		if(task->p.job_release_time <= _OS_GetElapsedTime()) {
 		
+#if OS_MIXED_CRITICALITY==1
+			if(g_high_criticality_mode && !IS_HI_CRITICALITY_TASK(task->attributes)) {
+				
+				// The pending low criticality job is dropped
+				DropJobs(task, _OS_GetElapsedTime(), TRUE);
+			}
+			else
+#endif
 			// We have a job waiting to complete. So insert this into ready queue
-			_OS_PQueueInsertWithKey(&g_ready_q, (_OS_TaskQNode *)task, 
-									task->p.job_release_time + task->p.deadline);
+			_OS_ReadyQueueInsert(task, task->p.job_release_time + GetJobDeadline(task));
 		}
 		else {
 			// There is no active job. So insert this into wait queue
@@ -601,15 +1339,58 @@ void _OS_SchedulerUnblockTask(OS_Task * task)
 									task->p.job_release_time);
 		}
 	}
+	else if(IS_CBS_TASK(task->attributes)) {
+	
+		_OS_ReadyQueueInsert(task, GetServerDeadline(task, _OS_GetElapsedTime()));
+	}
 	else {
 
 		// Insert this task into Aperiodic ready queue
-		_OS_PQueueInsertWithKey(&g_ap_ready_q,(_OS_TaskQNode *)task, task->ap.priority());
+		_OS_BitmapQueueInsert(&g_ap_ready_q, (_OS_TaskQNode *)task, task->ap.priority());
 	}
 	
 	OS_EXIT_CRITICAL(intsts);
 }
 
+#if OS_STATIC_SCHEDULE==0
+///////////////////////////////////////////////////////////////////////////////
+// Takes a ready task out of the ready queue till the system ceiling is lowered.
+// The deadlines of the blocked periodic tasks are still tracked
+// ASSUMPTION: The interrupts are disabled
+///////////////////////////////////////////////////////////////////////////////
+static void BlockOnCeiling(OS_Task * task)
+{
+	OS_TRACE_SWITCH_OUT(TRACE_BLOCK, task, 0);
+	
+	_OS_ReadyQueueDelete(task);
+	
+	if(IS_PERIODIC_TASK(task->attributes)) {
+		_OS_PQueueInsertWithKey(&g_periodic_blocked_q, (_OS_TaskQNode *)task, task->p.alarm_time());
+	}
+	
+	// The ready tasks are not in any wait queue. So the non priority links are free
+	_OS_NPQueueInsert(&g_ceiling_blocked_q, (_OS_TaskQNode *)task);
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Puts back all the tasks held back by the mutex ceiling into the scheduler queues.
+// The tasks that are still blocked by the new ceiling are held back again when
+// they are picked by _OS_Schedule
+///////////////////////////////////////////////////////////////////////////////
+void _OS_SchedulerReleaseCeilingBlocked()
+{
+	OS_Task * task;
+	
+	while(TRUE) {
+	
+		_OS_NPQueueGet(&g_ceiling_blocked_q, (_OS_TaskQNode **)&task);
+		if(!task) break;
+		
+		_OS_SchedulerUnblockTask(task);
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // This function updates the accumulated budget and remaining budget for the
 // currently running task
@@ -627,13 +1408,234 @@ void _OS_UpdateCurrentTaskBudget()
 	if(IS_PERIODIC_TASK(g_current_task->attributes)) {
 	
 	    // Adjust the remaining  budget for the current task
-	    ASSERT(budget_spent <= g_current_task->p.remaining_budget);
-	    g_current_task->p.remaining_budget -= budget_spent;		
+	    ChargeTaskBudget(g_current_task, budget_spent, _OS_GetElapsedTime());
+	    ChargeProcessServer(g_current_task, budget_spent, _OS_GetElapsedTime());
+	}
+	else if(IS_CBS_TASK(g_current_task->attributes)) {
+	
+		ChargeServerBudget(g_current_task, budget_spent, _OS_GetElapsedTime());
+		ChargeProcessServer(g_current_task, budget_spent, _OS_GetElapsedTime());
 	}
 	
 	OS_EXIT_CRITICAL(intsts);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Charges the budget spent by a periodic task till now. With budget reclamation,
+// the spare budget is used first and the task's own budget is used for the rest.
+///////////////////////////////////////////////////////////////////////////////
+static void ChargeTaskBudget(OS_Task * task, UINT32 budget_spent, UINT64 now)
+{
+#if OS_BUDGET_RECLAMATION==1
+	// The process reservations are isolated from the others. So they do not use spare budget
+	if(!task->owner_process->server)
+	{
+		budget_spent -= UseSpareBudget(task->p.alarm_time(), now - budget_spent, budget_spent);
+	}
+#endif
+
+	// The budget spent should always be <= remaining_budget. However because of
+	// inaccuracies in the tick <-> us conversions, it is better to limit the budget_spent
+	if(budget_spent > task->p.remaining_budget)
+		budget_spent = task->p.remaining_budget;
+	
+	task->p.remaining_budget -= budget_spent;
+}
+
+#if OS_STATIC_SCHEDULE==0
+///////////////////////////////////////////////////////////////////////////////
+// Returns the budget that the periodic / CBS task can use from now on. A task in
+// a process reservation is limited by the budget of the process server as well
+///////////////////////////////////////////////////////////////////////////////
+static UINT32 GetUsableBudget(OS_Task * task, UINT64 now)
+{
+	OS_Task * server = GetProcessServer(task);
+	
+	if(server)
+	{
+		return MIN(task->p.remaining_budget, server->p.remaining_budget);
+	}
+	
+#if OS_BUDGET_RECLAMATION==1
+	return task->p.remaining_budget + GetSpareBudget(task->p.alarm_time(), now);
+#else
+	return task->p.remaining_budget;
+#endif
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Charges the budget spent by a CBS task. When the server budget is exhausted, it is
+// recharged and the server deadline is postponed by one period. So the task cannot 
+// delay the other tasks more than its bandwidth, but it stays ready.
+// ASSUMPTION: The task is in the ready queue and the interrupts are disabled
+///////////////////////////////////////////////////////////////////////////////
+static void ChargeServerBudget(OS_Task * task, UINT32 budget_spent, UINT64 now)
+{
+	UINT64 deadline;
+	
+	ChargeTaskBudget(task, budget_spent, now);
+	
+	if(task->p.remaining_budget == 0)
+	{
+		KlogStr(KLOG_TBE_EXCEPTION, "CBS Budget Exhausted - ", task->name);
+		
+		// Count the number of budget exhaustions
+		task->p.TBE_count++;
+		OS_TRACE(TRACE_TBE, task, task->p.TBE_count);
+		
+		deadline = task->p.alarm_time() + task->p.period;
+		task->p.remaining_budget = task->p.budget;
+		
+		_OS_PQueueDelete(GetReadyQueue(task), (_OS_TaskQNode *)task);
+		_OS_PQueueInsertWithKey(GetReadyQueue(task), (_OS_TaskQNode *)task, deadline);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Charges the budget spent by a task to the server of its process reservation, if any
+///////////////////////////////////////////////////////////////////////////////
+static void ChargeProcessServer(OS_Task * task, UINT32 budget_spent, UINT64 now)
+{
+	OS_Task * server = GetProcessServer(task);
+	
+	if(server)
+	{
+		// The server accumulates the CPU time used by the process
+		server->accumulated_budget += budget_spent;
+		ChargeServerBudget(server, budget_spent, now);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The CBS rule for a new job: The current budget & deadline can be used only if the 
+// budget does not exceed the server bandwidth till the deadline. Otherwise the budget
+// is recharged and a new deadline is used. Returns the server deadline to be used
+///////////////////////////////////////////////////////////////////////////////
+static UINT64 GetServerDeadline(OS_Task * task, UINT64 now)
+{
+	UINT64 deadline = task->p.alarm_time();
+	
+	if((deadline <= now) || 
+		((UINT64)task->p.remaining_budget * task->p.period >= (deadline - now) * task->p.budget)) {
+		
+		deadline = now + task->p.period;
+		task->p.remaining_budget = task->p.budget;
+	}
+	
+	return deadline;
+}
+
+#if OS_BUDGET_RECLAMATION==1
+///////////////////////////////////////////////////////////////////////////////
+// Removes the spare budgets which are used up or expired by the given time
+///////////////////////////////////////////////////////////////////////////////
+static void RemoveSpareBudgets(UINT64 now)
+{
+	UINT32 i, count = 0;
+	
+	for(i = 0; i < g_spare_budget_count; i++)
+	{
+		if((g_spare_budget[i].budget > 0) && (g_spare_budget[i].deadline > now))
+		{
+			g_spare_budget[count++] = g_spare_budget[i];
+		}
+	}
+	
+	g_spare_budget_count = count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Adds the unused budget of a job to the spare budgets. It is available till the 
+// deadline of the job
+///////////////////////////////////////////////////////////////////////////////
+static void DonateSpareBudget(UINT64 deadline, UINT32 budget, UINT64 now)
+{
+	UINT32 i, j;
+	
+	if((budget == 0) || (deadline <= now)) return;
+	
+	RemoveSpareBudgets(now);
+	
+	// Find the position in the deadline order
+	for(i = 0; i < g_spare_budget_count; i++)
+	{
+		if(g_spare_budget[i].deadline >= deadline) break;
+	}
+	
+	if((i < g_spare_budget_count) && (g_spare_budget[i].deadline == deadline))
+	{
+		g_spare_budget[i].budget += budget;
+		return;
+	}
+	
+	// When there is no space, the spare budget with the latest deadline is dropped.
+	// It is only a loss of the spare time
+	if(g_spare_budget_count == OS_MAX_SPARE_BUDGETS)
+	{
+		if(i == g_spare_budget_count) return;
+		g_spare_budget_count--;
+	}
+	
+	for(j = g_spare_budget_count; j > i; j--)
+	{
+		g_spare_budget[j] = g_spare_budget[j - 1];
+	}
+	
+	g_spare_budget[i].deadline = deadline;
+	g_spare_budget[i].budget = budget;
+	g_spare_budget_count++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the spare budget that a task with the given deadline can use from now on
+// Only the spare budgets with earlier (or same) deadline can be used and each of 
+// them only until its own deadline. They are used in the deadline order.
+///////////////////////////////////////////////////////////////////////////////
+static UINT32 GetSpareBudget(UINT64 deadline, UINT64 now)
+{
+	UINT64 time = now;
+	UINT32 i;
+	
+	for(i = 0; (i < g_spare_budget_count) && (g_spare_budget[i].deadline <= deadline); i++)
+	{
+		if(g_spare_budget[i].deadline > time)
+		{
+			time += MIN(g_spare_budget[i].budget, g_spare_budget[i].deadline - time);
+		}
+	}
+	
+	return (UINT32)(time - now);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Charges the time spent by a task with the given deadline to the spare budgets
+// The task has been running since the time 'start'. Returns the budget charged to
+// the spare budgets. The rest should be charged to the task's own budget.
+///////////////////////////////////////////////////////////////////////////////
+static UINT32 UseSpareBudget(UINT64 deadline, UINT64 start, UINT32 budget_spent)
+{
+	UINT64 time = start;
+	UINT64 end = start + budget_spent;
+	UINT32 i, used;
+	
+	for(i = 0; (i < g_spare_budget_count) && (g_spare_budget[i].deadline <= deadline) 
+		&& (time < end); i++)
+	{
+		if(g_spare_budget[i].deadline > time)
+		{
+			used = (UINT32) MIN(g_spare_budget[i].budget, MIN(g_spare_budget[i].deadline, end) - time);
+			g_spare_budget[i].budget -= used;
+			time += used;
+		}
+	}
+	
+	RemoveSpareBudgets(end);
+	
+	return (UINT32)(time - start);
+}
+#endif // OS_BUDGET_RECLAMATION
+
 ///////////////////////////////////////////////////////////////////////////////
 // The below function, gets the total elapsed time since the beginning
 // of the system in microseconds.
@@ -656,10 +1658,208 @@ UINT64 _OS_GetElapsedTime()
     do
     {
         old_global_time = g_current_period_us;
-        elapsed_time = g_current_period_us + _OS_Timer_GetTimeElapsed_us(PERIODIC_TIMER);
+        elapsed_time = g_current_period_us + GetPeriodOffset();
     }
     // To ensure that the timer has not expired since we have read both g_current_period_us and _OS_Timer_GetTimeElapsed_us
     while(old_global_time != g_current_period_us);
     
     return elapsed_time;
 }
+
+#if OS_TICKLESS_SCHEDULING==1
+///////////////////////////////////////////////////////////////////////////////
+// Returns the time elapsed since g_current_period_us. The interrupts may be disabled
+// when the periodic timer reloads. Until its interrupt is serviced, g_current_period_us
+// lags by one PERIODIC_TIMER_INTERVAL, which is a long time in tickless mode.
+///////////////////////////////////////////////////////////////////////////////
+static UINT32 GetPeriodOffset(void)
+{
+	UINT32 offset_us = _OS_Timer_GetTimeElapsed_us(PERIODIC_TIMER);
+	
+	// If the interrupt is pending, the timer has already reloaded. Read the timer again
+	// as the above read could have happened just before the reload.
+	if(_OS_Timer_IsInterruptPending(PERIODIC_TIMER))
+	{
+		offset_us = PERIODIC_TIMER_INTERVAL + _OS_Timer_GetTimeElapsed_us(PERIODIC_TIMER);
+	}
+	
+	return offset_us;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the absolute time of the next job release or blocked task deadline
+// Returns (UINT64)-1 if there is no such event
+///////////////////////////////////////////////////////////////////////////////
+static UINT64 GetNextEventTime(void)
+{
+	UINT64 next_release = (UINT64) -1;
+	UINT64 next_dline = (UINT64) -1;
+	
+#if OS_STATIC_SCHEDULE==1
+	// The start of the next slot of the static schedule
+	return MIN(GetNextSlotTime(), _OS_SemNextTimeout());
+#endif
+	
+	_OS_QueuePeekWithKey(&g_wait_q, NULL, &next_release);
+	_OS_QueuePeekWithKey(&g_periodic_blocked_q, NULL, &next_dline);
+	
+	return MIN(MIN(next_release, next_dline), _OS_SemNextTimeout());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Programs the budget timer as a one-shot timer for the given absolute time
+// The timer is always kept running so that the budget spent can be measured
+///////////////////////////////////////////////////////////////////////////////
+static void SetReleaseTimer(UINT64 now, UINT64 abs_timeout_us)
+{
+	UINT64 timeout_us;
+	
+	if(abs_timeout_us == (UINT64) -1)
+	{
+		_OS_Timer_SetMaxTimeout();
+		return;
+	}
+	
+	// The event could already be due if we got here late
+	timeout_us = (abs_timeout_us > now) ? (abs_timeout_us - now) : 0;
+	
+	if(timeout_us < TICKLESS_MIN_TIMEOUT_US) 
+		timeout_us = TICKLESS_MIN_TIMEOUT_US;
+	
+	// If the event is too far, we will simply come back and re-arm the timer
+	if(timeout_us > MAX_TIMER1_INTERVAL_uS)
+		timeout_us = MAX_TIMER1_INTERVAL_uS;
+	
+	_OS_Timer_SetTimeout_us((UINT32) timeout_us);
+}
+#endif
+
+#if OS_STATIC_SCHEDULE==1
+///////////////////////////////////////////////////////////////////////////////
+// Finds the TCBs of the tasks in the static schedule. All the periodic tasks should
+// be in the schedule. The tasks are taken out of the wait queue as their jobs are
+// released by the schedule.
+///////////////////////////////////////////////////////////////////////////////
+static void BindStaticSchedule(void)
+{
+	const OS_StaticTask * spec;
+	OS_Task * task;
+	UINT32 i, j;
+	
+	for(i = 0; i < g_static_schedule.task_count; i++)
+	{
+		spec = &g_static_schedule.tasks[i];
+		g_static_task[i] = NULL;
+		
+		for(j = 0; j < MAX_TASK_COUNT; j++)
+		{
+			task = &g_task_pool[j];
+			if(IsResourceBusy(g_task_usage_mask, j) && IS_PERIODIC_TASK(task->attributes) &&
+				!strcmp(task->name, spec->name) && (task->p.period == spec->period) && 
+				(task->p.deadline == spec->deadline) && (task->p.budget == spec->budget) &&
+				(task->p.phase == spec->phase))
+			{
+				g_static_task[i] = task;
+				_OS_PQueueDelete(&g_wait_q, (_OS_TaskQNode *) task);
+				break;
+			}
+		}
+		
+		if(!g_static_task[i])
+		{
+			panic("Task %s of the static schedule is not created\n", spec->name);
+		}
+	}
+	
+	if(g_wait_q.count || g_ready_q.count)
+	{
+		panic("Only the periodic tasks of the static schedule can be used\n");
+	}
+	
+	// The first hyperperiod starts with the first budget timer interrupt. Till then
+	// we are in the last slot of the hyperperiod before, which has no pending job
+	g_static_slot = &g_static_schedule.slots[g_static_schedule.slot_count - 1];
+	g_static_frame_start = (INT64) TICKLESS_MIN_TIMEOUT_US - g_static_schedule.hyperperiod;
+	
+	for(i = 0; i < g_static_schedule.task_count; i++)
+	{
+		g_static_task[i]->p.job_release_time = TICKLESS_MIN_TIMEOUT_US + g_static_task[i]->p.phase;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Moves to the slot for the given time. At the end of the last slot of a job, the 
+// job is over. If the task has not completed it, there was a TBE or a deadline miss
+// if the task was blocked.
+///////////////////////////////////////////////////////////////////////////////
+static void AdvanceStaticSchedule(UINT64 now)
+{
+	const OS_StaticSlot * last = &g_static_schedule.slots[g_static_schedule.slot_count - 1];
+	OS_Task * task;
+	
+	while(GetNextSlotTime() <= now)
+	{
+		task = (g_static_slot->task != OS_SLOT_IDLE) ? g_static_task[g_static_slot->task] : NULL;
+		if(task && (g_static_slot->flags & OS_SLOT_JOB_END) && 
+			((INT64) task->p.job_release_time == g_static_frame_start + g_static_slot->release))
+		{
+			if(IsResourceBusy(g_static_blocked_mask, task->id))
+			{
+				KlogStr(KLOG_DEADLINE_MISS, "Deadline Miss (Blocked) - ", task->name);
+				task->p.dline_miss_count++;
+				OS_TRACE(TRACE_DEADLINE_MISS, task, task->p.dline_miss_count);
+			}
+			else
+			{
+				KlogStr(KLOG_TBE_EXCEPTION, "TBE Exception = ", task->name);
+				task->p.TBE_count++;
+				OS_TRACE(TRACE_TBE, task, task->p.TBE_count);
+			}
+			
+			task->p.exec_count++;
+			task->p.job_release_time += task->p.period;
+		}
+		
+		if(g_static_slot == last)
+		{
+			g_static_slot = &g_static_schedule.slots[0];
+			g_static_frame_start += g_static_schedule.hyperperiod;
+		}
+		else
+		{
+			g_static_slot++;
+		}
+	}
+}
+
+// Returns the start time of the next slot
+static UINT64 GetNextSlotTime(void)
+{
+	const OS_StaticSlot * next = g_static_slot + 1;
+	
+	if(next == &g_static_schedule.slots[g_static_schedule.slot_count])
+	{
+		return (UINT64)(g_static_frame_start + g_static_schedule.hyperperiod);
+	}
+	
+	return (UINT64)(g_static_frame_start + next->start);
+}
+
+// Returns the task of the current slot if the job of the slot is pending and the
+// task is not blocked. NULL otherwise
+static OS_Task * GetStaticSlotTask(void)
+{
+	OS_Task * task;
+	
+	if(g_static_slot->task == OS_SLOT_IDLE) return NULL;
+	
+	task = g_static_task[g_static_slot->task];
+	if(!task || IsResourceBusy(g_static_blocked_mask, task->id) ||
+		((INT64) task->p.job_release_time != g_static_frame_start + g_static_slot->release))
+	{
+		return NULL;
+	}
+	
+	return task;
+}
+#endif // OS_STATIC_SCHEDULE
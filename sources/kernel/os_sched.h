@@ -15,13 +15,16 @@
 
 extern _OS_Queue g_ready_q;
 extern _OS_Queue g_wait_q;
-extern _OS_Queue g_ap_ready_q;
+extern _OS_BitmapQueue g_ap_ready_q;
 extern _OS_Queue g_completed_task_q;
 
 // The following queue has all the tasks that are blocked on resources such ASSERT
 // Semaphores or IOs
 extern _OS_Queue g_periodic_blocked_q;
 
+// The ready tasks that are held back by the mutex ceiling
+extern _OS_Queue g_ceiling_blocked_q;
+
 // This global variable can be accessed from outside
 extern BOOL _OS_IsRunning;
 
@@ -38,10 +41,19 @@ extern UINT32 g_budget_timer_intr_counter;
 extern UINT32 g_max_scheduler_elapsed_count;
 extern UINT32 g_sched_starting_counter_value;
 extern UINT32 g_sched_ending_counter_value;
+extern UINT32 g_max_mmu_switch_elapsed_count;
+extern UINT32 g_schedule_counter;
+extern UINT32 g_ptable_switch_counter;
 #endif
 
 extern OS_Task * g_idle_task;  // A TCB for the idle task
 
+#if OS_MIXED_CRITICALITY==1
+// TRUE while the low criticality jobs are dropped
+extern BOOL g_high_criticality_mode;
+extern UINT32 g_criticality_switch_count;
+#endif
+
 extern OS_Process * g_kernel_process;	// Kernel process
 
 // Some function prototypes
@@ -57,7 +69,11 @@ void _OS_SetAlarm(OS_Task *task,
                   BOOL ready);
 void _OS_SchedulerBlockCurrentTask();
 void _OS_SchedulerUnblockTask(OS_Task * task);
+void _OS_SchedulerReleaseCeilingBlocked();
 void _OS_UpdateCurrentTaskBudget();
+void _OS_ReadyQueueInsert(OS_Task * task, UINT64 deadline);
+void _OS_ReadyQueueDelete(OS_Task * task);
+UINT64 _OS_GetElapsedTime();
 
 void kernel_process_entry(void * pdata);
 
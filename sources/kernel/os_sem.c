@@ -10,20 +10,52 @@
 #include "os_sem.h"
 #include "os_timer.h"
 #include "os_sched.h"
+#include "os_trace.h"
 #include "util.h"
 
 // Placeholders for all the semaphore objects
 OS_SemaphoreCB g_semaphore_pool[MAX_SEMAPHORE_COUNT];
 UINT32 g_semaphore_usage_mask[(MAX_SEMAPHORE_COUNT + 31) >> 5];
 
+// The semaphore that each periodic / CBS task waits on and the wait queue it is in
+static OS_SemaphoreCB * g_sem_waiting_on[MAX_TASK_COUNT];
+static _OS_Queue * g_sem_wait_queue[MAX_TASK_COUNT];
+
+// The waits with a timeout indexed by the task id. The semaphore is NULL if the task
+// does not wait with a timeout
+typedef struct
+{
+	UINT64 timeout;
+	OS_SemaphoreCB * semobj;
+	
+} _OS_SemTimeout;
+
+static _OS_SemTimeout g_sem_timed_wait[MAX_TASK_COUNT];
+
+// The earliest timeout. It can be earlier than any real timeout after a task
+// got the semaphore in time. The next check then finds the real one
+static UINT64 g_sem_next_timeout = (UINT64) -1;
+
 // Bit #1 in the semaphore attributes indicates if this is a binary semaphore or not
 #define BINARY_SEMAPHORE_MASK		1
 
+// Bit #2 marks the semaphore of a user space lock
+#define FUTEX_SEMAPHORE_MASK		2
+
 // Helper macros
 #define IS_BINARY_SEMAPHORE(attributes)		(attributes & BINARY_SEMAPHORE_MASK)
 #define IS_COUNTING_SEMAPHORE(attributes)		(!(attributes & BINARY_SEMAPHORE_MASK))
 
 static OS_Return assert_open(OS_Sem_t sem);
+static void SignalSemaphore(OS_SemaphoreCB * semobj);
+static void BlockOnSemaphore(OS_SemaphoreCB * semobj);
+static OS_Task * WakeWaiter(OS_SemaphoreCB * semobj, BOOL any_job);
+static OS_Task * TakeWaiter(OS_SemaphoreCB * semobj, BOOL any_job);
+static void StartTimedWait(OS_Task * task, OS_SemaphoreCB * semobj, UINT64 timeout);
+static void ExpireTimedWait(OS_Task * task);
+static void InsertPeriodicWaiter(OS_SemaphoreCB * semobj, OS_Task * task, UINT64 now);
+static void RemovePeriodicWaiter(OS_Task * task);
+static void ReleasePendingWaiters(OS_SemaphoreCB * semobj, UINT64 now);
 
 OS_Return _OS_SemAlloc(OS_Sem_t *sem, UINT32 value, BOOL binary)
 {
@@ -62,6 +94,7 @@ OS_Return _OS_SemAlloc(OS_Sem_t *sem, UINT32 value, BOOL binary)
 	semobj->owner = (OS_Process *) g_current_process;
 	
 	_OS_QueueInit(&semobj->periodic_wait_queue);
+	_OS_QueueInit(&semobj->pending_wait_queue);
 	_OS_QueueInit(&semobj->aperiodic_wait_queue);
 	
 	status = SUCCESS;
@@ -96,35 +129,107 @@ OS_Return _OS_SemWait(OS_Sem_t sem)
 	_OS_UpdateCurrentTaskBudget();
 	
 	KlogStr(KLOG_SEMAPHORE_DEBUG, "Sem Task :- ", g_current_task->name);
+	OS_TRACE(TRACE_SEM_WAIT, g_current_task, sem);
 
 	// If the semaphore count is 0, then block the thread
 	if(semobj->count == 0) {
 
-		// Block the current task
-		_OS_SchedulerBlockCurrentTask();
+		BlockOnSemaphore(semobj);
 		
-		// Block the thread			
-		if(IS_PERIODIC_TASK(g_current_task->attributes)) {
+		Klog32(KLOG_SEMAPHORE_DEBUG, "Semaphore :- ", semobj->count);				
+	}	
+	else {
+	
+		// Decrement the semaphore count in order to acquire it
+		semobj->count--;
+		Klog32(KLOG_SEMAPHORE_DEBUG, "Semaphore - ", semobj->count);		
+	
+		// The return path for this function is through _OS_Schedule, so it is important to
+		// update the result in the syscall_result
+		if(g_current_task->syscall_result) {
+			g_current_task->syscall_result[0] = SUCCESS;
+		}
+	}	
+	
+	_OS_Schedule();
+	
+exit:
+	return status;
+}
+
+OS_Return _OS_SemTimedWait(OS_Sem_t sem, UINT64 timeout_us, UINT32 mode)
+{
+	OS_Return status;
+	UINT64 now, abs_timeout;
+	
+#if OS_ENABLE_CPU_STATS==1
+	// We need to track how long did we take to schedule the next task
+    g_sched_starting_counter_value = _OS_Timer_GetCount(PERIODIC_TIMER);
+#endif	
+
+	if((status = assert_open(sem)) != SUCCESS) {
+		goto exit;
+	}
+
+	// Get the Semaphore object
+	OS_SemaphoreCB * semobj = (OS_SemaphoreCB *)&g_semaphore_pool[sem];
+
+	// Make sure that the current process owns the Semaphore.
+	if(semobj->owner != (OS_Process *) g_current_process) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+	
+	now = _OS_GetElapsedTime();
+	
+	switch(mode) {
+	case OS_TIMEOUT_RELATIVE:
+		abs_timeout = now + timeout_us;
+		break;
 		
-			// Add the current task to the semaphore's blocked queue for periodic tasks
-			// Note that this is not a priority queue
-			_OS_NPQueueInsert(&semobj->periodic_wait_queue, (_OS_TaskQNode *)g_current_task);			
+	case OS_TIMEOUT_ABSOLUTE:
+		abs_timeout = timeout_us;
+		break;
+		
+	case OS_TIMEOUT_AT_DEADLINE:
+		// The aperiodic tasks have no deadline
+		if(IS_PERIODIC_TASK(g_current_task->attributes)) {
+			abs_timeout = g_current_task->p.job_release_time + g_current_task->p.deadline;
+		}
+		else if(IS_CBS_TASK(g_current_task->attributes)) {
+			abs_timeout = g_current_task->p.alarm_time();
 		}
 		else {
-		
-			// Add the current task to the semaphore's blocked queue for aperiodic tasks
-			// Note that we are going to use this as a priority queue
-			_OS_PQueueInsertWithKey(&semobj->aperiodic_wait_queue, (_OS_TaskQNode *)g_current_task, 
-				g_current_task->ap.priority());
+			status = BAD_ARGUMENT;
+			goto exit;
 		}
+		break;
 		
-		Klog32(KLOG_SEMAPHORE_DEBUG, "Semaphore :- ", semobj->count);				
+	default:
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+
+	// If the semaphore is not available and the time is already up, we return without waiting
+	if(semobj->count == 0 && abs_timeout <= now) {
+		status = TIMEOUT;
+		goto exit;
+	}
+	
+	// Update the accumulated and remaining budgets
+	_OS_UpdateCurrentTaskBudget();
+	
+	OS_TRACE(TRACE_SEM_WAIT, g_current_task, sem);
+
+	if(semobj->count == 0) {
+
+		BlockOnSemaphore(semobj);
+		StartTimedWait(g_current_task, semobj, abs_timeout);
 	}	
 	else {
 	
 		// Decrement the semaphore count in order to acquire it
 		semobj->count--;
-		Klog32(KLOG_SEMAPHORE_DEBUG, "Semaphore - ", semobj->count);		
 	
 		// The return path for this function is through _OS_Schedule, so it is important to
 		// update the result in the syscall_result
@@ -142,7 +247,6 @@ exit:
 OS_Return _OS_SemPost(OS_Sem_t sem)
 {
 	OS_Return status;
-	OS_Task * selected_task = NULL;
 	
 #if OS_ENABLE_CPU_STATS==1
 	// We need to track how long did we take to schedule the next task
@@ -165,51 +269,38 @@ OS_Return _OS_SemPost(OS_Sem_t sem)
 	// Update the accumulated and remaining budgets
 	_OS_UpdateCurrentTaskBudget();
 
-	if(semobj->count == 0) {
+	OS_TRACE(TRACE_SEM_POST, g_current_task, sem);
+	SignalSemaphore(semobj);
 	
-		// Unblock a waiting task. First check the periodic queue
-		// We need to go through all periodic waiting tasks and identify a ready task with
-		// an earliest deadline. Since the periodic wait queue is not priority queue
-		// we need to check all waiting tasks before we pick one
-		OS_Task * task = (OS_Task *) semobj->periodic_wait_queue.head;
-		UINT64 deadline = (UINT64) -1;	// Largest value
-		while(task) {
-		
-			// Check if the task has a job waiting. Otherwise ignore the task
-			if(task->p.job_release_time <= g_current_period_us) {
-				if(deadline > task->p.alarm_time()) {
-					deadline = task->p.alarm_time();
-					selected_task = task;
-				}
-			}
-			
-			// Go to next task in the semaphore periodic wait queue (non-priority queue)
-			task = (OS_Task *) task->qp.np_next;
-		}
+	_OS_Schedule();	
+	
+exit:
+	return status;
+}
 
-		if(selected_task) {
-		
-			// Take this task out from both semaphore wait queue
-			_OS_NPQueueDelete(&semobj->periodic_wait_queue, (_OS_TaskQNode *) selected_task);			
-		}
-		else {
-		
-			// Check the aperiodic_wait_queue
-			_OS_PQueueGet(&semobj->aperiodic_wait_queue, (_OS_TaskQNode **) &selected_task);		
-		}
+void _OS_SemSignal(OS_Sem_t sem)
+{
+	if(assert_open(sem) != SUCCESS) {
+		return;
 	}
 	
-	if(selected_task) {
+	OS_TRACE(TRACE_SEM_POST, NULL, sem);
+	SignalSemaphore((OS_SemaphoreCB *)&g_semaphore_pool[sem]);
+}
+
+// Wakes up the waiting task with the earliest deadline or increments the count
+static void SignalSemaphore(OS_SemaphoreCB * semobj)
+{
+	OS_Task * selected_task = NULL;
+	
+	if(semobj->count == 0) {
 	
-		// Reblock this task into the scheduler queue
-		_OS_SchedulerUnblockTask(selected_task);
-			
 		// If a task is getting ready, then there is no need to increment the semaphore count
-		// The return path for this function is through _OS_Schedule, so it is important to
-		// update the result in the syscall_result
-		if(selected_task->syscall_result) 
-			selected_task->syscall_result[0] = SUCCESS;
-			
+		selected_task = WakeWaiter(semobj, FALSE);
+	}
+	
+	if(selected_task) {
+		
 		Klog32(KLOG_SEMAPHORE_DEBUG, "Semaphore :+ ", semobj->count);		
 	}
 	else if(!semobj->count || IS_COUNTING_SEMAPHORE(semobj->attributes)) {
@@ -218,11 +309,6 @@ OS_Return _OS_SemPost(OS_Sem_t sem)
 		semobj->count++;
 		Klog32(KLOG_SEMAPHORE_DEBUG, "Semaphore + ", semobj->count);		
 	}
-		
-	_OS_Schedule();	
-	
-exit:
-	return status;
 }
 
 OS_Return _OS_SemFree(OS_Sem_t sem)
@@ -247,24 +333,20 @@ OS_Return _OS_SemFree(OS_Sem_t sem)
 		goto exit;
 	}
 
-    // Get the task execution time
-    UINT32 budget_spent = _OS_Timer_GetTimeElapsed_us(BUDGET_TIMER);
-    g_current_task->accumulated_budget += budget_spent;
-	
-	if(IS_PERIODIC_TASK(g_current_task->attributes)) {
-	
-	    // Adjust the remaining  budget for the current task
-	    ASSERT(budget_spent <= g_current_task->p.remaining_budget);
-	    g_current_task->p.remaining_budget -= budget_spent;		
-	}
+	// Update the accumulated and remaining budgets
+	_OS_UpdateCurrentTaskBudget();
 
 	// We need to unblock all waiting periodic tasks
 	while(TRUE) {
 	
-		// First the periodic wait queue
-		_OS_NPQueueGet(&semobj->periodic_wait_queue, (_OS_TaskQNode **)&task);		
+		// First the periodic wait queues
+		task = (OS_Task *) semobj->periodic_wait_queue.head;
+		if(!task) task = (OS_Task *) semobj->pending_wait_queue.head;
 		if(!task) break;
 		
+		RemovePeriodicWaiter(task);
+		g_sem_timed_wait[task->id].semobj = NULL;
+		
 		// Unblock this task
 		_OS_SchedulerUnblockTask(task);
 
@@ -281,6 +363,8 @@ OS_Return _OS_SemFree(OS_Sem_t sem)
 		// The aperiodic_wait_queue is a priority queue
 		_OS_PQueueGet(&semobj->aperiodic_wait_queue, (_OS_TaskQNode **)&task);
 		if(!task) break;
+		
+		g_sem_timed_wait[task->id].semobj = NULL;
 
 		// Unblock this task
 		_OS_SchedulerUnblockTask(task);
@@ -301,6 +385,186 @@ exit:
 	return status;
 }
 
+OS_Return _OS_SemFutexAlloc(OS_Sem_t *sem)
+{
+	OS_Return status;
+	
+	if(!g_current_process) {
+		return PROCESS_INVALID;
+	}
+	
+	// An aborted job would leave the lock taken for good, as the kernel does not know
+	// who holds it
+	if(_OS_ProcessAbortsJobs(g_current_process)) {
+		return NOT_SUPPORTED;
+	}
+	
+	status = _OS_SemAlloc(sem, 0, FALSE);
+	if(status == SUCCESS) {
+		g_semaphore_pool[*sem].attributes |= FUTEX_SEMAPHORE_MASK;
+	}
+	
+	return status;
+}
+
+BOOL _OS_SemProcessHasFutex(const OS_Process * process)
+{
+	UINT32 index;
+	
+	for(index = 0; index < MAX_SEMAPHORE_COUNT; index++)
+	{
+		if(IsResourceBusy(g_semaphore_usage_mask, index) && 
+			(g_semaphore_pool[index].owner == process) &&
+			(g_semaphore_pool[index].attributes & FUTEX_SEMAPHORE_MASK)) {
+			return TRUE;
+		}
+	}
+	
+	return FALSE;
+}
+
+OS_Return _OS_SemFutexWait(OS_Sem_t sem, const volatile UINT32 * word, UINT32 value)
+{
+	OS_Return status;
+	
+#if OS_ENABLE_CPU_STATS==1
+	// We need to track how long did we take to schedule the next task
+    g_sched_starting_counter_value = _OS_Timer_GetCount(PERIODIC_TIMER);
+#endif	
+
+	if((status = assert_open(sem)) != SUCCESS) {
+		goto exit;
+	}
+	
+	if(!word || ((UINTPTR) word & 3)) {
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+	
+#if ENABLE_MMU
+	// The word of a user task should be mapped for the user mode in its process. Otherwise
+	// reading it here faults in the kernel or reads the kernel memory. A system task can
+	// read the kernel memory anyway
+	if(IS_USER_TASK(g_current_task->attributes) &&
+		!_MMU_is_user_readable(g_current_process->ptable, (VADDR) word)) {
+		status = BAD_ARGUMENT;
+		goto exit;
+	}
+#endif
+
+	// Get the Semaphore object
+	OS_SemaphoreCB * semobj = (OS_SemaphoreCB *)&g_semaphore_pool[sem];
+
+	// Make sure that the current process owns the Semaphore.
+	if(semobj->owner != (OS_Process *) g_current_process) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+	
+	// The word is read with the interrupts disabled. So if the lock was released after
+	// the caller saw it taken, we return here rather than miss the wake up
+	if(*word != value) {
+		goto exit;
+	}
+
+	// Update the accumulated and remaining budgets
+	_OS_UpdateCurrentTaskBudget();
+	
+	OS_TRACE(TRACE_SEM_WAIT, g_current_task, sem);
+	BlockOnSemaphore(semobj);
+	
+	_OS_Schedule();
+	
+exit:
+	return status;
+}
+
+OS_Return _OS_SemFutexWake(OS_Sem_t sem)
+{
+	OS_Return status;
+	
+#if OS_ENABLE_CPU_STATS==1
+	// We need to track how long did we take to schedule the next task
+    g_sched_starting_counter_value = _OS_Timer_GetCount(PERIODIC_TIMER);
+#endif
+
+	if((status = assert_open(sem)) != SUCCESS) {
+		goto exit;
+	}
+	
+	// Get the Semaphore object
+	OS_SemaphoreCB * semobj = (OS_SemaphoreCB *)&g_semaphore_pool[sem];
+	
+	// Make sure that the current process owns the Semaphore.
+	if(semobj->owner != (OS_Process *) g_current_process) {
+		status = RESOURCE_NOT_OWNED;
+		goto exit;
+	}
+	
+	// The count is not used. Nobody may be waiting if the waiter saw the lock
+	// free before it blocked. Then we return without going through the scheduler,
+	// so the budget is not charged here. It would be charged again at the next switch
+	if(!semobj->periodic_wait_queue.count && !semobj->pending_wait_queue.count &&
+		!semobj->aperiodic_wait_queue.count) {
+		goto exit;
+	}
+	
+	// Update the accumulated and remaining budgets
+	_OS_UpdateCurrentTaskBudget();
+	
+	WakeWaiter(semobj, TRUE);
+
+	OS_TRACE(TRACE_SEM_POST, g_current_task, sem);
+	
+	// The woken task may have an earlier deadline
+	if(g_current_task->syscall_result) {
+		g_current_task->syscall_result[0] = SUCCESS;
+	}
+	
+	_OS_Schedule();	
+	
+exit:
+	return status;
+}
+
+OS_Return _OS_SemKernelAlloc(OS_Sem_t *sem)
+{
+	OS_Return status = _OS_SemAlloc(sem, 0, FALSE);
+	
+	if(status == SUCCESS) {
+	
+		// The user processes cannot wait on it or post it
+		g_semaphore_pool[*sem].owner = g_kernel_process;
+	}
+	
+	return status;
+}
+
+void _OS_SemKernelWait(OS_Sem_t sem)
+{
+	ASSERT(assert_open(sem) == SUCCESS);
+	
+	// Update the accumulated and remaining budgets
+	_OS_UpdateCurrentTaskBudget();
+	
+	OS_TRACE(TRACE_SEM_WAIT, g_current_task, sem);
+	BlockOnSemaphore(&g_semaphore_pool[sem]);
+}
+
+OS_Task * _OS_SemKernelWake(OS_Sem_t sem)
+{
+	OS_Task * task;
+	
+	ASSERT(assert_open(sem) == SUCCESS);
+	
+	task = TakeWaiter(&g_semaphore_pool[sem], TRUE);
+	if(task) {
+		OS_TRACE(TRACE_SEM_POST, g_current_task, sem);
+	}
+	
+	return task;
+}
+
 OS_Return _OS_SemGetValue(OS_Sem_t sem, UINT32* val)
 {
 	OS_Return status;
@@ -325,6 +589,210 @@ exit:
 	return status;
 }
 
+void _OS_SemExpireTimeouts(UINT64 now)
+{
+	UINT64 next_timeout = (UINT64) -1;
+	UINT32 id;
+	
+	// This is the common case. So the timeouts cost next to nothing till one is due
+	if(now < g_sem_next_timeout) {
+		return;
+	}
+	
+	for(id = 0; id < MAX_TASK_COUNT; id++) {
+	
+		const _OS_SemTimeout * wait = &g_sem_timed_wait[id];
+		
+		if(!wait->semobj) {
+			continue;
+		}
+		
+		if(wait->timeout <= now) {
+			ExpireTimedWait(&g_task_pool[id]);
+		}
+		else if(wait->timeout < next_timeout) {
+			next_timeout = wait->timeout;
+		}
+	}
+	
+	g_sem_next_timeout = next_timeout;
+}
+
+UINT64 _OS_SemNextTimeout(void)
+{
+	return g_sem_next_timeout;
+}
+
+void _OS_SemWaiterUpdate(OS_Task * task)
+{
+	OS_SemaphoreCB * semobj = g_sem_waiting_on[task->id];
+	
+	if(semobj) {
+		RemovePeriodicWaiter(task);
+		InsertPeriodicWaiter(semobj, task, _OS_GetElapsedTime());
+	}
+}
+
+// Blocks the current task on the semaphore
+static void BlockOnSemaphore(OS_SemaphoreCB * semobj)
+{
+	// Block the current task
+	_OS_SchedulerBlockCurrentTask();
+	
+	// Block the thread			
+	if(IS_PERIODIC_TASK(g_current_task->attributes) || IS_CBS_TASK(g_current_task->attributes)) {
+	
+		// Add the current task to the semaphore's blocked queue for periodic tasks
+		// CBS tasks also go here as they are scheduled by their deadlines
+		InsertPeriodicWaiter(semobj, g_current_task, _OS_GetElapsedTime());
+	}
+	else {
+	
+		// Add the current task to the semaphore's blocked queue for aperiodic tasks
+		// Note that we are going to use this as a priority queue
+		_OS_PQueueInsertWithKey(&semobj->aperiodic_wait_queue, (_OS_TaskQNode *)g_current_task, 
+			g_current_task->ap.priority());
+	}
+}
+
+// Wakes up the periodic task with the earliest deadline, else the aperiodic task with 
+// the highest priority. If any_job is set, a periodic task whose job expired while it 
+// waited is woken up when there is no one else. Returns NULL if no task was woken up
+static OS_Task * WakeWaiter(OS_SemaphoreCB * semobj, BOOL any_job)
+{
+	OS_Task * selected_task = TakeWaiter(semobj, any_job);
+	
+	// The return path for this function is through _OS_Schedule, so it is important to
+	// update the result in the syscall_result
+	if(selected_task && selected_task->syscall_result) 
+		selected_task->syscall_result[0] = SUCCESS;
+	
+	return selected_task;
+}
+
+// Same as WakeWaiter. But the result of the woken task is left as it is
+static OS_Task * TakeWaiter(OS_SemaphoreCB * semobj, BOOL any_job)
+{
+	OS_Task * selected_task;
+	
+	// The tasks whose next job is released by now join the periodic queue. Then
+	// its first task has the earliest deadline among the tasks with a job waiting
+	if(semobj->pending_wait_queue.count) {
+		ReleasePendingWaiters(semobj, _OS_GetElapsedTime());
+	}
+	
+	selected_task = (OS_Task *) semobj->periodic_wait_queue.head;
+	if(!selected_task) {
+	
+		// Check the aperiodic_wait_queue
+		_OS_PQueueGet(&semobj->aperiodic_wait_queue, (_OS_TaskQNode **) &selected_task);
+	}
+	else {
+	
+		// Take this task out from the semaphore wait queue
+		RemovePeriodicWaiter(selected_task);
+	}
+	
+	if(!selected_task && any_job) {
+		selected_task = (OS_Task *) semobj->pending_wait_queue.head;
+		if(selected_task) {
+			RemovePeriodicWaiter(selected_task);
+		}
+	}
+	
+	if(selected_task) {
+	
+		// The task got the semaphore in time
+		g_sem_timed_wait[selected_task->id].semobj = NULL;
+		
+		// Reblock this task into the scheduler queue
+		_OS_SchedulerUnblockTask(selected_task);
+	}
+	
+	return selected_task;
+}
+
+// Notes down the timeout of the current task which is waiting on the semaphore
+static void StartTimedWait(OS_Task * task, OS_SemaphoreCB * semobj, UINT64 timeout)
+{
+	g_sem_timed_wait[task->id].timeout = timeout;
+	g_sem_timed_wait[task->id].semobj = semobj;
+	
+	if(timeout < g_sem_next_timeout) {
+		g_sem_next_timeout = timeout;
+	}
+}
+
+// Takes the task out of the semaphore wait queue and makes it ready with TIMEOUT
+// as the result of its wait
+static void ExpireTimedWait(OS_Task * task)
+{
+	OS_SemaphoreCB * semobj = g_sem_timed_wait[task->id].semobj;
+	
+	if(IS_PERIODIC_TASK(task->attributes) || IS_CBS_TASK(task->attributes)) {
+		RemovePeriodicWaiter(task);
+	}
+	else {
+		_OS_PQueueDelete(&semobj->aperiodic_wait_queue, (_OS_TaskQNode *) task);
+	}
+	
+	g_sem_timed_wait[task->id].semobj = NULL;
+	
+	// A periodic task whose deadline has passed goes on as a late job from its next release
+	_OS_SchedulerUnblockTask(task);
+	
+	// The return path for waiting tasks is through _OS_Schedule, so it is important to
+	// update the result in the syscall_result	
+	if(task->syscall_result) {
+		task->syscall_result[0] = TIMEOUT;
+	}
+}
+
+// Queues a periodic / CBS task in the order of its deadline (the key of the task) if its 
+// job is released. Otherwise the task waits apart till its next job is released
+static void InsertPeriodicWaiter(OS_SemaphoreCB * semobj, OS_Task * task, UINT64 now)
+{
+	_OS_Queue * q;
+	
+	if(task->p.job_release_time <= now) {
+		q = &semobj->periodic_wait_queue;
+		_OS_NPQueueInsertSorted(q, (_OS_TaskQNode *) task);
+	}
+	else {
+		q = &semobj->pending_wait_queue;
+		_OS_NPQueueInsert(q, (_OS_TaskQNode *) task);
+	}
+	
+	g_sem_waiting_on[task->id] = semobj;
+	g_sem_wait_queue[task->id] = q;
+}
+
+static void RemovePeriodicWaiter(OS_Task * task)
+{
+	_OS_NPQueueDelete(g_sem_wait_queue[task->id], (_OS_TaskQNode *) task);
+	
+	g_sem_waiting_on[task->id] = NULL;
+	g_sem_wait_queue[task->id] = NULL;
+}
+
+// Moves the tasks whose next job is released by now to the periodic wait queue
+static void ReleasePendingWaiters(OS_SemaphoreCB * semobj, UINT64 now)
+{
+	OS_Task * task = (OS_Task *) semobj->pending_wait_queue.head;
+	OS_Task * next;
+	
+	while(task) {
+	
+		next = (OS_Task *) task->qp.np_next;
+		if(task->p.job_release_time <= now) {
+			RemovePeriodicWaiter(task);
+			InsertPeriodicWaiter(semobj, task, now);
+		}
+		
+		task = next;
+	}
+}
+
 static OS_Return assert_open(OS_Sem_t sem)
 {
 	if(sem < 0 || sem >= MAX_SEMAPHORE_COUNT) {
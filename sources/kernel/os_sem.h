@@ -20,7 +20,8 @@ typedef struct
 	UINT32 count;
 	UINT32 attributes;
 	OS_Process * owner;					// Owner process
-	_OS_Queue periodic_wait_queue;    		// Wait queue for periodic tasks
+	_OS_Queue periodic_wait_queue;    		// Wait queue for periodic tasks with a released job
+	_OS_Queue pending_wait_queue;			// Periodic tasks whose job expired while waiting
 	_OS_Queue aperiodic_wait_queue;  		// Wait queue for aperiodic tasks
     
 } OS_SemaphoreCB;
@@ -37,13 +38,64 @@ extern OS_SemaphoreCB g_semaphore_pool[MAX_SEMAPHORE_COUNT];
 // priority. This does not necessarily mean a task with the smallest period. 
 // This semaphore behavior ideal for use with an EDF scheduler
 // The periodic tasks are given preference in the order of their priority.
+// The periodic wait queue is kept in the order of the deadlines. A task whose job
+// expires while it waits is set apart till its next job is released. So posting
+// the semaphore takes the first task of the queue in the common case.
 //
 ///////////////////////////////////////////////////////////////////////////////
 
 OS_Return _OS_SemAlloc(OS_Sem_t *sem, UINT32 value, BOOL binary);
 OS_Return _OS_SemWait(OS_Sem_t sem);
+OS_Return _OS_SemTimedWait(OS_Sem_t sem, UINT64 timeout_us, UINT32 mode);
 OS_Return _OS_SemPost(OS_Sem_t sem);
 OS_Return _OS_SemFree(OS_Sem_t sem);
 OS_Return _OS_SemGetValue(OS_Sem_t sem, UINT32 *val);
 
+// The kernel side of the user space locks (OS_Lock). The semaphore is only used for its
+// wait queues, its count does not change.
+// _OS_SemFutexWait blocks the current task on the semaphore if *word is still value.
+// Otherwise it returns SUCCESS right away, as the lock was released in the meantime.
+// _OS_SemFutexWake wakes up one waiter in the same order as _OS_SemPost. A periodic 
+// waiter whose job has expired is also woken up if there is no one else, else it would
+// not see the lock released
+// _OS_SemFutexAlloc allocates the semaphore of a lock. The kernel does not know who
+// holds a lock, so it could not release the lock of an aborted job. It returns
+// NOT_SUPPORTED if the jobs of a task of the current process can be aborted, and
+// _OS_SetOverrunPolicy refuses OVERRUN_ABORT in a process that has a lock.
+// _OS_SemProcessHasFutex tells if the process has a lock
+OS_Return _OS_SemFutexAlloc(OS_Sem_t *sem);
+BOOL _OS_SemProcessHasFutex(const OS_Process * process);
+OS_Return _OS_SemFutexWait(OS_Sem_t sem, const volatile UINT32 * word, UINT32 value);
+OS_Return _OS_SemFutexWake(OS_Sem_t sem);
+
+// Wait queues for the kernel objects that are shared by the processes. The semaphore
+// belongs to the kernel process, so the user processes cannot use it. Its count does
+// not change.
+// _OS_SemKernelWait blocks the current task. The caller writes the result of the task 
+// before and then calls _OS_Schedule.
+// _OS_SemKernelWake wakes up one waiter in the same order as _OS_SemFutexWake and returns
+// it, or NULL if there is none. The result of the woken task is not written, as its 
+// return arguments may not be mapped in the current process. It does not reschedule
+OS_Return _OS_SemKernelAlloc(OS_Sem_t *sem);
+void _OS_SemKernelWait(OS_Sem_t sem);
+OS_Task * _OS_SemKernelWake(OS_Sem_t sem);
+
+// Posts the semaphore from within the scheduler. It does not check the owner process and
+// does not reschedule, the caller does. Invalid semaphores are ignored
+void _OS_SemSignal(OS_Sem_t sem);
+
+// The timeouts of _OS_SemTimedWait. There is no timer of their own. The scheduler
+// takes the next timeout into account when it programs the timer in the tickless mode
+// and calls _OS_SemExpireTimeouts from the timer ISRs after the blocked deadlines are
+// checked. Without the tickless mode, the timeouts are seen at the next periodic tick
+// ASSUMPTION: The interrupts are disabled
+void _OS_SemExpireTimeouts(UINT64 now);
+UINT64 _OS_SemNextTimeout(void);
+
+// Moves a periodic task waiting on a semaphore to its new place in the wait queues.
+// The scheduler calls it when the deadline of a blocked task changes. Nothing is done
+// if the task is not waiting on a semaphore
+// ASSUMPTION: The interrupts are disabled
+void _OS_SemWaiterUpdate(OS_Task * task);
+
 #endif //_OS_SEM_H
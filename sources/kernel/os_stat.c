@@ -17,6 +17,35 @@
 extern OS_Task * g_idle_task;
 UINT64 _OS_GetElapsedTime();
 
+_OS_TaskJobStat g_task_job_stat[MAX_TASK_COUNT];
+
+// Returns the log scale histogram bin of a value. See OS_TaskHistograms
+static __inline__ UINT32 GetHistogramBin(UINT32 value)
+{
+	UINT32 leading_zeros, bin;
+	
+#if defined(__arm__)
+	__asm__ volatile("clz %0, %1" : "=r" (leading_zeros) : "r" (value));
+#else
+	// Host builds (unittests)
+	leading_zeros = value ? __builtin_clz(value) : 32;
+#endif
+	
+	bin = 32 - leading_zeros;
+	return (bin < OS_HISTOGRAM_BINS) ? bin : (OS_HISTOGRAM_BINS - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Adds a sample to a log scale histogram
+///////////////////////////////////////////////////////////////////////////////
+static void AddSample(UINT32 * histogram, UINT32 * max, UINT64 value_us)
+{
+	UINT32 value = (value_us > 0xFFFFFFFF) ? 0xFFFFFFFF : (UINT32) value_us;
+	
+	histogram[GetHistogramBin(value)]++;
+	if(*max < value) *max = value;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Statistics variable initialization
 ///////////////////////////////////////////////////////////////////////////////
@@ -25,6 +54,9 @@ void _OS_StatInit(void)
 	g_max_scheduler_elapsed_count = 0;
 	g_periodic_timer_intr_counter = 0;
 	g_budget_timer_intr_counter = 0;
+	g_max_mmu_switch_elapsed_count = 0;
+	g_schedule_counter = 0;
+	g_ptable_switch_counter = 0;
 }
 
 OS_Return _OS_GetStatCounters(OS_StatCounters * ptr)
@@ -41,8 +73,12 @@ OS_Return _OS_GetStatCounters(OS_StatCounters * ptr)
 	ptr->max_scheduler_elapsed_us = CONVERT_TMR0_TICKS_TO_us(g_max_scheduler_elapsed_count);
 	ptr->periodic_timer_intr_counter = g_periodic_timer_intr_counter;
 	ptr->budget_timer_intr_counter = g_budget_timer_intr_counter;
+	ptr->max_mmu_switch_elapsed_us = CONVERT_TMR0_TICKS_TO_us(g_max_mmu_switch_elapsed_count);
+	ptr->schedule_counter = g_schedule_counter;
+	ptr->ptable_switch_counter = g_ptable_switch_counter;
 	
 	g_max_scheduler_elapsed_count = 0;	// Reset this every time this function is called
+	g_max_mmu_switch_elapsed_count = 0;
 	
 	return SUCCESS;
 }
@@ -70,7 +106,7 @@ OS_Return _OS_GetTaskStatCounters(OS_Task_t task, OS_TaskStatCounters * ptr)
 	strncpy(ptr->name, tcb->name, sizeof(ptr->name) - 1);
 	ptr->name[sizeof(ptr->name) - 1] = '\0';
 	
-    if(IS_PERIODIC_TASK(tcb->attributes))
+    if(IS_PERIODIC_TASK(tcb->attributes) || IS_CBS_TASK(tcb->attributes))
 	{
 		ptr->period = tcb->p.period;
 		ptr->budget = tcb->p.budget;
@@ -90,4 +126,64 @@ OS_Return _OS_GetTaskStatCounters(OS_Task_t task, OS_TaskStatCounters * ptr)
 	return SUCCESS;	
 }
 
+OS_Return _OS_GetTaskHistograms(OS_Task_t task, OS_TaskHistograms * ptr)
+{
+	if(!ptr)
+		return INVALID_ARG;
+	
+	// This function can only be called by process with admin previleges.
+	if(!(g_current_process->attributes & ADMIN_PROCESS))
+		return NOT_ADMINISTRATOR;
+	
+	if(task >= MAX_TASK_COUNT)
+		return INVALID_TASK;
+	
+	if(IS_PERIODIC_TASK(g_task_pool[task].attributes))
+	{
+		*ptr = g_task_job_stat[task].hist;
+	}
+	else
+	{
+		memset(ptr, 0, sizeof(OS_TaskHistograms));
+	}
+	
+	return SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Clears the histograms of a new task
+///////////////////////////////////////////////////////////////////////////////
+void _OS_StatTaskInit(const OS_Task * task)
+{
+	memset(&g_task_job_stat[task->id].hist, 0, sizeof(OS_TaskHistograms));
+	g_task_job_stat[task->id].started_release_us = (UINT64) -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Notes down the start jitter when a job of a periodic task is dispatched the first time
+///////////////////////////////////////////////////////////////////////////////
+void _OS_StatJobStart(const OS_Task * task, UINT64 now)
+{
+	_OS_TaskJobStat * stat = &g_task_job_stat[task->id];
+	
+	if(task->p.job_release_time > now)
+		return;
+	
+	stat->started_release_us = task->p.job_release_time;
+	AddSample(stat->hist.start_jitter, &stat->hist.max_start_jitter_us, now - task->p.job_release_time);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Notes down the response time when a job of a periodic task yields
+///////////////////////////////////////////////////////////////////////////////
+void _OS_StatJobEnd(const OS_Task * task, UINT64 now)
+{
+	_OS_TaskJobStat * stat = &g_task_job_stat[task->id];
+	
+	if(task->p.job_release_time > now)
+		return;
+	
+	AddSample(stat->hist.response_time, &stat->hist.max_response_time_us, now - task->p.job_release_time);
+}
+
 #endif // OS_ENABLE_CPU_STATS
@@ -18,6 +18,27 @@
 void _OS_StatInit(void);
 OS_Return _OS_GetStatCounters(OS_StatCounters * ptr);
 OS_Return _OS_GetTaskStatCounters(OS_Task_t task, OS_TaskStatCounters * ptr);
+OS_Return _OS_GetTaskHistograms(OS_Task_t task, OS_TaskHistograms * ptr);
+
+// Job timing statistics of a task
+typedef struct
+{
+	OS_TaskHistograms hist;
+	UINT64 started_release_us;		// Release time of the last job that was dispatched
+	
+} _OS_TaskJobStat;
+
+extern _OS_TaskJobStat g_task_job_stat[MAX_TASK_COUNT];
+
+void _OS_StatTaskInit(const OS_Task * task);
+void _OS_StatJobStart(const OS_Task * task, UINT64 now);
+void _OS_StatJobEnd(const OS_Task * task, UINT64 now);
+
+// Returns TRUE if the current job of the periodic task was not dispatched so far
+static __inline__ BOOL _OS_StatIsNewJob(const OS_Task * task)
+{
+	return g_task_job_stat[task->id].started_release_us != task->p.job_release_time;
+}
 
 #endif
 
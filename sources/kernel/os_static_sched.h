@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_static_sched.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Static schedule table used when OS_STATIC_SCHEDULE is enabled
+//					The table is generated offline by tools/schedgen from the task
+//					manifest. It has the EDF schedule of one hyperperiod as a list of
+//					slots. The kernel dispatches the task of the current slot and does
+//					not use the scheduler queues for the periodic tasks.
+//					This file is shared with the host tools. So it should only depend
+//					on os_types.h
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _OS_STATIC_SCHED_H
+#define _OS_STATIC_SCHED_H
+
+#include "os_types.h"
+
+// Maximum number of periodic tasks in a static schedule
+#define OS_STATIC_MAX_TASKS			255
+
+// Task index of the slots in which no periodic task runs
+#define OS_SLOT_IDLE				0xFF
+
+// Slot flags
+#define OS_SLOT_JOB_END				1		// The job has used up its budget at the end of the slot
+
+// Periodic task in the schedule. The tasks are created as usual and matched by
+// their name and parameters when the scheduling starts
+typedef struct
+{
+	const INT8 * name;
+	UINT32 period;
+	UINT32 deadline;
+	UINT32 budget;
+	UINT32 phase;
+
+} OS_StaticTask;
+
+// The slot lasts till the start of the next slot. Each slot belongs to one job of a
+// task. The release time of the job can be before the start of the hyperperiod
+// (negative) if the job is carried over from the previous hyperperiod.
+typedef struct
+{
+	UINT32 start;			// Offset in us from the start of the hyperperiod
+	INT32 release;			// Release time of the job relative to the start of the hyperperiod
+	UINT8 task;				// Index in the task list or OS_SLOT_IDLE
+	UINT8 flags;
+
+} OS_StaticSlot;
+
+typedef struct
+{
+	UINT32 hyperperiod;		// in us
+	UINT32 task_count;
+	UINT32 slot_count;
+	const OS_StaticTask * tasks;
+	const OS_StaticSlot * slots;
+
+} OS_StaticSchedule;
+
+// The generated table
+extern const OS_StaticSchedule g_static_schedule;
+
+#endif // _OS_STATIC_SCHED_H
@@ -9,7 +9,11 @@
 
 #include "os_core.h"
 #include "os_sem.h"
+#include "os_mutex.h"
+#include "os_msgq.h"
+#include "os_event.h"
 #include "os_stat.h"
+#include "os_trace.h"
 #include "os_driver.h"
 #include "target.h"
 #include "../usr/includes/os_syscall.h"
@@ -23,19 +27,27 @@ static void syscall_ProcessCreate(const _OS_Syscall_Args * param_info, const voi
 static void syscall_ProcessCreateFromFile(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_SemAlloc(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_SemWait(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
+static void syscall_SemTimedWait(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_SemPost(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_SemFree(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_SemGetValue(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
+static void syscall_Mutex(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
+static void syscall_Futex(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
+static void syscall_MsgQueue(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
+static void syscall_Event(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_GetCurTask(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_TaskYield(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_TaskComplete(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_SetUserLED(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_OSGetStat(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_TaskGetStat(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
+static void syscall_TaskGetHistograms(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_GetTaskAllocMask(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_DriverStandardCall(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_DriverCustomCall(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_GetCurProcess(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
+static void syscall_ProcessSetReservation(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
+static void syscall_TaskSetOverrunPolicy(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_MapPhysicalMem(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_UnmapMem(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
 static void syscall_GetDisplayFrameBuffer(const _OS_Syscall_Args * param_info, const void * arg, void * ret);
@@ -77,9 +89,15 @@ static Syscall_handler _syscall_handlers[SYSCALL_MAX_COUNT] = {
 		syscall_MapPhysicalMem,
 		syscall_UnmapMem,
 		syscall_GetDisplayFrameBuffer,
+		syscall_ProcessSetReservation,
+		syscall_TaskSetOverrunPolicy,
+		syscall_TaskGetHistograms,
+		syscall_Mutex,
+		syscall_Futex,
+		syscall_SemTimedWait,
+		syscall_MsgQueue, 
+		syscall_Event,
 		0, 0, 0, 
-		0, 0, 0, 0, 
-		0, 0, 0, 0, 
 		syscall_SetUserLED
 	};
 
@@ -97,9 +115,14 @@ void _OS_KernelSyscall(const _OS_Syscall_Args * param_info, const void * arg, vo
 	
 	Klog32(KLOG_SYSCALL, "Syscall Id - ", param_info->id);
 	
+	OS_TRACE(TRACE_SYSCALL_ENTER, g_current_task, param_info->id | (param_info->sub_id << 16));
+	
 	// Note down the return pointer which may be needed to update the output parameters
 	if(g_current_task) g_current_task->syscall_result = (UINT32 *)ret;
 	_syscall_handlers[param_info->id](param_info, arg, ret);
+	
+	// The syscalls that switch to another task do not come back here
+	OS_TRACE(TRACE_SYSCALL_EXIT, g_current_task, param_info->id | (param_info->sub_id << 16));
 }
 
 void syscall_PeriodicTaskCreate(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
@@ -108,7 +131,26 @@ void syscall_PeriodicTaskCreate(const _OS_Syscall_Args * param_info, const void
 	UINT32 * uint_ret = (UINT32 *)ret;
 	OS_Return result = SYSCALL_ARGUMENT_ERROR;
 	
-	if((param_info->arg_count >= 9) && (param_info->ret_count >= 2))
+	if(param_info->sub_id == SUBCALL_PERIODIC_MIXED_CRITICALITY_TASK)
+	{
+		if((param_info->arg_count >= 11) && (param_info->ret_count >= 2))
+		{
+			result = _OS_CreateMixedCriticalityTask((UINT16)uint_args[0],
+									(UINT32)uint_args[1],
+									(UINT32)uint_args[2],
+									(UINT32)uint_args[3],
+									(UINT32)uint_args[4],
+									(UINT32)uint_args[5],
+									(UINT32 *)uint_args[6],
+									(UINT32)uint_args[7],
+									(INT8 *)uint_args[8],
+									USER_TASK,
+									(OS_Task_t *)(uint_ret+1),
+									(void *)uint_args[9],
+									(void *)uint_args[10]);
+		}
+	}
+	else if((param_info->arg_count >= 9) && (param_info->ret_count >= 2))
 	{	
 		result = _OS_CreatePeriodicTask((UINT32)uint_args[0],
 									(UINT32)uint_args[1],
@@ -134,10 +176,21 @@ void syscall_TaskYield(const _OS_Syscall_Args * param_info, const void * arg, vo
 void syscall_TaskComplete(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
 {
 	UINT32 * uint_ret = (UINT32 *)ret;
+	OS_Return result;
 	
-	// Complete current aperiodic task. This removes the task from future scheduling
-	// and moves it into permanent blocked queue
-	OS_Return result = _OS_CompleteAperiodicTask();
+	if(IS_PERIODIC_TASK(g_current_task->attributes))
+	{
+		// The periodic task ends for good. Its TCB and the CPU reserved for it are
+		// freed, so that new tasks can be admitted. This call does not return
+		if(uint_ret) uint_ret[0] = SUCCESS;
+		result = _OS_CompletePeriodicTask();
+	}
+	else
+	{
+		// Complete current aperiodic task. This removes the task from future scheduling
+		// and moves it into permanent blocked queue
+		result = _OS_CompleteAperiodicTask();
+	}
 	
 	if(uint_ret) uint_ret[0] = result;
 }
@@ -148,7 +201,22 @@ void syscall_AperiodicTaskCreate(const _OS_Syscall_Args * param_info, const void
 	UINT32 * uint_ret = (UINT32 *)ret;
 	OS_Return result = SYSCALL_ARGUMENT_ERROR;
 	
-	if((param_info->arg_count >= 6) && (param_info->ret_count >= 2))
+	if(param_info->sub_id == SUBCALL_APERIODIC_CBS_TASK)
+	{
+		if((param_info->arg_count >= 7) && (param_info->ret_count >= 2))
+		{
+			result = _OS_CreateCBSTask((UINT32)uint_args[0],
+									(UINT32)uint_args[1],
+									(UINT32 *)uint_args[2],
+									(UINT32)uint_args[3],
+									(INT8 *)uint_args[4],
+									USER_TASK,
+									(OS_Task_t *)(uint_ret+1),
+									(void *)uint_args[5],
+									(void *)uint_args[6]);
+		}
+	}
+	else if((param_info->arg_count >= 6) && (param_info->ret_count >= 2))
 	{
 		result = _OS_CreateAperiodicTask((UINT32)uint_args[0],
 								(UINT32 *)uint_args[1],
@@ -184,6 +252,35 @@ void syscall_GetCurProcess(const _OS_Syscall_Args * param_info, const void * arg
 	}
 }
 
+void syscall_ProcessSetReservation(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
+{
+	const UINT32 * uint_args = (const UINT32 *)arg;
+	UINT32 * uint_ret = (UINT32 *)ret;
+	OS_Return result = SYSCALL_ARGUMENT_ERROR;
+	
+	if((param_info->arg_count >= 2) && (param_info->ret_count >= 1))
+	{
+		result = _OS_SetProcessReservation(g_current_process, (UINT32)uint_args[0], (UINT32)uint_args[1]);
+	}
+	
+	if(uint_ret) uint_ret[0] = result;
+}
+
+void syscall_TaskSetOverrunPolicy(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
+{
+	const UINT32 * uint_args = (const UINT32 *)arg;
+	UINT32 * uint_ret = (UINT32 *)ret;
+	OS_Return result = SYSCALL_ARGUMENT_ERROR;
+	
+	if((param_info->arg_count >= 4) && (param_info->ret_count >= 1))
+	{
+		result = _OS_SetOverrunPolicy((OS_Task_t)uint_args[0], (UINT32)uint_args[1], 
+									(UINT32)uint_args[2], (OS_Sem_t)uint_args[3]);
+	}
+	
+	if(uint_ret) uint_ret[0] = result;
+}
+
 void syscall_MapPhysicalMem(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
 {
 	const UINT32 * uint_args = (const UINT32 *)arg;
@@ -236,7 +333,7 @@ void syscall_MapPhysicalMem(const _OS_Syscall_Args * param_info, const void * ar
 								uint_args[1],
 								uint_args[1],
 								uint_args[2], 
-								ap, cacheable, write_Buffer);
+								ap, cacheable, write_Buffer, FALSE);
 
 #elif USER_PAGE_SIZE==64
 
@@ -245,11 +342,14 @@ void syscall_MapPhysicalMem(const _OS_Syscall_Args * param_info, const void * ar
 								uint_args[1],
 								uint_args[1],
 								uint_args[2], 
-								ap, cacheable, write_Buffer);
+								ap, cacheable, write_Buffer, FALSE);
 
 #else
 	#error "Supported values for USER_PAGE_SIZE is either 4 or 64"
 #endif
+		// The process may already have TLB entries for this area
+		FLUSH_PROCESS_TLB(pcb);
+
 		// Store the Virtual address we have used (we are using Virtual Address == Physical Address)
 		uint_ret[1] = uint_args[1];
 #endif // ENABLE_MMU	
@@ -289,7 +389,7 @@ void syscall_UnmapMem(const _OS_Syscall_Args * param_info, const void * arg, voi
 								uint_args[1],
 								uint_args[1],
 								uint_args[2], 
-								KERNEL_NA_USER_NA, FALSE, FALSE);
+								KERNEL_NA_USER_NA, FALSE, FALSE, FALSE);
 
 #elif USER_PAGE_SIZE==64
 
@@ -298,11 +398,13 @@ void syscall_UnmapMem(const _OS_Syscall_Args * param_info, const void * arg, voi
 								uint_args[1],
 								uint_args[1],
 								uint_args[2], 
-								KERNEL_NA_USER_NA, FALSE, FALSE);
+								KERNEL_NA_USER_NA, FALSE, FALSE, FALSE);
 
 #else
 	#error "Supported values for USER_PAGE_SIZE is either 4 or 64"
 #endif
+		// Discard the TLB entries of the unmapped area
+		FLUSH_PROCESS_TLB(pcb);
 #endif // ENABLE_MMU	
 
 	} while(0);
@@ -337,6 +439,19 @@ void syscall_SemWait(const _OS_Syscall_Args * param_info, const void * arg, void
 	if(ret) ((UINT32 *)ret)[0] = result;
 }
 
+void syscall_SemTimedWait(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
+{
+	const UINT32 * uint_args = (const UINT32 *)arg;
+	OS_Return result = SYSCALL_ARGUMENT_ERROR;
+	
+	if(param_info->arg_count >= 4)
+	{		
+		result = _OS_SemTimedWait(uint_args[0], ((UINT64) uint_args[2] << 32) | uint_args[1], uint_args[3]);
+	}
+	
+	if(ret) ((UINT32 *)ret)[0] = result;
+}
+
 void syscall_SemPost(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
 {
 	const UINT32 * uint_args = (const UINT32 *)arg;
@@ -377,6 +492,181 @@ void syscall_SemGetValue(const _OS_Syscall_Args * param_info, const void * arg,
 	if(uint_ret) uint_ret[0] = result;
 }
 
+void syscall_Mutex(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
+{
+	const UINT32 * uint_args = (const UINT32 *)arg;
+	UINT32 * uint_ret = (UINT32 *)ret;
+	OS_Return result = SYSCALL_ARGUMENT_ERROR;
+	
+	switch(param_info->sub_id)
+	{
+	case SUBCALL_MUTEX_ALLOC:
+		if((param_info->arg_count >= 1) && (param_info->ret_count >= 2))
+		{
+			result = _OS_MutexAlloc((OS_Mutex_t *)(uint_ret+1), uint_args[0]);
+		}
+		break;
+		
+	case SUBCALL_MUTEX_LOCK:
+		if(param_info->arg_count >= 1)
+		{
+			result = _OS_MutexLock(uint_args[0]);
+		}
+		break;
+		
+	case SUBCALL_MUTEX_UNLOCK:
+		if(param_info->arg_count >= 1)
+		{
+			result = _OS_MutexUnlock(uint_args[0]);
+		}
+		break;
+		
+	case SUBCALL_MUTEX_FREE:
+		if(param_info->arg_count >= 1)
+		{
+			result = _OS_MutexFree(uint_args[0]);
+		}
+		break;
+	}
+	
+	if(uint_ret) uint_ret[0] = result;
+}
+
+void syscall_Futex(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
+{
+	const UINT32 * uint_args = (const UINT32 *)arg;
+	OS_Return result = SYSCALL_ARGUMENT_ERROR;
+	
+	switch(param_info->sub_id)
+	{
+	case SUBCALL_FUTEX_WAIT:
+		if(param_info->arg_count >= 3)
+		{
+			result = _OS_SemFutexWait(uint_args[0], (const volatile UINT32 *) uint_args[1], uint_args[2]);
+		}
+		break;
+		
+	case SUBCALL_FUTEX_WAKE:
+		if(param_info->arg_count >= 1)
+		{
+			result = _OS_SemFutexWake(uint_args[0]);
+		}
+		break;
+		
+	case SUBCALL_FUTEX_INIT:
+		if(param_info->ret_count >= 2)
+		{
+			result = _OS_SemFutexAlloc((OS_Sem_t *)((UINT32 *)ret + 1));
+		}
+		break;
+	}
+	
+	if(ret) ((UINT32 *)ret)[0] = result;
+}
+
+void syscall_MsgQueue(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
+{
+	const UINT32 * uint_args = (const UINT32 *)arg;
+	UINT32 * uint_ret = (UINT32 *)ret;
+	OS_Return result = SYSCALL_ARGUMENT_ERROR;
+	
+	switch(param_info->sub_id)
+	{
+	case SUBCALL_MSGQ_CREATE:
+		if((param_info->arg_count >= 3) && (param_info->ret_count >= 2))
+		{
+			result = _OS_MsgQueueCreate((const INT8 *) uint_args[0], uint_args[1], uint_args[2], 
+										(OS_MsgQueue_t *)(uint_ret+1));
+		}
+		break;
+		
+	case SUBCALL_MSGQ_OPEN:
+		if((param_info->arg_count >= 1) && (param_info->ret_count >= 2))
+		{
+			result = _OS_MsgQueueOpen((const INT8 *) uint_args[0], (OS_MsgQueue_t *)(uint_ret+1));
+		}
+		break;
+		
+	case SUBCALL_MSGQ_ALLOC:
+		if((param_info->arg_count >= 1) && (param_info->ret_count >= 2))
+		{
+			result = _OS_MsgQueueAlloc(uint_args[0], (void **)(uint_ret+1));
+		}
+		break;
+		
+	case SUBCALL_MSGQ_SEND:
+		if(param_info->arg_count >= 2)
+		{
+			result = _OS_MsgQueueSend(uint_args[0], (const void *) uint_args[1]);
+		}
+		break;
+		
+	case SUBCALL_MSGQ_RECEIVE:
+		if((param_info->arg_count >= 1) && (param_info->ret_count >= 2))
+		{
+			result = _OS_MsgQueueReceive(uint_args[0], (void **)(uint_ret+1));
+		}
+		break;
+		
+	case SUBCALL_MSGQ_RELEASE:
+		if(param_info->arg_count >= 2)
+		{
+			result = _OS_MsgQueueRelease(uint_args[0], (const void *) uint_args[1]);
+		}
+		break;
+	}
+	
+	if(uint_ret) uint_ret[0] = result;
+}
+
+void syscall_Event(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
+{
+	const UINT32 * uint_args = (const UINT32 *)arg;
+	UINT32 * uint_ret = (UINT32 *)ret;
+	OS_Return result = SYSCALL_ARGUMENT_ERROR;
+	
+	switch(param_info->sub_id)
+	{
+	case SUBCALL_EVENT_ALLOC:
+		if((param_info->arg_count >= 1) && (param_info->ret_count >= 2))
+		{
+			result = _OS_EventAlloc((OS_Event_t *)(uint_ret+1), uint_args[0]);
+		}
+		break;
+		
+	case SUBCALL_EVENT_WAIT:
+		// The task that posts the flags returns them in the second word
+		if((param_info->arg_count >= 3) && (param_info->ret_count >= 2))
+		{
+			result = _OS_EventWait(uint_args[0], uint_args[1], uint_args[2], uint_ret+1);
+		}
+		break;
+		
+	case SUBCALL_EVENT_POST:
+		if(param_info->arg_count >= 2)
+		{
+			result = _OS_EventPost(uint_args[0], uint_args[1]);
+		}
+		break;
+		
+	case SUBCALL_EVENT_CLEAR:
+		if(param_info->arg_count >= 2)
+		{
+			result = _OS_EventClear(uint_args[0], uint_args[1]);
+		}
+		break;
+		
+	case SUBCALL_EVENT_FREE:
+		if(param_info->arg_count >= 1)
+		{
+			result = _OS_EventFree(uint_args[0]);
+		}
+		break;
+	}
+	
+	if(uint_ret) uint_ret[0] = result;
+}
+
 void syscall_GetCurTask(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
 {
 	// TODO: Implement this function
@@ -424,7 +714,10 @@ void syscall_GetDisplayFrameBuffer(const _OS_Syscall_Args * param_info, const vo
 								(UINT32)FB_ADDR,
 								(UINT32)FB_ADDR,
 								FB_SIZE,
-								KERNEL_RW_USER_RW, FALSE, FALSE);
+								KERNEL_RW_USER_RW, FALSE, FALSE, FALSE);
+
+		// The kernel map of the frame buffer may already be in the TLB
+		FLUSH_PROCESS_TLB(g_current_process);
 #endif
 
 		uint_ret[0] = (UINT32)FB_ADDR;				
@@ -475,6 +768,24 @@ void syscall_TaskGetStat(const _OS_Syscall_Args * param_info, const void * arg,
 #endif	
 }
 
+void syscall_TaskGetHistograms(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
+{
+	UINT32 * uint_ret = (UINT32 *)ret;
+#if OS_ENABLE_CPU_STATS==1
+	const UINT32 * uint_args = (const UINT32 *)arg;
+	OS_Return result = SYSCALL_ARGUMENT_ERROR;
+	
+	if(param_info->arg_count >= 2)
+	{
+		result = _OS_GetTaskHistograms((OS_Task_t )uint_args[0], (OS_TaskHistograms *)uint_args[1]);
+	}
+	
+	if(uint_ret) uint_ret[0] = result;
+#else
+	if(uint_ret) uint_ret[0] = NOT_CONFIGURED;	
+#endif	
+}
+
 void syscall_GetTaskAllocMask(const _OS_Syscall_Args * param_info, const void * arg, void * ret)
 {
 	UINT32 * uint_ret = (UINT32 *)ret;
@@ -12,10 +12,14 @@
 #include "os_queue.h"
 #include "os_timer.h"
 #include "os_task.h"
+#include "os_vfp.h"
+#include "os_trace.h"
+#include "os_stat.h"
 #include "util.h"
 
 // function prototype declaration
-static BOOL ValidateNewThread(UINT32 period, UINT32 budget);
+static BOOL ValidateNewThread(OS_Task * new_task);
+static void AddTaskReservation(OS_Task * task);
 
 #ifdef _USE_STD_LIBS
 	#define FAULT(x, ...) printf(x, ...);
@@ -23,15 +27,36 @@ static BOOL ValidateNewThread(UINT32 period, UINT32 budget);
 	#define FAULT(x, ...)
 #endif
 
+// The CPU usage is kept in fixed point, 1.0 == CPU_USAGE_ONE. The usage of each thread
+// is rounded up so that the total is never below the actual value.
+#define CPU_USAGE_SHIFT		24
+#define CPU_USAGE_ONE		(1ull << CPU_USAGE_SHIFT)
+
 // Macro for calculating the thread usage
-#define CALC_THREAD_CPU_USAGE(period, budget) ((FP32)budget / (FP32)period)
+#define CALC_THREAD_CPU_USAGE(period, budget) \
+	((((UINT64)(budget) << CPU_USAGE_SHIFT) + (period) - 1) / (period))
 #define MIN(a,b) ((a)<(b)?(a):(b))
+#define MAX(a,b) ((a)>(b)?(a):(b))
 #define ALIGNED_ARRAY(ptr) ASSERT((int) ptr % 8 == 0)
 
 ///////////////////////////////////////////////////////////////////////////////
 // Global Data
 ///////////////////////////////////////////////////////////////////////////////
-static FP32 g_total_allocated_cpu = 0.0;
+// Sum of budget / period of all periodic & CBS tasks
+static UINT64 g_total_allocated_cpu = 0;
+
+// Sum of budget / MIN(period, deadline) of all periodic & CBS tasks
+static UINT64 g_total_allocated_density = 0;
+
+#if OS_MIXED_CRITICALITY==1
+// Sum of budget / MIN(period, deadline) of the low criticality tasks
+static UINT64 g_lo_criticality_density = 0;
+
+// Sum of the low criticality budget / MIN(period, deadline) of the high criticality tasks.
+// The CBS tasks and the process servers are high criticality tasks with the same budget
+// in both modes.
+static UINT64 g_hi_criticality_lo_density = 0;
+#endif
 
 // Placeholders for all the task control blocks
 OS_Task	g_task_pool[MAX_TASK_COUNT];
@@ -74,9 +99,55 @@ OS_Return OS_CreatePeriodicTask(
 			pdata);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// OS_CreateMixedCriticalityTask - API to create periodic tasks with a criticality level
+///////////////////////////////////////////////////////////////////////////////
+OS_Return OS_CreateMixedCriticalityTask(
+	UINT16 criticality,
+	UINT32 period_in_us,
+	UINT32 deadline_in_us,
+	UINT32 budget_in_us,
+	UINT32 hi_budget_in_us,
+	UINT32 phase_shift_in_us,
+	UINT32 *stack,
+	UINT32 stack_size_in_bytes,
+	const INT8 * task_name,
+	OS_Task_t *task,
+	void (*periodic_entry_function)(void *pdata),
+	void *pdata)
+{	
+	return _OS_CreateMixedCriticalityTask(
+			criticality,
+			period_in_us,
+			deadline_in_us,
+			budget_in_us,
+			hi_budget_in_us,
+			phase_shift_in_us,
+			stack,
+			stack_size_in_bytes,
+			task_name,
+			USER_TASK,
+			task,
+			periodic_entry_function,
+			pdata);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// OS_SetOverrunPolicy - API to set the action taken when a periodic job overruns
+///////////////////////////////////////////////////////////////////////////////
+OS_Return OS_SetOverrunPolicy(
+	OS_Task_t task,
+	UINT32 policy,
+	UINT32 skip_count,
+	OS_Sem_t notify_sem)
+{
+	return _OS_SetOverrunPolicy(task, policy, skip_count, notify_sem);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // OS_CreatePeriodicTask - API to create periodic tasks
 //		OS Internal function with more arguments
+// The task has high criticality with the same budget in both criticality modes
 ///////////////////////////////////////////////////////////////////////////////
 OS_Return _OS_CreatePeriodicTask(
 	UINT32 period_in_us,
@@ -91,7 +162,41 @@ OS_Return _OS_CreatePeriodicTask(
 	void (*periodic_entry_function)(void *pdata),
 	void *pdata)
 {
-	FP32 this_thread_cpu;
+	return _OS_CreateMixedCriticalityTask(
+			HIGH_CRITICALITY,
+			period_in_us,
+			deadline_in_us,
+			budget_in_us,
+			budget_in_us,
+			phase_shift_in_us,
+			stack,
+			stack_size_in_bytes,
+			task_name,
+			options,
+			task,
+			periodic_entry_function,
+			pdata);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The task creation routine for periodic tasks
+//		OS Internal function with more arguments
+///////////////////////////////////////////////////////////////////////////////
+OS_Return _OS_CreateMixedCriticalityTask(
+	UINT16 criticality,
+	UINT32 period_in_us,
+	UINT32 deadline_in_us,
+	UINT32 budget_in_us,
+	UINT32 hi_budget_in_us,
+	UINT32 phase_shift_in_us,
+	UINT32 *stack,
+	UINT32 stack_size_in_bytes,
+	const INT8 * task_name,
+	UINT16 options,
+	OS_Task_t *task,
+	void (*periodic_entry_function)(void *pdata),
+	void *pdata)
+{
 	UINT32 stack_size;
 	UINT32 intsts;
 	OS_Task *tcb;
@@ -108,6 +213,14 @@ OS_Return _OS_CreatePeriodicTask(
 		return INVALID_ARG;
 	}
 
+#if OS_TICKLESS_SCHEDULING==1
+	// There is no periodic tick in tickless mode. So any period above the minimum is fine
+	if(period_in_us < MIN_TASK_PERIOD)
+	{
+		FAULT("Task %s: Period should be at least %d\n", task_name, TASK_MIN_PERIOD);
+		return INVALID_PERIOD;
+	}
+#else
 	if((period_in_us < MIN_TASK_PERIOD) || (period_in_us % MIN_TASK_PERIOD))
 	{
 		FAULT("Task %s: Period should be multiple of %d\n", task_name, TASK_MIN_PERIOD);
@@ -119,6 +232,7 @@ OS_Return _OS_CreatePeriodicTask(
 		FAULT("Task %s: Phase should be multiple of %d\n", task_name, TASK_MIN_PERIOD);
 		return INVALID_PHASE;		
 	}
+#endif
 	
 	if(deadline_in_us < budget_in_us)
 	{
@@ -136,6 +250,39 @@ OS_Return _OS_CreatePeriodicTask(
 		return INVALID_BUDGET;
 	}
 	
+	if(criticality == LOW_CRITICALITY)
+	{
+		hi_budget_in_us = budget_in_us;
+	}
+	else if(criticality != HIGH_CRITICALITY)
+	{
+		FAULT("Task %s: Invalid criticality %d\n", task_name, criticality);
+		return INVALID_ARG;
+	}
+	
+	if((hi_budget_in_us < budget_in_us) || (hi_budget_in_us > deadline_in_us))
+	{
+		FAULT("Task %s: The high criticality budget should be between the budget and the deadline\n", task_name);
+		return INVALID_BUDGET;
+	}
+	
+#if OS_MIXED_CRITICALITY==0
+	if((criticality == LOW_CRITICALITY) || (hi_budget_in_us != budget_in_us))
+	{
+		FAULT("Task %s: Mixed criticality scheduling is not enabled\n", task_name);
+		return NOT_SUPPORTED;
+	}
+#endif
+
+#if OS_STATIC_SCHEDULE==1
+	// The static schedule cannot change once the scheduling starts
+	if(_OS_IsRunning)
+	{
+		FAULT("Task %s: The periodic tasks should be created before the static schedule starts\n", task_name);
+		return NOT_SUPPORTED;
+	}
+#endif
+	
 	// Validate for minimum stack size for user stacks. Kernel stacks know what they want
 	if(IS_USER_TASK(options) && (stack_size_in_bytes < OS_MIN_USER_STACK_SIZE))	
 	{
@@ -163,6 +310,7 @@ OS_Return _OS_CreatePeriodicTask(
 	stack_size = stack_size_in_bytes >> 2; 
 
 	tcb->attributes = (PERIODIC_TASK | options);
+	if(criticality == HIGH_CRITICALITY) tcb->attributes |= HI_CRITICALITY_TASK;
 #if OS_WITH_VALIDATE_TASK==1
 	tcb->signature = TASK_SIGNATURE;
 #endif
@@ -184,29 +332,58 @@ OS_Return _OS_CreatePeriodicTask(
 	tcb->p.exec_count = 0;
 	tcb->p.TBE_count = 0;
 	tcb->p.dline_miss_count = 0;
+	tcb->p.overrun_policy = OVERRUN_CONTINUE;
+	tcb->p.overrun_skip = 0;
+	tcb->p.overrun_sem = -1;
+	tcb->p.skipped_count = 0;
+	tcb->p.restart_job = FALSE;
 	tcb->p.alarm_time() = 0;
 	tcb->p.id = *task;
+#if OS_MIXED_CRITICALITY==1
+	tcb->p.budget_hi = hi_budget_in_us;
+	tcb->p.virtual_deadline = deadline_in_us;
+	tcb->p.dropped_count = 0;
+#endif
 	
 	// Note down the owner process
 	tcb->owner_process = g_current_process ? g_current_process : g_kernel_process;
+	
+	// The tasks in a process reservation are isolated by the reservation. They cannot
+	// take part in the mixed criticality scheduling
+	if(tcb->owner_process->server && (tcb->p.budget != hi_budget_in_us || criticality == LOW_CRITICALITY))
+	{
+		FAULT("Task %s: Criticality levels are not supported in a process reservation\n", task_name);
+		return NOT_SUPPORTED;
+	}
+	
+	// A dropped low criticality job is aborted. The kernel cannot release the user space
+	// locks that it holds
+	if((criticality == LOW_CRITICALITY) && _OS_SemProcessHasFutex(tcb->owner_process))
+	{
+		FAULT("Task %s: Low criticality tasks are not supported in a process with user space locks\n", task_name);
+		return NOT_SUPPORTED;
+	}
 
 	OS_ENTER_CRITICAL(intsts);
-	//if(!ValidateNewThread(period_in_us, budget_in_us))
-	if(!ValidateNewThread(MIN(period_in_us, deadline_in_us), budget_in_us))
+	if(!ValidateNewThread(tcb))
 	{
 		OS_EXIT_CRITICAL(intsts); 
-		FAULT("The total allocated CPU exceeds %d%", 100);
+		FAULT("The task set is not schedulable with %s", task_name);
 		return EXCEEDS_MAX_CPU;
 	}
 	
 	// Block the thread resource
 	SetResourceStatus(g_task_usage_mask, *task, FALSE);
+	OS_TRACE_TASK_CREATE(tcb);
+#if OS_WITH_VFP==1
+	_OS_VFPInitTask(tcb);
+#endif
+#if OS_ENABLE_CPU_STATS==1
+	_OS_StatTaskInit(tcb);
+#endif
 	
-	// Calculate the CPU usage of the current thread
-	this_thread_cpu = CALC_THREAD_CPU_USAGE(MIN(period_in_us, deadline_in_us), budget_in_us);
-	
-	// Update the g_total_allocated_cpu
-	g_total_allocated_cpu += this_thread_cpu;
+	// Update the g_total_allocated_cpu & g_total_allocated_density
+	AddTaskReservation(tcb);
 	
 	OS_EXIT_CRITICAL(intsts); 	// Exit the critical section
 
@@ -236,6 +413,81 @@ OS_Return _OS_CreatePeriodicTask(
   	return SUCCESS; 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// _OS_SetOverrunPolicy
+// The task and the notification semaphore should belong to the current process
+///////////////////////////////////////////////////////////////////////////////
+OS_Return _OS_SetOverrunPolicy(OS_Task_t task, UINT32 policy, UINT32 skip_count, OS_Sem_t notify_sem)
+{
+	OS_Process * process = g_current_process ? g_current_process : g_kernel_process;
+	OS_Task * tcb;
+	OS_Return status;
+	UINT32 intsts;
+	
+#if OS_STATIC_SCHEDULE==1
+	// The jobs follow the offline schedule. They cannot be aborted or skipped
+	return NOT_SUPPORTED;
+#endif
+	
+	if((task < 0) || (task >= MAX_TASK_COUNT) || !IsResourceBusy(g_task_usage_mask, task))
+		return INVALID_TASK;
+	
+	tcb = &g_task_pool[task];
+	if(!IS_PERIODIC_TASK(tcb->attributes))
+		return INVALID_TASK;
+	
+	if(tcb->owner_process != process)
+		return RESOURCE_NOT_OWNED;
+	
+	if((policy & ~(OVERRUN_ABORT | OVERRUN_SKIP | OVERRUN_NOTIFY)) || 
+		((policy & OVERRUN_SKIP) && !skip_count))
+		return BAD_ARGUMENT;
+	
+	// The kernel cannot release the user space locks held by an aborted job
+	if((policy & OVERRUN_ABORT) && _OS_SemProcessHasFutex(process))
+	{
+		FAULT("Task %s: Jobs cannot be aborted in a process with user space locks\n", tcb->name);
+		return NOT_SUPPORTED;
+	}
+	
+	if(policy & OVERRUN_NOTIFY)
+	{
+		// Checks that the semaphore is open and owned by the current process
+		status = _OS_SemGetValue(notify_sem, NULL);
+		if(status != SUCCESS) return status;
+	}
+	
+	OS_ENTER_CRITICAL(intsts);
+	tcb->p.overrun_policy = policy;
+	tcb->p.overrun_skip = (policy & OVERRUN_SKIP) ? skip_count : 0;
+	tcb->p.overrun_sem = (policy & OVERRUN_NOTIFY) ? notify_sem : -1;
+	OS_EXIT_CRITICAL(intsts);
+	
+	return SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// _OS_ProcessAbortsJobs
+///////////////////////////////////////////////////////////////////////////////
+BOOL _OS_ProcessAbortsJobs(const OS_Process * process)
+{
+	OS_Task * tcb;
+	UINT32 index;
+	
+	for(index = 0; index < MAX_TASK_COUNT; index++)
+	{
+		tcb = &g_task_pool[index];
+		if(IsResourceBusy(g_task_usage_mask, index) && (tcb->owner_process == process) &&
+			IS_PERIODIC_TASK(tcb->attributes) && ((tcb->p.overrun_policy & OVERRUN_ABORT) ||
+			!IS_HI_CRITICALITY_TASK(tcb->attributes)))
+		{
+			return TRUE;
+		}
+	}
+	
+	return FALSE;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // OS_CreateAperiodicTask
 // 		OS API for creating Aperiodic task
@@ -263,6 +515,29 @@ OS_Return OS_CreateAperiodicTask(UINT16 priority,
 		pdata);		
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// OS_CreateCBSTask
+// 		OS API for creating Aperiodic task served by a Constant Bandwidth Server
+///////////////////////////////////////////////////////////////////////////////
+OS_Return OS_CreateCBSTask(UINT32 budget_in_us,
+	UINT32 period_in_us,
+	UINT32 * stack, UINT32 stack_size_in_bytes,
+	const INT8 * task_name,
+	OS_Task_t * task,
+	void(* task_entry_function)(void * pdata),
+	void * pdata)
+{
+	return _OS_CreateCBSTask(budget_in_us,
+		period_in_us,
+		stack,
+		stack_size_in_bytes,
+		task_name,
+		USER_TASK,
+		task,
+		task_entry_function,
+		pdata);		
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // The task creation routine for Aperiodic tasks
 //		OS Internal function with more arguments
@@ -349,8 +624,15 @@ OS_Return _OS_CreateAperiodicTask(UINT16 priority,
 	
 	// Block the resource
 	SetResourceStatus(g_task_usage_mask, *task, FALSE);
+	OS_TRACE_TASK_CREATE(tcb);
+#if OS_WITH_VFP==1
+	_OS_VFPInitTask(tcb);
+#endif
+#if OS_ENABLE_CPU_STATS==1
+	_OS_StatTaskInit(tcb);
+#endif
 	
-	_OS_PQueueInsertWithKey(&g_ap_ready_q, (_OS_TaskQNode *) tcb, priority); // Add the task to aperiodic ready queue
+	_OS_BitmapQueueInsert(&g_ap_ready_q, (_OS_TaskQNode *) tcb, priority); // Add the task to aperiodic ready queue
 	OS_EXIT_CRITICAL(intsts); // Exit the critical section
 	
 	if(_OS_IsRunning)
@@ -362,21 +644,732 @@ OS_Return _OS_CreateAperiodicTask(UINT16 priority,
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Validation for sufficient CPU Budget
-// ASSUMPTION: The interrupts are disabled when this function is invoked
+// The task creation routine for Aperiodic tasks served by a Constant Bandwidth Server
+// The task gets budget_in_us of CPU time in every period_in_us. Its jobs are scheduled
+// by EDF with the server deadline. The CPU bandwidth is reserved like a periodic task
+// with deadline == period, so the task cannot disturb the periodic tasks.
+//		OS Internal function with more arguments
 ///////////////////////////////////////////////////////////////////////////////
-static BOOL ValidateNewThread(UINT32 period, UINT32 budget)
+OS_Return _OS_CreateCBSTask(UINT32 budget_in_us,
+	UINT32 period_in_us,
+	UINT32 * stack, UINT32 stack_size_in_bytes,
+	const INT8 * task_name,
+	UINT16 options,
+	OS_Task_t * task,
+	void(* task_entry_function)(void * pdata),
+	void * pdata)
 {
-	// The current threads budget in terms of CPU usage %ge
-	FP32 this_thread_cpu = CALC_THREAD_CPU_USAGE(period, budget);
+	UINT32 stack_size;
+	UINT32 intsts;
+	UINT64 now;
+	OS_Task *tcb;
 
-	// Dont allow allocation of more than 90% of thr CPU
-	if(g_total_allocated_cpu + this_thread_cpu >= 1.0)
+	if(!task)
 	{
-		return FALSE;
+		FAULT("Invalid Task");
+		return INVALID_TASK;
 	}
 
-	return TRUE;
+	if(!task_entry_function || !stack || !task_name)
+	{
+		FAULT("One or more invalid %s arguments", "task");
+		return INVALID_ARG;
+	}
+	
+	if(period_in_us < MIN_TASK_PERIOD)
+	{
+		FAULT("Task %s: Period should be at least %d\n", task_name, MIN_TASK_PERIOD);
+		return INVALID_PERIOD;
+	}
+	
+	if((budget_in_us < MIN_TASK_BUDGET) || (budget_in_us > period_in_us))
+	{
+		FAULT("Task %s: Budget should be between %d uSec and the period\n", task_name, MIN_TASK_BUDGET);
+		return INVALID_BUDGET;
+	}
+	
+#if OS_STATIC_SCHEDULE==1
+	FAULT("Task %s: Only the periodic tasks can have a reservation with the static schedule\n", task_name);
+	return NOT_SUPPORTED;
+#endif
+	
+	// Validate for minimum stack size for user stacks. Kernel stacks know what they want
+	if(IS_USER_TASK(options) && (stack_size_in_bytes < OS_MIN_USER_STACK_SIZE))	
+	{
+		FAULT("Stack size should be at least %d bytes", OS_MIN_USER_STACK_SIZE);
+		return INSUFFICIENT_STACK;
+	}	
+	
+	// Now get a free TCB resource from the pool
+	*task = (OS_Task_t) GetFreeResIndex(g_task_usage_mask, MAX_TASK_COUNT);
+	if(*task < 0) 
+	{
+		FAULT("_OS_CreateCBSTask failed for process %s: Exhausted all resources\n", g_current_process->name);
+		return RESOURCE_EXHAUSTED;	
+	}
+	
+	KlogStr(KLOG_GENERAL_INFO, "Creating CBS task - ", task_name);
+
+	// Get a pointer to the TCB
+	tcb = &g_task_pool[*task];
+
+	// Convert the stack_size_in_bytes into number of words
+	stack_size = stack_size_in_bytes >> 2;
+
+	tcb->attributes = (APERIODIC_TASK | CBS_TASK | options);
+#if OS_WITH_VALIDATE_TASK==1
+	tcb->signature = TASK_SIGNATURE;
+#endif
+	strncpy(tcb->name, task_name, OS_TASK_NAME_SIZE - 1);
+	tcb->name[OS_TASK_NAME_SIZE-1] = '\0';
+
+	// The server reservation goes into the periodic task members
+	tcb->p.budget = budget_in_us;
+	tcb->p.period = period_in_us;
+	tcb->p.deadline = period_in_us;
+	tcb->p.phase = 0;
+	tcb->p.stack = stack;
+	tcb->p.stack_size = stack_size;
+	tcb->p.top_of_stack = stack + stack_size;	// Stack grows bottom up
+	tcb->p.task_function = task_entry_function;
+	tcb->p.pdata = pdata;
+	tcb->p.job_release_time = 0;
+	tcb->p.accumulated_budget = 0;
+	tcb->p.exec_count = 0;
+	tcb->p.TBE_count = 0;
+	tcb->p.dline_miss_count = 0;
+	tcb->p.id = *task;
+#if OS_MIXED_CRITICALITY==1
+	tcb->p.budget_hi = budget_in_us;
+	tcb->p.virtual_deadline = period_in_us;
+#endif
+
+	// Note down the owner process
+	tcb->owner_process = g_current_process ? g_current_process : g_kernel_process;
+
+	OS_ENTER_CRITICAL(intsts);
+	if(!ValidateNewThread(tcb))
+	{
+		OS_EXIT_CRITICAL(intsts); 
+		FAULT("The task set is not schedulable with %s", task_name);
+		return EXCEEDS_MAX_CPU;
+	}
+	
+	// Block the thread resource
+	SetResourceStatus(g_task_usage_mask, *task, FALSE);
+	OS_TRACE_TASK_CREATE(tcb);
+#if OS_WITH_VFP==1
+	_OS_VFPInitTask(tcb);
+#endif
+#if OS_ENABLE_CPU_STATS==1
+	_OS_StatTaskInit(tcb);
+#endif
+	
+	// Update the g_total_allocated_cpu & g_total_allocated_density
+	AddTaskReservation(tcb);
+	
+	OS_EXIT_CRITICAL(intsts); 	// Exit the critical section
+
+	// Build a Stack for the new thread
+	if(IS_SYSTEM_TASK(tcb->attributes))
+	{
+		tcb->top_of_stack = _OS_BuildKernelTaskStack(tcb->top_of_stack, 
+			AperiodicKernelTaskEntry, tcb);
+	}
+	else	// User stack
+	{
+		tcb->top_of_stack = _OS_BuildUserTaskStack(tcb->top_of_stack, 
+			AperiodicUserTaskEntry, tcb);	
+	}
+	
+	OS_ENTER_CRITICAL(intsts);	// Enter critical section
+
+	// The task is ready now. So the server starts with full budget and a new deadline
+	now = _OS_IsRunning ? _OS_GetElapsedTime() : 0;
+	tcb->p.remaining_budget = budget_in_us;
+	_OS_ReadyQueueInsert(tcb, now + period_in_us);
+
+	OS_EXIT_CRITICAL(intsts); 	// Exit the critical section
+
+	if(_OS_IsRunning)
+	{
+		_OS_Schedule();
+	}
+
+	return SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the process whose reservation the periodic / CBS task is admitted in.
+// NULL if the task is admitted on the whole CPU. The process servers are admitted
+// on the whole CPU as well.
+///////////////////////////////////////////////////////////////////////////////
+static OS_Process * GetReservationGroup(OS_Task * task)
+{
+	OS_Process * process = task->owner_process;
+	return (process->server && (process->server != task)) ? process : NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the tasks with a CPU reservation (periodic & CBS tasks) already admitted
+// in the given group followed by new_task, one per call. The group is a process
+// reservation or NULL for the whole CPU.
+// index should be 0 for the first call. Returns NULL after the last task
+///////////////////////////////////////////////////////////////////////////////
+static OS_Task * GetNextReservedTask(OS_Task * new_task, OS_Process * group, INT32 * index)
+{
+	OS_Task * task;
+
+	while(*index < MAX_TASK_COUNT)
+	{
+		task = &g_task_pool[*index];
+		if(IsResourceBusy(g_task_usage_mask, (*index)++) && 
+			(IS_PERIODIC_TASK(task->attributes) || IS_CBS_TASK(task->attributes)) &&
+			(GetReservationGroup(task) == group))
+		{
+			return task;
+		}
+	}
+
+	if(*index == MAX_TASK_COUNT)
+	{
+		(*index)++;
+		return new_task;
+	}
+
+	return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the total execution time of the jobs with deadline <= t when all tasks
+// are released together at time 0
+///////////////////////////////////////////////////////////////////////////////
+static UINT64 GetProcessorDemand(OS_Task * new_task, OS_Process * group, UINT64 t)
+{
+	UINT64 demand = 0;
+	OS_Task * task;
+	INT32 index = 0;
+
+	while((task = GetNextReservedTask(new_task, group, &index)) != NULL)
+	{
+		if(task->p.deadline <= t)
+		{
+			demand += ((t - task->p.deadline) / task->p.period + 1) * TASK_WCET(task);
+		}
+	}
+
+	return demand;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the latest absolute deadline < t when all tasks are released together
+// at time 0. Returns 0 if there is no such deadline
+///////////////////////////////////////////////////////////////////////////////
+static UINT64 GetDeadlineBefore(OS_Task * new_task, OS_Process * group, UINT64 t)
+{
+	UINT64 latest = 0, deadline;
+	OS_Task * task;
+	INT32 index = 0;
+
+	while((task = GetNextReservedTask(new_task, group, &index)) != NULL)
+	{
+		if(task->p.deadline < t)
+		{
+			deadline = task->p.deadline + ((t - task->p.deadline - 1) / task->p.period) * task->p.period;
+			latest = MAX(latest, deadline);
+		}
+	}
+
+	return latest;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the length of the interval in which a reservation of budget in every period
+// surely supplies the given demand. The reservation may not supply anything for 
+// 2 * (period - budget) and then it supplies budget / period of the CPU. The whole
+// CPU is the reservation with budget == period.
+///////////////////////////////////////////////////////////////////////////////
+static UINT64 GetSupplyTime(UINT64 demand, UINT32 budget, UINT32 period)
+{
+	if(!demand) return 0;
+	
+	// Split the division so that it does not overflow
+	return (demand / budget) * period + ((demand % budget) * period + budget - 1) / budget +
+		2 * (UINT64)(period - budget);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Exact EDF schedulability test for constrained deadline tasks (deadline <= period)
+// It uses the Quick Processor-demand Analysis (QPA) from Zhang & Burns. The demand
+// is checked backwards from the end of the interval to be checked and most deadlines
+// are skipped. The total CPU usage should be < 1.0
+// For the tasks in a process reservation, the time needed by the reservation to supply
+// the demand is checked instead of the demand. So the test is sufficient in that case.
+///////////////////////////////////////////////////////////////////////////////
+static BOOL ProcessorDemandTest(OS_Task * new_task, OS_Process * group, UINT64 total_cpu)
+{
+	UINT64 slack = 0, busy_period = 0, next, bound, t, demand;
+	UINT64 min_deadline = (UINT64) -1, max_deadline = 0;
+	UINT64 supply_cpu = CPU_USAGE_ONE, supply_delay = 0;
+	UINT32 supply_budget = 1, supply_period = 1;
+	OS_Task * task;
+	INT32 index = 0;
+
+	if(group)
+	{
+		supply_budget = group->server->p.budget;
+		supply_period = group->server->p.period;
+		supply_cpu = ((UINT64)supply_budget << CPU_USAGE_SHIFT) / supply_period;
+		supply_delay = 2 * (UINT64)(supply_period - supply_budget);
+	}
+
+	while((task = GetNextReservedTask(new_task, group, &index)) != NULL)
+	{
+		slack += (UINT64)(task->p.period - task->p.deadline) * 
+				CALC_THREAD_CPU_USAGE(task->p.period, TASK_WCET(task));
+		busy_period += TASK_WCET(task);
+		min_deadline = MIN(min_deadline, task->p.deadline);
+		max_deadline = MAX(max_deadline, task->p.deadline);
+	}
+
+	// A deadline can be missed only within the bound given by the CPU usage
+	// (sum((period - deadline) * usage) + supply delay) / (supply usage - total usage)
+	bound = (slack + supply_delay * CPU_USAGE_ONE + (supply_cpu - total_cpu) - 1) / (supply_cpu - total_cpu);
+	bound = MAX(bound, max_deadline);
+
+	// Or within the synchronous busy period, which is usually much shorter when
+	// the CPU usage is close to 1.0
+	while(!group && (busy_period < bound))
+	{
+		next = 0;
+		index = 0;
+		while((task = GetNextReservedTask(new_task, group, &index)) != NULL)
+		{
+			next += ((busy_period + task->p.period - 1) / task->p.period) * TASK_WCET(task);
+		}
+
+		if(next == busy_period) break;
+		busy_period = next;
+	}
+	if(!group) bound = MIN(bound, busy_period);
+
+	// Start with the last deadline in the interval and move backwards
+	t = GetDeadlineBefore(new_task, group, bound + 1);
+	demand = GetSupplyTime(GetProcessorDemand(new_task, group, t), supply_budget, supply_period);
+
+	while((demand <= t) && (demand > min_deadline))
+	{
+		// There cannot be a deadline miss between demand and t
+		t = (demand < t) ? demand : GetDeadlineBefore(new_task, group, t);
+		demand = GetSupplyTime(GetProcessorDemand(new_task, group, t), supply_budget, supply_period);
+	}
+
+	return (demand <= min_deadline);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Density test with exact fractions. g_total_allocated_density rounds up the density
+// of each task, so a task set whose density is exactly 1.0 looks a bit more than that.
+// Here the densities are added over the LCM of the deadlines instead. Returns FALSE
+// if the LCM does not fit in 32 bits, which leaves the decision to the other tests
+///////////////////////////////////////////////////////////////////////////////
+static BOOL ExactDensityTest(OS_Task * new_task)
+{
+	UINT64 num = 0, den = 1, deadline, a, b, scale;
+	OS_Task * task;
+	INT32 index = 0;
+
+	while((task = GetNextReservedTask(new_task, NULL, &index)) != NULL)
+	{
+		deadline = MIN(task->p.period, task->p.deadline);
+
+		// Bring the sum to the LCM of den and deadline. a is their GCD
+		a = den;
+		b = deadline;
+		while(b)
+		{
+			scale = a % b;
+			a = b;
+			b = scale;
+		}
+		
+		scale = deadline / a;
+		if(den * scale > 0xFFFFFFFF)
+		{
+			return FALSE;
+		}
+		
+		// num <= den, so none of these overflow
+		num *= scale;
+		den *= scale;
+		num += TASK_WCET(task) * (den / deadline);
+		if(num > den)
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// EDF schedulability test of the whole CPU with all tasks using their worst case
+// budget. new_task is not yet in g_task_usage_mask
+///////////////////////////////////////////////////////////////////////////////
+static BOOL WorstCaseEDFTest(OS_Task * new_task)
+{
+	UINT32 period = new_task->p.period;
+	UINT32 budget = TASK_WCET(new_task);
+	UINT32 deadline = MIN(period, new_task->p.deadline);
+
+	// The density test is sufficient and it takes constant time. All task sets with
+	// deadline == period and most others are admitted right here
+	if(g_total_allocated_density + CALC_THREAD_CPU_USAGE(deadline, budget) <= CPU_USAGE_ONE)
+	{
+		return TRUE;
+	}
+
+	// Each task adds less than 1 to the rounding error. So a density up to 1.0 plus
+	// that error may still be exactly 1.0, as with U == 1.0 and deadline == period
+	if((g_total_allocated_density + CALC_THREAD_CPU_USAGE(deadline, budget) <= 
+		CPU_USAGE_ONE + MAX_TASK_COUNT) && ExactDensityTest(new_task))
+	{
+		return TRUE;
+	}
+
+	// EDF cannot schedule more than 100% of the CPU. The demand test below needs
+	// U < 1.0, so the task sets with deadline < period and U == 1.0 are rejected
+	if(g_total_allocated_cpu + CALC_THREAD_CPU_USAGE(period, budget) >= CPU_USAGE_ONE)
+	{
+		return FALSE;
+	}
+
+	// The density test is pessimistic for tasks with deadline < period. So do the
+	// exact test in that case
+	return ProcessorDemandTest(new_task, NULL, g_total_allocated_cpu + CALC_THREAD_CPU_USAGE(period, budget));
+}
+
+#if OS_MIXED_CRITICALITY==1
+///////////////////////////////////////////////////////////////////////////////
+// Sets the virtual deadlines of the high criticality periodic tasks to factor * deadline
+// The new deadlines are used from the next job of each task
+///////////////////////////////////////////////////////////////////////////////
+static void SetVirtualDeadlines(OS_Task * new_task, UINT64 factor)
+{
+	OS_Task * task;
+	INT32 index = 0;
+	UINT32 deadline;
+
+	while((task = GetNextReservedTask(new_task, NULL, &index)) != NULL)
+	{
+		if(IS_PERIODIC_TASK(task->attributes) && IS_HI_CRITICALITY_TASK(task->attributes))
+		{
+			deadline = (UINT32)((task->p.deadline * factor) >> CPU_USAGE_SHIFT);
+			task->p.virtual_deadline = MAX(task->p.budget, deadline);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// EDF-VD test for the mixed criticality task sets. The high criticality tasks get 
+// virtual deadlines scaled by x in the low criticality mode such that
+//		x = U_HI(LO) / (1 - U_LO)	and		x * U_LO + U_HI(HI) <= 1
+// The densities are used instead of the CPU usage as the deadlines can be less than
+// the periods. So this test is sufficient, but not exact.
+///////////////////////////////////////////////////////////////////////////////
+static BOOL EDFVirtualDeadlineTest(OS_Task * new_task)
+{
+	UINT32 deadline = MIN(new_task->p.period, new_task->p.deadline);
+	UINT64 lo_density = g_lo_criticality_density;
+	UINT64 hi_lo_density = g_hi_criticality_lo_density;
+	UINT64 hi_hi_density, factor;
+
+	if(IS_HI_CRITICALITY_TASK(new_task->attributes))
+	{
+		hi_lo_density += CALC_THREAD_CPU_USAGE(deadline, new_task->p.budget);
+	}
+	else
+	{
+		lo_density += CALC_THREAD_CPU_USAGE(deadline, new_task->p.budget);
+	}
+
+	if(lo_density >= CPU_USAGE_ONE)
+	{
+		return FALSE;
+	}
+
+	factor = (hi_lo_density * CPU_USAGE_ONE + (CPU_USAGE_ONE - lo_density) - 1) / (CPU_USAGE_ONE - lo_density);
+	if(factor > CPU_USAGE_ONE)
+	{
+		return FALSE;
+	}
+
+	// All densities with the high criticality budgets minus the low criticality tasks
+	hi_hi_density = g_total_allocated_density + CALC_THREAD_CPU_USAGE(deadline, TASK_WCET(new_task)) - lo_density;
+	if(((factor * lo_density) >> CPU_USAGE_SHIFT) + hi_hi_density > CPU_USAGE_ONE)
+	{
+		return FALSE;
+	}
+
+	SetVirtualDeadlines(new_task, factor);
+	return TRUE;
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Validation for sufficient CPU Budget. new_task is not yet in g_task_usage_mask
+// new_task can be a periodic or CBS task
+// ASSUMPTION: The interrupts are disabled when this function is invoked
+///////////////////////////////////////////////////////////////////////////////
+static BOOL ValidateNewThread(OS_Task * new_task)
+{
+	UINT32 period = new_task->p.period;
+	UINT32 budget = new_task->p.budget;
+	OS_Process * group = GetReservationGroup(new_task);
+
+	if(group)
+	{
+		// The task is checked against the process reservation only. Its CPU usage should be
+		// less than the reservation.
+		const UINT64 total_cpu = group->allocated_cpu + CALC_THREAD_CPU_USAGE(period, budget);
+		
+		if(total_cpu >= ((UINT64)group->server->p.budget << CPU_USAGE_SHIFT) / group->server->p.period)
+		{
+			return FALSE;
+		}
+		
+		return ProcessorDemandTest(new_task, group, total_cpu);
+	}
+
+	if(WorstCaseEDFTest(new_task))
+	{
+#if OS_MIXED_CRITICALITY==1
+		// Plain EDF can schedule all tasks with their high criticality budgets. So the 
+		// virtual deadlines are not needed
+		SetVirtualDeadlines(new_task, CPU_USAGE_ONE);
+#endif
+		return TRUE;
+	}
+
+#if OS_MIXED_CRITICALITY==1
+	return EDFVirtualDeadlineTest(new_task);
+#else
+	return FALSE;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Adds the CPU reserved for a new periodic or CBS task to its reservation group
+// ASSUMPTION: The interrupts are disabled when this function is invoked
+///////////////////////////////////////////////////////////////////////////////
+static void AddTaskReservation(OS_Task * task)
+{
+	OS_Process * group = GetReservationGroup(task);
+
+	if(group)
+	{
+		group->allocated_cpu += CALC_THREAD_CPU_USAGE(task->p.period, task->p.budget);
+		return;
+	}
+
+	g_total_allocated_cpu += CALC_THREAD_CPU_USAGE(task->p.period, TASK_WCET(task));
+	g_total_allocated_density += CALC_THREAD_CPU_USAGE(MIN(task->p.period, task->p.deadline), TASK_WCET(task));
+	
+#if OS_MIXED_CRITICALITY==1
+	if(IS_PERIODIC_TASK(task->attributes) && !IS_HI_CRITICALITY_TASK(task->attributes))
+	{
+		g_lo_criticality_density += CALC_THREAD_CPU_USAGE(MIN(task->p.period, task->p.deadline), task->p.budget);
+	}
+	else
+	{
+		g_hi_criticality_lo_density += CALC_THREAD_CPU_USAGE(MIN(task->p.period, task->p.deadline), task->p.budget);
+	}
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Releases the CPU reserved for a periodic or CBS task. A CBS task becomes a normal
+// aperiodic task after this, as it no longer has a reservation
+// ASSUMPTION: The interrupts are disabled when this function is invoked
+///////////////////////////////////////////////////////////////////////////////
+void _OS_ReleaseTaskReservation(OS_Task * task)
+{
+	OS_Process * group = GetReservationGroup(task);
+
+	ASSERT(IS_PERIODIC_TASK(task->attributes) || IS_CBS_TASK(task->attributes));
+
+	if(group)
+	{
+		group->allocated_cpu -= CALC_THREAD_CPU_USAGE(task->p.period, task->p.budget);
+	}
+	else
+	{
+		g_total_allocated_cpu -= CALC_THREAD_CPU_USAGE(task->p.period, TASK_WCET(task));
+		g_total_allocated_density -= CALC_THREAD_CPU_USAGE(MIN(task->p.period, task->p.deadline), TASK_WCET(task));
+		
+	#if OS_MIXED_CRITICALITY==1
+		if(IS_PERIODIC_TASK(task->attributes) && !IS_HI_CRITICALITY_TASK(task->attributes))
+		{
+			g_lo_criticality_density -= CALC_THREAD_CPU_USAGE(MIN(task->p.period, task->p.deadline), task->p.budget);
+		}
+		else
+		{
+			g_hi_criticality_lo_density -= CALC_THREAD_CPU_USAGE(MIN(task->p.period, task->p.deadline), task->p.budget);
+		}
+	#endif
+	}
+	
+	task->attributes &= ~TASK_SERVER_MASK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reserves budget_in_us of CPU time in every period_in_us for a process. The process
+// is scheduled by EDF as a Constant Bandwidth Server and its periodic / CBS tasks are
+// scheduled by EDF within the server. So a process overrunning its tasks' budgets 
+// delays only its own tasks. The tasks of the process are admitted against the 
+// reservation and the reservation is admitted against the whole CPU.
+// The reservation can be set only once and before the process creates its periodic
+// or CBS tasks.
+///////////////////////////////////////////////////////////////////////////////
+OS_Return _OS_SetProcessReservation(OS_Process * process, UINT32 budget_in_us, UINT32 period_in_us)
+{
+	OS_Task_t task;
+	OS_Task * tcb;
+	UINT32 intsts;
+	INT32 index;
+	BOOL busy;
+
+	if(!process)
+	{
+		FAULT("Invalid process");
+		return INVALID_ARG;
+	}
+
+	if(period_in_us < MIN_TASK_PERIOD)
+	{
+		FAULT("Process %s: Period should be at least %d\n", process->name, MIN_TASK_PERIOD);
+		return INVALID_PERIOD;
+	}
+	
+	if((budget_in_us < MIN_TASK_BUDGET) || (budget_in_us > period_in_us))
+	{
+		FAULT("Process %s: Budget should be between %d uSec and the period\n", process->name, MIN_TASK_BUDGET);
+		return INVALID_BUDGET;
+	}
+	
+#if OS_STATIC_SCHEDULE==1
+	FAULT("Process %s: Process reservations are not supported with the static schedule\n", process->name);
+	return NOT_SUPPORTED;
+#endif
+
+	OS_ENTER_CRITICAL(intsts);
+	
+	// Check if the process already has a reservation or a periodic / CBS task
+	busy = (process->server != NULL);
+	for(index = 0; !busy && (index < MAX_TASK_COUNT); index++)
+	{
+		tcb = &g_task_pool[index];
+		busy = IsResourceBusy(g_task_usage_mask, index) && (tcb->owner_process == process) &&
+			(IS_PERIODIC_TASK(tcb->attributes) || IS_CBS_TASK(tcb->attributes));
+	}
+	
+	if(busy)
+	{
+		OS_EXIT_CRITICAL(intsts);
+		FAULT("Process %s: The reservation should be set before creating the tasks\n", process->name);
+		return RESOURCE_BUSY;
+	}
+
+	// The server is a TCB without a context
+	task = (OS_Task_t) GetFreeResIndex(g_task_usage_mask, MAX_TASK_COUNT);
+	if(task < 0) 
+	{
+		OS_EXIT_CRITICAL(intsts);
+		FAULT("_OS_SetProcessReservation failed for process %s: Exhausted all resources\n", process->name);
+		return RESOURCE_EXHAUSTED;	
+	}
+	
+	KlogStr(KLOG_GENERAL_INFO, "Creating process server - ", process->name);
+
+	tcb = &g_task_pool[task];
+	memset(tcb, 0, sizeof(OS_Task));
+
+	tcb->attributes = (APERIODIC_TASK | CBS_TASK | PROCESS_SERVER_TASK | SYSTEM_TASK);
+#if OS_WITH_VALIDATE_TASK==1
+	tcb->signature = TASK_SIGNATURE;
+#endif
+	strncpy(tcb->name, process->name, sizeof(tcb->name));
+	tcb->name[OS_TASK_NAME_SIZE-1] = '\0';
+
+	// The server starts with full budget and a new deadline when the process becomes ready
+	tcb->p.budget = budget_in_us;
+	tcb->p.period = period_in_us;
+	tcb->p.deadline = period_in_us;
+	tcb->p.remaining_budget = budget_in_us;
+	tcb->p.alarm_time() = 0;
+	tcb->p.id = task;
+#if OS_MIXED_CRITICALITY==1
+	tcb->p.budget_hi = budget_in_us;
+	tcb->p.virtual_deadline = period_in_us;
+#endif
+	tcb->owner_process = process;
+
+	if(!ValidateNewThread(tcb))
+	{
+		OS_EXIT_CRITICAL(intsts); 
+		FAULT("The task set is not schedulable with process %s", process->name);
+		return EXCEEDS_MAX_CPU;
+	}
+	
+	// Block the thread resource
+	SetResourceStatus(g_task_usage_mask, task, FALSE);
+	OS_TRACE_TASK_CREATE(tcb);
+	AddTaskReservation(tcb);
+	
+	_OS_QueueInit(&process->ready_q);
+	process->allocated_cpu = 0;
+	process->server = tcb;
+	
+	OS_EXIT_CRITICAL(intsts);
+
+	return SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Releases the CPU reserved for a periodic task and its TCB
+// ASSUMPTION: The interrupts are disabled and the task is not in any queue
+///////////////////////////////////////////////////////////////////////////////
+void _OS_FreePeriodicTask(OS_Task * task)
+{
+	ASSERT(IS_PERIODIC_TASK(task->attributes));
+
+	_OS_ReleaseTaskReservation(task);
+	SetResourceStatus(g_task_usage_mask, task->id, TRUE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Builds a new initial stack for a periodic task whose job was aborted. The old
+// context is discarded and the task calls its function again from the start.
+// The user stacks are in the process memory. So it is called from _OS_Schedule
+// once the page table of the task's process is active
+///////////////////////////////////////////////////////////////////////////////
+void _OS_RestartPeriodicTask(OS_Task * task)
+{
+	ASSERT(IS_PERIODIC_TASK(task->attributes));
+	
+	task->p.restart_job = FALSE;
+	task->top_of_stack = task->stack + task->stack_size;
+	
+	if(IS_SYSTEM_TASK(task->attributes))
+	{
+		task->top_of_stack = _OS_BuildKernelTaskStack(task->top_of_stack, 
+			KernelTaskEntryMain, task);
+	}
+	else	// User stack
+	{
+		task->top_of_stack = _OS_BuildUserTaskStack(task->top_of_stack, 
+			UserTaskEntryMain, task);
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
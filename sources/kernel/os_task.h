@@ -28,12 +28,39 @@ enum
 	
 	SYSTEM_TASK			= 2,
 	USER_TASK			= 0,
-	TASK_PRIVILEGE_MASK	= 2
+	TASK_PRIVILEGE_MASK	= 2,
+	
+	// Aperiodic task served by a Constant Bandwidth Server. It is scheduled by EDF
+	// along with the periodic tasks. The server reservation is kept in the periodic
+	// task members (period, deadline, budget, remaining_budget & TBE_count)
+	CBS_TASK			= 4,
+	TASK_SERVER_MASK	= 4,
+	
+	// CBS which stands for a process with a CPU reservation in the ready queue. It has
+	// no context of its own. The ready tasks of the process run within its budget
+	PROCESS_SERVER_TASK		= 8,
+	TASK_PROCESS_SERVER_MASK	= 8,
+	
+	// Periodic task with high criticality for the mixed criticality scheduling
+	HI_CRITICALITY_TASK		= 16,
+	TASK_CRITICALITY_MASK	= 16
 };
 
 #define IS_PERIODIC_TASK(task_attr)		(((task_attr) & TASK_MODE_MASK) == PERIODIC_TASK)
 #define IS_APERIODIC_TASK(task_attr)	(((task_attr) & TASK_MODE_MASK) == APERIODIC_TASK)
 
+#define IS_CBS_TASK(task_attr)		(((task_attr) & TASK_SERVER_MASK) == CBS_TASK)
+#define IS_PROCESS_SERVER(task_attr)	(((task_attr) & TASK_PROCESS_SERVER_MASK) == PROCESS_SERVER_TASK)
+#define IS_HI_CRITICALITY_TASK(task_attr)	(((task_attr) & TASK_CRITICALITY_MASK) == HI_CRITICALITY_TASK)
+
+// The budget reserved for a periodic or CBS task. It is the high criticality budget
+// with the mixed criticality scheduling
+#if OS_MIXED_CRITICALITY==1
+	#define TASK_WCET(task)		((task)->p.budget_hi)
+#else
+	#define TASK_WCET(task)		((task)->p.budget)
+#endif
+
 #define IS_SYSTEM_TASK(task_attr)	(((task_attr) & TASK_PRIVILEGE_MASK) == SYSTEM_TASK)
 #define IS_USER_TASK(task_attr)		(((task_attr) & TASK_PRIVILEGE_MASK) == USER_TASK)
 
@@ -113,6 +140,27 @@ typedef union OS_Task
 		UINT32 TBE_count;
 		UINT32 dline_miss_count;
 		
+		// Action taken when a job exhausts its budget or misses its deadline. See OS_OverrunPolicy
+		UINT32 overrun_policy;
+		UINT32 overrun_skip;		// Number of releases skipped with OVERRUN_SKIP
+		OS_Sem_t overrun_sem;		// Posted with OVERRUN_NOTIFY
+		UINT32 skipped_count;		// Releases skipped so far. They are counted in exec_count as well
+		
+		// The job was aborted. The task starts again from its entry function when it runs next
+		BOOL restart_job;
+		
+	#if OS_MIXED_CRITICALITY==1
+		// Budget in the high criticality mode. Same as budget for the low criticality tasks
+		UINT32 budget_hi;
+		
+		// Deadline of the high criticality tasks in the low criticality mode
+		UINT32 virtual_deadline;
+		
+		// Jobs of a low criticality task dropped in the high criticality mode. They
+		// are not counted in exec_count
+		UINT32 dropped_count;
+	#endif
+		
 	} __attribute__ ((packed)) p;
 
 	struct OS_AperiodicTask
@@ -157,6 +205,21 @@ OS_Return _OS_CreatePeriodicTask(
 	void (*periodic_entry_function)(void *pdata),
 	void *pdata);
 
+OS_Return _OS_CreateMixedCriticalityTask(
+	UINT16 criticality,
+	UINT32 period_in_us,
+	UINT32 deadline_in_us,
+	UINT32 budget_in_us,
+	UINT32 hi_budget_in_us,
+	UINT32 phase_shift_in_us,
+	UINT32 *stack,
+	UINT32 stack_size_in_bytes,
+	const INT8 * task_name,
+	UINT16 options,
+	OS_Task_t *task,
+	void (*periodic_entry_function)(void *pdata),
+	void *pdata);
+
 OS_Return _OS_CreateAperiodicTask(UINT16 priority, 
 	UINT32 * stack, 
 	UINT32 stack_size_in_bytes,
@@ -166,12 +229,48 @@ OS_Return _OS_CreateAperiodicTask(UINT16 priority,
 	void(* task_entry_function)(void * pdata),
 	void * pdata);
 
+OS_Return _OS_CreateCBSTask(UINT32 budget_in_us,
+	UINT32 period_in_us,
+	UINT32 * stack, 
+	UINT32 stack_size_in_bytes,
+	const INT8 * task_name,
+	UINT16 options,
+	OS_Task_t * task,
+	void(* task_entry_function)(void * pdata),
+	void * pdata);
+
 OS_Return _OS_GetTaskAllocMask(UINT32 * alloc_mask, UINT32 count, UINT32 starting_task);
 
+// Sets the action taken when a job of the periodic task overruns. See OS_SetOverrunPolicy
+OS_Return _OS_SetOverrunPolicy(OS_Task_t task, UINT32 policy, UINT32 skip_count, OS_Sem_t notify_sem);
+
+// Tells if the kernel may abort the jobs of a periodic task of the process: the tasks
+// with OVERRUN_ABORT and the low criticality tasks, whose jobs are dropped in the high
+// criticality mode
+BOOL _OS_ProcessAbortsJobs(const struct OS_Process * process);
+
+// Discards the saved context of a periodic task whose job was aborted. The task starts
+// again from its entry function. The page table of its process should be active
+void _OS_RestartPeriodicTask(OS_Task * task);
+
 // Function to be called when an Aperiodic task finishes so that it is no more included
 // in scheduling. Only Aperiodic tasks are allowed to complete
 OS_Return _OS_CompleteAperiodicTask();
 
+// Function to be called when a periodic task finishes for good. The CPU reserved
+// for the task is released for new tasks. It does not return on success
+OS_Return _OS_CompletePeriodicTask();
+
+// Releases the CPU reserved for a periodic task and its TCB
+void _OS_FreePeriodicTask(OS_Task * task);
+
+// Releases the CPU reserved for a periodic or CBS task. The TCB is not freed
+void _OS_ReleaseTaskReservation(OS_Task * task);
+
+// Reserves budget_in_us of CPU time in every period_in_us for a process. The periodic
+// and CBS tasks created in the process after this are admitted against the reservation
+OS_Return _OS_SetProcessReservation(struct OS_Process * process, UINT32 budget_in_us, UINT32 period_in_us);
+
 // Placeholders for all the process control blocks
 extern OS_Task	g_task_pool[MAX_TASK_COUNT];
 extern UINT32 	g_task_usage_mask[];
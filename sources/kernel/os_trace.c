@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_trace.c
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Binary trace of the scheduler events
+//					An event is a 16 byte record in a ring buffer. The writers claim
+//					the next record with an atomic increment. So the events can be
+//					recorded from the ISRs and the tasks without a lock and the
+//					oldest records are overwritten when the ring is full.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "target.h"
+#include "os_trace.h"
+#include "util.h"
+
+#if OS_TRACE_ENABLED==1
+
+OS_TraceBuffer g_trace_buffer;
+
+// The task that was dispatched last and has not switched out since. NULL if there is none
+static const OS_Task * g_trace_running;
+
+UINT64 _OS_GetElapsedTime();
+
+///////////////////////////////////////////////////////////////////////////////
+// The PMU cycle counter is a single register read. Otherwise the time is taken
+// in microseconds from the periodic timer
+///////////////////////////////////////////////////////////////////////////////
+static __inline__ UINT32 GetTimestamp(void)
+{
+#if OS_PMU_TIMEBASE==1
+	UINT32 cycles;
+
+	__asm__ volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (cycles));
+
+	return cycles;
+#else
+	return (UINT32) _OS_GetElapsedTime();
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Claims the next record and returns its sequence number
+///////////////////////////////////////////////////////////////////////////////
+static __inline__ UINT32 ClaimRecord(void)
+{
+	UINT32 seq;
+
+#if defined(_ARM_ARCH_v7)
+	UINT32 next, failed;
+
+	// The exclusive store fails if anyone else claimed a record after our load
+	__asm__ volatile(
+		"1:	ldrex	%0, [%3]\n"
+		"	add		%1, %0, #1\n"
+		"	strex	%2, %1, [%3]\n"
+		"	teq		%2, #0\n"
+		"	bne		1b\n"
+		: "=&r" (seq), "=&r" (next), "=&r" (failed)
+		: "r" (&g_trace_buffer.header.next_seq)
+		: "cc", "memory");
+#else
+	// There are no exclusive loads / stores before ARMv6
+	UINT32 intsts;
+
+	OS_ENTER_CRITICAL(intsts);
+	seq = g_trace_buffer.header.next_seq++;
+	OS_EXIT_CRITICAL(intsts);
+#endif
+
+	return seq;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Fills in the header. The decoder finds everything else from it
+///////////////////////////////////////////////////////////////////////////////
+void _OS_TraceInit(void)
+{
+	OS_TraceHeader * header = &g_trace_buffer.header;
+
+	memset(&g_trace_buffer, 0, sizeof(g_trace_buffer));
+
+	header->magic = OS_TRACE_MAGIC;
+	header->version = OS_TRACE_VERSION;
+	header->record_size = sizeof(OS_TraceRecord);
+#if OS_PMU_TIMEBASE==1
+	header->timestamp_freq = ARMCLK;
+#else
+	header->timestamp_freq = 1000000;
+#endif
+	header->task_count = MAX_TASK_COUNT;
+	header->name_size = OS_TASK_NAME_SIZE;
+	header->names_offset = (UINT32)((UINT8 *) g_trace_buffer.names - (UINT8 *) &g_trace_buffer);
+	header->record_count = OS_TRACE_BUFFER_SIZE;
+	header->records_offset = (UINT32)((UINT8 *) g_trace_buffer.records - (UINT8 *) &g_trace_buffer);
+	header->next_seq = 0;
+
+	g_trace_running = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Records an event. The task can be NULL
+///////////////////////////////////////////////////////////////////////////////
+void _OS_TraceEvent(UINT32 event, const OS_Task * task, UINT32 arg)
+{
+	UINT32 timestamp = GetTimestamp();
+	UINT32 seq = ClaimRecord();
+	OS_TraceRecord * record = &g_trace_buffer.records[seq & (OS_TRACE_BUFFER_SIZE - 1)];
+
+	record->timestamp = timestamp;
+	record->event = (UINT8) event;
+	record->cpu = 0;
+	record->task = task ? (UINT16) task->id : OS_TRACE_NO_TASK;
+	record->arg = arg;
+
+	// The record is valid once its sequence number is in place
+	__asm__ volatile("" : : : "memory");
+	record->seq = seq;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Notes down the name of a new task. The task IDs are reused. So the decoder
+// names the tasks as they were when the buffer was read
+///////////////////////////////////////////////////////////////////////////////
+void _OS_TraceTaskCreate(const OS_Task * task)
+{
+	strncpy(g_trace_buffer.names[task->id], task->name, OS_TASK_NAME_SIZE);
+	g_trace_buffer.names[task->id][OS_TASK_NAME_SIZE - 1] = '\0';
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Records the task that is about to run
+// ASSUMPTION: The interrupts are disabled
+///////////////////////////////////////////////////////////////////////////////
+void _OS_TraceDispatch(const OS_Task * task)
+{
+	if(task == g_trace_running)
+	{
+		return;
+	}
+
+	// The last task did not block or finish its job. So it was preempted
+	if(g_trace_running)
+	{
+		_OS_TraceEvent(TRACE_PREEMPT, g_trace_running, task->id);
+	}
+
+	_OS_TraceEvent(TRACE_DISPATCH, task, 0);
+	g_trace_running = task;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Records an event after which the task does not run till it is dispatched again
+///////////////////////////////////////////////////////////////////////////////
+void _OS_TraceSwitchOut(UINT32 event, const OS_Task * task, UINT32 arg)
+{
+	_OS_TraceEvent(event, task, arg);
+
+	if(task == g_trace_running)
+	{
+		g_trace_running = NULL;
+	}
+}
+
+#endif // OS_TRACE_ENABLED
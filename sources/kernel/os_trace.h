@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_trace.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Binary trace of the scheduler events
+//					The events go into a ring buffer with a timestamp. Nothing is
+//					formatted on the target. tools/tracedump converts a dump of
+//					g_trace_buffer into the Chrome trace / Perfetto JSON format.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _OS_TRACE_H
+#define _OS_TRACE_H
+
+#include "os_core.h"
+#include "os_trace_format.h"
+
+#if OS_TRACE_ENABLED==1
+
+#if (OS_TRACE_BUFFER_SIZE & (OS_TRACE_BUFFER_SIZE - 1)) != 0
+	#error "OS_TRACE_BUFFER_SIZE should be a power of 2"
+#endif
+
+typedef struct
+{
+	OS_TraceHeader header;
+	INT8 names[MAX_TASK_COUNT][OS_TASK_NAME_SIZE];
+	OS_TraceRecord records[OS_TRACE_BUFFER_SIZE];
+
+} OS_TraceBuffer;
+
+// The trace. Read it from the target memory to decode it
+extern OS_TraceBuffer g_trace_buffer;
+
+void _OS_TraceInit(void);
+void _OS_TraceEvent(UINT32 event, const OS_Task * task, UINT32 arg);
+void _OS_TraceTaskCreate(const OS_Task * task);
+void _OS_TraceDispatch(const OS_Task * task);
+void _OS_TraceSwitchOut(UINT32 event, const OS_Task * task, UINT32 arg);
+
+// Records an event of the task. The task can be NULL
+#define OS_TRACE(event, task, arg)				_OS_TraceEvent((event), (task), (arg))
+
+// Records an event after which the task does not run till it is dispatched again
+#define OS_TRACE_SWITCH_OUT(event, task, arg)	_OS_TraceSwitchOut((event), (task), (arg))
+
+// Records the task that is about to run. A task that was running and did not switch out
+// is recorded as preempted. Nothing is recorded if the same task continues
+#define OS_TRACE_DISPATCH(task)					_OS_TraceDispatch(task)
+
+// Notes down the name of a new task
+#define OS_TRACE_TASK_CREATE(task)				_OS_TraceTaskCreate(task)
+
+#else
+
+#define OS_TRACE(event, task, arg)
+#define OS_TRACE_SWITCH_OUT(event, task, arg)
+#define OS_TRACE_DISPATCH(task)
+#define OS_TRACE_TASK_CREATE(task)
+
+#endif // OS_TRACE_ENABLED
+
+#endif // _OS_TRACE_H
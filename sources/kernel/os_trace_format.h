@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_trace_format.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Layout of the scheduler trace buffer used when OS_TRACE_ENABLED
+//					The buffer starts with OS_TraceHeader. The header has the offsets
+//					of the task name table and of the ring of the event records, so
+//					a dump of the buffer can be decoded without the kernel build.
+//					This file is shared with the host tools. So it should only depend
+//					on os_types.h
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _OS_TRACE_FORMAT_H
+#define _OS_TRACE_FORMAT_H
+
+#include "os_types.h"
+
+#define OS_TRACE_MAGIC				0x45435254		// "TRCE"
+#define OS_TRACE_VERSION			1
+
+// Task field of the events that do not belong to a task
+#define OS_TRACE_NO_TASK			0xFFFF
+
+typedef enum
+{
+	TRACE_RELEASE = 1,			// A job is released. arg: Absolute deadline in us (lower 32 bits)
+	TRACE_DISPATCH,				// The task starts running
+	TRACE_PREEMPT,				// The task is switched out while it is still ready. arg: ID of the next task
+	TRACE_JOB_END,				// A periodic task finished its job. arg: Number of jobs completed
+	TRACE_YIELD,				// An aperiodic task yielded the CPU
+	TRACE_BLOCK,				// The task is blocked
+	TRACE_UNBLOCK,				// The task is ready again
+	TRACE_TASK_END,				// The task completed for good
+	TRACE_TBE,					// Time budget exception. arg: Number of TBEs of the task
+	TRACE_DEADLINE_MISS,		// arg: Number of deadline misses of the task
+	TRACE_SEM_WAIT,				// arg: Semaphore ID
+	TRACE_SEM_POST,				// arg: Semaphore ID
+	TRACE_SYSCALL_ENTER,		// arg: Syscall ID | (sub ID << 16)
+	TRACE_SYSCALL_EXIT,			// arg: Syscall ID | (sub ID << 16). Not there if the syscall switched the task
+	TRACE_IRQ,					// The task is interrupted. arg: Timer (PERIODIC_TIMER / BUDGET_TIMER)
+
+	TRACE_EVENT_COUNT
+
+} OS_TraceEventType;
+
+// One event. The seq field is written last. It is the position of the record in the
+// whole trace, so the records that were overwritten or not completely written when
+// the buffer was read can be told apart
+typedef struct
+{
+	UINT32 timestamp;			// In the ticks of the trace timebase. It wraps around
+	UINT8 event;				// OS_TraceEventType
+	UINT8 cpu;
+	UINT16 task;				// Task ID or OS_TRACE_NO_TASK
+	UINT32 arg;
+	UINT32 seq;
+
+} OS_TraceRecord;
+
+typedef struct
+{
+	UINT32 magic;				// OS_TRACE_MAGIC
+	UINT16 version;				// OS_TRACE_VERSION
+	UINT16 record_size;			// sizeof(OS_TraceRecord)
+	UINT32 timestamp_freq;		// Ticks of the timestamps per second
+	UINT32 task_count;			// Entries in the task name table
+	UINT32 name_size;			// Size of each task name
+	UINT32 names_offset;		// Offset of the task name table from the start of the header
+	UINT32 record_count;		// Records in the ring. It is a power of 2
+	UINT32 records_offset;		// Offset of the ring from the start of the header
+	volatile UINT32 next_seq;	// Sequence number of the next record. The ring has the
+								// records from next_seq - record_count to next_seq - 1
+
+} OS_TraceHeader;
+
+#endif // _OS_TRACE_FORMAT_H
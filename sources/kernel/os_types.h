@@ -54,8 +54,18 @@ typedef _OS_KernelObj_Handle 	OS_Task_t;
 typedef _OS_KernelObj_Handle 	OS_Process_t;
 typedef _OS_KernelObj_Handle	OS_Sem_t;
 typedef _OS_KernelObj_Handle	OS_Mutex_t;
+typedef _OS_KernelObj_Handle	OS_MsgQueue_t;
+typedef _OS_KernelObj_Handle	OS_Event_t;
 typedef _OS_KernelObj_Handle	OS_Driver_t;
 
+// User space lock. See OS_LockInit
+typedef struct
+{
+	volatile UINT32 word;		// 0 - Free, 1 - Taken, 2 - Taken and may have waiters
+	OS_Sem_t sem;				// Wait queue of the lock in the kernel
+	
+} OS_Lock;
+
 // An unsigned integer type which is guaranteed to be able to hold a pointer for the given platform
 typedef unsigned long UINTPTR;	
 
@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_vfp.c
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Lazy switching of the VFP / NEON registers
+//					The VFP holds the registers of one task, g_vfp_owner, and it is
+//					disabled while any other task runs. When another task uses the
+//					VFP, the undefined instruction trap saves the registers of the
+//					owner, loads the registers of the task and makes it the owner.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "target.h"
+#include "os_vfp.h"
+#include "util.h"
+
+// The hard float ABI passes the floating point arguments in the VFP registers
+#if defined(__ARM_PCS_VFP) && (OS_WITH_VFP==0)
+	#error "FLOAT_ABI=hard needs OS_WITH_VFP"
+#endif
+
+#if OS_WITH_VFP==1
+
+#if !defined(_ARM_ARCH_v7)
+	#error "OS_WITH_VFP needs the ARMv7 VFPv3 / NEON unit"
+#endif
+
+// VFP and Advanced SIMD instructions in the ARM state:
+//		Coprocessor 10 / 11 load / store and 64 bit transfers (LDC, STC, MCRR, MRRC)
+//		Coprocessor 10 / 11 data processing and 32 bit transfers (CDP, MCR, MRC)
+//		Advanced SIMD data processing
+//		Advanced SIMD element / structure load / store
+#define IS_VFP_INSTRUCTION(instr)	\
+	((((instr) & 0x0E000E00) == 0x0C000A00) || \
+	 (((instr) & 0x0F000E00) == 0x0E000A00) || \
+	 (((instr) & 0xFE000000) == 0xF2000000) || \
+	 (((instr) & 0xFF100000) == 0xF4000000))
+
+// The registers of the tasks by the task ID. They are kept out of the TCB so that
+// its layout, which the context switch code depends on, does not change
+static OS_VFPContext g_vfp_context[MAX_TASK_COUNT];
+
+OS_Task * g_vfp_owner;
+BOOL g_vfp_enabled;
+UINT32 g_vfp_switch_counter;
+
+///////////////////////////////////////////////////////////////////////////////
+// Gives the tasks access to the VFP. It stays disabled till the first use
+///////////////////////////////////////////////////////////////////////////////
+void _OS_VFPInit(void)
+{
+	_sysctl_vfp_init();
+
+	g_vfp_owner = NULL;
+	g_vfp_enabled = FALSE;
+	g_vfp_switch_counter = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Called when a task is created. The task ID may have been used by a deleted task.
+// So its registers should not be in the VFP or in the context pool
+// ASSUMPTION: The interrupts are disabled
+///////////////////////////////////////////////////////////////////////////////
+void _OS_VFPInitTask(OS_Task * task)
+{
+	if(g_vfp_owner == task)
+	{
+		g_vfp_owner = NULL;
+	}
+
+	g_vfp_context[task->id].used = FALSE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Called from the undefined instruction handler in the ARM state with the trapped
+// instruction. Returns TRUE if the VFP is now enabled for the current task and the
+// instruction should be executed again. FALSE if it is not a VFP instruction or if
+// the VFP was already enabled, in which case the instruction is really undefined.
+// NOTE: The handler runs with the IRQs disabled. The kernel code in a system call
+// runs for the current task and uses its registers.
+///////////////////////////////////////////////////////////////////////////////
+BOOL _OS_VFPTrap(UINT32 instr)
+{
+	OS_Task * task = g_current_task;
+	OS_VFPContext * context;
+
+	if(g_vfp_enabled || !IS_VFP_INSTRUCTION(instr))
+	{
+		return FALSE;
+	}
+
+	// An ISR or the scheduler has no registers to switch to
+	if(!task)
+	{
+		panic("VFP instruction outside the task context");
+	}
+
+	_sysctl_vfp_enable(TRUE);
+	g_vfp_enabled = TRUE;
+
+	if(task != g_vfp_owner)
+	{
+		if(g_vfp_owner)
+		{
+			_sysctl_vfp_save(&g_vfp_context[g_vfp_owner->id]);
+		}
+
+		// The registers start with zeros and the default FPSCR on the first use
+		context = &g_vfp_context[task->id];
+		if(!context->used)
+		{
+			memset(context, 0, sizeof(OS_VFPContext));
+			context->used = TRUE;
+		}
+
+		_sysctl_vfp_restore(context);
+		g_vfp_owner = task;
+		g_vfp_switch_counter++;
+	}
+
+	return TRUE;
+}
+
+#endif // OS_WITH_VFP
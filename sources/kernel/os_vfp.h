@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_vfp.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Lazy switching of the VFP / NEON registers
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _OS_VFP_H
+#define _OS_VFP_H
+
+#include "os_core.h"
+#include "sysctl.h"
+
+#if OS_WITH_VFP==1
+
+// The VFP / NEON registers of a task
+typedef struct
+{
+	UINT64 d[32];			// d0-d31, saved with vstmia. So it should be the first member
+	UINT32 fpscr;
+	BOOL used;				// The task has used the VFP since it was created
+
+} OS_VFPContext;
+
+// The task whose registers are in the VFP now. NULL if there is none
+extern OS_Task * g_vfp_owner;
+extern BOOL g_vfp_enabled;
+extern UINT32 g_vfp_switch_counter;		// Number of times the registers were switched
+
+void _OS_VFPInit(void);
+void _OS_VFPInitTask(OS_Task * task);
+BOOL _OS_VFPTrap(UINT32 instr);
+
+///////////////////////////////////////////////////////////////////////////////
+// Called before switching to a task. The VFP is left enabled only if it already
+// holds the registers of the task. Otherwise the first VFP instruction of the task
+// traps into _OS_VFPTrap. The coprocessor is written only when the state changes.
+// ASSUMPTION: The interrupts are disabled
+///////////////////////////////////////////////////////////////////////////////
+static __inline__ void _OS_VFPSwitch(OS_Task * task)
+{
+	BOOL enable = (task == g_vfp_owner);
+
+	if(enable != g_vfp_enabled)
+	{
+		_sysctl_vfp_enable(enable);
+		g_vfp_enabled = enable;
+	}
+}
+
+#endif // OS_WITH_VFP
+
+#endif // _OS_VFP_H
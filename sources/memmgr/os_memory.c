@@ -24,6 +24,10 @@ static UINT32 g_kernel_heap_alloc = 0;
 
 static const UINTPTR g_user_heap_start = (UINTPTR)&__user_heap_start__;
 static const UINT32 g_user_heap_length = (UINTPTR)&__user_heap_length__;
+static UINT32 g_user_heap_alloc = 0;
+
+// The user pages are mapped with the same page size as the heap in the kernel map
+#define USER_PAGE_ALLOC_SIZE	(KERNEL_PAGE_SIZE << 10)
 
 #if ENABLE_MMU
 
@@ -38,14 +42,14 @@ void _OS_MapHeapMemory(_MMU_L1_PageTable * ptable)
 	// Create Map for Kernel heap space. Kernel will have read/write permissions
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) &__kernel_heap_start__, (PADDR) &__kernel_heap_start__, 
-			(UINT32) &__kernel_heap_length__, KERNEL_RW_USER_NA, TRUE, TRUE);
+			(UINT32) &__kernel_heap_length__, KERNEL_RW_USER_NA, TRUE, TRUE, TRUE);
 
 	// Create Map for User heap space. Kernel will have read/write permissions.
 	// Map for the user process will be added by malloc functions as and when
-	// the memory is allocated.
+	// the memory is allocated. So this map is not global.
 	KERNEL_VA_TO_PA_MAP_FUNCTION(ptable, 
 			(VADDR) &__user_heap_start__, (PADDR) &__user_heap_start__, 
-			(UINT32) &__user_heap_length__, KERNEL_RW_USER_NA, TRUE, TRUE);
+			(UINT32) &__user_heap_length__, KERNEL_RW_USER_NA, TRUE, TRUE, FALSE);
 }
 
 #endif	// ENABLE_MMU
@@ -90,6 +94,31 @@ void * kmallocaligned(UINT32 size, UINT32 aligned)
 	return mem;
 }
 
+// Routine for allocating pages from the user heap. The pages can be mapped into
+// the user processes. The size is rounded up to whole pages
+void * _OS_AllocUserPages(UINT32 size)
+{
+	void * mem = NULL;
+	UINT32 intsts;
+	
+	ASSERT(size > 0);
+	
+	size = (size + USER_PAGE_ALLOC_SIZE - 1) & ~(USER_PAGE_ALLOC_SIZE - 1);
+	
+	OS_ENTER_CRITICAL(intsts);
+	
+	// The heap start is aligned to the page size in the linker script
+	if((g_user_heap_alloc + size) <= g_user_heap_length)
+	{
+		mem = (void *)(g_user_heap_start + g_user_heap_alloc);
+		g_user_heap_alloc += size;
+	}
+	
+	OS_EXIT_CRITICAL(intsts);
+	
+	return mem;
+}
+
 // Routine for allocating memory for user space process
 void * malloc(UINT32 size)
 {
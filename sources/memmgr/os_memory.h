@@ -34,6 +34,10 @@ void * kmallocaligned(UINT32 size, UINT32 aligned);
 // Routine for allocating memory in the kernel. Aligned memory will have word alignment
 void * kmalloc(UINT32 size);
 
+// Routine for allocating pages from the user heap. The pages can be mapped into
+// the user processes. The size is rounded up to whole pages
+void * _OS_AllocUserPages(UINT32 size);
+
 // Routine for allocating memory for user space process
 void * malloc(UINT32 size);
 
@@ -90,7 +90,7 @@ _MMU_L2_PageTable * _MMU_allocate_l2_course_page_table()
 // Function to create L1 VA to PA mapping for a given process
 OS_Return _MMU_add_l1_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR va, PADDR pa, 
 								UINT32 size, _MMU_PTE_AccessPermission access, 
-								BOOL cache_enable, BOOL write_buffer)
+								BOOL cache_enable, BOOL write_buffer, BOOL global)
 {
 #if _ARM_ARCH >= 6
 	
@@ -127,6 +127,7 @@ OS_Return _MMU_add_l1_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR va, PADDR p
 			(APX << 15) |						// APX: Extended Access permissions
 			(AP << 10) |						// Access permissions
 			(XN << 4) |							// Execute Never
+			(global ? 0 : (1 << 17)) |			// nG: Not Global
 			(KERNEL_DOMAIN << 5) |				// Domain
 			(cache_enable ? (1 << 3) : 0) |		// Enable cache?
 			(write_buffer ? (1 << 2) : 0) |		// Enable write buffer?
@@ -150,7 +151,7 @@ OS_Return _MMU_add_l1_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR va, PADDR p
 /////////////////////////////////////////////////////////////////////////////////
 OS_Return _MMU_add_l2_large_page_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR va, PADDR pa, 
 								UINT32 size, _MMU_PTE_AccessPermission access,
-								BOOL cache_enable, BOOL write_buffer)
+								BOOL cache_enable, BOOL write_buffer, BOOL global)
 {
 #if _ARM_ARCH >= 6
 
@@ -226,6 +227,7 @@ OS_Return _MMU_add_l2_large_page_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR
 			l2_ptable->pte[l2_index] = 
 				((pa & 0xffff0000) | 				// Base physical address of the section
 				(XN << 15) |						// Execute Never flag
+				(global ? 0 : (1 << 11)) |			// nG: Not Global
 				(APX << 9) |						// APX: Extended Access permissions
 				(AP << 4) |							// Access permissions
 				(cache_enable ? (1 << 3) : 0) |		// Enable cache?
@@ -254,7 +256,7 @@ OS_Return _MMU_add_l2_large_page_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR
 /////////////////////////////////////////////////////////////////////////////////
 OS_Return _MMU_add_l2_small_page_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR va, PADDR pa, 
 								UINT32 size, _MMU_PTE_AccessPermission access,
-								BOOL cache_enable, BOOL write_buffer)
+								BOOL cache_enable, BOOL write_buffer, BOOL global)
 {
 #if _ARM_ARCH >= 6
 
@@ -329,6 +331,7 @@ OS_Return _MMU_add_l2_small_page_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR
 			// Create l2 course page table entry
 			l2_ptable->pte[l2_index] = 
 				((pa & 0xfffff000) | 				// Base physical address of the section
+				(global ? 0 : (1 << 11)) |			// nG: Not Global
 				(APX << 9) |						// APX: Extended Access permissions
 				(AP << 4) |							// Access permissions
 				(cache_enable ? (1 << 3) : 0) |		// Enable cache?
@@ -349,4 +352,45 @@ OS_Return _MMU_add_l2_small_page_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR
 	return SUCCESS;
 }
 
+/////////////////////////////////////////////////////////////////////////////////
+// Function to check if the user mode can read the given virtual address in the
+// ptable. The page table is walked the same way as the MMU does. The user mode can
+// read the pages whose access permissions have AP[1] set
+/////////////////////////////////////////////////////////////////////////////////
+BOOL _MMU_is_user_readable(_MMU_L1_PageTable * ptable, VADDR va)
+{
+#if _ARM_ARCH >= 6
+
+	_MMU_L2_PageTable * l2_ptable;
+	UINT32 pte;
+	
+	if(!ptable) {
+		return FALSE;
+	}
+	
+	// The top 12 bits of the virtual address select the L1 page table entry
+	pte = ptable->pte[(va >> 20) & 0xfff];
+	
+	switch(pte & 0x03)
+	{
+		case PTE_SECTION:
+			// Access permissions are in bits [11..10]
+			return (pte & (2 << 10)) != 0;
+			
+		case PTE_CORSE:
+			// Since we are using va == pa, the L2 page table can be read at its physical address
+			l2_ptable = (_MMU_L2_PageTable *) (pte & 0xfffffc00);
+			pte = l2_ptable->pte[(va >> 12) & 0xff];
+			
+			// Both the large and the small pages have the access permissions in bits [5..4]
+			return ((pte & 0x03) != L2PTE_FAULT) && ((pte & (2 << 4)) != 0);
+			
+		default:
+			return FALSE;
+	}
+#else
+	#error "Not implemented Yet"
+#endif
+}
+
 #endif // ENABLE_MMU
@@ -95,6 +95,23 @@ void _sysctl_set_ptable(PADDR ptable);
 // Function to flush TLB
 void _sysctl_flush_tlb(void);
 
+#if ENABLE_MMU_ASID==1
+// Function to set page table address along with the ASID of its process
+void _sysctl_set_ptable_asid(PADDR ptable, UINT32 asid);
+
+// Function to flush non-global TLB entries of the given ASID
+void _sysctl_flush_tlb_asid(UINT32 asid);
+
+// ASID 0 is reserved for use while switching the page table. Process ASIDs start from 1
+#define RESERVED_ASID		0
+#define MAX_ASID			255
+
+// Flush the TLB entries after the page table of a given process is modified
+#define FLUSH_PROCESS_TLB(pcb)	_sysctl_flush_tlb_asid((pcb)->asid)
+#else
+#define FLUSH_PROCESS_TLB(pcb)	_sysctl_flush_tlb()
+#endif
+
 // Function to set domain access rights
 void _sysctl_set_domain_rights(UINT32 value, UINT32 mask);
 
@@ -105,22 +122,27 @@ _MMU_L1_PageTable * _MMU_allocate_l1_page_table();
 _MMU_L2_PageTable * _MMU_allocate_l2_course_page_table();
 
 // Function to create L1 VA to PA mapping for a given page table
+// The global maps should be identical in all processes (kernel maps). Their TLB entries
+// are shared by all ASIDs.
 OS_Return _MMU_add_l1_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR va, PADDR pa, 
 								UINT32 size, _MMU_PTE_AccessPermission access, 
-								BOOL cache_enable, BOOL write_buffer);
+								BOOL cache_enable, BOOL write_buffer, BOOL global);
 
 // Function to create L2 VA to PA mapping for a given page table							
 OS_Return _MMU_add_l2_large_page_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR va, PADDR pa, 
 								UINT32 size, _MMU_PTE_AccessPermission access,
-								BOOL cache_enable, BOOL write_buffer);
+								BOOL cache_enable, BOOL write_buffer, BOOL global);
 								
 OS_Return _MMU_add_l2_small_page_va_to_pa_map(_MMU_L1_PageTable * ptable, VADDR va, PADDR pa, 
 								UINT32 size, _MMU_PTE_AccessPermission access,
-								BOOL cache_enable, BOOL write_buffer);
+								BOOL cache_enable, BOOL write_buffer, BOOL global);
 
 // Function to create Kernel VA to PA mapping
 void _OS_create_kernel_memory_map(_MMU_L1_PageTable * ptable);
 
+// Function to check if the user mode can read the given virtual address in a page table
+BOOL _MMU_is_user_readable(_MMU_L1_PageTable * ptable, VADDR va);
+
 #if KERNEL_PAGE_SIZE==1024
 #define KERNEL_VA_TO_PA_MAP_FUNCTION	_MMU_add_l1_va_to_pa_map
 #elif KERNEL_PAGE_SIZE==64
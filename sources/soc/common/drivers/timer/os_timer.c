@@ -28,6 +28,43 @@
 #define TIMER1_UPDATE		0x200
 #define TIMER1_AUTORELOAD	0x800
 
+#if (TIMER0_TICK_FREQ <= 250000) || (TIMER0_TICK_FREQ >= 256000000) || \
+	(TIMER1_TICK_FREQ <= 250000) || (TIMER1_TICK_FREQ >= 256000000)
+	#error "The fixed point tick conversions need a timer clock between 250 KHz and 256 MHz"
+#endif
+
+#if OS_PMU_TIMEBASE==1
+
+#if !defined(_ARM_ARCH_v7)
+	#error "OS_PMU_TIMEBASE needs the ARMv7 performance monitors"
+#endif
+
+// The budget interval is measured from the cycle count at the last budget timer update.
+// The cycles short of a whole microsecond are carried over to the next interval.
+// NOTE: The 32 bit counter wraps after 2^32 / ARMCLK seconds (~4.3s at 1GHz), which is
+// longer than the periodic timer interval. So an interval never spans a wrap.
+static UINT32 g_budget_start_cycles;
+static UINT32 g_budget_residue_cycles;
+
+static __inline__ UINT32 PMU_GetCycleCount(void)
+{
+	UINT32 cycles;
+	
+	__asm__ volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (cycles));
+	
+	return cycles;
+}
+
+// Starts a new budget interval. Keep the fraction of a microsecond of the last one
+static __inline__ void PMU_StartBudgetInterval(void)
+{
+	UINT32 now = PMU_GetCycleCount();
+	
+	g_budget_residue_cycles = (now - g_budget_start_cycles + g_budget_residue_cycles) % PMU_CYCLES_PER_us;
+	g_budget_start_cycles = now;
+}
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // Function to initialize the timers 0 & 1
 ///////////////////////////////////////////////////////////////////////////////
@@ -47,6 +84,15 @@ void _OS_InitTimer ()
 		// Configure the two prescalars
 		rTCFG0 = (rTCFG0 & 0xffffff00) | TIMER_PRESCALAR_0;	 // Set the Pre-scaler 0
 		rTCFG1 = (rTCFG1 & 0xffffff00) | (TIMER1_DIVIDER << 4) | TIMER0_DIVIDER;		// Set the divider
+
+#if OS_PMU_TIMEBASE==1
+		// Enable the PMU (PMCR.E) and reset the cycle counter (PMCR.C) without the divider
+		// by 64. Then enable the cycle counter (PMCNTENSET.C)
+		__asm__ volatile("mcr p15, 0, %0, c9, c12, 0" : : "r" (0x5));
+		__asm__ volatile("mcr p15, 0, %0, c9, c12, 1" : : "r" (0x80000000));
+		g_budget_start_cycles = PMU_GetCycleCount();
+		g_budget_residue_cycles = 0;
+#endif
 		
 		// Set the interrupt handlers. This also unmasks that interrupt
 		OS_SetInterruptVector(_OS_PeriodicTimerISR, TIMER0_INTERRUPT_INDEX);
@@ -114,6 +160,10 @@ void _OS_Timer_SetTimeout_us(UINT32 delay_in_us)
     // We are going to use Timer 1 as one shot timer.
     rTCON = (rTCON & (~0xf00)) | TIMER1_UPDATE;
     rTCON = (rTCON & (~0xf00)) | TIMER1_START;
+    
+#if OS_PMU_TIMEBASE==1
+    PMU_StartBudgetInterval();
+#endif
 }
 
 void _OS_Timer_SetMaxTimeout(void)
@@ -132,6 +182,10 @@ void _OS_Timer_SetMaxTimeout(void)
     // We are going to use Timer 1 as one shot timer.
     rTCON = (rTCON & (~0xf00)) | TIMER1_UPDATE;
     rTCON = (rTCON & (~0xf00)) | TIMER1_START;
+    
+#if OS_PMU_TIMEBASE==1
+    PMU_StartBudgetInterval();
+#endif
 }
 
 void _OS_Timer_Disable(UINT32 timer)
@@ -157,8 +211,15 @@ UINT32 _OS_Timer_GetTimeElapsed_us(UINT32 timer)
     }
     else
     {
+#if OS_PMU_TIMEBASE==1
+    	// The budget spent is measured in CPU cycles. The division by the constant is
+    	// done with a multiply by the compiler
+    	diff_count = PMU_GetCycleCount() - g_budget_start_cycles + g_budget_residue_cycles;
+    	return diff_count / PMU_CYCLES_PER_us;
+#else
     	diff_count = (rTCNTB1 - rTCNTO1);
 		return CONVERT_TMR1_TICKS_TO_us(diff_count);    	
+#endif
     }
 }
 
@@ -177,3 +238,16 @@ UINT32 _OS_Timer_GetMaxCount(UINT32 timer)
 {
 	return (timer == PERIODIC_TIMER) ? rTCNTB0 : rTCNTB1;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns TRUE if the timer has expired and its interrupt is not yet acknowledged
+// This is useful when the interrupts are disabled and the timer has reloaded
+///////////////////////////////////////////////////////////////////////////////
+BOOL _OS_Timer_IsInterruptPending(UINT32 timer)
+{
+#if defined(SOC_S3C2440)
+	return (rSRCPND & (1 << (TIMER0_INTERRUPT_INDEX + timer))) ? TRUE : FALSE;
+#elif defined(SOC_S5PV210)
+	return (rTINT_CSTAT & (0x20 << timer)) ? TRUE : FALSE;
+#endif
+}
@@ -56,12 +56,32 @@ void _OS_StartSyncTimer();
 
 #endif
 
-// TODO: I need to make below calculations extremely efficient.
-// Use 64 bit calculation for accuracy and always round up
-#define CONVERT_TMR0_us_TO_TICKS(us)	((UINT32)(TIMER0_TICK_PER_us * (us)))
-#define CONVERT_TMR1_us_TO_TICKS(us)	((UINT32)(TIMER1_TICK_PER_us * (us)))
-#define CONVERT_TMR0_TICKS_TO_us(tick)	((UINT32)((tick) * TIMER0_us_PER_TICK + 0.5))
-#define CONVERT_TMR1_TICKS_TO_us(tick)	((UINT32)((tick) * TIMER1_us_PER_TICK + 0.5))
+// The conversions between the timer ticks and microseconds use fixed point multipliers
+// computed at compile time from the timer clock (TIMERx_TICK_FREQ in Hz). So there is
+// no floating point (soft float library) call in the ISR path. A 32x32 bit multiply
+// and a shift are enough, as the multipliers fit in 32 bits for the timer clocks between
+// 250 KHz and 256 MHz. The microseconds are rounded up to the ticks so that a timeout
+// never expires early. The ticks are rounded to the nearest microsecond.
+#define TIMER_TICKS_FP_SHIFT			24
+#define TIMER_us_FP_SHIFT				30
+
+#define TIMER_TICKS_PER_us_FP(freq)		((UINT32)((((UINT64)(freq) << TIMER_TICKS_FP_SHIFT) + 999999) / 1000000))
+#define TIMER_us_PER_TICK_FP(freq)		((UINT32)(((1000000ull << TIMER_us_FP_SHIFT) + (freq) / 2) / (freq)))
+
+#define TIMER_us_TO_TICKS(us, freq)		((UINT32)(((UINT64)(us) * TIMER_TICKS_PER_us_FP(freq) + \
+											((1 << TIMER_TICKS_FP_SHIFT) - 1)) >> TIMER_TICKS_FP_SHIFT))
+#define TIMER_TICKS_TO_us(tick, freq)	((UINT32)(((UINT64)(tick) * TIMER_us_PER_TICK_FP(freq) + \
+											(1 << (TIMER_us_FP_SHIFT - 1))) >> TIMER_us_FP_SHIFT))
+
+#define CONVERT_TMR0_us_TO_TICKS(us)	TIMER_us_TO_TICKS(us, TIMER0_TICK_FREQ)
+#define CONVERT_TMR1_us_TO_TICKS(us)	TIMER_us_TO_TICKS(us, TIMER1_TICK_FREQ)
+#define CONVERT_TMR0_TICKS_TO_us(tick)	TIMER_TICKS_TO_us(tick, TIMER0_TICK_FREQ)
+#define CONVERT_TMR1_TICKS_TO_us(tick)	TIMER_TICKS_TO_us(tick, TIMER1_TICK_FREQ)
+
+#if OS_PMU_TIMEBASE==1
+// Cycles of the PMU cycle counter (CPU clock) per microsecond
+#define PMU_CYCLES_PER_us				(ARMCLK / 1000000)
+#endif
 
 // Timer functions
 void _OS_Timer_AckInterrupt(UINT32 timer);
@@ -72,6 +92,7 @@ void _OS_Timer_Disable(UINT32 timer);
 UINT32 _OS_Timer_GetTimeElapsed_us(UINT32 timer);
 UINT32 _OS_Timer_GetCount(UINT32 timer);
 UINT32 _OS_Timer_GetMaxCount(UINT32 timer);
+BOOL _OS_Timer_IsInterruptPending(UINT32 timer);
 
 // Timer ISR
 void _OS_PeriodicTimerISR(void *arg);
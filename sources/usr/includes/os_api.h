@@ -57,6 +57,7 @@ typedef enum
     ACCESS_DENIED = -43,
     DEFER_IO_REQUEST = -44,
     RESOURCE_BUSY = -45,
+    TIMEOUT = -46,
 	
 	
 	UNKNOWN = -99	
@@ -81,6 +82,44 @@ enum
     TASK_PRIORITY_IDLE     = 255		// Actual kernel idle task is at 256
 };
 
+// Criticality levels of the periodic tasks for the mixed criticality scheduling
+typedef enum
+{
+	LOW_CRITICALITY = 0,		// Dropped when the system switches to the high criticality mode
+	HIGH_CRITICALITY = 1
+	
+} OS_Criticality;
+
+// Actions taken when a job of a periodic task overruns, i.e. exhausts its budget or 
+// misses its deadline. The actions can be combined. With OVERRUN_CONTINUE the late job
+// goes on in the next period and takes the budget of the next job
+typedef enum
+{
+	OVERRUN_CONTINUE = 0,		// Default
+	OVERRUN_ABORT = 1,			// The late job is abandoned. The task function is called again at the next release
+	OVERRUN_SKIP = 2,			// The next skip_count releases are skipped so that the late work can catch up
+	OVERRUN_NOTIFY = 4			// The notification semaphore is posted
+	
+} OS_OverrunPolicy;
+
+// How the timeout of OS_SemTimedWait is given
+typedef enum
+{
+	OS_TIMEOUT_RELATIVE = 0,		// Microseconds from now
+	OS_TIMEOUT_ABSOLUTE = 1,		// Time in microseconds as given by OS_GetElapsedTime
+	OS_TIMEOUT_AT_DEADLINE = 2		// At the deadline of the current job. The timeout value is not used
+	
+} OS_TimeoutMode;
+
+// How OS_EventWait waits for the flags. OS_EVENT_AUTO_CLEAR can be ORed with either mode
+typedef enum
+{
+	OS_EVENT_WAIT_ANY = 0,			// Any of the flags in the mask
+	OS_EVENT_WAIT_ALL = 1,			// All the flags in the mask
+	OS_EVENT_AUTO_CLEAR = 2			// The flags in the mask are cleared when the wait is satisfied
+	
+} OS_EventWaitMode;
+
 ///////////////////////////////////////////////////////////////////////////////
 //                                  OS Data types
 ///////////////////////////////////////////////////////////////////////////////
@@ -90,8 +129,18 @@ typedef _OS_KernelObj_Handle 	OS_Task_t;
 typedef _OS_KernelObj_Handle 	OS_Process_t;
 typedef _OS_KernelObj_Handle	OS_Sem_t;
 typedef _OS_KernelObj_Handle	OS_Mutex_t;
+typedef _OS_KernelObj_Handle	OS_MsgQueue_t;
+typedef _OS_KernelObj_Handle	OS_Event_t;
 typedef _OS_KernelObj_Handle	OS_Driver_t;
 
+// User space lock. See OS_LockInit
+typedef struct
+{
+	volatile UINT32 word;		// 0 - Free, 1 - Taken, 2 - Taken and may have waiters
+	OS_Sem_t sem;				// Wait queue of the lock in the kernel
+	
+} OS_Lock;
+
 // Structure for Date and Time
 typedef struct
 {
@@ -156,6 +205,51 @@ OS_Return OS_CreateAperiodicTask(
 	void (*task_entry_function)(void *pdata),
 	void *pdata);
 
+// Aperiodic task served by a Constant Bandwidth Server. The task is scheduled by 
+// EDF along with the periodic tasks. It is guaranteed budget/period of the CPU and
+// may use the idle time, but it cannot take more than that from the periodic tasks.
+OS_Return OS_CreateCBSTask(
+	UINT32 budget_in_us,
+	UINT32 period_in_us,
+	UINT32 *stack,
+	UINT32 stack_size_in_bytes,
+	const INT8 * task_name,
+	OS_Task_t *task,
+	void (*task_entry_function)(void *pdata),
+	void *pdata);
+
+// Periodic task with a criticality level for the mixed criticality scheduling. The budget
+// is used in the low criticality mode. A high criticality task gets hi_budget_in_us in the
+// high criticality mode and the low criticality tasks do not run in that mode.
+// The tasks created by OS_CreatePeriodicTask are high criticality tasks with the same 
+// budget in both modes. Returns NOT_SUPPORTED if OS_MIXED_CRITICALITY is not enabled,
+// or for a low criticality task in a process with user space locks (OS_Lock).
+OS_Return OS_CreateMixedCriticalityTask(
+	UINT16 criticality,			// LOW_CRITICALITY or HIGH_CRITICALITY
+	UINT32 period_in_us,
+	UINT32 deadline_in_us,
+	UINT32 budget_in_us,
+	UINT32 hi_budget_in_us,
+	UINT32 phase_shift_in_us,
+	UINT32 *stack,
+	UINT32 stack_size_in_bytes,
+	const INT8 * task_name,
+	OS_Task_t *task,
+	void (*periodic_entry_function)(void *pdata),
+	void *pdata);
+
+// Sets the action taken when a job of the periodic task overruns. See OS_OverrunPolicy
+// skip_count is used with OVERRUN_SKIP and notify_sem with OVERRUN_NOTIFY. The semaphore
+// should belong to the calling process. A handler task waiting on it can log the overrun
+// or degrade the service. A job blocked on a semaphore is never aborted, the other 
+// actions still apply. Returns NOT_SUPPORTED with OS_STATIC_SCHEDULE, and for
+// OVERRUN_ABORT in a process with user space locks (OS_Lock)
+OS_Return OS_SetOverrunPolicy(
+	OS_Task_t task,
+	UINT32 policy,				// OS_OverrunPolicy flags
+	UINT32 skip_count,
+	OS_Sem_t notify_sem);
+
 ///////////////////////////////////////////////////////////////////////////////
 //                          Process creation APIs
 // Using processes is optional. It is possible to create tasks under the default 
@@ -194,6 +288,13 @@ OS_Return OS_CreateProcessFromFile(
 // API for getting the current process handle
 OS_Process_t OS_GetCurrentProcess();
 
+// OS_SetProcessReservation:
+// Reserves budget_in_us of CPU time in every period_in_us for the current process.
+// The periodic & CBS tasks of the process are scheduled within the reservation, so 
+// they cannot delay the tasks of other processes by overrunning their budgets.
+// It should be called before the process creates its periodic / CBS tasks
+OS_Return OS_SetProcessReservation(UINT32 budget_in_us, UINT32 period_in_us);
+
 ///////////////////////////////////////////////////////////////////////////////
 //                              Memory Mapping functions
 // Note that these functions can only be called from Admin processes. Non admin
@@ -241,10 +342,84 @@ OS_Return OS_UnmapMemory(
 ///////////////////////////////////////////////////////////////////////////////
 OS_Return OS_SemAlloc(OS_Sem_t *sem, UINT32 value, BOOL binary);
 OS_Return OS_SemWait(OS_Sem_t sem);
+
+// Waits on the semaphore till the timeout. Returns TIMEOUT if the semaphore was not 
+// acquired by then. See OS_TimeoutMode. With OS_TIMEOUT_AT_DEADLINE a periodic task gives
+// up the wait when its job misses the deadline. The job then goes on late from the next
+// release, as with OVERRUN_CONTINUE. CBS tasks give up at their server deadline.
+// The aperiodic tasks cannot use it. The timeouts are seen at the next timer interrupt
+OS_Return OS_SemTimedWait(OS_Sem_t sem, UINT64 timeout_us, OS_TimeoutMode mode);
+
 OS_Return OS_SemPost(OS_Sem_t sem);
 OS_Return OS_SemFree(OS_Sem_t sem);
 OS_Return OS_SemGetValue(OS_Sem_t sem, INT32 *val);
 
+///////////////////////////////////////////////////////////////////////////////
+// Mutex functions. The mutexes follow the Stack Resource Policy. A job that may
+// lock a mutex held by another task does not start till the mutex is unlocked.
+// ceiling_deadline_us is the shortest relative deadline (the period for the CBS
+// tasks) of the tasks that lock the mutex. If it is 0, it is learnt as the tasks
+// lock the mutex. Unlock the mutexes before the job completes and do not wait
+// on a semaphore while holding a mutex. The kernel unlocks the mutexes of a job
+// that is aborted (OVERRUN_ABORT) and of a task that ends for good.
+///////////////////////////////////////////////////////////////////////////////
+OS_Return OS_MutexAlloc(OS_Mutex_t *mutex, UINT32 ceiling_deadline_us);
+OS_Return OS_MutexLock(OS_Mutex_t mutex);
+OS_Return OS_MutexUnlock(OS_Mutex_t mutex);
+OS_Return OS_MutexFree(OS_Mutex_t mutex);
+
+///////////////////////////////////////////////////////////////////////////////
+// User space locks. Taking a free lock and releasing a lock that nobody waits
+// for do not enter the kernel. A task that finds the lock taken waits in the
+// kernel as on a semaphore: the periodic tasks in the order of their deadlines,
+// then the aperiodic tasks by priority. There is no preemption ceiling as with
+// the mutexes. The lock can be shared by the tasks of one process.
+// The kernel does not know who holds a lock. A job aborted while holding it would
+// leave it taken for good. So the user space locks cannot be combined with aborted
+// jobs: OVERRUN_ABORT and the low criticality tasks, whose jobs are aborted in the
+// high criticality mode. OS_LockInit returns NOT_SUPPORTED in a process with such a
+// task, and such a task is refused in a process with a lock. Likewise, a task should
+// not end while it holds a lock.
+///////////////////////////////////////////////////////////////////////////////
+OS_Return OS_LockInit(OS_Lock * lock);
+OS_Return OS_LockAcquire(OS_Lock * lock);
+OS_Return OS_LockRelease(OS_Lock * lock);
+OS_Return OS_LockFree(OS_Lock * lock);
+
+///////////////////////////////////////////////////////////////////////////////
+// Message queues between the processes. The messages are not copied. The slots
+// of a queue are mapped into every process that creates or opens it, at the same
+// address. The sender fills in a slot from OS_MsgQueueAlloc and sends it. The
+// receiver reads the message in place and releases the slot. Only the process
+// that holds a slot can send or release it. OS_MsgQueueAlloc returns
+// RESOURCE_EXHAUSTED if all the slots are in use. OS_MsgQueueReceive waits for a
+// message. The waiting periodic tasks get the messages in the order of their
+// deadlines, then the aperiodic tasks by priority. The slot size is msg_size
+// rounded up to a power of 2. The queues cannot be freed.
+///////////////////////////////////////////////////////////////////////////////
+OS_Return OS_MsgQueueCreate(const INT8 * name, UINT32 msg_size, UINT32 msg_count, OS_MsgQueue_t * queue);
+OS_Return OS_MsgQueueOpen(const INT8 * name, OS_MsgQueue_t * queue);
+OS_Return OS_MsgQueueAlloc(OS_MsgQueue_t queue, void ** msg);
+OS_Return OS_MsgQueueSend(OS_MsgQueue_t queue, void * msg);
+OS_Return OS_MsgQueueReceive(OS_MsgQueue_t queue, void ** msg);
+OS_Return OS_MsgQueueRelease(OS_MsgQueue_t queue, void * msg);
+
+///////////////////////////////////////////////////////////////////////////////
+// Event flags. An event is a group of 32 flags. OS_EventWait waits till any or
+// all of the flags in the mask are set (see OS_EventWaitMode) and returns the
+// flags of the mask that were set. The flags start as given to OS_EventAlloc.
+// OS_EventPost sets the flags and wakes up every
+// task whose wait they satisfy with one call, the periodic tasks in the order of
+// their deadlines, then the aperiodic tasks by priority. All of them see the
+// flags of the post. The flags of the waits with OS_EVENT_AUTO_CLEAR are cleared
+// after that. The event can be shared by the tasks of one process.
+///////////////////////////////////////////////////////////////////////////////
+OS_Return OS_EventAlloc(OS_Event_t * event, UINT32 flags);
+OS_Return OS_EventWait(OS_Event_t event, UINT32 mask, UINT32 mode, UINT32 * flags);
+OS_Return OS_EventPost(OS_Event_t event, UINT32 flags);
+OS_Return OS_EventClear(OS_Event_t event, UINT32 flags);
+OS_Return OS_EventFree(OS_Event_t event);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Function to get the currently running thread. It returns a void pointer 
 // which may be used as a Periodic / Aperiodic Task pointers
@@ -257,6 +432,13 @@ void * OS_GetCurrentTask();
 ///////////////////////////////////////////////////////////////////////////////
 void OS_TaskYield();
 
+///////////////////////////////////////////////////////////////////////////////
+// Function to end the current task for good
+// A periodic task gives back its TCB and the CPU reserved for it, so that other
+// tasks can be admitted in its place. It does not return on success
+///////////////////////////////////////////////////////////////////////////////
+OS_Return OS_TaskComplete();
+
 ///////////////////////////////////////////////////////////////////////////////
 //                             Driver invocations
 ///////////////////////////////////////////////////////////////////////////////
@@ -309,6 +491,9 @@ typedef struct
 	UINT32 max_scheduler_elapsed_us;		// This will be reset each time, its value is read
 	UINT32 periodic_timer_intr_counter;
 	UINT32 budget_timer_intr_counter;
+	UINT32 max_mmu_switch_elapsed_us;		// Time to switch the address space. Reset each time, its value is read
+	UINT32 schedule_counter;				// Number of times the scheduler picked a task
+	UINT32 ptable_switch_counter;			// Number of times the page table was switched
 	
 } OS_StatCounters;
 
@@ -325,6 +510,20 @@ typedef struct
 	
 } OS_TaskStatCounters;
 
+// Response time and start jitter histograms of a periodic task. The bins are in log scale
+// Bin 0 counts the values below 1 us and bin n the values from 2^(n-1) to 2^n - 1 us.
+// The last bin also has all the longer values
+#define OS_HISTOGRAM_BINS	24
+
+typedef struct
+{
+	UINT32 response_time[OS_HISTOGRAM_BINS];	// Job release to the end of the job (yield)
+	UINT32 start_jitter[OS_HISTOGRAM_BINS];		// Job release to the first dispatch of the job
+	UINT32 max_response_time_us;
+	UINT32 max_start_jitter_us;
+	
+} OS_TaskHistograms;
+
 // Get global OS statistics. This function can be called only from Admin process
 // Non-admin tasks will get NOT_ADMINISTRATOR error
 OS_Return OS_GetStatCounters(OS_StatCounters * ptr);
@@ -333,6 +532,11 @@ OS_Return OS_GetStatCounters(OS_StatCounters * ptr);
 // Non-admin tasks will get NOT_ADMINISTRATOR error
 OS_Return OS_GetTaskStatCounters(OS_Task_t task, OS_TaskStatCounters * ptr);
 
+// Get the response time and start jitter histograms of a periodic task. The histograms of
+// the other tasks are empty. This function can be called only from Admin process
+// Non-admin tasks will get NOT_ADMINISTRATOR error
+OS_Return OS_GetTaskHistograms(OS_Task_t task, OS_TaskHistograms * ptr);
+
 // Get global Task allocation mask. This function can be called only from Admin process
 // Non-admin tasks will get NOT_ADMINISTRATOR error
 // alloc_mask - is a bit mask indicating which task numbers are under use.
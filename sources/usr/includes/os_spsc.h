@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	os_spsc.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Lock free ring buffer for one producer and one consumer
+//		The ring does not enter the kernel. The producer and the consumer can be
+//		tasks of different processes if the ring is in memory mapped into both,
+//		for example a slot of a message queue (see OS_MsgQueueCreate). The ring
+//		holds no pointers, so it can be mapped at a different address in each
+//		process. There should be only one producer task and one consumer task.
+//
+//		The indices run freely and the slot is the index masked with the slot
+//		count. The producer writes only head and the consumer writes only tail.
+//		They are in separate cache lines, so the two sides do not write to the
+//		same line. Each side keeps a copy of the other index in its own line
+//		and reads the shared one only when the copy says the ring is full or
+//		empty.
+//
+//		Producer:								Consumer:
+//			slot = OS_SpscReserve(ring);			slot = OS_SpscPeek(ring);
+//			if(slot) {								if(slot) {
+//				// Write the slot						// Read the slot
+//				OS_SpscCommit(ring);					OS_SpscRelease(ring);
+//			}										}
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _OS_SPSC_H
+#define _OS_SPSC_H
+
+#include "os_api.h"
+
+// Larger of the cache lines of the supported cores (64 bytes on the Cortex-A8)
+#define OS_SPSC_CACHE_LINE			64
+
+typedef struct
+{
+	// Producer side
+	volatile UINT32 head;			// Slots written so far
+	UINT32 tail_copy;				// Last tail seen by the producer
+	UINT8 producer_pad[OS_SPSC_CACHE_LINE - 2 * sizeof(UINT32)];
+
+	// Consumer side
+	volatile UINT32 tail;			// Slots read so far
+	UINT32 head_copy;				// Last head seen by the consumer
+	UINT8 consumer_pad[OS_SPSC_CACHE_LINE - 2 * sizeof(UINT32)];
+
+	// Read only after OS_SpscInit
+	UINT32 mask;					// Slot count - 1
+	UINT32 slot_size;				// In bytes, a multiple of 4
+	UINT8 config_pad[OS_SPSC_CACHE_LINE - 2 * sizeof(UINT32)];
+
+	// The slots follow the header
+
+} __attribute__ ((aligned(OS_SPSC_CACHE_LINE))) OS_SpscRing;
+
+// Bytes needed for a ring with slot_count slots of slot_size bytes
+#define OS_SPSC_RING_SIZE(slot_size, slot_count)	\
+	(sizeof(OS_SpscRing) + (((slot_size) + 3) & ~3) * (slot_count))
+
+// The writes before the barrier are seen by the other side before the writes after it
+// and the reads before it are done before the writes after it
+static __inline__ void _OS_SpscBarrier(void)
+{
+#if defined(__ARM_ARCH_7A__)
+	__asm__ volatile("dmb" : : : "memory");
+#elif defined(__arm__)
+	// The cores before ARMv6 are in order and the kernel runs on one core. Only the
+	// compiler can reorder the accesses
+	__asm__ volatile("" : : : "memory");
+#else
+	// Host builds of the unit tests
+	__sync_synchronize();
+#endif
+}
+
+static __inline__ UINT8 * _OS_SpscSlot(OS_SpscRing * ring, UINT32 index)
+{
+	return (UINT8 *)(ring + 1) + (index & ring->mask) * ring->slot_size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Initializes the ring in OS_SPSC_RING_SIZE(slot_size, slot_count) bytes of
+// memory aligned to OS_SPSC_CACHE_LINE. slot_count should be a power of 2.
+// Call it before the producer and the consumer start
+///////////////////////////////////////////////////////////////////////////////
+static __inline__ OS_Return OS_SpscInit(OS_SpscRing * ring, UINT32 slot_size, UINT32 slot_count)
+{
+	if(!ring || ((unsigned long) ring & (OS_SPSC_CACHE_LINE - 1)) || !slot_size ||
+		!slot_count || (slot_count & (slot_count - 1))) {
+		return BAD_ARGUMENT;
+	}
+
+	ring->head = 0;
+	ring->tail_copy = 0;
+	ring->tail = 0;
+	ring->head_copy = 0;
+	ring->mask = slot_count - 1;
+	ring->slot_size = (slot_size + 3) & ~3;
+
+	_OS_SpscBarrier();
+
+	return SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Producer. Returns the next free slot or NULL if the ring is full. The slot is
+// seen by the consumer after OS_SpscCommit
+///////////////////////////////////////////////////////////////////////////////
+static __inline__ void * OS_SpscReserve(OS_SpscRing * ring)
+{
+	UINT32 head = ring->head;
+
+	if(head - ring->tail_copy > ring->mask) {
+
+		ring->tail_copy = ring->tail;
+		if(head - ring->tail_copy > ring->mask) {
+			return NULL;
+		}
+
+		// The consumer is done with the slot before we write it
+		_OS_SpscBarrier();
+	}
+
+	return _OS_SpscSlot(ring, head);
+}
+
+static __inline__ void OS_SpscCommit(OS_SpscRing * ring)
+{
+	// The slot is written before the consumer sees the new head
+	_OS_SpscBarrier();
+	ring->head = ring->head + 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Consumer. Returns the oldest slot or NULL if the ring is empty. The slot can
+// be written again by the producer after OS_SpscRelease
+///////////////////////////////////////////////////////////////////////////////
+static __inline__ void * OS_SpscPeek(OS_SpscRing * ring)
+{
+	UINT32 tail = ring->tail;
+
+	if(tail == ring->head_copy) {
+
+		ring->head_copy = ring->head;
+		if(tail == ring->head_copy) {
+			return NULL;
+		}
+
+		// The slot is read after the head that covers it
+		_OS_SpscBarrier();
+	}
+
+	return _OS_SpscSlot(ring, tail);
+}
+
+static __inline__ void OS_SpscRelease(OS_SpscRing * ring)
+{
+	// The slot is read before the producer sees it free
+	_OS_SpscBarrier();
+	ring->tail = ring->tail + 1;
+}
+
+// Number of slots written and not yet released. Exact only on the producer or the consumer
+static __inline__ UINT32 OS_SpscCount(const OS_SpscRing * ring)
+{
+	return ring->head - ring->tail;
+}
+
+#endif // _OS_SPSC_H
@@ -39,6 +39,15 @@ enum
 	// Display functions
 	SYSCALL_GET_DISP_FRAME_BUFFER,
 	
+	SYSCALL_PROCESS_SET_RESERVATION,
+	SYSCALL_TASK_SET_OVERRUN_POLICY,
+	SYSCALL_TASK_GET_HISTOGRAMS,
+	SYSCALL_MUTEX,							// The sub_id indicates the mutex function
+	SYSCALL_FUTEX,							// Slow path of the user space locks
+	SYSCALL_SEM_TIMED_WAIT,
+	SYSCALL_MSGQ,							// The sub_id indicates the message queue function
+	SYSCALL_EVENT,							// The sub_id indicates the event flag function
+	
 	// Reserved space for other syscall
 	
 	SYSCALL_PFM_LED_SET = 32,	
@@ -47,6 +56,52 @@ enum
 };
 
 
+enum    // Sub IDs for SYSCALL_PERIODIC_TASK_CREATE
+{
+    SUBCALL_PERIODIC_TASK = 0,
+    SUBCALL_PERIODIC_MIXED_CRITICALITY_TASK = 1
+};
+
+enum    // Sub IDs for SYSCALL_APERIODIC_TASK_CREATE
+{
+    SUBCALL_APERIODIC_PRIORITY_TASK = 0,
+    SUBCALL_APERIODIC_CBS_TASK = 1
+};
+
+enum    // Sub IDs for SYSCALL_MUTEX
+{
+    SUBCALL_MUTEX_ALLOC = 0,
+    SUBCALL_MUTEX_LOCK = 1,
+    SUBCALL_MUTEX_UNLOCK = 2,
+    SUBCALL_MUTEX_FREE = 3
+};
+
+enum    // Sub IDs for SYSCALL_FUTEX
+{
+    SUBCALL_FUTEX_WAIT = 0,
+    SUBCALL_FUTEX_WAKE = 1,
+    SUBCALL_FUTEX_INIT = 2
+};
+
+enum    // Sub IDs for SYSCALL_MSGQ
+{
+    SUBCALL_MSGQ_CREATE = 0,
+    SUBCALL_MSGQ_OPEN = 1,
+    SUBCALL_MSGQ_ALLOC = 2,
+    SUBCALL_MSGQ_SEND = 3,
+    SUBCALL_MSGQ_RECEIVE = 4,
+    SUBCALL_MSGQ_RELEASE = 5
+};
+
+enum    // Sub IDs for SYSCALL_EVENT
+{
+    SUBCALL_EVENT_ALLOC = 0,
+    SUBCALL_EVENT_WAIT = 1,
+    SUBCALL_EVENT_POST = 2,
+    SUBCALL_EVENT_CLEAR = 3,
+    SUBCALL_EVENT_FREE = 4
+};
+
 enum    // Sub IDs for SYSCALL_DRIVER_STANDARD_CALL
 {
     SUBCALL_DRIVER_LOOKUP = 0,
@@ -30,7 +30,7 @@ OS_Return OS_CreatePeriodicTask(
 	
 	// Prepare the argument info structure
 	param_info.id = SYSCALL_PERIODIC_TASK_CREATE;
-	param_info.sub_id = 0;
+	param_info.sub_id = SUBCALL_PERIODIC_TASK;
 	param_info.arg_count = ARRAYSIZE(arg);
 	param_info.ret_count = ARRAYSIZE(ret);
 	
@@ -52,6 +52,50 @@ OS_Return OS_CreatePeriodicTask(
 	return (OS_Return) ret[0];
 }
 
+OS_Return OS_CreateMixedCriticalityTask(
+	UINT16 criticality,
+	UINT32 period_in_us,
+	UINT32 deadline_in_us,
+	UINT32 budget_in_us,
+	UINT32 hi_budget_in_us,
+	UINT32 phase_shift_in_us,
+	UINT32 *stack,
+	UINT32 stack_size_in_bytes,
+	const INT8 * task_name,
+	OS_Task_t *task,
+	void (*periodic_entry_function)(void *pdata),
+	void *pdata)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[11];
+	UINT32 ret[2];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_PERIODIC_TASK_CREATE;
+	param_info.sub_id = SUBCALL_PERIODIC_MIXED_CRITICALITY_TASK;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = criticality;
+	arg[1] = period_in_us;
+	arg[2] = deadline_in_us;
+	arg[3] = budget_in_us;
+	arg[4] = hi_budget_in_us;
+	arg[5] = phase_shift_in_us;
+	arg[6] = (UINT32)stack;
+	arg[7] = stack_size_in_bytes;
+	arg[8] = (UINT32)task_name;
+	arg[9] = (UINT32)periodic_entry_function;
+	arg[10] = (UINT32)pdata;
+	
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	// Store the return value
+	*task = (OS_Task_t) ret[1];
+	
+	return (OS_Return) ret[0];
+}
+
 OS_Return OS_CreateAperiodicTask(
 	UINT16 priority,				// Smaller the number, higher the priority
 	UINT32 *stack,
@@ -67,7 +111,7 @@ OS_Return OS_CreateAperiodicTask(
 	
 	// Prepare the argument info structure
 	param_info.id = SYSCALL_APERIODIC_TASK_CREATE;
-	param_info.sub_id = 0;
+	param_info.sub_id = SUBCALL_APERIODIC_PRIORITY_TASK;
 	param_info.arg_count = ARRAYSIZE(arg);
 	param_info.ret_count = ARRAYSIZE(ret);
 	
@@ -86,6 +130,42 @@ OS_Return OS_CreateAperiodicTask(
 	return (OS_Return) ret[0];
 }
 
+OS_Return OS_CreateCBSTask(
+	UINT32 budget_in_us,
+	UINT32 period_in_us,
+	UINT32 *stack,
+	UINT32 stack_size_in_bytes,
+	const INT8 * task_name,
+	OS_Task_t *task,
+	void (*task_entry_function)(void *pdata),
+	void *pdata)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[7];
+	UINT32 ret[2];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_APERIODIC_TASK_CREATE;
+	param_info.sub_id = SUBCALL_APERIODIC_CBS_TASK;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = budget_in_us;
+	arg[1] = period_in_us;
+	arg[2] = (UINT32)stack;
+	arg[3] = stack_size_in_bytes;
+	arg[4] = (UINT32)task_name;
+	arg[5] = (UINT32)task_entry_function;
+	arg[6] = (UINT32)pdata;
+	
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	// Store the return value
+	*task = (OS_Task_t) ret[1];
+	
+	return (OS_Return) ret[0];
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Process creation APIs
 // Using processes is optional. It is possible to create tasks under the default 
@@ -126,6 +206,50 @@ OS_Process_t OS_GetCurrentProcess()
 	return ret[0];
 }
 
+// Function for reserving the CPU for the current process
+OS_Return OS_SetProcessReservation(UINT32 budget_in_us, UINT32 period_in_us)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[2];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_PROCESS_SET_RESERVATION;
+	param_info.sub_id = 0;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = budget_in_us;
+	arg[1] = period_in_us;
+	
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	return (OS_Return) ret[0];
+}
+
+// Function for setting the action taken when a job of a periodic task overruns
+OS_Return OS_SetOverrunPolicy(OS_Task_t task, UINT32 policy, UINT32 skip_count, OS_Sem_t notify_sem)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[4];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_TASK_SET_OVERRUN_POLICY;
+	param_info.sub_id = 0;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = task;
+	arg[1] = policy;
+	arg[2] = skip_count;
+	arg[3] = notify_sem;
+	
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	return (OS_Return) ret[0];
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Memory Mapping functions
 ///////////////////////////////////////////////////////////////////////////////
@@ -220,6 +344,26 @@ void OS_TaskYield()
 	_OS_Syscall(&param_info, NULL, NULL, SYSCALL_SWITCHING);	
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Function to end the current task for good
+///////////////////////////////////////////////////////////////////////////////
+OS_Return OS_TaskComplete()
+{
+	_OS_Syscall_Args param_info;
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_TASK_COMPLETE;
+	param_info.sub_id = 0;
+	param_info.arg_count = 0;
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	// The task is switched out and never comes back when this call succeeds
+	_OS_Syscall(&param_info, NULL, &ret, SYSCALL_SWITCHING);
+	
+	return (OS_Return) ret[0];
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Semaphore Functions
 ///////////////////////////////////////////////////////////////////////////////
@@ -263,6 +407,27 @@ OS_Return OS_SemWait(OS_Sem_t sem)
 	return (OS_Return) ret[0];
 }
 
+OS_Return OS_SemTimedWait(OS_Sem_t sem, UINT64 timeout_us, OS_TimeoutMode mode)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[4];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_SEM_TIMED_WAIT;
+	param_info.sub_id = 0;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = sem;
+	arg[1] = (UINT32) timeout_us;
+	arg[2] = (UINT32) (timeout_us >> 32);
+	arg[3] = mode;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_SWITCHING);
+	
+	return (OS_Return) ret[0];
+}
+
 OS_Return OS_SemPost(OS_Sem_t sem)
 {
 	_OS_Syscall_Args param_info;
@@ -322,6 +487,464 @@ OS_Return OS_SemGetValue(OS_Sem_t sem, INT32 *val)
 	return (OS_Return) ret[0];
 }
 
+OS_Return OS_MutexAlloc(OS_Mutex_t *mutex, UINT32 ceiling_deadline_us)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[1];
+	UINT32 ret[2];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_MUTEX;
+	param_info.sub_id = SUBCALL_MUTEX_ALLOC;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = ceiling_deadline_us;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	// Store the return value
+	*mutex = (OS_Mutex_t) ret[1];
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_MutexLock(OS_Mutex_t mutex)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[1];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_MUTEX;
+	param_info.sub_id = SUBCALL_MUTEX_LOCK;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = mutex;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_SWITCHING);
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_MutexUnlock(OS_Mutex_t mutex)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[1];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_MUTEX;
+	param_info.sub_id = SUBCALL_MUTEX_UNLOCK;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = mutex;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_SWITCHING);
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_MutexFree(OS_Mutex_t mutex)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[1];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_MUTEX;
+	param_info.sub_id = SUBCALL_MUTEX_FREE;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = mutex;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	return (OS_Return) ret[0];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// User space locks
+// The lock word is 0 when free, 1 when taken and 2 when taken and some task may
+// be waiting in the kernel. This is the mutex of Drepper's "Futexes Are Tricky"
+// that needs only an atomic exchange, as SWP is all that the ARM920T has.
+///////////////////////////////////////////////////////////////////////////////
+#define LOCK_FREE			0
+#define LOCK_TAKEN			1
+#define LOCK_CONTENDED		2
+
+// Stores the value in the word and returns the old value in one atomic step. It is
+// a memory barrier as well, so the critical section stays between the swaps
+static __inline__ UINT32 AtomicSwap(volatile UINT32 * word, UINT32 value)
+{
+	UINT32 old;
+	
+#if defined(__ARM_ARCH_7A__)
+	UINT32 failed;
+	
+	// SWP is deprecated on ARMv7. The exclusive store fails if the word was written
+	// by anyone else after our load
+	__asm__ volatile(
+		"	dmb\n"
+		"1:	ldrex	%0, [%2]\n"
+		"	strex	%1, %3, [%2]\n"
+		"	teq		%1, #0\n"
+		"	bne		1b\n"
+		"	dmb\n"
+		: "=&r" (old), "=&r" (failed)
+		: "r" (word), "r" (value)
+		: "cc", "memory");
+#else
+	// There are no exclusive loads / stores before ARMv6
+	__asm__ volatile(
+		"	swp		%0, %2, [%1]\n"
+		: "=&r" (old)
+		: "r" (word), "r" (value)
+		: "memory");
+#endif
+
+	return old;
+}
+
+// Blocks on the semaphore of the lock if the lock word is still value
+static OS_Return FutexWait(OS_Lock * lock, UINT32 value)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[3];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_FUTEX;
+	param_info.sub_id = SUBCALL_FUTEX_WAIT;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = lock->sem;
+	arg[1] = (UINT32) &lock->word;
+	arg[2] = value;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_SWITCHING);
+	
+	return (OS_Return) ret[0];
+}
+
+// Wakes up the first waiter of the lock
+static OS_Return FutexWake(OS_Lock * lock)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[1];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_FUTEX;
+	param_info.sub_id = SUBCALL_FUTEX_WAKE;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = lock->sem;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_SWITCHING);
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_LockInit(OS_Lock * lock)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 ret[2];
+	
+	if(!lock) {
+		return BAD_ARGUMENT;
+	}
+	
+	lock->word = LOCK_FREE;
+	
+	// Only the wait queues of the semaphore are used. The kernel refuses it in a
+	// process whose jobs can be aborted
+	param_info.id = SYSCALL_FUTEX;
+	param_info.sub_id = SUBCALL_FUTEX_INIT;
+	param_info.arg_count = 0;
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	_OS_Syscall(&param_info, NULL, &ret, SYSCALL_BASIC);
+	
+	// Store the return value
+	lock->sem = (OS_Sem_t) ret[1];
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_LockAcquire(OS_Lock * lock)
+{
+	OS_Return status = SUCCESS;
+	
+	// Fast path: the lock was free
+	if(AtomicSwap(&lock->word, LOCK_TAKEN) == LOCK_FREE) {
+		return SUCCESS;
+	}
+	
+	// Mark the lock contended so that the holder wakes us up when it releases
+	// the lock. We may take the lock as contended when nobody waits any more.
+	// That costs an extra system call at the release, but no wake up is lost
+	while(AtomicSwap(&lock->word, LOCK_CONTENDED) != LOCK_FREE) {
+	
+		status = FutexWait(lock, LOCK_CONTENDED);
+		if(status != SUCCESS) {
+			break;
+		}
+	}
+	
+	return status;
+}
+
+OS_Return OS_LockRelease(OS_Lock * lock)
+{
+	// Fast path: nobody is waiting
+	if(AtomicSwap(&lock->word, LOCK_FREE) != LOCK_CONTENDED) {
+		return SUCCESS;
+	}
+	
+	return FutexWake(lock);
+}
+
+OS_Return OS_LockFree(OS_Lock * lock)
+{
+	if(!lock) {
+		return BAD_ARGUMENT;
+	}
+	
+	return OS_SemFree(lock->sem);
+}
+
+OS_Return OS_MsgQueueCreate(const INT8 * name, UINT32 msg_size, UINT32 msg_count, OS_MsgQueue_t * queue)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[3];
+	UINT32 ret[2];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_MSGQ;
+	param_info.sub_id = SUBCALL_MSGQ_CREATE;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = (UINT32) name;
+	arg[1] = msg_size;
+	arg[2] = msg_count;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	// Store the return value
+	*queue = (OS_MsgQueue_t) ret[1];
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_MsgQueueOpen(const INT8 * name, OS_MsgQueue_t * queue)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[1];
+	UINT32 ret[2];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_MSGQ;
+	param_info.sub_id = SUBCALL_MSGQ_OPEN;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = (UINT32) name;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	// Store the return value
+	*queue = (OS_MsgQueue_t) ret[1];
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_MsgQueueAlloc(OS_MsgQueue_t queue, void ** msg)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[1];
+	UINT32 ret[2];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_MSGQ;
+	param_info.sub_id = SUBCALL_MSGQ_ALLOC;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = queue;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	if((OS_Return) ret[0] == SUCCESS) {
+		*msg = (void *) ret[1];
+	}
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_MsgQueueSend(OS_MsgQueue_t queue, void * msg)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[2];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_MSGQ;
+	param_info.sub_id = SUBCALL_MSGQ_SEND;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = queue;
+	arg[1] = (UINT32) msg;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_SWITCHING);
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_MsgQueueReceive(OS_MsgQueue_t queue, void ** msg)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[1];
+	UINT32 ret[2];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_MSGQ;
+	param_info.sub_id = SUBCALL_MSGQ_RECEIVE;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = queue;
+	
+	// NO_DATA comes back after the task waited for a message. The message may have
+	// been taken by another receiver by the time this task runs, so look again
+	do {
+		_OS_Syscall(&param_info, &arg, &ret, SYSCALL_SWITCHING);
+	} while((OS_Return) ret[0] == NO_DATA);
+	
+	if((OS_Return) ret[0] == SUCCESS) {
+		*msg = (void *) ret[1];
+	}
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_MsgQueueRelease(OS_MsgQueue_t queue, void * msg)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[2];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_MSGQ;
+	param_info.sub_id = SUBCALL_MSGQ_RELEASE;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = queue;
+	arg[1] = (UINT32) msg;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_EventAlloc(OS_Event_t * event, UINT32 flags)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[1];
+	UINT32 ret[2];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_EVENT;
+	param_info.sub_id = SUBCALL_EVENT_ALLOC;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = flags;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	// Store the return value
+	*event = (OS_Event_t) ret[1];
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_EventWait(OS_Event_t event, UINT32 mask, UINT32 mode, UINT32 * flags)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[3];
+	UINT32 ret[2];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_EVENT;
+	param_info.sub_id = SUBCALL_EVENT_WAIT;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = event;
+	arg[1] = mask;
+	arg[2] = mode;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_SWITCHING);
+	
+	if(flags && (OS_Return) ret[0] == SUCCESS) {
+		*flags = ret[1];
+	}
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_EventPost(OS_Event_t event, UINT32 flags)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[2];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_EVENT;
+	param_info.sub_id = SUBCALL_EVENT_POST;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = event;
+	arg[1] = flags;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_SWITCHING);
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_EventClear(OS_Event_t event, UINT32 flags)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[2];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_EVENT;
+	param_info.sub_id = SUBCALL_EVENT_CLEAR;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = event;
+	arg[1] = flags;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+	
+	return (OS_Return) ret[0];
+}
+
+OS_Return OS_EventFree(OS_Event_t event)
+{
+	_OS_Syscall_Args param_info;
+	UINT32 arg[1];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_EVENT;
+	param_info.sub_id = SUBCALL_EVENT_FREE;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = event;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_SWITCHING);
+	
+	return (OS_Return) ret[0];
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Statistics Functions
 ///////////////////////////////////////////////////////////////////////////////
@@ -362,6 +985,25 @@ OS_Return OS_GetTaskStatCounters(OS_Task_t task, OS_TaskStatCounters * ptr)
 	return (OS_Return) ret[0];	
 }
 
+OS_Return OS_GetTaskHistograms(OS_Task_t task, OS_TaskHistograms * ptr)
+{
+	_OS_Syscall_Args param_info;
+	void * arg[2];
+	UINT32 ret[1];
+	
+	// Prepare the argument info structure
+	param_info.id = SYSCALL_TASK_GET_HISTOGRAMS;
+	param_info.sub_id = 0;
+	param_info.arg_count = ARRAYSIZE(arg);
+	param_info.ret_count = ARRAYSIZE(ret);
+	
+	arg[0] = (void *)task;
+	arg[1] = (void *)ptr;
+	_OS_Syscall(&param_info, &arg, &ret, SYSCALL_BASIC);
+			
+	return (OS_Return) ret[0];
+}
+
 OS_Return OS_GetTaskAllocMask(UINT32 * alloc_mask, UINT32 count, UINT32 starting_task)
 {
 	_OS_Syscall_Args param_info;
@@ -0,0 +1,347 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	schedgen.c
+//	Author:	Bala bhat (bhat.balasubramanya@gmail.com)
+//
+//	Description: This tool generates the static schedule table for OS_STATIC_SCHEDULE
+//	It runs preemptive EDF over the hyperperiod of the task manifest with every job
+//	using its full budget and writes the resulting slots as C source. The jobs still
+//	pending at the end of the hyperperiod are carried into the next one. So the EDF
+//	schedule is repeated until the carried over jobs are the same at the start and at
+//	the end of the hyperperiod and that hyperperiod is written out.
+//
+//	Usage: schedgen <task manifest> [output file]
+//
+//	Each line of the manifest describes one periodic task. All times are in us:
+//		<name> <period> <deadline> <budget> <phase>
+//	Any more columns are ignored, so the plain periodic task sets of the scheduler
+//	simulator can be used as they are. Lines starting with '#' are ignored.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "os_static_sched.h"
+
+#define TASK_NAME_SIZE		16
+#define MAX_PASSES			64
+
+typedef struct
+{
+	char name[TASK_NAME_SIZE];
+	UINT32 period;
+	UINT32 deadline;
+	UINT32 budget;
+	UINT32 phase;
+
+} Task;
+
+// The job of a task that is released and not finished. The deadlines are not more
+// than the periods, so a task has at most one such job in a feasible schedule.
+typedef struct
+{
+	BOOL pending;
+	INT64 release;			// Relative to the start of the hyperperiod
+	INT64 deadline;
+	UINT32 remaining;
+
+} Job;
+
+static Task tasks[OS_STATIC_MAX_TASKS];
+static UINT32 task_count;
+static UINT32 hyperperiod;
+
+static OS_StaticSlot * slots;
+static UINT32 slot_count;
+static UINT32 slot_size;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Reads the task manifest. Returns 0 on success
+//////////////////////////////////////////////////////////////////////////////////////////
+static int readManifest(const char * path)
+{
+	FILE * fp = fopen(path, "r");
+	char line[256];
+	int lineno = 0;
+
+	if(!fp)
+	{
+		fprintf(stderr, "Could not open %s\n", path);
+		return -1;
+	}
+
+	while(fgets(line, sizeof(line), fp))
+	{
+		Task * task = &tasks[task_count];
+		char * ptr = line;
+
+		lineno++;
+		while(*ptr == ' ' || *ptr == '\t') ptr++;
+		if(*ptr == '#' || *ptr == '\n' || *ptr == '\r' || *ptr == '\0') continue;
+
+		// The last index is OS_SLOT_IDLE
+		if(task_count == OS_STATIC_MAX_TASKS - 1)
+		{
+			fprintf(stderr, "%s:%d: More than %d tasks\n", path, lineno, OS_STATIC_MAX_TASKS - 1);
+			break;
+		}
+
+		if(sscanf(ptr, "%15s %u %u %u %u", task->name, &task->period, &task->deadline,
+			&task->budget, &task->phase) != 5)
+		{
+			fprintf(stderr, "%s:%d: Invalid task specification\n", path, lineno);
+			break;
+		}
+
+		if(!task->budget || (task->budget > task->deadline) || (task->deadline > task->period)
+			|| (task->phase >= task->period))
+		{
+			fprintf(stderr, "%s:%d: The tasks should have 0 < budget <= deadline <= period and phase < period\n",
+				path, lineno);
+			break;
+		}
+
+		task_count++;
+	}
+
+	if(!feof(fp))
+	{
+		fclose(fp);
+		return -1;
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Least common multiple of all periods. Returns 0 if it does not fit in 32 bits
+//////////////////////////////////////////////////////////////////////////////////////////
+static UINT32 getHyperperiod(void)
+{
+	UINT64 lcm = 1, a, b, t;
+	UINT32 i;
+
+	for(i = 0; i < task_count; i++)
+	{
+		a = lcm;
+		b = tasks[i].period;
+		while(b) { t = a % b; a = b; b = t; }
+
+		lcm = (lcm / a) * tasks[i].period;
+		if(lcm > 0xFFFFFFFFull) return 0;
+	}
+
+	return (UINT32) lcm;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Starts a new slot for the job of the given task
+//////////////////////////////////////////////////////////////////////////////////////////
+static void addSlot(UINT32 start, UINT32 task, INT64 release)
+{
+	if(slot_count == slot_size)
+	{
+		slot_size = slot_size ? (slot_size * 2) : 1024;
+		slots = (OS_StaticSlot *) realloc(slots, slot_size * sizeof(OS_StaticSlot));
+		if(!slots)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+
+	slots[slot_count].start = start;
+	slots[slot_count].release = (INT32) release;
+	slots[slot_count].task = (UINT8) task;
+	slots[slot_count].flags = 0;
+	slot_count++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Runs EDF for one hyperperiod starting with the pending jobs in 'jobs'. On return,
+// 'jobs' has the jobs pending at the end, relative to the start of the next hyperperiod.
+// Returns 0 if no deadline is missed.
+//////////////////////////////////////////////////////////////////////////////////////////
+static int runHyperperiod(Job * jobs)
+{
+	UINT64 next_release[OS_STATIC_MAX_TASKS];
+	UINT64 now = 0, next;
+	UINT32 i, run, last = OS_SLOT_IDLE;
+	BOOL job_end = TRUE;
+
+	slot_count = 0;
+	for(i = 0; i < task_count; i++) next_release[i] = tasks[i].phase;
+
+	while(now < hyperperiod)
+	{
+		// Release the new jobs
+		for(i = 0; i < task_count; i++)
+		{
+			if(next_release[i] == now)
+			{
+				jobs[i].pending = TRUE;
+				jobs[i].release = now;
+				jobs[i].deadline = now + tasks[i].deadline;
+				jobs[i].remaining = tasks[i].budget;
+				next_release[i] += tasks[i].period;
+			}
+		}
+
+		// The earliest deadline job runs till it finishes or till the next release
+		run = OS_SLOT_IDLE;
+		next = hyperperiod;
+		for(i = 0; i < task_count; i++)
+		{
+			if(jobs[i].pending && ((run == OS_SLOT_IDLE) || (jobs[i].deadline < jobs[run].deadline)))
+				run = i;
+			if(next_release[i] < next)
+				next = next_release[i];
+		}
+
+		if(run != OS_SLOT_IDLE)
+		{
+			if((run != last) || job_end) addSlot((UINT32) now, run, jobs[run].release);
+			if(now + jobs[run].remaining < next) next = now + jobs[run].remaining;
+
+			jobs[run].remaining -= (UINT32)(next - now);
+			job_end = (jobs[run].remaining == 0);
+			if(job_end)
+			{
+				jobs[run].pending = FALSE;
+				slots[slot_count - 1].flags |= OS_SLOT_JOB_END;
+			}
+		}
+		else if((last != OS_SLOT_IDLE) || !slot_count)
+		{
+			addSlot((UINT32) now, OS_SLOT_IDLE, 0);
+		}
+
+		last = run;
+		now = next;
+
+		for(i = 0; i < task_count; i++)
+		{
+			if(jobs[i].pending && (jobs[i].deadline <= (INT64) now))
+			{
+				fprintf(stderr, "Task %s misses its deadline at %lld us. The task set is not schedulable\n",
+					tasks[i].name, jobs[i].deadline);
+				return -1;
+			}
+		}
+	}
+
+	for(i = 0; i < task_count; i++)
+	{
+		if(jobs[i].pending)
+		{
+			jobs[i].release -= hyperperiod;
+			jobs[i].deadline -= hyperperiod;
+		}
+		else
+		{
+			memset(&jobs[i], 0, sizeof(Job));
+		}
+	}
+
+	return 0;
+}
+
+static void writeTable(FILE * fp, const char * manifest)
+{
+	UINT32 i;
+
+	fprintf(fp, "///////////////////////////////////////////////////////////////////////////////\n");
+	fprintf(fp, "// Static schedule generated by tools/schedgen from %s\n", manifest);
+	fprintf(fp, "// Hyperperiod %u us, %u tasks, %u slots. Do not edit\n", hyperperiod, task_count, slot_count);
+	fprintf(fp, "///////////////////////////////////////////////////////////////////////////////\n\n");
+	fprintf(fp, "#include \"os_static_sched.h\"\n\n");
+
+	fprintf(fp, "static const OS_StaticTask tasks[] =\n{\n");
+	for(i = 0; i < task_count; i++)
+	{
+		fprintf(fp, "\t{ \"%s\", %u, %u, %u, %u },\n", tasks[i].name, tasks[i].period,
+			tasks[i].deadline, tasks[i].budget, tasks[i].phase);
+	}
+	fprintf(fp, "};\n\n");
+
+	fprintf(fp, "static const OS_StaticSlot slots[] =\n{\n");
+	for(i = 0; i < slot_count; i++)
+	{
+		fprintf(fp, "\t{ %u, %d, %u, %u },\n", slots[i].start, slots[i].release,
+			slots[i].task, slots[i].flags);
+	}
+	fprintf(fp, "};\n\n");
+
+	fprintf(fp, "const OS_StaticSchedule g_static_schedule =\n{\n");
+	fprintf(fp, "\t%u,\n\t%u,\n\t%u,\n\ttasks,\n\tslots\n};\n", hyperperiod, task_count, slot_count);
+}
+
+int main(int argc, char * argv[])
+{
+	Job jobs[OS_STATIC_MAX_TASKS], start[OS_STATIC_MAX_TASKS];
+	UINT64 usage = 0;
+	UINT32 pass, i;
+	FILE * fp = stdout;
+
+	if((argc < 2) || (argc > 3))
+	{
+		fprintf(stderr, "Usage: %s <task manifest> [output file]\n", argv[0]);
+		return 1;
+	}
+
+	if(readManifest(argv[1]) || !task_count)
+	{
+		if(!task_count) fprintf(stderr, "%s: No tasks\n", argv[1]);
+		return 1;
+	}
+
+	hyperperiod = getHyperperiod();
+	if(!hyperperiod || (hyperperiod > 0x7FFFFFFF))
+	{
+		fprintf(stderr, "The hyperperiod is too long\n");
+		return 1;
+	}
+
+	// Repeat the hyperperiod until the jobs carried over to the next one do not change
+	memset(jobs, 0, sizeof(jobs));
+	for(pass = 0; pass < MAX_PASSES; pass++)
+	{
+		memcpy(start, jobs, sizeof(jobs));
+		if(runHyperperiod(jobs)) return 1;
+		if(!memcmp(start, jobs, sizeof(jobs))) break;
+	}
+
+	if(pass == MAX_PASSES)
+	{
+		fprintf(stderr, "The schedule does not repeat after %d hyperperiods\n", MAX_PASSES);
+		return 1;
+	}
+
+	if(argc == 3)
+	{
+		fp = fopen(argv[2], "w");
+		if(!fp)
+		{
+			fprintf(stderr, "Could not create %s\n", argv[2]);
+			return 1;
+		}
+	}
+
+	writeTable(fp, argv[1]);
+	if(fp != stdout) fclose(fp);
+
+	for(i = 0; i < task_count; i++)
+	{
+		usage += (UINT64) tasks[i].budget * (hyperperiod / tasks[i].period);
+	}
+
+	fprintf(stderr, "Hyperperiod %u us, %u slots, CPU usage %.2f%%\n", hyperperiod, slot_count,
+		100.0 * usage / hyperperiod);
+
+	free(slots);
+	return 0;
+}
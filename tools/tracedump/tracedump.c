@@ -0,0 +1,376 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	tracedump.c
+//	Author:	Bala bhat (bhat.balasubramanya@gmail.com)
+//
+//	Description: This tool converts a dump of the kernel scheduler trace buffer
+//	(g_trace_buffer, see os_trace_format.h) into the Chrome trace event JSON format.
+//	The output can be opened in chrome://tracing or in the Perfetto UI. Each task is
+//	shown as a thread with its running slices, system calls and scheduler events.
+//	The timer interrupts are shown on a separate "IRQ" thread.
+//
+//	Usage: tracedump <trace dump> [output file]
+//
+//	The dump is the raw memory of g_trace_buffer, for example from the debugger:
+//		dump binary memory trace.bin &g_trace_buffer (char *)&g_trace_buffer + sizeof(g_trace_buffer)
+//	or from the scheduler simulator with sched_sim -d.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "os_trace_format.h"
+
+// Thread IDs of the events that do not belong to a task
+#define TID_KERNEL			OS_TRACE_NO_TASK
+#define TID_IRQ				(OS_TRACE_NO_TASK + 1)
+
+// Open slices of a task
+typedef struct
+{
+	double run_start;			// Start of the running slice or < 0
+	double syscall_start;		// Start of the system call slice or < 0
+	UINT32 syscall;
+
+} TaskState;
+
+static const char * event_names[TRACE_EVENT_COUNT] =
+{
+	NULL,
+	"release",
+	"dispatch",
+	"preempted",
+	"job end",
+	"yield",
+	"blocked",
+	"unblocked",
+	"task end",
+	"TBE",
+	"deadline miss",
+	"sem wait",
+	"sem post",
+	"syscall enter",
+	"syscall exit",
+	"IRQ"
+};
+
+static UINT8 * dump;
+static const OS_TraceHeader * header;
+static TaskState * tasks;
+static FILE * out;
+static BOOL first_event = TRUE;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Reads the whole dump. Returns the size or 0 on error
+//////////////////////////////////////////////////////////////////////////////////////////
+static long readDump(const char * path)
+{
+	FILE * fp = fopen(path, "rb");
+	long size;
+
+	if(!fp)
+	{
+		fprintf(stderr, "Could not open %s\n", path);
+		return 0;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	dump = (UINT8 *) malloc(size > 0 ? size : 1);
+	if(!dump || (size <= 0) || (fread(dump, size, 1, fp) != 1))
+	{
+		fprintf(stderr, "Could not read %s\n", path);
+		fclose(fp);
+		return 0;
+	}
+
+	fclose(fp);
+	return size;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Checks that the header describes a buffer that fits in the dump. Returns 0 if so
+//////////////////////////////////////////////////////////////////////////////////////////
+static int checkHeader(long size)
+{
+	header = (const OS_TraceHeader *) dump;
+
+	if((size < (long) sizeof(OS_TraceHeader)) || (header->magic != OS_TRACE_MAGIC))
+	{
+		fprintf(stderr, "Not a trace dump\n");
+		return -1;
+	}
+
+	if((header->version != OS_TRACE_VERSION) || (header->record_size != sizeof(OS_TraceRecord)))
+	{
+		fprintf(stderr, "Trace version %u with %u byte records is not supported\n",
+			header->version, header->record_size);
+		return -1;
+	}
+
+	if(!header->timestamp_freq || !header->record_count ||
+		(header->record_count & (header->record_count - 1)) ||
+		((UINT64) header->names_offset + (UINT64) header->task_count * header->name_size > (UINT64) size) ||
+		((UINT64) header->records_offset + (UINT64) header->record_count * sizeof(OS_TraceRecord) > (UINT64) size))
+	{
+		fprintf(stderr, "The trace header is not valid or the dump is truncated\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Writes a JSON string. The task names come from the target as they are
+//////////////////////////////////////////////////////////////////////////////////////////
+static void writeString(const char * str, UINT32 max)
+{
+	UINT32 i;
+
+	fputc('"', out);
+	for(i = 0; (i < max) && str[i]; i++)
+	{
+		if((str[i] == '"') || (str[i] == '\\'))
+			fprintf(out, "\\%c", str[i]);
+		else if((unsigned char) str[i] < 0x20)
+			fprintf(out, "\\u%04x", (unsigned char) str[i]);
+		else
+			fputc(str[i], out);
+	}
+	fputc('"', out);
+}
+
+static void beginEvent(void)
+{
+	fprintf(out, first_event ? "\n" : ",\n");
+	first_event = FALSE;
+}
+
+static void writeThreadName(UINT32 tid, const char * name, UINT32 max)
+{
+	beginEvent();
+	fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", tid);
+	writeString(name, max);
+	fprintf(out, "}}");
+}
+
+// Instant event of a thread
+static void writeInstant(UINT32 tid, const char * name, double ts, const char * arg_name, UINT32 arg)
+{
+	beginEvent();
+	fprintf(out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f", name, tid, ts);
+	if(arg_name) fprintf(out, ",\"args\":{\"%s\":%u}", arg_name, arg);
+	fprintf(out, "}");
+}
+
+// Complete event (slice) of a thread
+static void writeSlice(UINT32 tid, const char * name, double start, double end, const char * arg_name, UINT32 arg)
+{
+	beginEvent();
+	fprintf(out, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+		name, tid, start, end - start);
+	if(arg_name) fprintf(out, ",\"args\":{\"%s\":%u}", arg_name, arg);
+	fprintf(out, "}");
+}
+
+static void closeSyscall(UINT32 task, double ts)
+{
+	if(tasks[task].syscall_start >= 0)
+	{
+		writeSlice(task, "syscall", tasks[task].syscall_start, ts, "id", tasks[task].syscall);
+		tasks[task].syscall_start = -1;
+	}
+}
+
+static void closeRun(UINT32 task, double ts)
+{
+	closeSyscall(task, ts);
+	if(tasks[task].run_start >= 0)
+	{
+		writeSlice(task, "running", tasks[task].run_start, ts, NULL, 0);
+		tasks[task].run_start = -1;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Converts the records in the order they were written. Returns the number of records
+//////////////////////////////////////////////////////////////////////////////////////////
+static UINT32 convertRecords(UINT32 * torn)
+{
+	const OS_TraceRecord * records = (const OS_TraceRecord *)(dump + header->records_offset);
+	UINT32 first = (header->next_seq > header->record_count) ? (header->next_seq - header->record_count) : 0;
+	UINT32 seq, task, running = OS_TRACE_NO_TASK, count = 0;
+	UINT32 last_raw = 0;
+	INT64 ticks = 0;
+	double ts = 0;
+
+	for(seq = first; seq != header->next_seq; seq++)
+	{
+		const OS_TraceRecord * record = &records[seq & (header->record_count - 1)];
+
+		// The record was being written or overwritten when the buffer was read
+		if((record->seq != seq) || !record->event || (record->event >= TRACE_EVENT_COUNT))
+		{
+			(*torn)++;
+			continue;
+		}
+
+		// The timestamps wrap around. An interrupted writer can take its timestamp
+		// before a later record. So the difference is signed
+		if(count) ticks += (INT32)(record->timestamp - last_raw);
+		last_raw = record->timestamp;
+		ts = (double) ticks * 1000000.0 / header->timestamp_freq;
+		count++;
+
+		task = record->task;
+		if((task != OS_TRACE_NO_TASK) && (task >= header->task_count))
+		{
+			(*torn)++;
+			continue;
+		}
+
+		switch(record->event)
+		{
+		case TRACE_DISPATCH:
+			if((running != OS_TRACE_NO_TASK) && (running != task)) closeRun(running, ts);
+			if(task == OS_TRACE_NO_TASK) break;
+			if(tasks[task].run_start < 0) tasks[task].run_start = ts;
+			running = task;
+			break;
+
+		case TRACE_PREEMPT:
+		case TRACE_JOB_END:
+		case TRACE_YIELD:
+		case TRACE_BLOCK:
+		case TRACE_TASK_END:
+			if(task == OS_TRACE_NO_TASK) break;
+			closeRun(task, ts);
+			if(running == task) running = OS_TRACE_NO_TASK;
+			writeInstant(task, event_names[record->event], ts,
+				(record->event == TRACE_PREEMPT) ? "next task" :
+				(record->event == TRACE_JOB_END) ? "jobs" : NULL, record->arg);
+			break;
+
+		case TRACE_SYSCALL_ENTER:
+			if(task == OS_TRACE_NO_TASK) break;
+			closeSyscall(task, ts);
+			tasks[task].syscall_start = ts;
+			tasks[task].syscall = record->arg;
+			break;
+
+		case TRACE_SYSCALL_EXIT:
+			if(task == OS_TRACE_NO_TASK) break;
+			closeSyscall(task, ts);
+			break;
+
+		case TRACE_IRQ:
+			writeInstant(TID_IRQ, record->arg ? "budget timer" : "periodic timer", ts, "task", task);
+			break;
+
+		case TRACE_RELEASE:
+			writeInstant((task == OS_TRACE_NO_TASK) ? TID_KERNEL : task, "release", ts, "deadline", record->arg);
+			break;
+
+		case TRACE_TBE:
+		case TRACE_DEADLINE_MISS:
+			writeInstant((task == OS_TRACE_NO_TASK) ? TID_KERNEL : task, event_names[record->event], ts,
+				"count", record->arg);
+			break;
+
+		case TRACE_SEM_WAIT:
+		case TRACE_SEM_POST:
+			writeInstant((task == OS_TRACE_NO_TASK) ? TID_KERNEL : task, event_names[record->event], ts,
+				"sem", record->arg);
+			break;
+
+		default:
+			writeInstant((task == OS_TRACE_NO_TASK) ? TID_KERNEL : task, event_names[record->event], ts, NULL, 0);
+			break;
+		}
+	}
+
+	// Close the slices still open at the end of the trace
+	for(task = 0; task < header->task_count; task++)
+	{
+		closeRun(task, ts);
+	}
+
+	return count;
+}
+
+int main(int argc, char * argv[])
+{
+	const char * names;
+	long size;
+	UINT32 i, count, torn = 0;
+
+	if((argc < 2) || (argc > 3))
+	{
+		fprintf(stderr, "Usage: %s <trace dump> [output file]\n", argv[0]);
+		return 1;
+	}
+
+	size = readDump(argv[1]);
+	if(!size || checkHeader(size))
+	{
+		return 1;
+	}
+
+	out = stdout;
+	if(argc == 3)
+	{
+		out = fopen(argv[2], "w");
+		if(!out)
+		{
+			fprintf(stderr, "Could not create %s\n", argv[2]);
+			return 1;
+		}
+	}
+
+	tasks = (TaskState *) malloc(header->task_count * sizeof(TaskState));
+	if(!tasks)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	for(i = 0; i < header->task_count; i++)
+	{
+		tasks[i].run_start = -1;
+		tasks[i].syscall_start = -1;
+	}
+
+	fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+	beginEvent();
+	fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"chARM\"}}");
+	writeThreadName(TID_KERNEL, "kernel", 16);
+	writeThreadName(TID_IRQ, "IRQ", 16);
+
+	names = (const char *)(dump + header->names_offset);
+	for(i = 0; i < header->task_count; i++)
+	{
+		if(names[i * header->name_size]) writeThreadName(i, &names[i * header->name_size], header->name_size);
+	}
+
+	count = convertRecords(&torn);
+
+	fprintf(out, "\n]}\n");
+	if(out != stdout) fclose(out);
+
+	fprintf(stderr, "%u events", count);
+	if(header->next_seq > header->record_count)
+		fprintf(stderr, ", %u older events overwritten", header->next_seq - header->record_count);
+	if(torn)
+		fprintf(stderr, ", %u incomplete records skipped", torn);
+	fprintf(stderr, "\n");
+
+	free(tasks);
+	free(dump);
+	return 0;
+}
@@ -0,0 +1,250 @@
+/**********************************************************************************
+ *
+ *						Copyright 2014 xxxxxxx, xxxxxxx
+ *	File:	main.c
+ *	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+ *	Description: Benchmark for the os_queue priority queue backends
+ *					The queues are driven the same way as the EDF scheduler drives
+ *					g_wait_q and g_ready_q. The task set is feasible, so every job
+ *					completes before its deadline and most tasks wait for their next
+ *					release in the wait queue. Each periodic tick releases the jobs
+ *					from the wait queue, then the ready jobs run in the order of
+ *					their deadlines for one tick and the completed jobs yield. Some
+ *					tasks are taken out of the queues and put back in between.
+ *					The average, p99.9 and worst costs are reported for each release ISR,
+ *					each yield and each delete.
+ *
+ *********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Select the backend given on the command line instead of the one in os_config.h
+#include "os_config.h"
+#undef OS_PQUEUE_BACKEND
+#define OS_PQUEUE_BACKEND	BENCH_PQUEUE_BACKEND
+
+#define ASSERT(x)
+
+// os_queue.c only needs ASSERT from os_core.h. Skip the rest of the kernel headers
+#define _OS_CORE_H
+
+#include "os_queue.c"		// Directly include the source file for os_queue
+
+#define TICK_US					1000
+#define SIMULATED_TICKS			200000
+#define DELETE_EVERY_N_TICKS	4
+#define BLOCKED_TICKS			10
+#define UTILIZATION				0.9
+#define COST_BUCKET_NS			10
+#define COST_BUCKETS			4096		// The last bucket has all the longer ones
+
+typedef enum
+{
+	IN_WAIT_Q,
+	IN_READY_Q,
+	BLOCKED
+
+} Bench_TaskState;
+
+typedef struct
+{
+	_OS_HybridQNode 	qp;		// Should be the first element
+	UINT32				period;
+	UINT32				budget;
+	UINT32				remaining;
+	UINT64				release;
+	UINT64				unblock;
+	Bench_TaskState		state;
+
+} Bench_Task;
+
+typedef struct
+{
+	UINT64				total;
+	UINT64				worst;
+	UINT64				count;
+	UINT32				histogram[COST_BUCKETS];
+
+} Bench_Cost;
+
+static _OS_Queue wait_q;
+static _OS_Queue ready_q;
+
+static UINT64 now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void add_cost(Bench_Cost * cost, UINT64 start)
+{
+	UINT64 elapsed = now_ns() - start;
+
+	cost->total += elapsed;
+	cost->count++;
+	if(elapsed > cost->worst) cost->worst = elapsed;
+	cost->histogram[(elapsed < COST_BUCKET_NS * COST_BUCKETS) ? 
+		(elapsed / COST_BUCKET_NS) : (COST_BUCKETS - 1)]++;
+}
+
+// Returns the cost below which the given permille of the calls are
+static UINT64 cost_percentile(const Bench_Cost * cost, UINT32 permille)
+{
+	UINT64 limit = (cost->count * permille + 999) / 1000, sum = 0;
+	UINT32 i;
+
+	for(i = 0; i < COST_BUCKETS; i++)
+	{
+		sum += cost->histogram[i];
+		if(sum && (sum >= limit)) break;
+	}
+
+	return (i < COST_BUCKETS) ? (i + 1) * COST_BUCKET_NS : cost->worst;
+}
+
+// The worst case on the host includes its own interrupts. The p99.9 cost is steadier
+static void print_cost(const char * name, const Bench_Cost * cost)
+{
+	printf("    %-8s %9llu calls, %8.1f ns avg, %8llu ns p99.9, %8llu ns worst\n", name, cost->count,
+		cost->count ? (double)cost->total / cost->count : 0.0, cost_percentile(cost, 999), cost->worst);
+}
+
+static void run_benchmark(UINT32 task_count)
+{
+	static const UINT32 periods[] = { 1, 2, 4, 5, 8, 10, 20, 40, 50, 100 };
+	Bench_Task * tasks = (Bench_Task *) calloc(task_count, sizeof(Bench_Task));
+	UINT32 * weights = (UINT32 *) calloc(task_count, sizeof(UINT32));
+	Bench_Task * task;
+	static Bench_Cost release, yield, delete;
+	UINT64 current = 0, key, start, weight_sum = 0;
+	UINT32 i, tick, cpu, run, max_ready = 0, max_wait = 0;
+	double utilization = 0;
+
+	memset(&release, 0, sizeof(release));
+	memset(&yield, 0, sizeof(yield));
+	memset(&delete, 0, sizeof(delete));
+	_OS_QueueInit(&wait_q);
+	_OS_QueueInit(&ready_q);
+	srand(1234);
+
+	// Each task gets a random share of the total utilization. The budgets are rounded
+	// down, so the task set stays feasible under EDF
+	for(i = 0; i < task_count; i++)
+	{
+		weights[i] = 1 + rand() % 100;
+		weight_sum += weights[i];
+	}
+
+	for(i = 0; i < task_count; i++)
+	{
+		tasks[i].period = periods[rand() % (sizeof(periods) / sizeof(periods[0]))] * TICK_US;
+		tasks[i].budget = (UINT32)(UTILIZATION * weights[i] * tasks[i].period / weight_sum);
+		if(!tasks[i].budget) tasks[i].budget = 1;
+		utilization += (double)tasks[i].budget / tasks[i].period;
+		tasks[i].release = (rand() % 10) * TICK_US;
+		tasks[i].state = IN_WAIT_Q;
+		_OS_PQueueInsertWithKey(&wait_q, (_OS_HybridQNode *)&tasks[i], tasks[i].release);
+	}
+
+	if(utilization >= 1)
+	{
+		printf("  tasks %4d: The task set is not feasible (utilization %.3f)\n", task_count, utilization);
+		exit(1);
+	}
+
+	for(tick = 0; tick < SIMULATED_TICKS; tick++, current += TICK_US)
+	{
+		// Release all jobs whose release time has arrived (_OS_PeriodicTimerISR)
+		start = now_ns();
+		while(_OS_QueuePeekWithKey(&wait_q, (_OS_HybridQNode **)&task, &key) && (key <= current))
+		{
+			_OS_PQueueGet(&wait_q, NULL);
+			_OS_PQueueInsertWithKey(&ready_q, (_OS_HybridQNode *)task, task->release + task->period);
+			task->remaining = task->budget;
+			task->state = IN_READY_Q;
+		}
+		add_cost(&release, start);
+
+		if(ready_q.count > max_ready) max_ready = ready_q.count;
+		if(wait_q.count > max_wait) max_wait = wait_q.count;
+
+		// The ready jobs run in the order of their deadlines till the next tick. A job
+		// that completes waits for its next release (_OS_TaskYield)
+		for(cpu = TICK_US; cpu && _OS_QueuePeek(&ready_q, (_OS_HybridQNode **)&task); cpu -= run)
+		{
+			run = (task->remaining < cpu) ? task->remaining : cpu;
+			task->remaining -= run;
+			if(task->remaining) continue;
+
+			start = now_ns();
+			_OS_PQueueGet(&ready_q, NULL);
+			task->release += task->period;
+			_OS_PQueueInsertWithKey(&wait_q, (_OS_HybridQNode *)task, task->release);
+			task->state = IN_WAIT_Q;
+			add_cost(&yield, start);
+		}
+
+		// A job left over at the tick is past its deadline only if the set is not feasible
+		if(_OS_QueuePeekWithKey(&ready_q, (_OS_HybridQNode **)&task, &key) && (key <= current + TICK_US))
+		{
+			printf("  tasks %4d: Deadline miss at %llu us\n", task_count, current + TICK_US);
+			exit(1);
+		}
+
+		// Every few ticks, a random task is taken out of its queue wherever it is
+		// (_OS_PQueueDelete) and put back in the wait queue some ticks later
+		if((tick % DELETE_EVERY_N_TICKS) == 0)
+		{
+			task = &tasks[rand() % task_count];
+			if(task->state != BLOCKED) {
+				start = now_ns();
+				_OS_PQueueDelete((task->state == IN_READY_Q) ? &ready_q : &wait_q, (_OS_HybridQNode *)task);
+				add_cost(&delete, start);
+				task->state = BLOCKED;
+				task->unblock = current + BLOCKED_TICKS * TICK_US;
+			}
+		}
+
+		for(i = 0; i < task_count; i++)
+		{
+			task = &tasks[i];
+			if((task->state == BLOCKED) && (task->unblock <= current)) {
+				// Skip the releases missed while blocked
+				while(task->release <= current) task->release += task->period;
+				_OS_PQueueInsertWithKey(&wait_q, (_OS_HybridQNode *)task, task->release);
+				task->state = IN_WAIT_Q;
+			}
+		}
+	}
+
+	printf("  tasks %4d: utilization %.3f, up to %u ready and %u waiting tasks\n",
+		task_count, utilization, max_ready, max_wait);
+	print_cost("release", &release);
+	print_cost("yield", &yield);
+	print_cost("delete", &delete);
+
+	free(weights);
+	free(tasks);
+}
+int main(void)
+{
+	static const UINT32 task_counts[] = { 8, 64, 256 };
+	UINT32 i;
+
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+	printf("Backend: pairing heap\n");
+#else
+	printf("Backend: sorted list\n");
+#endif
+
+	for(i = 0; i < sizeof(task_counts) / sizeof(task_counts[0]); i++)
+	{
+		run_benchmark(task_counts[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,451 @@
+/**********************************************************************************
+ *
+ *						Copyright 2014 xxxxxxx, xxxxxxx
+ *	File:	main.c
+ *	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+ *	Description: Discrete event simulator for the EDF scheduler
+ *					The kernel scheduler (os_sched.c, os_task.c, os_queue.c, os_sem.c
+ *					and os_mutex.c) runs on the host against simulated timers. A task set
+ *					is replayed for a long simulated time and the deadline misses,
+ *					TBEs, preemptions and the scheduler cost per event are reported.
+ *
+ *	Usage: sched_sim [-t seconds] [-s seed] [-d trace file] [-b | -l | -f] <taskset file>
+ *
+ *	Each line of the task set file describes one periodic task. All times are in us:
+ *		<name> <period> <deadline> <budget> <phase> <exec_min> <exec_max> [policy]
+ *	The optional overrun policy is "abort" and / or "skip <releases>". Without it
+ *	a late job continues into the next period. With "lock <index> <offset> <length>"
+ *	each job holds the lock for length us of its execution, starting after offset us.
+ *	The tasks with the same index share the lock. It is a mutex, whose ceiling is the
+ *	shortest deadline of these tasks, or a binary semaphore with -b. With -b, the
+ *	wait on the semaphore times out after "timeout <us>" or at the job deadline with
+ *	"timeout dline". A job whose wait timed out skips its critical section. A job
+ *	aborted in its critical section gives up the mutex, which is not possible with -b.
+ *	With -l, the mutexes learn their ceilings as the tasks lock them. So the first jobs
+ *	wait for the locks until every task has locked once. With -f, the locks are user space
+ *	locks, which enter the kernel only when they are contended. The kernel does not know
+ *	who holds them, so a task that aborts its jobs is expected to be rejected with -f,
+ *	unless it is in a process reservation. With "bound <us>" every job
+ *	of the task should respond within that time, which is counted like a miss.
+ *	With "start <us>" the task is created at that time instead of at the start and
+ *	its phase is counted from there. With "end <jobs>" the task ends for good after
+ *	that many completed jobs, which frees its CPU reservation. A task marked "reject"
+ *	is expected to fail the admission test.
+ *	or an aperiodic task that never yields, served by a Constant Bandwidth Server:
+ *		cbs <name> <period> <budget>
+ *	or a process with a CPU reservation. The tasks on the following lines belong
+ *	to that process:
+ *		process <name> <period> <budget>
+ *	or a high / low criticality task for the mixed criticality scheduling:
+ *		hi <name> <period> <deadline> <budget> <hi_budget> <phase> <exec_min> <exec_max> [policy]
+ *		lo <name> <period> <deadline> <budget> <phase> <exec_min> <exec_max> [policy]
+ *	The low criticality jobs dropped in the high criticality mode are aborted. A dropped
+ *	job that goes on past a later release of its task is counted like a miss.
+ *	Lines starting with '#' are ignored.
+ *
+ *	With -d, the scheduler trace is written to the file for tools/tracedump. The
+ *	simulator should be built with TRACE=1. The last OS_TRACE_BUFFER_SIZE events
+ *	are kept, so use a short simulated time.
+ *
+ *********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "sim.h"
+
+#define DEFAULT_DURATION_SEC	1000
+#define DEFAULT_SEED			1234
+
+static Sim_TaskSpec tasks[SIM_MAX_TASKS];
+static Sim_Result result;
+
+///////////////////////////////////////////////////////////////////////////////
+// Kernel logging functions
+///////////////////////////////////////////////////////////////////////////////
+void panic(const INT8 *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+
+	exit(1);
+}
+
+void SyslogStr(const INT8 * str, const INT8 * value)
+{
+	printf("%s%s\n", str, value ? value : "");
+}
+
+void Syslog32(const INT8 * str, UINT32 value)
+{
+	printf("%s%u\n", str, value);
+}
+
+void Syslog64(const INT8 * str, UINT64 value)
+{
+	printf("%s%llu\n", str, value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes the scheduler trace buffer to the file. Returns 0 on success
+///////////////////////////////////////////////////////////////////////////////
+static INT32 write_trace(const char * path)
+{
+	UINT32 size;
+	const void * trace = Sim_GetTrace(&size);
+	FILE * fp;
+
+	if(!trace)
+	{
+		fprintf(stderr, "Build the simulator with TRACE=1 to record the trace\n");
+		return -1;
+	}
+
+	fp = fopen(path, "wb");
+	if(!fp || (fwrite(trace, size, 1, fp) != 1))
+	{
+		fprintf(stderr, "Could not write %s\n", path);
+		if(fp) fclose(fp);
+		return -1;
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reads the overrun policy and the lock at the end of a periodic task line.
+// Returns 0 on success
+///////////////////////////////////////////////////////////////////////////////
+static INT32 parse_task_options(const char * ptr, Sim_TaskSpec * spec)
+{
+	char word[16];
+	int used;
+
+	while(sscanf(ptr, "%15s%n", word, &used) == 1)
+	{
+		ptr += used;
+		if(!strcmp(word, "abort"))
+		{
+			spec->abort = TRUE;
+		}
+		else if(!strcmp(word, "skip") && (sscanf(ptr, "%u%n", &spec->skip, &used) == 1) && spec->skip)
+		{
+			ptr += used;
+		}
+		else if(!strcmp(word, "lock") && (sscanf(ptr, "%d %u %u%n", &spec->lock, &spec->lock_offset,
+			&spec->lock_length, &used) == 3) && (spec->lock >= 0) && (spec->lock < SIM_MAX_LOCKS))
+		{
+			ptr += used;
+		}
+		else if(!strcmp(word, "start") && (sscanf(ptr, "%u%n", &spec->start, &used) == 1))
+		{
+			ptr += used;
+		}
+		else if(!strcmp(word, "end") && (sscanf(ptr, "%u%n", &spec->end, &used) == 1) && spec->end)
+		{
+			ptr += used;
+		}
+		else if(!strcmp(word, "bound") && (sscanf(ptr, "%u%n", &spec->bound, &used) == 1) && spec->bound)
+		{
+			ptr += used;
+		}
+		else if(!strcmp(word, "reject"))
+		{
+			spec->reject = TRUE;
+		}
+		else if(!strcmp(word, "timeout") && (sscanf(ptr, "%15s%n", word, &used) == 1))
+		{
+			ptr += used;
+			spec->lock_timeout = strcmp(word, "dline") ? strtoul(word, NULL, 0) : SIM_TIMEOUT_DEADLINE;
+			if(!spec->lock_timeout) return -1;
+		}
+		else
+		{
+			return -1;
+		}
+	}
+
+	return (spec->lock_timeout && (spec->lock < 0)) ? -1 : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reads the task set. Returns the number of tasks or -1 on error
+///////////////////////////////////////////////////////////////////////////////
+static INT32 load_taskset(const char * path)
+{
+	FILE * fp = fopen(path, "r");
+	char line[256];
+	INT32 count = 0, lineno = 0, group = -1;
+
+	if(!fp)
+	{
+		fprintf(stderr, "Could not open %s\n", path);
+		return -1;
+	}
+
+	while(fgets(line, sizeof(line), fp))
+	{
+		Sim_TaskSpec * spec = &tasks[count];
+		char * ptr = line;
+		int used = 0;
+
+		lineno++;
+		while(*ptr == ' ' || *ptr == '\t') ptr++;
+		if(*ptr == '#' || *ptr == '\n' || *ptr == '\r' || *ptr == '\0') continue;
+
+		if(count == SIM_MAX_TASKS)
+		{
+			fprintf(stderr, "%s:%d: More than %d tasks\n", path, lineno, SIM_MAX_TASKS);
+			fclose(fp);
+			return -1;
+		}
+
+		spec->group = group;
+		spec->lock = -1;
+		
+		if(!strncmp(ptr, "process", 7) && (ptr[7] == ' ' || ptr[7] == '\t'))
+		{
+			spec->process = TRUE;
+			spec->group = -1;
+			group = count;
+			if(sscanf(ptr + 7, "%15s %u %u", spec->name, &spec->period, &spec->budget) != 3)
+			{
+				fprintf(stderr, "%s:%d: Invalid process specification\n", path, lineno);
+				fclose(fp);
+				return -1;
+			}
+		}
+		else if(!strncmp(ptr, "cbs", 3) && (ptr[3] == ' ' || ptr[3] == '\t'))
+		{
+			spec->cbs = TRUE;
+			if(sscanf(ptr + 3, "%15s %u %u", spec->name, &spec->period, &spec->budget) != 3)
+			{
+				fprintf(stderr, "%s:%d: Invalid CBS task specification\n", path, lineno);
+				fclose(fp);
+				return -1;
+			}
+		}
+		else if(!strncmp(ptr, "hi", 2) && (ptr[2] == ' ' || ptr[2] == '\t'))
+		{
+			spec->mixed = spec->high = TRUE;
+			if(sscanf(ptr + 2, "%15s %u %u %u %u %u %u %u%n", spec->name, &spec->period, &spec->deadline,
+				&spec->budget, &spec->budget_hi, &spec->phase, &spec->exec_min, &spec->exec_max, &used) != 8
+				|| spec->exec_min > spec->exec_max || parse_task_options(ptr + 2 + used, spec))
+			{
+				fprintf(stderr, "%s:%d: Invalid high criticality task specification\n", path, lineno);
+				fclose(fp);
+				return -1;
+			}
+		}
+		else if(!strncmp(ptr, "lo", 2) && (ptr[2] == ' ' || ptr[2] == '\t'))
+		{
+			spec->mixed = TRUE;
+			if(sscanf(ptr + 2, "%15s %u %u %u %u %u %u%n", spec->name, &spec->period, &spec->deadline,
+				&spec->budget, &spec->phase, &spec->exec_min, &spec->exec_max, &used) != 7
+				|| spec->exec_min > spec->exec_max || parse_task_options(ptr + 2 + used, spec))
+			{
+				fprintf(stderr, "%s:%d: Invalid low criticality task specification\n", path, lineno);
+				fclose(fp);
+				return -1;
+			}
+			spec->budget_hi = spec->budget;
+		}
+		else if(sscanf(ptr, "%15s %u %u %u %u %u %u%n", spec->name, &spec->period, &spec->deadline,
+			&spec->budget, &spec->phase, &spec->exec_min, &spec->exec_max, &used) != 7
+			|| spec->exec_min > spec->exec_max || parse_task_options(ptr + used, spec))
+		{
+			fprintf(stderr, "%s:%d: Invalid task specification\n", path, lineno);
+			fclose(fp);
+			return -1;
+		}
+
+		count++;
+	}
+
+	fclose(fp);
+	return count;
+}
+
+// Returns the cost below which the given permille of the events are
+static UINT64 event_cost_percentile(const Sim_EventCost * cost, UINT32 permille)
+{
+	UINT64 limit = (cost->count * permille + 999) / 1000, sum = 0;
+	UINT32 i;
+
+	for(i = 0; i < SIM_COST_BUCKETS; i++)
+	{
+		sum += cost->histogram[i];
+		if(sum && (sum >= limit)) break;
+	}
+
+	return (i < SIM_COST_BUCKETS) ? (i + 1) * SIM_COST_BUCKET_NS : cost->max_ns;
+}
+
+static void print_event_cost(const char * name, const Sim_EventCost * cost)
+{
+	printf("  %-16s %12llu events, %8.1f ns avg, %8llu ns p99, %8llu ns p99.9, %8llu ns worst\n",
+		name, cost->count, cost->count ? (double)cost->total_ns / cost->count : 0.0,
+		event_cost_percentile(cost, 990), event_cost_percentile(cost, 999), cost->max_ns);
+}
+
+int main(int argc, char * argv[])
+{
+	UINT64 duration_sec = DEFAULT_DURATION_SEC;
+	UINT32 seed = DEFAULT_SEED;
+	const char * path = NULL;
+	const char * trace_path = NULL;
+	UINT32 locks = SIM_LOCKS_MUTEX;
+	UINT32 total_misses = 0, admission_errors = 0;
+	BOOL has_locks = FALSE;
+	INT32 count, i;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "-t") && (i + 1 < argc))
+			duration_sec = strtoull(argv[++i], NULL, 0);
+		else if(!strcmp(argv[i], "-s") && (i + 1 < argc))
+			seed = strtoul(argv[++i], NULL, 0);
+		else if(!strcmp(argv[i], "-d") && (i + 1 < argc))
+			trace_path = argv[++i];
+		else if(!strcmp(argv[i], "-b"))
+			locks = SIM_LOCKS_SEMAPHORE;
+		else if(!strcmp(argv[i], "-l"))
+			locks = SIM_LOCKS_LEARNT_MUTEX;
+		else if(!strcmp(argv[i], "-f"))
+			locks = SIM_LOCKS_FUTEX;
+		else
+			path = argv[i];
+	}
+
+	if(!path || !duration_sec)
+	{
+		fprintf(stderr, "Usage: %s [-t seconds] [-s seed] [-d trace file] [-b | -l | -f] <taskset file>\n", argv[0]);
+		return 1;
+	}
+
+	count = load_taskset(path);
+	if(count < 0) return 1;
+
+	// The kernel unlocks the mutexes of an aborted job. It does not know the holder of
+	// a binary semaphore. So a job aborted in its critical section would keep the lock
+	for(i = 0; i < count; i++)
+	{
+		if((locks == SIM_LOCKS_SEMAPHORE) && tasks[i].abort && (tasks[i].lock >= 0))
+		{
+			fprintf(stderr, "%s: The task %s cannot abort its jobs with a binary semaphore\n",
+				path, tasks[i].name);
+			return 1;
+		}
+
+		if(tasks[i].lock >= 0) has_locks = TRUE;
+	}
+
+	// Nor does it know the holder of a user space lock. So it refuses to abort the jobs
+	// in the process of the locks, which is the process of the tasks outside a reservation
+	for(i = 0; i < count; i++)
+	{
+		if((locks == SIM_LOCKS_FUTEX) && has_locks && tasks[i].abort && (tasks[i].group < 0))
+		{
+			tasks[i].reject = TRUE;
+		}
+	}
+
+	srand(seed);
+	Sim_Run(tasks, count, duration_sec * 1000000ull, locks, &result);
+	if(trace_path && write_trace(trace_path)) return 1;
+
+	printf("Task set: %s, seed %u%s\n", path, seed, (locks == SIM_LOCKS_SEMAPHORE) ? 
+		", binary semaphores for the locks" : (locks == SIM_LOCKS_LEARNT_MUTEX) ? ", learnt mutex ceilings" :
+		(locks == SIM_LOCKS_FUTEX) ? ", user space locks" : "");
+	printf("Simulated %llu us, idle %.2f%%, %u context switches\n", result.simulated_us,
+		100.0 * result.idle_us / result.simulated_us, result.context_switches);
+	if(result.mode_switches)
+		printf("Switched to the high criticality mode %u times\n", result.mode_switches);
+
+	printf("\n%-16s %8s %8s %8s %10s %8s %10s %8s %8s %10s %10s %10s %10s\n", "task", "period", "budget",
+		"jobs", "completed", "late", "dline_miss", "TBE", "skipped", "preempted", "avg_resp", "max_resp",
+		"max_jitter");
+
+	for(i = 0; i < count; i++)
+	{
+		const Sim_TaskResult * task = &result.tasks[i];
+
+		// A task that needs a feature left out of the build is neither admitted nor rejected
+		if(!task->unsupported && ((task->create_status != 0) != tasks[i].reject))
+		{
+			printf("%-16s %8u %8u   expected to be %s\n", tasks[i].name, tasks[i].period,
+				tasks[i].budget, tasks[i].reject ? "rejected" : "admitted");
+			admission_errors++;
+		}
+
+		if(task->create_status != 0)
+		{
+			printf("%-16s %8u %8u   not admitted (error %d)\n", tasks[i].name,
+				tasks[i].period, tasks[i].budget, task->create_status);
+			continue;
+		}
+
+		if(tasks[i].process)
+		{
+			// The CPU time of the process and the budget exhaustions of its server
+			printf("%-16s %8u %8u   process, cpu %.2f%%, %u budget exhaustions, %u deadline misses\n",
+				tasks[i].name, tasks[i].period, tasks[i].budget,
+				100.0 * task->cpu_us / result.simulated_us, task->TBE_count, task->dline_miss_count);
+			total_misses += task->dline_miss_count;
+			continue;
+		}
+
+		if(tasks[i].cbs)
+		{
+			// The server deadline misses are counted as deadline misses as well
+			printf("%-16s %8u %8u   cbs, cpu %.2f%%, %u budget exhaustions, %u deadline misses\n",
+				tasks[i].name, tasks[i].period, tasks[i].budget,
+				100.0 * task->cpu_us / result.simulated_us, task->TBE_count, task->dline_miss_count);
+			total_misses += task->dline_miss_count;
+			continue;
+		}
+
+		printf("%-16s %8u %8u %8u %10u %8u %10u %8u %8u %10u %10.1f %10u %10u\n", tasks[i].name,
+			tasks[i].period, tasks[i].budget, task->jobs, task->completed, task->late,
+			task->dline_miss_count, task->TBE_count, task->skipped, task->preemptions,
+			task->completed ? (double)task->total_response_us / task->completed : 0.0,
+			task->max_response_us, task->max_start_jitter_us);
+
+		total_misses += task->dline_miss_count;
+	}
+
+	for(i = 0; i < count; i++)
+	{
+		if(result.tasks[i].timeouts)
+			printf("%s: %u lock waits timed out\n", tasks[i].name, result.tasks[i].timeouts);
+		if(result.tasks[i].kernel_waits)
+			printf("%s: %u lock acquisitions waited in the kernel\n", tasks[i].name,
+				result.tasks[i].kernel_waits);
+		if(result.tasks[i].over_bound)
+			printf("%s: %u jobs took longer than %u us\n", tasks[i].name, result.tasks[i].over_bound,
+				tasks[i].bound);
+		if(result.tasks[i].dropped)
+			printf("%s: %u jobs dropped in the high criticality mode\n", tasks[i].name,
+				result.tasks[i].dropped);
+		if(result.tasks[i].dropped_late)
+			printf("%s: %u dropped jobs went on past a later release\n", tasks[i].name,
+				result.tasks[i].dropped_late);
+		total_misses += result.tasks[i].over_bound + result.tasks[i].dropped_late;
+	}
+
+	printf("\nScheduler cost per event (host):\n");
+	print_event_cost("periodic timer", &result.events[SIM_EVENT_PERIODIC_TIMER]);
+	print_event_cost("budget timer", &result.events[SIM_EVENT_BUDGET_TIMER]);
+	print_event_cost("yield", &result.events[SIM_EVENT_YIELD]);
+
+	// Non-zero exit status if any deadline or response bound was missed or the admission
+	// test did not decide as expected, so that it can be used in scripts
+	if(admission_errors) return 3;
+	return total_misses ? 2 : 0;
+}
@@ -0,0 +1,147 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	sim.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Interface between the simulator front end and the simulated kernel
+//					The kernel headers conflict with the host stdio headers. So
+//					only the basic types are shared through this file.
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SIM_H
+#define _SIM_H
+
+#include "os_types.h"
+
+#define SIM_MAX_TASKS			32
+#define SIM_TASK_NAME_SIZE		16
+#define SIM_MAX_LOCKS			8
+
+// The lock wait of a task times out at the deadline of its job
+#define SIM_TIMEOUT_DEADLINE	((UINT32) -1)
+
+// Kinds of locks used by the tasks
+enum
+{
+	SIM_LOCKS_MUTEX = 0,		// Mutexes with the ceiling given at the allocation
+	SIM_LOCKS_LEARNT_MUTEX,		// Mutexes that learn the ceiling as the tasks lock them
+	SIM_LOCKS_SEMAPHORE,		// Binary semaphores
+	SIM_LOCKS_FUTEX				// User space locks that wait in the kernel only on contention
+};
+
+// Description of one periodic task of the task set. All times are in microseconds.
+// The execution time of every job is drawn uniformly from [exec_min, exec_max].
+// A CBS task uses only the period & budget. It never yields, so it shows that a
+// runaway aperiodic task cannot take more than its reserved bandwidth from the others.
+// A process entry is a process with a CPU reservation of budget in every period.
+// The tasks with group set to the index of the process entry belong to that process.
+// A mixed criticality task has a criticality level and a high criticality budget.
+// A periodic task can abort its late jobs or skip releases after them. Otherwise the
+// late job continues and the task function yields at its end.
+// A periodic task can hold a lock for a part of each job. The locks are SRP mutexes
+// or binary semaphores, which shows the priority inversion that the mutexes avoid.
+// They can also be user space locks, whose waiters block in the kernel on a semaphore.
+// A wait on a binary semaphore can time out. The job then skips its critical section.
+// The response time of every job can be checked against a bound, such as the one that
+// the SRP gives for the blocking.
+// A periodic task can be created at a later time and can end for good after some jobs,
+// which gives its CPU reservation back for the tasks created after it.
+typedef struct
+{
+	BOOL	cbs;
+	BOOL	process;
+	BOOL	mixed;				// Created with a criticality level
+	BOOL	high;				// High criticality task
+	INT32	group;				// Index of the process entry or -1
+	INT8	name[SIM_TASK_NAME_SIZE];
+	UINT32	period;
+	UINT32	deadline;
+	UINT32	budget;
+	UINT32	budget_hi;			// Budget in the high criticality mode
+	UINT32	phase;
+	UINT32	exec_min;
+	UINT32	exec_max;
+	BOOL	abort;				// OVERRUN_ABORT
+	UINT32	skip;				// Releases skipped after an overrun with OVERRUN_SKIP
+	INT32	lock;				// Index of the lock held by the jobs or -1
+	UINT32	lock_offset;		// Execution time of the job before it locks
+	UINT32	lock_length;		// Execution time of the job while it holds the lock
+	UINT32	lock_timeout;		// Timeout of the wait on a binary semaphore, SIM_TIMEOUT_DEADLINE or 0
+	UINT32	start;				// Time at which the task is created. Its phase is counted from there
+	UINT32	end;				// Completed jobs after which the task ends or 0
+	BOOL	reject;				// The task is expected to be rejected by the admission test
+	UINT32	bound;				// Bound of the response time of every job or 0
+
+} Sim_TaskSpec;
+
+// Results for one task
+typedef struct
+{
+	INT32	create_status;		// OS_Return of the task creation / _OS_SetOverrunPolicy / _OS_SetProcessReservation
+	BOOL	unsupported;		// The kernel is built without the feature that the task needs
+	UINT32	jobs;				// Jobs finished by the kernel (completed, TBE, missed or skipped)
+	UINT32	completed;			// Jobs that ran until the end of their execution time
+	UINT32	late;				// Completed jobs that finished after their deadline
+	UINT32	over_bound;			// Completed jobs that took longer than the bound
+	UINT32	skipped;
+	UINT32	TBE_count;
+	UINT32	dline_miss_count;
+	UINT32	preemptions;
+	UINT32	timeouts;			// Lock waits that timed out
+	UINT32	kernel_waits;		// User space lock acquisitions that waited in the kernel
+	UINT32	dropped;			// Low criticality jobs dropped in the high criticality mode
+	UINT32	dropped_late;		// Completed jobs that were dropped and went past a later release
+	UINT32	max_response_us;
+	UINT64	total_response_us;
+	UINT32	max_start_jitter_us;	// From the kernel histograms
+	UINT64	cpu_us;				// CPU time used by the task
+
+} Sim_TaskResult;
+
+// Kinds of scheduler entries
+enum
+{
+	SIM_EVENT_PERIODIC_TIMER = 0,
+	SIM_EVENT_BUDGET_TIMER,
+	SIM_EVENT_YIELD,
+	SIM_EVENT_COUNT
+};
+
+// Host side cost of the scheduler entries. The worst case is often a host interrupt
+// or a page fault. So the costs are kept in a histogram for the percentiles as well
+#define SIM_COST_BUCKET_NS		10
+#define SIM_COST_BUCKETS		4096		// The last bucket has all the longer ones
+
+typedef struct
+{
+	UINT64	count;
+	UINT64	total_ns;
+	UINT64	max_ns;
+	UINT32	histogram[SIM_COST_BUCKETS];
+
+} Sim_EventCost;
+
+typedef struct
+{
+	UINT64			simulated_us;
+	UINT64			idle_us;
+	UINT32			context_switches;
+	UINT32			mode_switches;		// Switches to the high criticality mode
+	Sim_EventCost	events[SIM_EVENT_COUNT];
+	Sim_TaskResult	tasks[SIM_MAX_TASKS];
+
+} Sim_Result;
+
+// Runs the task set on the kernel scheduler for duration_us of simulated time
+// locks is one of SIM_LOCKS_xxx
+// This can be called only once per process as the kernel state is not reset
+void Sim_Run(const Sim_TaskSpec * spec, UINT32 count, UINT64 duration_us, UINT32 locks, Sim_Result * result);
+
+// Returns the scheduler trace buffer. NULL if the simulator is built without TRACE=1
+const void * Sim_GetTrace(UINT32 * size);
+
+// Returns a random number in [min, max]
+UINT32 Sim_Random(UINT32 min, UINT32 max);
+
+#endif // _SIM_H
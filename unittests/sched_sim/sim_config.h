@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	sim_config.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Kernel configuration used by the scheduler simulator
+//					Every file of the simulator should include this first so that
+//					the kernel structures have the same layout in all of them.
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SIM_CONFIG_H
+#define _SIM_CONFIG_H
+
+#include "os_config.h"
+
+// Select the options given on the command line instead of the ones in os_config.h
+#ifdef SIM_PQUEUE_BACKEND
+	#undef OS_PQUEUE_BACKEND
+	#define OS_PQUEUE_BACKEND		SIM_PQUEUE_BACKEND
+#endif
+
+#ifdef SIM_TICKLESS_SCHEDULING
+	#undef OS_TICKLESS_SCHEDULING
+	#define OS_TICKLESS_SCHEDULING	SIM_TICKLESS_SCHEDULING
+#endif
+
+#ifdef SIM_BUDGET_RECLAMATION
+	#undef OS_BUDGET_RECLAMATION
+	#define OS_BUDGET_RECLAMATION	SIM_BUDGET_RECLAMATION
+#endif
+
+#ifdef SIM_MIXED_CRITICALITY
+	#undef OS_MIXED_CRITICALITY
+	#define OS_MIXED_CRITICALITY	SIM_MIXED_CRITICALITY
+#endif
+
+#ifdef SIM_TRACE_ENABLED
+	#undef OS_TRACE_ENABLED
+	#define OS_TRACE_ENABLED		SIM_TRACE_ENABLED
+#endif
+
+#ifdef SIM_STATIC_SCHEDULE
+	#undef OS_STATIC_SCHEDULE
+	#define OS_STATIC_SCHEDULE		SIM_STATIC_SCHEDULE
+#endif
+
+// There is no VFP to switch on the host
+#undef OS_WITH_VFP
+#define OS_WITH_VFP					0
+
+// Kernel logs go to the UART on the target. There is no use for them here
+#undef OS_KERNEL_LOGGING
+#define OS_KERNEL_LOGGING			0
+
+#endif // _SIM_CONFIG_H
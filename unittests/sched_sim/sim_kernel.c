@@ -0,0 +1,22 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	sim_kernel.c
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Builds the kernel scheduler sources for the simulator
+//					The sources are included directly so that the configuration
+//					in sim_config.h is applied to them.
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#include "sim_config.h"
+
+#include "os_queue.c"		// Directly include the source files for the scheduler
+#include "os_task.c"
+#undef MIN					// os_task.c and os_sched.c both define MIN
+#include "os_sched.c"
+#include "os_sem.c"
+#include "os_mutex.c"
+#include "os_event.c"
+#include "os_trace.c"
+#include "os_stat.c"
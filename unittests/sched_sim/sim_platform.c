@@ -0,0 +1,813 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	sim_platform.c
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Simulated timers, context switch layer and the event loop
+//					The simulated time advances from one event to the next. An
+//					event is either a timer interrupt or the completion of the job
+//					executed by the current task. The kernel code itself takes no
+//					simulated time, its cost is measured on the host clock.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "sim_config.h"
+#include "os_core.h"
+#include "os_sched.h"
+#include "os_timer.h"
+#include "os_trace.h"
+#include "os_stat.h"
+#include "os_mutex.h"
+#include "sysctl.h"
+#include "util.h"
+#include "target.h"
+#include "sim.h"
+
+#define NEVER				((UINT64) -1)
+#define SIM_TIMER_COUNT		2
+
+// Kernel functions without a prototype in the kernel headers
+void _OS_Start();
+void _OS_TaskYield();
+
+// Progress of a job through its critical section
+enum
+{
+	SIM_LOCK_BEFORE = 0,
+	SIM_LOCK_HELD,
+	SIM_LOCK_DONE
+};
+
+// States of the word of a user space lock, as in the user library
+enum
+{
+	SIM_FUTEX_FREE = 0,
+	SIM_FUTEX_TAKEN,
+	SIM_FUTEX_CONTENDED
+};
+
+// State of the job executed by a simulated task
+typedef struct
+{
+	const Sim_TaskSpec * spec;
+	Sim_TaskResult * result;
+	OS_Task * task;
+	UINT64 release;			// Release time of the job being executed
+	UINT64 work_release;	// Release time of the job whose work is being done
+	UINT32 exec;			// Execution time of that work
+	UINT32 remaining;		// Execution time left for that work
+	UINT32 lock_state;		// SIM_LOCK_xxx for that work
+	UINT32 wait_result[1];	// Result of the lock wait, set by the kernel when the task is woken up
+	BOOL contended;			// The user space lock was found taken by this work
+	UINT32 work_dropped;	// Jobs of the task dropped by the kernel when that work started
+	BOOL active;
+	BOOL created;			// The creation of the task was tried
+
+} Sim_Job;
+
+// Parameters passed to the simulated process entry function
+typedef struct
+{
+	const Sim_TaskSpec * spec;
+	UINT32 count;
+	Sim_Result * result;
+
+} Sim_TaskSet;
+
+///////////////////////////////////////////////////////////////////////////////
+// Global Data
+///////////////////////////////////////////////////////////////////////////////
+OS_Process * g_process_list_head;
+OS_Process * g_current_process;
+OS_Process * g_kernel_process;
+
+static OS_Process g_sim_process;
+static OS_Process g_sim_reserved_process[SIM_MAX_TASKS];
+static Sim_Job g_sim_jobs[SIM_MAX_TASKS];
+static UINT32 g_sim_stack[SIM_MAX_TASKS + 1][OS_IDLE_TASK_STACK_SIZE];
+
+// The locks are the mutexes, the binary semaphores or the user space locks. A user space
+// lock is a word with the semaphore that its waiters block on
+static OS_Mutex_t g_sim_lock[SIM_MAX_LOCKS];
+static UINT32 g_sim_locks;
+static BOOL g_sim_sem_locks;
+static UINT32 g_sim_lock_word[SIM_MAX_LOCKS];
+static Sim_Job * g_sim_lock_holder[SIM_MAX_LOCKS];
+
+// Simulated time in microseconds
+static UINT64 g_sim_time_us;
+
+// Timer 0 is auto reload, timer 1 is one shot. Both count in microseconds
+static UINT32 g_timer_interval[SIM_TIMER_COUNT];
+static UINT64 g_timer_start[SIM_TIMER_COUNT];
+static BOOL g_timer_armed[SIM_TIMER_COUNT];
+static BOOL g_timer_pending[SIM_TIMER_COUNT];
+
+static void sim_task_function(void * pdata) { }
+
+///////////////////////////////////////////////////////////////////////////////
+// Simulated timers
+///////////////////////////////////////////////////////////////////////////////
+static void StartTimer(UINT32 timer, UINT32 interval_us)
+{
+	g_timer_interval[timer] = interval_us;
+	g_timer_start[timer] = g_sim_time_us;
+	g_timer_armed[timer] = TRUE;
+}
+
+static UINT64 GetTimerExpiry(UINT32 timer)
+{
+	return g_timer_armed[timer] ? (g_timer_start[timer] + g_timer_interval[timer]) : NEVER;
+}
+
+void _OS_Timer_AckInterrupt(UINT32 timer)
+{
+	g_timer_pending[timer] = FALSE;
+}
+
+void _OS_Timer_PeriodicTimerStart(UINT32 interval_us)
+{
+	StartTimer(PERIODIC_TIMER, interval_us);
+}
+
+void _OS_Timer_SetTimeout_us(UINT32 timeout_us)
+{
+	StartTimer(BUDGET_TIMER, timeout_us);
+}
+
+void _OS_Timer_SetMaxTimeout(void)
+{
+	StartTimer(BUDGET_TIMER, MAX_TIMER1_INTERVAL_uS);
+}
+
+void _OS_Timer_Disable(UINT32 timer)
+{
+	g_timer_armed[timer] = FALSE;
+}
+
+UINT32 _OS_Timer_GetTimeElapsed_us(UINT32 timer)
+{
+	// Like the hardware, a one shot timer stops counting once it expires
+	UINT64 elapsed = g_sim_time_us - g_timer_start[timer];
+	return (elapsed < g_timer_interval[timer]) ? (UINT32) elapsed : g_timer_interval[timer];
+}
+
+UINT32 _OS_Timer_GetCount(UINT32 timer)
+{
+	// The timers are downcounting
+	return g_timer_interval[timer] - _OS_Timer_GetTimeElapsed_us(timer);
+}
+
+UINT32 _OS_Timer_GetMaxCount(UINT32 timer)
+{
+	return g_timer_interval[timer];
+}
+
+BOOL _OS_Timer_IsInterruptPending(UINT32 timer)
+{
+	return g_timer_pending[timer];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Context switch & CPU layer. Nothing runs on the task stacks in the simulator
+///////////////////////////////////////////////////////////////////////////////
+void _OS_ContextRestore(void *new_task)
+{
+	g_current_task = (OS_Task *) new_task;
+	g_current_process = g_current_task->owner_process;
+}
+
+void _OS_Exit(void) { }
+
+UINT32 *_OS_BuildKernelTaskStack(UINT32 * stack_ptr, void (*task_function)(void *), void * arg)
+{
+	OS_Task * task = (OS_Task *) arg;
+
+	// A periodic task gets a new stack when its late job is aborted. The work left
+	// of that job is dropped
+	if(IS_PERIODIC_TASK(task->attributes) && task->pdata)
+	{
+		((Sim_Job *) task->pdata)->remaining = 0;
+	}
+
+	return stack_ptr;
+}
+
+UINT32 *_OS_BuildUserTaskStack(UINT32 * stack_ptr, void (*task_function)(void (*entry_function)(void *pdata),
+	void *pdata), void * arg)
+{
+	return stack_ptr;
+}
+
+// The user mode entry points are in assembly on the target
+void UserTaskEntryMain(void (*entry_function)(void *pdata), void *pdata) { }
+void AperiodicUserTaskEntry(void (*entry_function)(void *pdata), void *pdata) { }
+
+UINT32 _disable_interrupt() { return 0; }
+void _enable_interrupt(UINT32 intsts) { }
+
+// Nothing is mapped in the simulator and the tasks are system tasks
+BOOL _MMU_is_user_readable(_MMU_L1_PageTable * ptable, VADDR va) { return TRUE; }
+
+void _sysctl_enable_mmu() { }
+void _sysctl_set_ptable(PADDR ptable) { }
+void _sysctl_flush_tlb(void) { }
+void _sysctl_set_domain_rights(UINT32 value, UINT32 mask) { }
+void _sysctl_wait_for_interrupt(void) { }
+#if ENABLE_MMU && (ENABLE_MMU_ASID==1)
+void _sysctl_set_ptable_asid(PADDR ptable, UINT32 asid) { }
+void _sysctl_flush_tlb_asid(UINT32 asid) { }
+#endif
+
+void OS_TaskYield(void)
+{
+	_OS_TaskYield();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Resource allocation functions from util.c
+///////////////////////////////////////////////////////////////////////////////
+INT32 GetFreeResIndex(UINT32 res_mask[], INT32 res_count)
+{
+	// Get the number of 32 bit words
+	INT32 count = (res_count + 31) >> 5;
+	INT32 free_res_index = -1;
+	INT32 i;
+
+	for(i = 0; i < count; i++)
+	{
+		if(~res_mask[i])
+		{
+			free_res_index = (i << 5) + (31 - __builtin_clz(~res_mask[i]));
+		}
+	}
+
+	return (free_res_index < res_count) ? free_res_index : -1;
+}
+
+void SetResourceStatus(UINT32 res_mask[], INT32 res_index, BOOL free)
+{
+	if(free)
+	{
+		res_mask[res_index >> 5] &= ~(1 << (res_index & 0x1f));
+	}
+	else
+	{
+		res_mask[res_index >> 5] |= (1 << (res_index & 0x1f));
+	}
+}
+
+BOOL IsResourceBusy(UINT32 res_mask[], INT32 res_index)
+{
+	return (res_mask[res_index >> 5] & (1 << (res_index & 0x1f)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Creates the task of the task set entry in its process. A task with a start time
+// is created from the event loop, like a system call from the current task
+///////////////////////////////////////////////////////////////////////////////
+static void CreateTask(UINT32 index)
+{
+	Sim_Job * job = &g_sim_jobs[index];
+	const Sim_TaskSpec * spec = job->spec;
+	OS_Process * process;
+	OS_Task_t tcb;
+
+	job->created = TRUE;
+
+	// The task is created in its process
+	g_current_process = (spec->group < 0) ? &g_sim_process : &g_sim_reserved_process[spec->group];
+	
+	if(spec->process)
+	{
+		// The process entry function does nothing. The tasks are created from here
+		process = &g_sim_reserved_process[index];
+		strncpy(process->name, spec->name, sizeof(process->name));
+		process->name[OS_PROCESS_NAME_SIZE - 1] = '\0';
+		process->process_entry_function = sim_task_function;
+		process->attributes = SYSTEM_PROCESS;
+#if ENABLE_MMU && (ENABLE_MMU_ASID==1)
+		process->asid = index + 2;
+#endif
+		process->next = g_sim_process.next;
+		g_sim_process.next = process;
+		
+		job->result->create_status = _OS_SetProcessReservation(process, spec->budget, spec->period);
+		if(job->result->create_status == SUCCESS)
+		{
+			job->task = process->server;
+		}
+		return;
+	}
+	
+	if(spec->cbs)
+	{
+		job->result->create_status = _OS_CreateCBSTask(spec->budget,
+			spec->period,
+			g_sim_stack[index],
+			OS_IDLE_TASK_STACK_SIZE << 2,
+			spec->name,
+			SYSTEM_TASK,
+			&tcb,
+			sim_task_function,
+			job);
+	}
+	else if(spec->mixed)
+	{
+		job->result->create_status = _OS_CreateMixedCriticalityTask(
+			spec->high ? HIGH_CRITICALITY : LOW_CRITICALITY,
+			spec->period,
+			spec->deadline,
+			spec->budget,
+			spec->budget_hi,
+			spec->start + spec->phase,
+			g_sim_stack[index],
+			OS_IDLE_TASK_STACK_SIZE << 2,
+			spec->name,
+			SYSTEM_TASK,
+			&tcb,
+			sim_task_function,
+			job);
+		job->result->unsupported = (job->result->create_status == NOT_SUPPORTED);
+	}
+	else
+	{
+		job->result->create_status = _OS_CreatePeriodicTask(spec->period,
+			spec->deadline,
+			spec->budget,
+			spec->start + spec->phase,
+			g_sim_stack[index],
+			OS_IDLE_TASK_STACK_SIZE << 2,
+			spec->name,
+			SYSTEM_TASK,
+			&tcb,
+			sim_task_function,
+			job);
+	}
+
+	if((job->result->create_status == SUCCESS) && (spec->abort || spec->skip))
+	{
+		job->result->create_status = _OS_SetOverrunPolicy(tcb, 
+			(spec->abort ? OVERRUN_ABORT : 0) | (spec->skip ? OVERRUN_SKIP : 0), spec->skip, -1);
+	}
+
+	if(job->result->create_status == SUCCESS)
+	{
+		job->task = (OS_Task *)&g_task_pool[tcb];
+	}
+}
+
+// Creates the tasks whose start time has come. Returns the next start time
+static UINT64 StartTasks(UINT32 count)
+{
+	UINT64 next = NEVER;
+	UINT32 i;
+
+	for(i = 0; i < count; i++)
+	{
+		if(g_sim_jobs[i].created) continue;
+
+		if(g_sim_jobs[i].spec->start <= g_sim_time_us)
+		{
+			CreateTask(i);
+
+			// The kernel may have switched to the new task
+			g_current_process = g_current_task->owner_process;
+		}
+		else if(g_sim_jobs[i].spec->start < next)
+		{
+			next = g_sim_jobs[i].spec->start;
+		}
+	}
+
+	return next;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The simulated process creates the idle task and the periodic tasks the same
+// way kernel_process_entry & main would do on the target
+///////////////////////////////////////////////////////////////////////////////
+static void sim_process_entry(void * pdata)
+{
+	Sim_TaskSet * set = (Sim_TaskSet *) pdata;
+	OS_Task_t tcb;
+	UINT32 i;
+
+	_OS_CreateAperiodicTask(MIN_PRIORITY + 1,
+		g_sim_stack[SIM_MAX_TASKS],
+		OS_IDLE_TASK_STACK_SIZE << 2,
+		"idle",
+		SYSTEM_TASK,
+		&tcb,
+		sim_task_function,
+		NULL);
+
+	g_idle_task = (OS_Task *)&g_task_pool[tcb];
+
+	// The locks come first. The kernel refuses to abort the jobs in a process
+	// with user space locks
+	g_current_process = &g_sim_process;
+
+	// The ceiling of a mutex is the shortest deadline of the tasks that share it
+	for(i = 0; i < SIM_MAX_LOCKS; i++)
+	{
+		UINT32 ceiling = 0, j;
+
+		for(j = 0; j < set->count; j++)
+		{
+			if((set->spec[j].lock == i) && (!ceiling || (set->spec[j].deadline < ceiling)))
+			{
+				ceiling = set->spec[j].deadline;
+			}
+		}
+
+		if(!ceiling) continue;
+
+		if((g_sim_sem_locks ? _OS_SemAlloc((OS_Sem_t *)&g_sim_lock[i], 1, TRUE) :
+			(g_sim_locks == SIM_LOCKS_FUTEX) ? _OS_SemFutexAlloc((OS_Sem_t *)&g_sim_lock[i]) :
+			_OS_MutexAlloc(&g_sim_lock[i], (g_sim_locks == SIM_LOCKS_LEARNT_MUTEX) ? 0 : ceiling)) != SUCCESS)
+		{
+			panic("Could not allocate lock %u\n", i);
+		}
+	}
+
+	for(i = 0; i < set->count; i++)
+	{
+		if(!set->spec[i].start) CreateTask(i);
+	}
+}
+
+static UINT64 GetHostTime_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void RecordEventCost(Sim_Result * result, UINT32 event, UINT64 start_ns)
+{
+	UINT64 elapsed = GetHostTime_ns() - start_ns;
+	Sim_EventCost * cost = &result->events[event];
+
+	cost->count++;
+	cost->total_ns += elapsed;
+	if(elapsed > cost->max_ns) cost->max_ns = elapsed;
+	cost->histogram[(elapsed < SIM_COST_BUCKET_NS * SIM_COST_BUCKETS) ? 
+		(elapsed / SIM_COST_BUCKET_NS) : (SIM_COST_BUCKETS - 1)]++;
+}
+
+// Returns the job executed by the task, if the kernel still runs the same job.
+// The kernel moves to the next job when it yields, exceeds its budget or misses its deadline
+static Sim_Job * GetCurrentJob(OS_Task * task)
+{
+	Sim_Job * job;
+
+	if(!task || !IS_PERIODIC_TASK(task->attributes)) return NULL;
+
+	job = (Sim_Job *) task->pdata;
+	return (job->active && (job->release == task->p.job_release_time)) ? job : NULL;
+}
+
+// Returns the execution time left in the work of the job when it locks or unlocks
+// next. A critical section that goes past the end of the work is cut short
+static UINT32 GetLockPoint(const Sim_Job * job)
+{
+	UINT32 done = job->spec->lock_offset;
+
+	if(job->lock_state == SIM_LOCK_DONE) return 0;
+	if(job->lock_state == SIM_LOCK_HELD) done += job->spec->lock_length;
+
+	return (done < job->exec) ? (job->exec - done) : 0;
+}
+
+// Swaps the word of a user space lock. The simulator runs on one thread, so a plain
+// swap is atomic with respect to the simulated tasks
+static UINT32 SwapLockWord(INT32 lock, UINT32 value)
+{
+	UINT32 old = g_sim_lock_word[lock];
+	g_sim_lock_word[lock] = value;
+	return old;
+}
+
+// Takes or releases a user space lock for the current task the way OS_LockAcquire and
+// OS_LockRelease do. A task that waited in the kernel tries again once it runs. The lock
+// is given to one job at a time, so a lost wake up stalls the waiter and two holders panic
+static OS_Return StepFutexLock(Sim_Job * job)
+{
+	INT32 lock = job->spec->lock;
+	OS_Sem_t sem = (OS_Sem_t) g_sim_lock[lock];
+	OS_Task * task = job->task;
+	OS_Return status = SUCCESS;
+
+	if(job->lock_state == SIM_LOCK_BEFORE)
+	{
+		// The first try is the fast path. A job that found the lock taken marks it contended
+		UINT32 old = SwapLockWord(lock, job->contended ? SIM_FUTEX_CONTENDED : SIM_FUTEX_TAKEN);
+
+		if((old != SIM_FUTEX_FREE) && !job->contended)
+		{
+			job->contended = TRUE;
+			old = SwapLockWord(lock, SIM_FUTEX_CONTENDED);
+		}
+
+		if(old != SIM_FUTEX_FREE)
+		{
+			status = _OS_SemFutexWait(sem, &g_sim_lock_word[lock], SIM_FUTEX_CONTENDED);
+			if(g_current_task != task) job->result->kernel_waits++;
+			return status;
+		}
+
+		if(g_sim_lock_holder[lock])
+		{
+			panic("Lock %d is held by %s and %s\n", lock, g_sim_lock_holder[lock]->spec->name, job->spec->name);
+		}
+
+		g_sim_lock_holder[lock] = job;
+		job->lock_state = SIM_LOCK_HELD;
+	}
+	else
+	{
+		g_sim_lock_holder[lock] = NULL;
+		job->lock_state = SIM_LOCK_DONE;
+		job->contended = FALSE;
+		if(SwapLockWord(lock, SIM_FUTEX_FREE) == SIM_FUTEX_CONTENDED)
+		{
+			status = _OS_SemFutexWake(sem);
+		}
+	}
+
+	return status;
+}
+
+// Locks or unlocks for the current task. The kernel may switch to another task.
+// A task blocked on the lock holds it once it runs again
+static void StepLock(Sim_Job * job)
+{
+	OS_Mutex_t lock = g_sim_lock[job->spec->lock];
+	OS_Return status;
+
+	if(g_sim_locks == SIM_LOCKS_FUTEX)
+	{
+		status = StepFutexLock(job);
+	}
+	else if(job->lock_state == SIM_LOCK_BEFORE)
+	{
+		job->lock_state = SIM_LOCK_HELD;
+		if(g_sim_sem_locks && job->spec->lock_timeout)
+		{
+			// The kernel gives the result of the wait through the syscall result
+			job->task->syscall_result = job->wait_result;
+			job->wait_result[0] = SUCCESS;
+			status = (job->spec->lock_timeout == SIM_TIMEOUT_DEADLINE) ?
+				_OS_SemTimedWait(lock, 0, OS_TIMEOUT_AT_DEADLINE) :
+				_OS_SemTimedWait(lock, job->spec->lock_timeout, OS_TIMEOUT_RELATIVE);
+			if(status == TIMEOUT)
+			{
+				job->wait_result[0] = TIMEOUT;
+				status = SUCCESS;
+			}
+		}
+		else
+		{
+			status = g_sim_sem_locks ? _OS_SemWait(lock) : _OS_MutexLock(lock);
+		}
+	}
+	else
+	{
+		job->lock_state = SIM_LOCK_DONE;
+		status = g_sim_sem_locks ? _OS_SemPost(lock) : _OS_MutexUnlock(lock);
+	}
+
+	if(status != SUCCESS)
+	{
+		panic("Lock %d of task %s failed with error %d\n", job->spec->lock, job->spec->name, status);
+	}
+}
+
+// Copies the kernel counters of the task into its results
+static void GetTaskResult(Sim_Job * job)
+{
+	OS_Task * task = job->task;
+
+	job->result->jobs = task->p.exec_count;
+	job->result->TBE_count = task->p.TBE_count;
+	job->result->dline_miss_count = task->p.dline_miss_count;
+	if(IS_PERIODIC_TASK(task->attributes)) job->result->skipped = task->p.skipped_count;
+#if OS_MIXED_CRITICALITY==1
+	if(IS_PERIODIC_TASK(task->attributes)) job->result->dropped = task->p.dropped_count;
+#endif
+	job->result->max_start_jitter_us = g_task_job_stat[task->id].hist.max_start_jitter_us;
+	job->result->cpu_us = task->accumulated_budget;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Runs the event loop
+///////////////////////////////////////////////////////////////////////////////
+void Sim_Run(const Sim_TaskSpec * spec, UINT32 count, UINT64 duration_us, UINT32 locks, Sim_Result * result)
+{
+	Sim_TaskSet set = { spec, count, result };
+	OS_Task * task;
+	Sim_Job * job;
+	UINT64 irq_time, start_ns, response, next_start;
+	UINT32 timer, run, i;
+
+	memset(result, 0, sizeof(Sim_Result));
+	g_sim_locks = locks;
+	g_sim_sem_locks = (locks == SIM_LOCKS_SEMAPHORE);
+
+	for(i = 0; i < count; i++)
+	{
+		g_sim_jobs[i].spec = &spec[i];
+		g_sim_jobs[i].result = &result->tasks[i];
+	}
+
+#if OS_TRACE_ENABLED==1
+	_OS_TraceInit();
+#endif
+
+	_OS_QueueInit(&g_ready_q);
+	_OS_QueueInit(&g_wait_q);
+	_OS_BitmapQueueInit(&g_ap_ready_q);
+	_OS_QueueInit(&g_completed_task_q);
+	_OS_QueueInit(&g_periodic_blocked_q);
+	_OS_QueueInit(&g_ceiling_blocked_q);
+
+	strcpy(g_sim_process.name, "sim");
+	g_sim_process.process_entry_function = sim_process_entry;
+	g_sim_process.pdata = &set;
+	g_sim_process.attributes = ADMIN_PROCESS | SYSTEM_PROCESS;
+#if ENABLE_MMU && (ENABLE_MMU_ASID==1)
+	g_sim_process.asid = 1;
+#endif
+	g_process_list_head = g_kernel_process = &g_sim_process;
+
+	_OS_Start();
+
+	while(g_sim_time_us < duration_us)
+	{
+		next_start = StartTasks(count);
+		task = g_current_task;
+
+		// Start a new job if the kernel released one for this task. If the kernel moved
+		// on from a late job that was not aborted, the task function is still in the
+		// middle of that work and yields at its end. So the new job only finishes it
+		if(IS_PERIODIC_TASK(task->attributes) && !GetCurrentJob(task))
+		{
+			job = (Sim_Job *) task->pdata;
+			job->release = task->p.job_release_time;
+			if(!job->active || !job->remaining)
+			{
+				job->work_release = job->release;
+				job->exec = job->remaining = Sim_Random(job->spec->exec_min, job->spec->exec_max);
+				job->lock_state = (job->spec->lock >= 0) ? SIM_LOCK_BEFORE : SIM_LOCK_DONE;
+				job->contended = FALSE;
+#if OS_MIXED_CRITICALITY==1
+				job->work_dropped = task->p.dropped_count;
+#endif
+			}
+			job->active = TRUE;
+		}
+
+		job = GetCurrentJob(task);
+		if(job && (job->wait_result[0] == TIMEOUT))
+		{
+			// The lock wait timed out. The job goes on without the critical section
+			job->wait_result[0] = SUCCESS;
+			job->lock_state = SIM_LOCK_DONE;
+			job->result->timeouts++;
+		}
+
+		irq_time = GetTimerExpiry(PERIODIC_TIMER);
+		timer = PERIODIC_TIMER;
+		if(GetTimerExpiry(BUDGET_TIMER) < irq_time)
+		{
+			irq_time = GetTimerExpiry(BUDGET_TIMER);
+			timer = BUDGET_TIMER;
+		}
+
+		// A task starts before the next interrupt. It is not an interrupt
+		if(next_start < irq_time)
+		{
+			irq_time = next_start;
+			timer = SIM_TIMER_COUNT;
+		}
+
+		// The job runs till it completes or till it locks / unlocks
+		run = job ? (job->remaining - GetLockPoint(job)) : 0;
+
+		if(job && !run && (job->lock_state != SIM_LOCK_DONE))
+		{
+			StepLock(job);
+		}
+		else if(job && (g_sim_time_us + run <= irq_time) && (job->lock_state != SIM_LOCK_DONE))
+		{
+			g_sim_time_us += run;
+			job->remaining -= run;
+		}
+		else if(job && (g_sim_time_us + run <= irq_time))
+		{
+			// The job completes before the next interrupt
+			g_sim_time_us += job->remaining;
+			job->remaining = 0;
+			job->active = FALSE;
+			job->result->completed++;
+
+			// The release times are in the kernel time base
+			response = _OS_GetElapsedTime() - job->work_release;
+			if(response > job->result->max_response_us)
+				job->result->max_response_us = (UINT32) response;
+			job->result->total_response_us += response;
+			if(response > job->spec->deadline) job->result->late++;
+			if(job->spec->bound && (response > job->spec->bound)) job->result->over_bound++;
+#if OS_MIXED_CRITICALITY==1
+			// A dropped job should be aborted. It should not go on in the time of a later job
+			if((task->p.dropped_count != job->work_dropped) && (response > job->spec->period))
+				job->result->dropped_late++;
+#endif
+
+			start_ns = GetHostTime_ns();
+			if(job->spec->end && (job->result->completed == job->spec->end))
+			{
+				// The task ends for good with this job. Its TCB may go to a task created later
+				GetTaskResult(job);
+				job->result->jobs++;
+				job->task = NULL;
+				_OS_CompletePeriodicTask();
+			}
+			else
+			{
+				_OS_TaskYield();
+			}
+			RecordEventCost(result, SIM_EVENT_YIELD, start_ns);
+		}
+		else if(timer == SIM_TIMER_COUNT)
+		{
+			// The task is created at the top of the loop
+			if(job) job->remaining -= (UINT32)(irq_time - g_sim_time_us);
+			if(task == g_idle_task) result->idle_us += irq_time - g_sim_time_us;
+			g_sim_time_us = irq_time;
+		}
+		else
+		{
+			if(job) job->remaining -= (UINT32)(irq_time - g_sim_time_us);
+			if(task == g_idle_task) result->idle_us += irq_time - g_sim_time_us;
+			g_sim_time_us = irq_time;
+
+			// Timer 0 reloads by itself, timer 1 stops
+			if(timer == PERIODIC_TIMER)
+				g_timer_start[PERIODIC_TIMER] += g_timer_interval[PERIODIC_TIMER];
+			else
+				g_timer_armed[BUDGET_TIMER] = FALSE;
+			g_timer_pending[timer] = TRUE;
+
+			// Like the IRQ handler, pass the interrupted task to the ISR
+			g_current_task = NULL;
+			start_ns = GetHostTime_ns();
+			if(timer == PERIODIC_TIMER)
+			{
+				_OS_PeriodicTimerISR(task);
+				RecordEventCost(result, SIM_EVENT_PERIODIC_TIMER, start_ns);
+			}
+			else
+			{
+				_OS_BudgetTimerISR(task);
+				RecordEventCost(result, SIM_EVENT_BUDGET_TIMER, start_ns);
+			}
+
+			// The interrupted job is still pending but another task got the CPU
+			if(job && (g_current_task != task) && (GetCurrentJob(task) == job))
+				job->result->preemptions++;
+		}
+
+		if(g_current_task != task) result->context_switches++;
+	}
+
+	result->simulated_us = g_sim_time_us;
+#if OS_MIXED_CRITICALITY==1
+	result->mode_switches = g_criticality_switch_count;
+#endif
+
+	for(i = 0; i < count; i++)
+	{
+		if(g_sim_jobs[i].task) GetTaskResult(&g_sim_jobs[i]);
+	}
+}
+
+UINT32 Sim_Random(UINT32 min, UINT32 max)
+{
+	return (max > min) ? (min + (UINT32)(rand() % (max - min + 1))) : min;
+}
+
+const void * Sim_GetTrace(UINT32 * size)
+{
+#if OS_TRACE_ENABLED==1
+	*size = sizeof(g_trace_buffer);
+	return &g_trace_buffer;
+#else
+	*size = 0;
+	return NULL;
+#endif
+}
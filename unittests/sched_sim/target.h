@@ -0,0 +1,21 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	target.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Target definitions for the scheduler simulator
+//					The simulated timers count in microseconds.
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _TARGET_H
+#define _TARGET_H
+
+#define	TIMER0_TICK_FREQ	(1000000)
+#define	TIMER1_TICK_FREQ	(1000000)
+
+// Same limits as the real targets. Lets use 1 second for this.
+#define	MAX_TIMER0_INTERVAL_uS		1000000
+#define	MAX_TIMER1_INTERVAL_uS		1000000
+
+#endif // _TARGET_H
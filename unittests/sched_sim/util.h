@@ -0,0 +1,21 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	util.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Utility functions for the scheduler simulator
+//					The string functions come from the host C library.
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _UTIL_H
+#define _UTIL_H
+
+#include <string.h>
+#include "os_types.h"
+
+void SetResourceStatus(UINT32 res_mask[], INT32 res_index, BOOL free);
+INT32 GetFreeResIndex(UINT32 res_mask[], INT32 count);
+BOOL IsResourceBusy(UINT32 res_mask[], INT32 res_index);
+
+#endif // _UTIL_H
@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	event_kernel.c
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Builds the events for the host against stubs
+//					The wait queues are the ones of the OS. The scheduler only
+//					notes down which tasks are blocked and the order in which
+//					they are woken up.
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#include "os_queue.c"		// Directly include the source files for the queues and the events
+#include "os_event.c"
+
+#include "event_test.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Global Data
+///////////////////////////////////////////////////////////////////////////////
+OS_Process g_process_pool[MAX_PROCESS_COUNT];
+OS_Process * g_current_process;
+OS_Task * g_current_task;
+UINT32 g_sched_starting_counter_value;
+
+static OS_Task g_test_task[TEST_TASK_COUNT];
+static UINT32 g_test_syscall_result[TEST_TASK_COUNT][2];
+static BOOL g_test_blocked[TEST_TASK_COUNT];
+
+static UINT32 g_test_woken[TEST_TASK_COUNT];
+static UINT32 g_test_woken_count;
+static UINT32 g_test_schedule_count;
+
+///////////////////////////////////////////////////////////////////////////////
+// Scheduler stubs
+///////////////////////////////////////////////////////////////////////////////
+void _OS_SchedulerBlockCurrentTask()
+{
+	g_test_blocked[g_current_task->id] = TRUE;
+}
+
+void _OS_SchedulerUnblockTask(OS_Task * task)
+{
+	g_test_blocked[task->id] = FALSE;
+	g_test_woken[g_test_woken_count++] = task->id;
+}
+
+void _OS_UpdateCurrentTaskBudget()
+{
+}
+
+void _OS_Schedule()
+{
+	g_test_schedule_count++;
+}
+
+UINT32 _OS_Timer_GetCount(UINT32 timer)
+{
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Resource allocation functions from util.c
+///////////////////////////////////////////////////////////////////////////////
+INT32 GetFreeResIndex(UINT32 res_mask[], INT32 res_count)
+{
+	// Get the number of 32 bit words
+	INT32 count = (res_count + 31) >> 5;
+	INT32 free_res_index = -1;
+	INT32 i;
+
+	for(i = 0; i < count; i++)
+	{
+		if(~res_mask[i])
+		{
+			free_res_index = (i << 5) + (31 - __builtin_clz(~res_mask[i]));
+		}
+	}
+
+	return (free_res_index < res_count) ? free_res_index : -1;
+}
+
+void SetResourceStatus(UINT32 res_mask[], INT32 res_index, BOOL free)
+{
+	if(free)
+	{
+		res_mask[res_index >> 5] &= ~(1 << (res_index & 0x1f));
+	}
+	else
+	{
+		res_mask[res_index >> 5] |= (1 << (res_index & 0x1f));
+	}
+}
+
+BOOL IsResourceBusy(UINT32 res_mask[], INT32 res_index)
+{
+	return (res_mask[res_index >> 5] & (1 << (res_index & 0x1f)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Test interface
+///////////////////////////////////////////////////////////////////////////////
+void Test_InitTask(UINT32 task, UINT32 kind, UINT64 key, UINT32 process)
+{
+	OS_Task * tcb = &g_test_task[task];
+
+	tcb->attributes = (kind == TEST_PERIODIC) ? (PERIODIC_TASK | SYSTEM_TASK) :
+					(kind == TEST_CBS) ? (APERIODIC_TASK | CBS_TASK | SYSTEM_TASK) :
+					(APERIODIC_TASK | SYSTEM_TASK);
+	tcb->id = task;
+	tcb->qp.key = key;
+	tcb->owner_process = &g_process_pool[process];
+	tcb->syscall_result = g_test_syscall_result[task];
+}
+
+void Test_SetTask(UINT32 task)
+{
+	g_current_task = &g_test_task[task];
+	g_current_process = g_current_task->owner_process;
+
+	// The result of the last call is cleared so that the ones written by the kernel are seen
+	g_test_syscall_result[task][0] = (UINT32) -1;
+	g_test_syscall_result[task][1] = 0;
+}
+
+void Test_EventWaiterUpdate(UINT32 task, UINT64 deadline)
+{
+	g_test_task[task].qp.key = deadline;
+	_OS_EventWaiterUpdate(&g_test_task[task]);
+}
+
+BOOL Test_IsBlocked(UINT32 task)
+{
+	return g_test_blocked[task];
+}
+
+OS_Return Test_GetWaitResult(UINT32 task)
+{
+	return (OS_Return) g_test_syscall_result[task][0];
+}
+
+UINT32 Test_GetWaitFlags(UINT32 task)
+{
+	return g_test_syscall_result[task][1];
+}
+
+UINT32 Test_GetWokenTasks(UINT32 * tasks)
+{
+	UINT32 count = g_test_woken_count;
+	UINT32 i;
+
+	for(i = 0; i < count; i++) {
+		tasks[i] = g_test_woken[i];
+	}
+	g_test_woken_count = 0;
+
+	return count;
+}
+
+UINT32 Test_GetEventFlags(OS_Event_t event)
+{
+	return g_event_pool[event].flags;
+}
+
+UINT32 Test_GetScheduleCount(void)
+{
+	UINT32 count = g_test_schedule_count;
+	g_test_schedule_count = 0;
+	return count;
+}
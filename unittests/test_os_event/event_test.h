@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	event_test.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Interface between the event test and the kernel code
+//					The kernel headers conflict with the host stdio headers. So
+//					the test gets the types and the error codes from the user API
+//					and the event functions are declared again here.
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _EVENT_TEST_H
+#define _EVENT_TEST_H
+
+// The kernel side has them from the kernel headers
+#ifndef _OS_CORE_H
+#include "os_api.h"
+#endif
+
+#define TEST_TASK_COUNT			8
+
+// The kinds of tasks. The periodic and the CBS tasks wait in the order of their
+// deadlines and the aperiodic tasks in the order of their priorities
+#define TEST_PERIODIC			0
+#define TEST_CBS				1
+#define TEST_APERIODIC			2
+
+OS_Return _OS_EventAlloc(OS_Event_t * event, UINT32 flags);
+OS_Return _OS_EventWait(OS_Event_t event, UINT32 mask, UINT32 mode, UINT32 * flags);
+OS_Return _OS_EventPost(OS_Event_t event, UINT32 flags);
+OS_Return _OS_EventClear(OS_Event_t event, UINT32 flags);
+OS_Return _OS_EventFree(OS_Event_t event);
+
+// Moves the waiting task to its place for the new deadline
+void Test_EventWaiterUpdate(UINT32 task, UINT64 deadline);
+
+// Sets up a task of the kind given. The key is the deadline of a periodic / CBS task
+// and the priority of an aperiodic task
+void Test_InitTask(UINT32 task, UINT32 kind, UINT64 key, UINT32 process);
+
+// Makes the task the current one. The kernel calls are made for it
+void Test_SetTask(UINT32 task);
+
+// Returns TRUE if the task is blocked in the scheduler
+BOOL Test_IsBlocked(UINT32 task);
+
+// The result and the flags that the kernel left for the task when it was woken up
+OS_Return Test_GetWaitResult(UINT32 task);
+UINT32 Test_GetWaitFlags(UINT32 task);
+
+// Returns the tasks woken up since the last call, in the order in which they were
+// woken up. The count is returned
+UINT32 Test_GetWokenTasks(UINT32 * tasks);
+
+// The flags that are set in the event now
+UINT32 Test_GetEventFlags(OS_Event_t event);
+
+// Calls to the scheduler since the last call
+UINT32 Test_GetScheduleCount(void);
+
+#endif // _EVENT_TEST_H
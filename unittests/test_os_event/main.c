@@ -0,0 +1,275 @@
+/**********************************************************************************
+ *
+ *						Copyright 2014 xxxxxxx, xxxxxxx
+ *	File:	main.c
+ *	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+ *	Description: Test program for the events (os_event.c)
+ *					Task 0 owns the events and posts them. The other tasks of
+ *					process 0 wait on them and task 7 is in another process.
+ *					The tests check the arguments, the waits for any and all of
+ *					the flags, the order in which one post wakes up several
+ *					waiters, the auto-clear and the free of an event with waiters.
+ *
+ *********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "event_test.h"
+
+#define REQUIRE(x) 	do { 																\
+						if(!(x)) {														\
+							printf("REQUIRE Failed in %s:%d: %s\n", __FUNCTION__, __LINE__, #x);	\
+							exit(1);													\
+						}																\
+					} while(0)
+
+#define POSTER					0
+#define STRANGER				7
+
+// The woken up tasks should be the ones given, in that order
+#define REQUIRE_WOKEN(...)	do {														\
+								const UINT32 expected[] = { __VA_ARGS__ };				\
+								UINT32 woken[TEST_TASK_COUNT];							\
+								UINT32 count = Test_GetWokenTasks(woken);				\
+								UINT32 i;												\
+								REQUIRE(count == sizeof(expected) / sizeof(UINT32));	\
+								for(i = 0; i < count; i++) {							\
+									REQUIRE(woken[i] == expected[i]);					\
+								}														\
+							} while(0)
+
+///////////////////////////////////////////////////////////////////////////////
+// Kernel logging functions
+///////////////////////////////////////////////////////////////////////////////
+void panic(const INT8 *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+
+	exit(1);
+}
+
+static void init_tasks(void)
+{
+	Test_InitTask(POSTER, TEST_PERIODIC, 1000, 0);
+	Test_InitTask(1, TEST_PERIODIC, 300, 0);
+	Test_InitTask(2, TEST_PERIODIC, 100, 0);
+	Test_InitTask(3, TEST_CBS, 200, 0);
+	Test_InitTask(4, TEST_APERIODIC, 5, 0);
+	Test_InitTask(5, TEST_APERIODIC, 2, 0);
+	Test_InitTask(6, TEST_PERIODIC, 400, 0);
+	Test_InitTask(STRANGER, TEST_PERIODIC, 100, 1);
+}
+
+// Blocks the task on the event. The wait can not be satisfied by the flags set now
+static void wait_blocked(UINT32 task, OS_Event_t event, UINT32 mask, UINT32 mode)
+{
+	Test_SetTask(task);
+	REQUIRE(_OS_EventWait(event, mask, mode, NULL) == SUCCESS);
+	REQUIRE(Test_IsBlocked(task));
+	REQUIRE(Test_GetScheduleCount() == 1);
+}
+
+static void post(OS_Event_t event, UINT32 flags, BOOL wakes)
+{
+	Test_SetTask(POSTER);
+	REQUIRE(_OS_EventPost(event, flags) == SUCCESS);
+	REQUIRE(Test_GetScheduleCount() == (wakes ? 1 : 0));
+
+	// The result of the poster is written only when it goes through the scheduler
+	if(wakes) {
+		REQUIRE(Test_GetWaitResult(POSTER) == SUCCESS);
+	}
+}
+
+static void require_woken_with(UINT32 task, OS_Return result, UINT32 flags)
+{
+	REQUIRE(!Test_IsBlocked(task));
+	REQUIRE(Test_GetWaitResult(task) == result);
+	REQUIRE(Test_GetWaitFlags(task) == flags);
+}
+
+static OS_Event_t test_args(void)
+{
+	OS_Event_t event;
+	UINT32 flags;
+
+	printf("Testing the arguments\n");
+
+	Test_SetTask(POSTER);
+	REQUIRE(_OS_EventAlloc(NULL, 0) == BAD_ARGUMENT);
+	REQUIRE(_OS_EventAlloc(&event, 0) == SUCCESS);
+
+	REQUIRE(_OS_EventWait(event, 0, OS_EVENT_WAIT_ANY, &flags) == BAD_ARGUMENT);
+	REQUIRE(_OS_EventWait(event, 1, OS_EVENT_AUTO_CLEAR << 1, &flags) == BAD_ARGUMENT);
+	REQUIRE(_OS_EventWait(-1, 1, OS_EVENT_WAIT_ANY, &flags) == BAD_ARGUMENT);
+	REQUIRE(_OS_EventPost(0x1000, 1) == BAD_ARGUMENT);
+	REQUIRE(_OS_EventFree(event - 1) == RESOURCE_NOT_OPEN);
+
+	// Only the process that allocated the event can use it
+	Test_SetTask(STRANGER);
+	REQUIRE(_OS_EventWait(event, 1, OS_EVENT_WAIT_ANY, &flags) == RESOURCE_NOT_OWNED);
+	REQUIRE(_OS_EventPost(event, 1) == RESOURCE_NOT_OWNED);
+	REQUIRE(_OS_EventClear(event, 1) == RESOURCE_NOT_OWNED);
+	REQUIRE(_OS_EventFree(event) == RESOURCE_NOT_OWNED);
+
+	REQUIRE(Test_GetEventFlags(event) == 0);
+	REQUIRE(!Test_IsBlocked(STRANGER));
+	REQUIRE(Test_GetScheduleCount() == 0);
+
+	return event;
+}
+
+static void test_immediate(OS_Event_t event)
+{
+	UINT32 flags;
+
+	printf("Testing the waits satisfied by the flags already set\n");
+
+	// The flags set now satisfy the wait without going through the scheduler
+	post(event, 0x5, FALSE);
+	REQUIRE(Test_GetEventFlags(event) == 0x5);
+
+	Test_SetTask(1);
+	REQUIRE(_OS_EventWait(event, 0x6, OS_EVENT_WAIT_ANY, &flags) == SUCCESS);
+	REQUIRE(flags == 0x4);
+	REQUIRE(Test_GetEventFlags(event) == 0x5);
+
+	REQUIRE(_OS_EventWait(event, 0x5, OS_EVENT_WAIT_ALL | OS_EVENT_AUTO_CLEAR, &flags) == SUCCESS);
+	REQUIRE(flags == 0x5);
+	REQUIRE(Test_GetEventFlags(event) == 0);
+
+	REQUIRE(!Test_IsBlocked(1));
+	REQUIRE(Test_GetScheduleCount() == 0);
+	REQUIRE_WOKEN();
+
+	Test_SetTask(POSTER);
+	REQUIRE(_OS_EventPost(event, 0x30) == SUCCESS);
+	REQUIRE(_OS_EventClear(event, 0x10) == SUCCESS);
+	REQUIRE(Test_GetEventFlags(event) == 0x20);
+	REQUIRE(_OS_EventClear(event, 0x20) == SUCCESS);
+}
+
+static void test_any_all(OS_Event_t event)
+{
+	printf("Testing the waits for any and all of the flags\n");
+
+	wait_blocked(1, event, 0x3, OS_EVENT_WAIT_ALL);
+	wait_blocked(2, event, 0x3, OS_EVENT_WAIT_ANY);
+
+	// One of the flags wakes up only the task waiting for any of them
+	post(event, 0x1, TRUE);
+	REQUIRE_WOKEN(2);
+	require_woken_with(2, SUCCESS, 0x1);
+	REQUIRE(Test_IsBlocked(1));
+
+	// A flag outside the mask does not wake up the task
+	post(event, 0x4, FALSE);
+	REQUIRE_WOKEN();
+	REQUIRE(Test_IsBlocked(1));
+
+	// The waiter for all the flags gets them when the last one is posted
+	post(event, 0x2, TRUE);
+	REQUIRE_WOKEN(1);
+	require_woken_with(1, SUCCESS, 0x3);
+	REQUIRE(Test_GetEventFlags(event) == 0x7);
+
+	Test_SetTask(POSTER);
+	REQUIRE(_OS_EventClear(event, 0xFFFFFFFF) == SUCCESS);
+}
+
+static void test_one_post(OS_Event_t event)
+{
+	printf("Testing one post waking up several waiters\n");
+
+	// The waiters come in a mixed order
+	wait_blocked(4, event, 0x4, OS_EVENT_WAIT_ANY);
+	wait_blocked(1, event, 0x1, OS_EVENT_WAIT_ANY | OS_EVENT_AUTO_CLEAR);
+	wait_blocked(6, event, 0x8, OS_EVENT_WAIT_ANY);
+	wait_blocked(5, event, 0x1, OS_EVENT_WAIT_ANY);
+	wait_blocked(3, event, 0x2, OS_EVENT_WAIT_ANY | OS_EVENT_AUTO_CLEAR);
+	wait_blocked(2, event, 0x3, OS_EVENT_WAIT_ALL);
+
+	// The periodic & CBS tasks are woken up in the order of their deadlines and then
+	// the aperiodic tasks in the order of their priorities. Task 6 waits for another flag
+	post(event, 0x7, TRUE);
+	REQUIRE_WOKEN(2, 3, 1, 5, 4);
+	REQUIRE(Test_IsBlocked(6));
+
+	// The auto-clear of tasks 1 & 3 is done after the pass. So task 5 that comes after
+	// task 1 still gets flag 0x1
+	require_woken_with(2, SUCCESS, 0x3);
+	require_woken_with(3, SUCCESS, 0x2);
+	require_woken_with(1, SUCCESS, 0x1);
+	require_woken_with(5, SUCCESS, 0x1);
+	require_woken_with(4, SUCCESS, 0x4);
+	REQUIRE(Test_GetEventFlags(event) == 0x4);
+
+	// A waiter whose deadline changes moves to its new place
+	wait_blocked(1, event, 0x8, OS_EVENT_WAIT_ANY);
+	wait_blocked(2, event, 0x8, OS_EVENT_WAIT_ANY);
+	Test_EventWaiterUpdate(6, 50);
+
+	post(event, 0x8, TRUE);
+	REQUIRE_WOKEN(6, 2, 1);
+	require_woken_with(6, SUCCESS, 0x8);
+	require_woken_with(2, SUCCESS, 0x8);
+	require_woken_with(1, SUCCESS, 0x8);
+	REQUIRE(Test_GetEventFlags(event) == 0xC);
+}
+
+static void test_free(OS_Event_t event)
+{
+	OS_Event_t other;
+	UINT32 flags;
+
+	printf("Testing the free of an event with waiters\n");
+
+	wait_blocked(4, event, 0x10, OS_EVENT_WAIT_ANY);
+	wait_blocked(1, event, 0x30, OS_EVENT_WAIT_ALL);
+	wait_blocked(3, event, 0x10, OS_EVENT_WAIT_ANY | OS_EVENT_AUTO_CLEAR);
+
+	// All the waiters are woken up with the error and without flags
+	Test_SetTask(POSTER);
+	REQUIRE(_OS_EventFree(event) == SUCCESS);
+	REQUIRE(Test_GetScheduleCount() == 1);
+	REQUIRE(Test_GetWaitResult(POSTER) == SUCCESS);
+
+	REQUIRE_WOKEN(3, 1, 4);
+	require_woken_with(3, RESOURCE_DELETED, 0);
+	require_woken_with(1, RESOURCE_DELETED, 0);
+	require_woken_with(4, RESOURCE_DELETED, 0);
+
+	// The handle can not be used after the free and it is given out again
+	REQUIRE(_OS_EventWait(event, 0x4, OS_EVENT_WAIT_ANY, &flags) == RESOURCE_NOT_OPEN);
+	REQUIRE(_OS_EventPost(event, 0x4) == RESOURCE_NOT_OPEN);
+	REQUIRE(_OS_EventFree(event) == RESOURCE_NOT_OPEN);
+
+	REQUIRE(_OS_EventAlloc(&other, 0) == SUCCESS);
+	REQUIRE(other == event);
+	REQUIRE(Test_GetEventFlags(other) == 0);
+	REQUIRE(_OS_EventFree(other) == SUCCESS);
+	REQUIRE(Test_GetScheduleCount() == 1);
+	REQUIRE_WOKEN();
+}
+
+int main(void)
+{
+	OS_Event_t event;
+
+	init_tasks();
+
+	event = test_args();
+	test_immediate(event);
+	test_any_all(event);
+	test_one_post(event);
+	test_free(event);
+	printf("Event tests passed\n");
+
+	return 0;
+}
@@ -0,0 +1,328 @@
+/**********************************************************************************
+ *
+ *						Copyright 2014 xxxxxxx, xxxxxxx
+ *	File:	main.c
+ *	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+ *	Description: Test program for the message queues (os_msgq.c)
+ *					Three processes use the queues. Process 0 creates them and
+ *					sends, process 1 opens them and receives and process 2 never
+ *					opens them. The tests check the arguments, the mapping of the
+ *					slots, the order of the messages, the ownership of the slots
+ *					and the wake up of a receiver that waited on an empty queue.
+ *					Then the cost of the kernel side of a message is measured.
+ *
+ *********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "msgq_test.h"
+
+#define REQUIRE(x) 	do { 																\
+						if(!(x)) {														\
+							printf("REQUIRE Failed in %s:%d: %s\n", __FUNCTION__, __LINE__, #x);	\
+							exit(1);													\
+						}																\
+					} while(0)
+
+#define SENDER					0
+#define RECEIVER				1
+#define STRANGER				2
+
+#define MSG_WORDS				15
+#define TEST_SLOT_COUNT			4
+#define BENCH_MSG_COUNT			10000000
+#define BENCH_SLOT_COUNT		64
+
+// The slots are a multiple of the cache line of 32 bytes on both targets
+#define TEST_SLOT_SIZE			64
+
+typedef struct
+{
+	UINT32 seq;
+	UINT32 payload[MSG_WORDS];		// payload[i] = seq ^ i
+
+} Test_Msg;
+
+static UINT64 now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static Test_Msg * alloc_msg(OS_MsgQueue_t queue, UINT32 seq)
+{
+	Test_Msg * msg;
+	UINT32 i;
+
+	REQUIRE(_OS_MsgQueueAlloc(queue, (void **) &msg) == SUCCESS);
+
+	msg->seq = seq;
+	for(i = 0; i < MSG_WORDS; i++) {
+		msg->payload[i] = seq ^ i;
+	}
+
+	return msg;
+}
+
+static void check_msg(const Test_Msg * msg, UINT32 seq)
+{
+	UINT32 i;
+
+	REQUIRE(msg->seq == seq);
+	for(i = 0; i < MSG_WORDS; i++) {
+		REQUIRE(msg->payload[i] == (seq ^ i));
+	}
+}
+
+static OS_MsgQueue_t test_create(void)
+{
+	OS_MsgQueue_t queue, other;
+	Test_Msg * msg[2];
+
+	Test_SetProcess(SENDER);
+
+	REQUIRE(_OS_MsgQueueCreate(NULL, sizeof(Test_Msg), TEST_SLOT_COUNT, &queue) == BAD_ARGUMENT);
+	REQUIRE(_OS_MsgQueueCreate("TEST", 0, TEST_SLOT_COUNT, &queue) == BAD_ARGUMENT);
+	REQUIRE(_OS_MsgQueueCreate("TEST", 0x100001, TEST_SLOT_COUNT, &queue) == BAD_ARGUMENT);
+	REQUIRE(_OS_MsgQueueCreate("TEST", sizeof(Test_Msg), 0, &queue) == BAD_ARGUMENT);
+	REQUIRE(_OS_MsgQueueCreate("TEST", sizeof(Test_Msg), 0x10000, &queue) == BAD_ARGUMENT);
+	REQUIRE(_OS_MsgQueueCreate("TEST", sizeof(Test_Msg), TEST_SLOT_COUNT, NULL) == BAD_ARGUMENT);
+
+	REQUIRE(_OS_MsgQueueCreate("TEST", sizeof(Test_Msg), TEST_SLOT_COUNT, &queue) == SUCCESS);
+	REQUIRE(_OS_MsgQueueCreate("TEST", sizeof(Test_Msg), TEST_SLOT_COUNT, &other) == RESOURCE_BUSY);
+
+	// The slots are in pages mapped into the creator with user access
+	REQUIRE(Test_GetMapCount(SENDER) == 1);
+	REQUIRE(_OS_MsgQueueAlloc(queue, (void **) &msg[0]) == SUCCESS);
+	REQUIRE(_OS_MsgQueueAlloc(queue, (void **) &msg[1]) == SUCCESS);
+	REQUIRE(((size_t) msg[0] & 0xFFF) == 0);
+	REQUIRE((UINT8 *) msg[1] - (UINT8 *) msg[0] == TEST_SLOT_SIZE);
+	REQUIRE(Test_IsMapped(SENDER, msg[0], TEST_SLOT_SIZE * TEST_SLOT_COUNT));
+	REQUIRE(!Test_IsMapped(RECEIVER, msg[0], TEST_SLOT_SIZE));
+	REQUIRE(_OS_MsgQueueRelease(queue, msg[0]) == SUCCESS);
+	REQUIRE(_OS_MsgQueueRelease(queue, msg[1]) == SUCCESS);
+
+	return queue;
+}
+
+static void test_open(OS_MsgQueue_t queue)
+{
+	OS_MsgQueue_t opened;
+	void * msg;
+
+	Test_SetProcess(RECEIVER);
+
+	REQUIRE(_OS_MsgQueueOpen(NULL, &opened) == BAD_ARGUMENT);
+	REQUIRE(_OS_MsgQueueOpen("TEST", NULL) == BAD_ARGUMENT);
+	REQUIRE(_OS_MsgQueueOpen("NONE", &opened) == RESOURCE_NOT_FOUND);
+
+	// The queue is mapped once into the process at the same address
+	REQUIRE(_OS_MsgQueueOpen("TEST", &opened) == SUCCESS);
+	REQUIRE(opened == queue);
+	REQUIRE(_OS_MsgQueueOpen("TEST", &opened) == SUCCESS);
+	REQUIRE(Test_GetMapCount(RECEIVER) == 1);
+
+	REQUIRE(_OS_MsgQueueAlloc(queue, &msg) == SUCCESS);
+	REQUIRE(Test_IsMapped(RECEIVER, msg, TEST_SLOT_SIZE));
+	REQUIRE(_OS_MsgQueueRelease(queue, msg) == SUCCESS);
+
+	// A process that did not open the queue gets no slot
+	Test_SetProcess(STRANGER);
+	REQUIRE(_OS_MsgQueueAlloc(queue, &msg) == RESOURCE_NOT_OWNED);
+	REQUIRE(_OS_MsgQueueReceive(queue, &msg) == RESOURCE_NOT_OWNED);
+	REQUIRE(Test_GetMapCount(STRANGER) == 0);
+
+	REQUIRE(_OS_MsgQueueAlloc(-1, &msg) == BAD_ARGUMENT);
+	REQUIRE(_OS_MsgQueueAlloc(queue - 1, &msg) == RESOURCE_NOT_OPEN);
+}
+
+// The messages come out in the order in which they were sent. The receiver reads
+// them in place, at the address where the sender wrote them
+static void test_order(OS_MsgQueue_t queue)
+{
+	Test_Msg * sent[TEST_SLOT_COUNT];
+	Test_Msg * msg;
+	UINT32 seq, i;
+
+	for(seq = 0; seq < 100; seq += TEST_SLOT_COUNT) {
+
+		Test_SetProcess(SENDER);
+		for(i = 0; i < TEST_SLOT_COUNT; i++) {
+			sent[i] = alloc_msg(queue, seq + i);
+			REQUIRE(_OS_MsgQueueSend(queue, sent[i]) == SUCCESS);
+		}
+
+		// All the slots are sent. The senders do not wait
+		REQUIRE(_OS_MsgQueueAlloc(queue, (void **) &msg) == RESOURCE_EXHAUSTED);
+
+		Test_SetProcess(RECEIVER);
+		for(i = 0; i < TEST_SLOT_COUNT; i++) {
+			REQUIRE(_OS_MsgQueueReceive(queue, (void **) &msg) == SUCCESS);
+			REQUIRE(msg == sent[i]);
+			check_msg(msg, seq + i);
+			REQUIRE(_OS_MsgQueueRelease(queue, msg) == SUCCESS);
+		}
+	}
+
+	// Nobody waited, so the scheduler was not called
+	REQUIRE(Test_GetScheduleCount() == 0);
+	REQUIRE(Test_GetBudgetUpdateCount() == 0);
+}
+
+// A slot can be sent only by the process that allocated it and released only by the
+// process that holds it
+static void test_ownership(OS_MsgQueue_t queue)
+{
+	Test_Msg * msg;
+	Test_Msg * received;
+
+	Test_SetProcess(SENDER);
+	msg = alloc_msg(queue, 0);
+
+	REQUIRE(_OS_MsgQueueSend(queue, NULL) == BAD_ARGUMENT);
+	REQUIRE(_OS_MsgQueueSend(queue, (UINT8 *) msg + 4) == BAD_ARGUMENT);
+	REQUIRE(_OS_MsgQueueSend(queue, (UINT8 *) msg + TEST_SLOT_SIZE * TEST_SLOT_COUNT) == BAD_ARGUMENT);
+	REQUIRE(_OS_MsgQueueRelease(queue, (UINT8 *) msg + 4) == BAD_ARGUMENT);
+
+	// Another process cannot send or release the allocated slot
+	Test_SetProcess(RECEIVER);
+	REQUIRE(_OS_MsgQueueSend(queue, msg) == RESOURCE_NOT_OWNED);
+	REQUIRE(_OS_MsgQueueRelease(queue, msg) == RESOURCE_NOT_OWNED);
+
+	// A sent slot belongs to nobody until it is received
+	Test_SetProcess(SENDER);
+	REQUIRE(_OS_MsgQueueSend(queue, msg) == SUCCESS);
+	REQUIRE(_OS_MsgQueueSend(queue, msg) == RESOURCE_NOT_OWNED);
+	REQUIRE(_OS_MsgQueueRelease(queue, msg) == RESOURCE_NOT_OWNED);
+
+	Test_SetProcess(RECEIVER);
+	REQUIRE(_OS_MsgQueueRelease(queue, msg) == RESOURCE_NOT_OWNED);
+	REQUIRE(_OS_MsgQueueReceive(queue, (void **) &received) == SUCCESS);
+	REQUIRE(received == msg);
+
+	// The received slot is held by the receiver. It cannot be sent again
+	REQUIRE(_OS_MsgQueueSend(queue, received) == RESOURCE_NOT_OWNED);
+	Test_SetProcess(SENDER);
+	REQUIRE(_OS_MsgQueueRelease(queue, received) == RESOURCE_NOT_OWNED);
+
+	Test_SetProcess(RECEIVER);
+	REQUIRE(_OS_MsgQueueRelease(queue, received) == SUCCESS);
+	REQUIRE(_OS_MsgQueueRelease(queue, received) == RESOURCE_NOT_OWNED);
+
+	// An allocated slot that is not sent goes back to the free slots
+	Test_SetProcess(SENDER);
+	msg = alloc_msg(queue, 0);
+	REQUIRE(_OS_MsgQueueRelease(queue, msg) == SUCCESS);
+	REQUIRE(_OS_MsgQueueSend(queue, msg) == RESOURCE_NOT_OWNED);
+}
+
+// A receiver on an empty queue waits. The send wakes it up through the scheduler and
+// it takes the message when it tries again
+static void test_wait(OS_MsgQueue_t queue)
+{
+	Test_Msg * msg;
+	Test_Msg * sent;
+
+	Test_SetProcess(RECEIVER);
+	REQUIRE(_OS_MsgQueueReceive(queue, (void **) &msg) == NO_DATA);
+	REQUIRE(Test_GetSyscallResult(RECEIVER) == NO_DATA);
+	REQUIRE(Test_GetWaiterCount() == 1);
+	REQUIRE(Test_GetScheduleCount() == 1);
+	REQUIRE(Test_GetBudgetUpdateCount() == 1);
+
+	Test_SetProcess(SENDER);
+	sent = alloc_msg(queue, 7);
+	REQUIRE(_OS_MsgQueueSend(queue, sent) == SUCCESS);
+	REQUIRE(Test_GetWaiterCount() == 0);
+	REQUIRE(Test_GetScheduleCount() == 1);
+	REQUIRE(Test_GetBudgetUpdateCount() == 1);
+	REQUIRE(Test_GetSyscallResult(SENDER) == SUCCESS);
+
+	// The next send finds nobody waiting and does not go through the scheduler
+	REQUIRE(_OS_MsgQueueSend(queue, alloc_msg(queue, 8)) == SUCCESS);
+	REQUIRE(Test_GetScheduleCount() == 0);
+	REQUIRE(Test_GetBudgetUpdateCount() == 0);
+
+	Test_SetProcess(RECEIVER);
+	REQUIRE(_OS_MsgQueueReceive(queue, (void **) &msg) == SUCCESS);
+	REQUIRE(msg == sent);
+	check_msg(msg, 7);
+	REQUIRE(_OS_MsgQueueRelease(queue, msg) == SUCCESS);
+	REQUIRE(_OS_MsgQueueReceive(queue, (void **) &msg) == SUCCESS);
+	check_msg(msg, 8);
+	REQUIRE(_OS_MsgQueueRelease(queue, msg) == SUCCESS);
+}
+
+// The pool has room for MAX_MSGQ_COUNT queues
+static void test_pool(void)
+{
+	OS_MsgQueue_t queue;
+	INT8 name[8];
+	UINT32 count = 0;
+
+	Test_SetProcess(SENDER);
+
+	do {
+		snprintf(name, sizeof(name), "Q%u", count++);
+	} while(_OS_MsgQueueCreate(name, sizeof(UINT32), 1, &queue) == SUCCESS);
+
+	REQUIRE(_OS_MsgQueueCreate("LAST", sizeof(UINT32), 1, &queue) == RESOURCE_EXHAUSTED);
+	printf("  %u more queues created\n", count - 1);
+}
+
+// The kernel side of a message: alloc, send, receive and release. On the target each
+// of them is a system call, and a send and a receive in two processes also switch the
+// process. So this is only a bound of what the kernel book keeping costs
+static void test_rate(void)
+{
+	OS_MsgQueue_t queue;
+	Test_Msg * msg;
+	UINT64 start, elapsed;
+	UINT32 seq;
+
+	Test_SetProcess(SENDER);
+	REQUIRE(_OS_MsgQueueCreate("BENCH", sizeof(Test_Msg), BENCH_SLOT_COUNT, &queue) == SUCCESS);
+	Test_SetProcess(RECEIVER);
+	REQUIRE(_OS_MsgQueueOpen("BENCH", &queue) == SUCCESS);
+
+	start = now_ns();
+	for(seq = 0; seq < BENCH_MSG_COUNT; seq++) {
+
+		Test_SetProcess(SENDER);
+		REQUIRE(_OS_MsgQueueAlloc(queue, (void **) &msg) == SUCCESS);
+		msg->seq = seq;
+		REQUIRE(_OS_MsgQueueSend(queue, msg) == SUCCESS);
+
+		Test_SetProcess(RECEIVER);
+		REQUIRE(_OS_MsgQueueReceive(queue, (void **) &msg) == SUCCESS);
+		REQUIRE(msg->seq == seq);
+		REQUIRE(_OS_MsgQueueRelease(queue, msg) == SUCCESS);
+	}
+	elapsed = now_ns() - start;
+
+	printf("  %u messages: %.1f ns/msg, %.1f M msgs/s for the kernel book keeping on the host\n",
+		BENCH_MSG_COUNT, (double) elapsed / BENCH_MSG_COUNT, BENCH_MSG_COUNT * 1000.0 / elapsed);
+}
+
+int main(void)
+{
+	OS_MsgQueue_t queue;
+
+	Test_Init();
+
+	queue = test_create();
+	test_open(queue);
+	test_order(queue);
+	test_ownership(queue);
+	test_wait(queue);
+	printf("Message queue tests passed\n");
+
+	test_rate();
+	test_pool();
+	printf("Rate and pool tests passed\n");
+
+	return 0;
+}
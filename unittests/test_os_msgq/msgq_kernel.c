@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	msgq_kernel.c
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Builds the message queues for the host against stubs
+//					The semaphore only keeps the waiting tasks in a list and the
+//					scheduler only counts its calls. The user pages and the kernel
+//					heap come from a static pool. The MMU map is noted down for
+//					each process so that the test can check it.
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#include "os_msgq.c"		// Directly include the source file for the message queues
+
+#include "msgq_test.h"
+
+#define TEST_POOL_SIZE			0x100000
+#define TEST_MAX_MAPS			16
+#define TEST_MAX_WAITERS		TEST_PROCESS_COUNT
+
+typedef struct
+{
+	VADDR va;
+	UINT32 size;
+	_MMU_PTE_AccessPermission access;
+
+} Test_Map;
+
+///////////////////////////////////////////////////////////////////////////////
+// Global Data
+///////////////////////////////////////////////////////////////////////////////
+OS_Process g_process_pool[MAX_PROCESS_COUNT];
+OS_Process * g_current_process;
+OS_Process * g_kernel_process = &g_process_pool[MAX_PROCESS_COUNT - 1];
+OS_Task * g_current_task;
+UINT32 g_sched_starting_counter_value;
+
+static OS_Task g_test_task[TEST_PROCESS_COUNT];
+static UINT32 g_test_syscall_result[TEST_PROCESS_COUNT][1];
+static _MMU_L1_PageTable g_test_ptable[TEST_PROCESS_COUNT];
+static Test_Map g_test_map[TEST_PROCESS_COUNT][TEST_MAX_MAPS];
+static UINT32 g_test_map_count[TEST_PROCESS_COUNT];
+
+static UINT8 g_test_pool[TEST_POOL_SIZE] __attribute__ ((aligned (0x1000)));
+static UINT32 g_test_pool_used;
+
+static UINT32 g_test_sem_count;
+static OS_Task * g_test_waiter[TEST_MAX_WAITERS];
+static UINT32 g_test_waiter_count;
+static UINT32 g_test_schedule_count;
+static UINT32 g_test_budget_update_count;
+
+///////////////////////////////////////////////////////////////////////////////
+// Memory stubs
+///////////////////////////////////////////////////////////////////////////////
+static void * AllocFromPool(UINT32 size, UINT32 align)
+{
+	UINT32 start = (g_test_pool_used + align - 1) & ~(align - 1);
+
+	if(start + size > TEST_POOL_SIZE) return NULL;
+
+	g_test_pool_used = start + size;
+	return &g_test_pool[start];
+}
+
+void * kmalloc(UINT32 size)
+{
+	return AllocFromPool(size, sizeof(UINTPTR));
+}
+
+void * _OS_AllocUserPages(UINT32 size)
+{
+	return AllocFromPool(size, 0x1000);
+}
+
+OS_Return KERNEL_VA_TO_PA_MAP_FUNCTION(_MMU_L1_PageTable * ptable, VADDR va, PADDR pa, 
+								UINT32 size, _MMU_PTE_AccessPermission access,
+								BOOL cache_enable, BOOL write_buffer, BOOL global)
+{
+	UINT32 process = ptable - g_test_ptable;
+	Test_Map * map;
+
+	if((process >= TEST_PROCESS_COUNT) || (va != pa) || global ||
+		(g_test_map_count[process] >= TEST_MAX_MAPS)) {
+		return BAD_ARGUMENT;
+	}
+
+	map = &g_test_map[process][g_test_map_count[process]++];
+	map->va = va;
+	map->size = size;
+	map->access = access;
+
+	return SUCCESS;
+}
+
+#if ENABLE_MMU_ASID==1
+void _sysctl_flush_tlb_asid(UINT32 asid) { }
+#else
+void _sysctl_flush_tlb(void) { }
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Semaphore & scheduler stubs
+///////////////////////////////////////////////////////////////////////////////
+OS_Return _OS_SemKernelAlloc(OS_Sem_t *sem)
+{
+	*sem = (OS_Sem_t) g_test_sem_count++;
+	return SUCCESS;
+}
+
+void _OS_SemKernelWait(OS_Sem_t sem)
+{
+	_OS_UpdateCurrentTaskBudget();
+	g_test_waiter[g_test_waiter_count++] = g_current_task;
+}
+
+OS_Task * _OS_SemKernelWake(OS_Sem_t sem)
+{
+	OS_Task * task;
+	UINT32 i;
+
+	if(!g_test_waiter_count) return NULL;
+
+	task = g_test_waiter[0];
+	for(i = 1; i < g_test_waiter_count; i++) {
+		g_test_waiter[i - 1] = g_test_waiter[i];
+	}
+	g_test_waiter_count--;
+
+	return task;
+}
+
+void _OS_UpdateCurrentTaskBudget()
+{
+	g_test_budget_update_count++;
+}
+
+void _OS_Schedule()
+{
+	g_test_schedule_count++;
+}
+
+UINT32 _OS_Timer_GetCount(UINT32 timer)
+{
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Resource allocation functions from util.c
+///////////////////////////////////////////////////////////////////////////////
+INT32 GetFreeResIndex(UINT32 res_mask[], INT32 res_count)
+{
+	// Get the number of 32 bit words
+	INT32 count = (res_count + 31) >> 5;
+	INT32 free_res_index = -1;
+	INT32 i;
+
+	for(i = 0; i < count; i++)
+	{
+		if(~res_mask[i])
+		{
+			free_res_index = (i << 5) + (31 - __builtin_clz(~res_mask[i]));
+		}
+	}
+
+	return (free_res_index < res_count) ? free_res_index : -1;
+}
+
+void SetResourceStatus(UINT32 res_mask[], INT32 res_index, BOOL free)
+{
+	if(free)
+	{
+		res_mask[res_index >> 5] &= ~(1 << (res_index & 0x1f));
+	}
+	else
+	{
+		res_mask[res_index >> 5] |= (1 << (res_index & 0x1f));
+	}
+}
+
+BOOL IsResourceBusy(UINT32 res_mask[], INT32 res_index)
+{
+	return (res_mask[res_index >> 5] & (1 << (res_index & 0x1f)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Test interface
+///////////////////////////////////////////////////////////////////////////////
+void Test_Init(void)
+{
+	// The bits past MAX_MSGQ_COUNT are marked busy as in _OS_InitFreeResources
+	if(MAX_MSGQ_COUNT & 0x1f) {
+		g_msgq_usage_mask[((MAX_MSGQ_COUNT + 31) >> 5) - 1] |= ~((1u << (MAX_MSGQ_COUNT & 0x1f)) - 1);
+	}
+}
+
+void Test_SetProcess(UINT32 process)
+{
+	OS_Task * task = &g_test_task[process];
+
+	g_process_pool[process].ptable = &g_test_ptable[process];
+	task->syscall_result = g_test_syscall_result[process];
+	task->owner_process = &g_process_pool[process];
+
+	g_current_process = &g_process_pool[process];
+	g_current_task = task;
+}
+
+OS_Return Test_GetSyscallResult(UINT32 process)
+{
+	return (OS_Return) g_test_syscall_result[process][0];
+}
+
+UINT32 Test_GetWaiterCount(void)
+{
+	return g_test_waiter_count;
+}
+
+UINT32 Test_GetScheduleCount(void)
+{
+	UINT32 count = g_test_schedule_count;
+	g_test_schedule_count = 0;
+	return count;
+}
+
+UINT32 Test_GetBudgetUpdateCount(void)
+{
+	UINT32 count = g_test_budget_update_count;
+	g_test_budget_update_count = 0;
+	return count;
+}
+
+BOOL Test_IsMapped(UINT32 process, const void * va, UINT32 size)
+{
+	Test_Map * map;
+	UINT32 i;
+
+	for(i = 0; i < g_test_map_count[process]; i++) {
+
+		map = &g_test_map[process][i];
+		if(((VADDR) va >= map->va) && ((VADDR) va + size <= map->va + map->size) &&
+			(map->access == KERNEL_RW_USER_RW)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+UINT32 Test_GetMapCount(UINT32 process)
+{
+	return g_test_map_count[process];
+}
@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+//	
+//						Copyright 2014 xxxxxxx, xxxxxxx
+//	File:	msgq_test.h
+//	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+//	Description: Interface between the message queue test and the kernel code
+//					The kernel headers conflict with the host stdio headers. So
+//					the test gets the types and the error codes from the user API
+//					and the message queue functions are declared again here.
+//	
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _MSGQ_TEST_H
+#define _MSGQ_TEST_H
+
+// The kernel side has them from the kernel headers
+#ifndef _OS_CORE_H
+#include "os_api.h"
+#endif
+
+#define TEST_PROCESS_COUNT		3
+
+OS_Return _OS_MsgQueueCreate(const INT8 * name, UINT32 msg_size, UINT32 msg_count, OS_MsgQueue_t * queue);
+OS_Return _OS_MsgQueueOpen(const INT8 * name, OS_MsgQueue_t * queue);
+OS_Return _OS_MsgQueueAlloc(OS_MsgQueue_t queue, void ** msg);
+OS_Return _OS_MsgQueueSend(OS_MsgQueue_t queue, const void * msg);
+OS_Return _OS_MsgQueueReceive(OS_MsgQueue_t queue, void ** msg);
+OS_Return _OS_MsgQueueRelease(OS_MsgQueue_t queue, const void * msg);
+
+// Sets up the free resources like the kernel initialization
+void Test_Init(void);
+
+// Makes the task of the process the current one. The kernel calls are made for it
+void Test_SetProcess(UINT32 process);
+
+// The result that the kernel left for the task of the process when it went through
+// the scheduler
+OS_Return Test_GetSyscallResult(UINT32 process);
+
+// Tasks waiting on the receivers semaphore of the queues
+UINT32 Test_GetWaiterCount(void);
+
+// Calls to the scheduler since the last call
+UINT32 Test_GetScheduleCount(void);
+
+// Updates of the budget of the current task since the last call
+UINT32 Test_GetBudgetUpdateCount(void);
+
+// Returns TRUE if [va, va + size) is mapped in the process with user access
+BOOL Test_IsMapped(UINT32 process, const void * va, UINT32 size);
+
+// Number of times that the pages of a queue were mapped into the process
+UINT32 Test_GetMapCount(UINT32 process);
+
+#endif // _MSGQ_TEST_H
@@ -4,7 +4,7 @@
  *	File:	Makefile
  *	Author:	Bala B. (bhat.balasubramanya@gmail.com)
  *	Description: Test program for os_queue
- *					This test is written to run on Mac
+ *					The Makefile builds it once for each OS_PQUEUE_BACKEND
  *
  *********************************************************************************/
  
@@ -14,17 +14,25 @@
 
 #define ASSERT(x) 	do { 																\
 						if(!(x)) {														\
-							printf("ASSERT Failed in " __FUNCTION__ ":" #x "\n");		\
-							exit(0);													\
+							printf("ASSERT Failed in %s:" #x "\n", __FUNCTION__);		\
+							exit(1);													\
 						}																\
 					} while(0);
 
 #define REQUIRE(x) 	do { 																\
 						if(!(x)) {														\
-							printf("ASSERT Failed in " __FUNCTION__ ":" #x "\n");		\
-							exit(0);													\
+							printf("ASSERT Failed in %s:" #x "\n", __FUNCTION__);		\
+							exit(1);													\
 						}																\
 					} while(0);
+
+// Select the backend given on the command line instead of the one in os_config.h
+#include "os_config.h"
+#undef OS_PQUEUE_BACKEND
+#define OS_PQUEUE_BACKEND	TEST_PQUEUE_BACKEND
+
+// os_queue.c only needs ASSERT from os_core.h. Skip the rest of the kernel headers
+#define _OS_CORE_H
 					
 #include "os_queue.c"		// Directly include the source file for os_queue
 
@@ -39,6 +47,13 @@ BOOL alloc_nodes(_OS_Queue *npq, _OS_Queue *pq, UINT32 num_nodes);
 void dealloc_nodes(_OS_Queue *npq, _OS_Queue *pq, UINT32 num_nodes);
 void dealloc_nodes_2(_OS_Queue *npq, _OS_Queue *pq, UINT32 num_nodes);
 void validate_pqueue(_OS_Queue *pq);
+void test_batch_insert(UINT32 queue_nodes, UINT32 batch_nodes);
+void test_bitmap_queue(UINT32 num_nodes);
+void test_np_sorted_insert(UINT32 num_nodes);
+void validate_bitmap_queue(_OS_BitmapQueue *bq);
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+UINT32 validate_heap_node(_OS_HybridQNode *parent, _OS_HybridQNode *node);
+#endif
 
 typedef struct Test_QNode
 {	
@@ -49,12 +64,19 @@ typedef struct Test_QNode
 
 _OS_Queue npq;
 _OS_Queue pq;
+_OS_BitmapQueue bq;
 
 int main(void)
 {
 	_OS_QueueInit(&npq);
 	_OS_QueueInit(&pq);
 	
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+	printf("Backend: pairing heap\n");
+#else
+	printf("Backend: sorted list\n");
+#endif
+
 	srand(time(NULL));
 	
 	alloc_nodes(&npq, &pq, 100);
@@ -72,6 +94,15 @@ int main(void)
 	dealloc_nodes_2(&npq, &pq, 300);
 	validate_pqueue(&pq);
 	
+	test_batch_insert(0, 50);
+	test_batch_insert(100, 1);
+	test_batch_insert(100, 64);
+	
+	test_bitmap_queue(300);
+	
+	test_np_sorted_insert(1);
+	test_np_sorted_insert(300);
+	
 	return 0;
 }
 
@@ -157,10 +188,21 @@ void validate_pqueue(_OS_Queue *pq)
 {
 	_OS_HybridQNode *node;
 	UINT32 count = 0;
+#if OS_PQUEUE_BACKEND!=OS_PQUEUE_PAIRING_HEAP
 	UINT64 key;
+#endif
 	
 	ASSERT(pq);	
 	
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+	node = pq->head;
+	if(node)
+	{
+		REQUIRE(node->p_prev == NULL);
+		REQUIRE(node->p_next == NULL);
+		count = validate_heap_node(NULL, node);
+	}
+#else
 	node = pq->head;
 	if(node)
 	{
@@ -174,9 +216,206 @@ void validate_pqueue(_OS_Queue *pq)
 		} 
 		while(node);
 	}
+#endif
 	
 	// Validate the count
 	REQUIRE(count == pq->count);
 	
 	printf("Validated PQ (count %d)\n", count);
 }
+
+#if OS_PQUEUE_BACKEND==OS_PQUEUE_PAIRING_HEAP
+// Validates the heap order and the sibling links of the subtree at 'node'. 
+// Returns the number of nodes in the subtree
+UINT32 validate_heap_node(_OS_HybridQNode *parent, _OS_HybridQNode *node)
+{
+	_OS_HybridQNode *child, *prev;
+	UINT32 count = 1;
+	
+	if(parent) 
+	{
+		REQUIRE(parent->key <= node->key);
+	}
+	
+	prev = node;
+	for(child = node->p_child; child; child = child->p_next)
+	{
+		// The first child points back to the parent, others to the previous sibling
+		REQUIRE(child->p_prev == prev);
+		count += validate_heap_node(node, child);
+		prev = child;
+	}
+	
+	return count;
+}
+#endif
+
+// Inserts a batch of nodes into a queue of nodes with random keys. The keys should
+// come out in increasing order and equal keys in the order of insertion, the nodes
+// in the queue first and then the batch in the order of the list
+void test_batch_insert(UINT32 queue_nodes, UINT32 batch_nodes)
+{
+	Test_QNode *nodes = (Test_QNode *) calloc(queue_nodes + batch_nodes, sizeof(Test_QNode));
+	_OS_HybridQNode *batch = NULL;
+	Test_QNode *node;
+	UINT32 i, value = 0;
+	UINT64 key = 0;
+	
+	ASSERT(nodes);
+	
+	_OS_QueueInit(&pq);
+	for(i = 0; i < queue_nodes; i++)
+	{
+		nodes[i].value = i;
+		_OS_PQueueInsertWithKey(&pq, (_OS_HybridQNode *)&nodes[i], rand() % 50);
+	}
+	
+	// Link the batch in the reverse order through p_next
+	for(i = queue_nodes + batch_nodes; i > queue_nodes; i--)
+	{
+		node = &nodes[i - 1];
+		node->value = i - 1;
+		node->qp.key = rand() % 50;
+		node->qp.p_next = batch;
+		batch = (_OS_HybridQNode *)node;
+	}
+	
+	_OS_PQueueInsertBatch(&pq, batch);
+	validate_pqueue(&pq);
+	REQUIRE(pq.count == queue_nodes + batch_nodes);
+	
+	while(_OS_QueuePeek(&pq, NULL))
+	{
+		_OS_PQueueGet(&pq, (_OS_HybridQNode **)&node);
+		REQUIRE((key < node->qp.key) || ((key == node->qp.key) && (value <= node->value)));
+		key = node->qp.key;
+		value = node->value;
+	}
+	REQUIRE(pq.count == 0);
+	
+	free(nodes);
+	printf("Validated batch insertion (%d + %d)\n", queue_nodes, batch_nodes);
+}
+
+// Inserts nodes with random keys into the bitmap queue, deletes every other node 
+// from the middle of the lists and gets the rest in the order of the keys
+void test_bitmap_queue(UINT32 num_nodes)
+{
+	Test_QNode *nodes = (Test_QNode *) calloc(num_nodes, sizeof(Test_QNode));
+	Test_QNode *node;
+	UINT32 i, key = 0, value = 0;
+	
+	ASSERT(nodes);
+	
+	_OS_BitmapQueueInit(&bq);
+	validate_bitmap_queue(&bq);
+	REQUIRE(!_OS_BitmapQueuePeek(&bq, NULL));
+	
+	for(i = 0; i < num_nodes; i++)
+	{
+		nodes[i].value = i;
+		_OS_BitmapQueueInsert(&bq, (_OS_HybridQNode *)&nodes[i], rand() % OS_BITMAP_QUEUE_LEVELS);
+	}
+	validate_bitmap_queue(&bq);
+	
+	for(i = 0; i < num_nodes; i += 2)
+	{
+		REQUIRE(_OS_BitmapQueueDelete(&bq, (_OS_HybridQNode *)&nodes[i]));
+	}
+	validate_bitmap_queue(&bq);
+	REQUIRE(bq.count == num_nodes / 2);
+	
+	// The keys should be in increasing order and equal keys in the order of insertion
+	while(_OS_BitmapQueuePeek(&bq, NULL))
+	{
+		_OS_BitmapQueueGet(&bq, (_OS_HybridQNode **)&node);
+		REQUIRE(node->value & 1);
+		REQUIRE((key < node->qp.key) || ((key == node->qp.key) && (value < node->value)));
+		key = node->qp.key;
+		value = node->value;
+	}
+	validate_bitmap_queue(&bq);
+	REQUIRE(bq.count == 0);
+	
+	free(nodes);
+	printf("Validated bitmap queue\n");
+}
+
+// Checks that the bitmap matches the lists and the list links are consistent
+void validate_bitmap_queue(_OS_BitmapQueue *bq)
+{
+	_OS_HybridQNode *node, *prev;
+	UINT32 level, count = 0;
+	BOOL busy;
+	
+	for(level = 0; level < OS_BITMAP_QUEUE_LEVELS; level++)
+	{
+		busy = (bq->level_map[level >> 5] & (0x80000000 >> (level & 0x1f))) ? TRUE : FALSE;
+		REQUIRE(busy == (bq->head[level] != NULL));
+		
+		if(bq->level_map[level >> 5]) 
+		{
+			REQUIRE(bq->group_map & (0x80000000 >> (level >> 5)));
+		}
+		else
+		{
+			REQUIRE(!(bq->group_map & (0x80000000 >> (level >> 5))));
+		}
+		
+		prev = NULL;
+		for(node = bq->head[level]; node; node = node->p_next)
+		{
+			REQUIRE(node->key == level);
+			if(prev) REQUIRE(node->p_prev == prev);
+			prev = node;
+			count++;
+		}
+		
+		// The p_prev of the head is the tail
+		if(prev) REQUIRE(bq->head[level]->p_prev == prev);
+	}
+	
+	REQUIRE(count == bq->count);
+}
+
+// Inserts nodes with random keys into the non-priority queue in the order of the keys,
+// deletes every third node and gets the rest. The keys should come out in increasing
+// order and equal keys in the order of insertion
+void test_np_sorted_insert(UINT32 num_nodes)
+{
+	Test_QNode *nodes = (Test_QNode *) calloc(num_nodes, sizeof(Test_QNode));
+	Test_QNode *node;
+	UINT32 i, value = 0;
+	UINT64 key = 0;
+	
+	ASSERT(nodes);
+	
+	_OS_QueueInit(&npq);
+	for(i = 0; i < num_nodes; i++)
+	{
+		nodes[i].value = i;
+		nodes[i].qp.key = rand() % 50;
+		_OS_NPQueueInsertSorted(&npq, (_OS_HybridQNode *)&nodes[i]);
+	}
+	REQUIRE(npq.count == num_nodes);
+	
+	for(i = 0; i < num_nodes; i += 3)
+	{
+		REQUIRE(_OS_NPQueueDelete(&npq, (_OS_HybridQNode *)&nodes[i]));
+	}
+	REQUIRE(npq.count == num_nodes - (num_nodes + 2) / 3);
+	
+	while(_OS_QueuePeek(&npq, NULL))
+	{
+		_OS_NPQueueGet(&npq, (_OS_HybridQNode **)&node);
+		REQUIRE(node->value != 3 * (node->value / 3));
+		REQUIRE((key < node->qp.key) || ((key == node->qp.key) && (value <= node->value)));
+		REQUIRE(!npq.head || !npq.head->np_prev);
+		key = node->qp.key;
+		value = node->value;
+	}
+	REQUIRE(npq.count == 0 && !npq.tail);
+	
+	free(nodes);
+	printf("Validated sorted non-priority insertion (%d)\n", num_nodes);
+}
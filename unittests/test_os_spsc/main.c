@@ -0,0 +1,227 @@
+/**********************************************************************************
+ *
+ *						Copyright 2014 xxxxxxx, xxxxxxx
+ *	File:	main.c
+ *	Author:	Bala B. (bhat.balasubramanya@gmail.com)
+ *	Description: Test program for the SPSC ring (os_spsc.h)
+ *					The single thread tests check the full / empty cases and the
+ *					wrap around of the indices. Then a producer and a consumer
+ *					thread pass messages through the ring. The consumer checks
+ *					the order and the contents and the rate is printed.
+ *
+ *********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "os_spsc.h"
+
+#define REQUIRE(x) 	do { 																\
+						if(!(x)) {														\
+							printf("REQUIRE Failed in %s:%d: %s\n", __FUNCTION__, __LINE__, #x);	\
+							exit(1);													\
+						}																\
+					} while(0)
+
+#define MSG_WORDS				7
+#define THREAD_MSG_COUNT		10000000
+#define THREAD_SLOT_COUNT		256
+
+typedef struct
+{
+	UINT32 seq;
+	UINT32 payload[MSG_WORDS];		// payload[i] = seq * (i + 1)
+
+} Test_Msg;
+
+static UINT64 now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static OS_SpscRing * alloc_ring(UINT32 slot_size, UINT32 slot_count)
+{
+	void * mem = NULL;
+
+	REQUIRE(posix_memalign(&mem, OS_SPSC_CACHE_LINE, OS_SPSC_RING_SIZE(slot_size, slot_count)) == 0);
+
+	return (OS_SpscRing *) mem;
+}
+
+static void test_layout(void)
+{
+	OS_SpscRing ring;
+
+	// The indices are not in the same cache line
+	REQUIRE(sizeof(OS_SpscRing) % OS_SPSC_CACHE_LINE == 0);
+	REQUIRE(((UINT8 *)&ring.tail - (UINT8 *)&ring.head) >= OS_SPSC_CACHE_LINE);
+	REQUIRE(((UINT8 *)&ring.mask - (UINT8 *)&ring.tail) >= OS_SPSC_CACHE_LINE);
+}
+
+static void test_init(void)
+{
+	OS_SpscRing * ring = alloc_ring(sizeof(UINT32), 8);
+
+	REQUIRE(OS_SpscInit(NULL, sizeof(UINT32), 8) == BAD_ARGUMENT);
+	REQUIRE(OS_SpscInit(ring, 0, 8) == BAD_ARGUMENT);
+	REQUIRE(OS_SpscInit(ring, sizeof(UINT32), 0) == BAD_ARGUMENT);
+	REQUIRE(OS_SpscInit(ring, sizeof(UINT32), 6) == BAD_ARGUMENT);
+	REQUIRE(OS_SpscInit((OS_SpscRing *)((UINT8 *) ring + 4), sizeof(UINT32), 8) == BAD_ARGUMENT);
+
+	REQUIRE(OS_SpscInit(ring, sizeof(UINT32), 8) == SUCCESS);
+	REQUIRE(OS_SpscCount(ring) == 0);
+	REQUIRE(OS_SpscPeek(ring) == NULL);
+
+	// The slots are word aligned
+	REQUIRE(OS_SpscInit(ring, 1, 8) == SUCCESS);
+	REQUIRE(ring->slot_size == 4);
+
+	free(ring);
+}
+
+static void test_full_empty(UINT32 start)
+{
+	const UINT32 count = 8;
+	OS_SpscRing * ring = alloc_ring(sizeof(UINT32), count);
+	UINT32 * slot;
+	UINT32 i, round;
+
+	REQUIRE(OS_SpscInit(ring, sizeof(UINT32), count) == SUCCESS);
+
+	// Start the indices at any value, to wrap around the 32 bits
+	ring->head = ring->tail = ring->tail_copy = ring->head_copy = start;
+
+	for(round = 0; round < 4; round++)
+	{
+		for(i = 0; i < count; i++)
+		{
+			slot = (UINT32 *) OS_SpscReserve(ring);
+			REQUIRE(slot != NULL);
+
+			// Reserving again without a commit gives the same slot
+			REQUIRE(OS_SpscReserve(ring) == slot);
+
+			*slot = round * count + i;
+			OS_SpscCommit(ring);
+			REQUIRE(OS_SpscCount(ring) == i + 1);
+		}
+
+		// Full
+		REQUIRE(OS_SpscReserve(ring) == NULL);
+
+		// Free one slot and fill it again
+		slot = (UINT32 *) OS_SpscPeek(ring);
+		REQUIRE(slot && *slot == round * count);
+		OS_SpscRelease(ring);
+
+		slot = (UINT32 *) OS_SpscReserve(ring);
+		REQUIRE(slot != NULL);
+		*slot = round * count + count;
+		OS_SpscCommit(ring);
+		REQUIRE(OS_SpscReserve(ring) == NULL);
+
+		for(i = 1; i <= count; i++)
+		{
+			slot = (UINT32 *) OS_SpscPeek(ring);
+			REQUIRE(slot && *slot == round * count + i);
+			OS_SpscRelease(ring);
+		}
+
+		// Empty
+		REQUIRE(OS_SpscPeek(ring) == NULL);
+		REQUIRE(OS_SpscCount(ring) == 0);
+	}
+
+	free(ring);
+}
+
+static void * producer_thread(void * arg)
+{
+	OS_SpscRing * ring = (OS_SpscRing *) arg;
+	Test_Msg * msg;
+	UINT32 seq, i;
+
+	for(seq = 0; seq < THREAD_MSG_COUNT; seq++)
+	{
+		// A task would wait for its next job or yield here
+		while(!(msg = (Test_Msg *) OS_SpscReserve(ring)))
+			sched_yield();
+
+		msg->seq = seq;
+		for(i = 0; i < MSG_WORDS; i++)
+		{
+			msg->payload[i] = seq * (i + 1);
+		}
+
+		OS_SpscCommit(ring);
+	}
+
+	return NULL;
+}
+
+static void * consumer_thread(void * arg)
+{
+	OS_SpscRing * ring = (OS_SpscRing *) arg;
+	const Test_Msg * msg;
+	UINT32 seq, i;
+
+	for(seq = 0; seq < THREAD_MSG_COUNT; seq++)
+	{
+		while(!(msg = (const Test_Msg *) OS_SpscPeek(ring)))
+			sched_yield();
+
+		REQUIRE(msg->seq == seq);
+		for(i = 0; i < MSG_WORDS; i++)
+		{
+			REQUIRE(msg->payload[i] == seq * (i + 1));
+		}
+
+		OS_SpscRelease(ring);
+	}
+
+	return NULL;
+}
+
+static void test_threads(void)
+{
+	OS_SpscRing * ring = alloc_ring(sizeof(Test_Msg), THREAD_SLOT_COUNT);
+	pthread_t producer, consumer;
+	UINT64 start, elapsed;
+
+	REQUIRE(OS_SpscInit(ring, sizeof(Test_Msg), THREAD_SLOT_COUNT) == SUCCESS);
+
+	start = now_ns();
+	REQUIRE(pthread_create(&consumer, NULL, consumer_thread, ring) == 0);
+	REQUIRE(pthread_create(&producer, NULL, producer_thread, ring) == 0);
+	pthread_join(producer, NULL);
+	pthread_join(consumer, NULL);
+	elapsed = now_ns() - start;
+
+	REQUIRE(OS_SpscCount(ring) == 0);
+
+	printf("  %u messages of %u bytes: %.1f ns/msg, %.1f M msgs/s\n",
+		THREAD_MSG_COUNT, (UINT32) sizeof(Test_Msg), (double) elapsed / THREAD_MSG_COUNT,
+		THREAD_MSG_COUNT * 1000.0 / elapsed);
+
+	free(ring);
+}
+
+int main(void)
+{
+	test_layout();
+	test_init();
+	test_full_empty(0);
+	test_full_empty(0xFFFFFFFC);
+	printf("Single thread tests passed\n");
+	fflush(stdout);
+
+	test_threads();
+	printf("Producer / consumer test passed\n");
+
+	return 0;
+}